@@ -20,6 +20,7 @@
 #include "transactions/TransactionUtils.h"
 #include "util/GlobalChecks.h"
 #include <Tracy.hpp>
+#include <chrono>
 #include <fmt/format.h>
 
 namespace stellar
@@ -402,11 +403,14 @@ ApplyBucketsWork::advance(std::string const& bucketName,
     ZoneScoped;
     releaseAssert(applicator);
     releaseAssert(mTotalSize != 0);
+    auto start = std::chrono::steady_clock::now();
     auto sz = applicator.advance(mCounters);
+    auto duration = std::chrono::steady_clock::now() - start;
     mAppliedEntries += sz;
     mCounters.logDebug(bucketName, mLevel, mApp.getClock().now());
 
     auto log = false;
+    auto appliedSize = mAppliedSize;
     if (applicator)
     {
         mAppliedSize += (applicator.pos() - mLastPos);
@@ -421,6 +425,9 @@ ApplyBucketsWork::advance(std::string const& bucketName,
         mCounters.logInfo(bucketName, mLevel, mApp.getClock().now());
         mCounters.reset(mApp.getClock().now());
     }
+    mApp.getCatchupManager().getPerformanceReport().record(
+        CatchupPerformanceReport::Stage::APPLY_BUCKETS, duration,
+        mAppliedSize - appliedSize, sz);
 
     auto appliedSizeMb = mAppliedSize / 1024 / 1024;
     if (appliedSizeMb > mLastAppliedSizeMb)
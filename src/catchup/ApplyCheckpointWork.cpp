@@ -6,6 +6,8 @@
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "catchup/ApplyLedgerWork.h"
+#include "herder/Herder.h"
+#include "herder/TxFrameInternTable.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryManager.h"
 #include "historywork/Progress.h"
@@ -20,6 +22,7 @@
 #include <Tracy.hpp>
 #include <fmt/format.h>
 #include <optional>
+#include <vector>
 
 namespace stellar
 {
@@ -27,7 +30,8 @@ namespace stellar
 ApplyCheckpointWork::ApplyCheckpointWork(Application& app,
                                          TmpDir const& downloadDir,
                                          LedgerRange const& range,
-                                         OnFailureCallback cb)
+                                         OnFailureCallback cb,
+                                         bool useKnownResults)
     : BasicWork(app,
                 "apply-ledgers-" + fmt::format(FMT_STRING("{}-{}"),
                                                range.mFirst, range.limit()),
@@ -37,6 +41,7 @@ ApplyCheckpointWork::ApplyCheckpointWork(Application& app,
     , mCheckpoint(
           app.getHistoryManager().checkpointContainingLedger(range.mFirst))
     , mOnFailure(cb)
+    , mUseKnownResults(useKnownResults)
 {
     // Ledger range check to enforce application of a single checkpoint
     auto const& hm = mApp.getHistoryManager();
@@ -64,47 +69,63 @@ ApplyCheckpointWork::getStatus() const
     return BasicWork::getStatus();
 }
 
-void
-ApplyCheckpointWork::closeFiles()
-{
-    mHdrIn.close();
-    mTxIn.close();
-    mFilesOpen = false;
-}
+size_t const ApplyCheckpointWork::READ_AHEAD_LEDGERS = 16;
 
-void
-ApplyCheckpointWork::onReset()
+// Reads the files of a checkpoint ledger by ledger. Used by one background
+// job at a time, and never by the main thread once constructed.
+class ApplyCheckpointWork::CheckpointReader
 {
-    mConditionalWork.reset();
-    closeFiles();
-}
-
-void
-ApplyCheckpointWork::openInputFiles()
+    XDRInputFileStream mHdrIn;
+    XDRInputFileStream mTxIn;
+    XDRInputFileStream mResultIn;
+    TransactionHistoryEntry mTxHistoryEntry;
+    TransactionHistoryResultEntry mTxHistoryResultEntry;
+    TxFrameInternTable& mInternTable;
+    // Ledgers up to the LCL at the start of the work are skipped, so their
+    // transactions are not read.
+    uint32_t const mLastSkipped;
+    bool const mUseKnownResults;
+
+    TxSetXDRFrameConstPtr readTxSet(uint32_t seq);
+    TransactionResultSet readTxResultSet(uint32_t seq);
+
+  public:
+    CheckpointReader(Application& app, TmpDir const& downloadDir,
+                     uint32_t checkpoint, bool useKnownResults);
+
+    // Returns false if there are no more ledgers to read.
+    bool readNext(PreparedLedger& ledger);
+};
+
+ApplyCheckpointWork::CheckpointReader::CheckpointReader(
+    Application& app, TmpDir const& downloadDir, uint32_t checkpoint,
+    bool useKnownResults)
+    : mInternTable(app.getHerder().getTxFrameInternTable())
+    , mLastSkipped(app.getLedgerManager().getLastClosedLedgerNum())
+    , mUseKnownResults(useKnownResults)
 {
-    ZoneScoped;
-    mHdrIn.close();
-    mTxIn.close();
-    FileTransferInfo hi(mDownloadDir, HISTORY_FILE_TYPE_LEDGER, mCheckpoint);
-    FileTransferInfo ti(mDownloadDir, HISTORY_FILE_TYPE_TRANSACTIONS,
-                        mCheckpoint);
+    FileTransferInfo hi(downloadDir, HISTORY_FILE_TYPE_LEDGER, checkpoint);
+    FileTransferInfo ti(downloadDir, HISTORY_FILE_TYPE_TRANSACTIONS,
+                        checkpoint);
     CLOG_DEBUG(History, "Replaying ledger headers from {}",
                hi.localPath_nogz());
     CLOG_DEBUG(History, "Replaying transactions from {}", ti.localPath_nogz());
     mHdrIn.open(hi.localPath_nogz());
     mTxIn.open(ti.localPath_nogz());
-    mTxHistoryEntry = TransactionHistoryEntry();
-    mHeaderHistoryEntry = LedgerHeaderHistoryEntry();
-    mFilesOpen = true;
+    if (mUseKnownResults)
+    {
+        FileTransferInfo ri(downloadDir, HISTORY_FILE_TYPE_RESULTS,
+                            checkpoint);
+        CLOG_DEBUG(History, "Using known results from {}",
+                   ri.localPath_nogz());
+        mResultIn.open(ri.localPath_nogz());
+    }
 }
 
 TxSetXDRFrameConstPtr
-ApplyCheckpointWork::getCurrentTxSet()
+ApplyCheckpointWork::CheckpointReader::readTxSet(uint32_t seq)
 {
     ZoneScoped;
-    auto& lm = mApp.getLedgerManager();
-    auto seq = lm.getLastClosedLedgerNum() + 1;
-
     // Check mTxHistoryEntry prior to loading next history entry.
     // This order is important because it accounts for ledger "gaps"
     // in the history archives (which are caused by ledgers with empty tx
@@ -136,19 +157,170 @@ ApplyCheckpointWork::getCurrentTxSet()
         }
     } while (mTxIn && mTxIn.readOne(mTxHistoryEntry));
 
-    CLOG_DEBUG(History, "Using empty txset for ledger {}", seq);
-    return TxSetXDRFrame::makeEmpty(lm.getLastClosedLedgerHeader());
+    return nullptr;
 }
 
-std::shared_ptr<LedgerCloseData>
-ApplyCheckpointWork::getNextLedgerCloseData()
+TransactionResultSet
+ApplyCheckpointWork::CheckpointReader::readTxResultSet(uint32_t seq)
 {
     ZoneScoped;
-    if (!mHdrIn || !mHdrIn.readOne(mHeaderHistoryEntry))
+    // Like transactions, results of ledgers with empty tx sets are not
+    // uploaded
+    do
     {
-        throw std::runtime_error("No more ledgers to replay!");
+        if (mTxHistoryResultEntry.ledgerSeq > seq)
+        {
+            break;
+        }
+        if (mTxHistoryResultEntry.ledgerSeq == seq)
+        {
+            return mTxHistoryResultEntry.txResultSet;
+        }
+    } while (mResultIn && mResultIn.readOne(mTxHistoryResultEntry));
+
+    return TransactionResultSet{};
+}
+
+bool
+ApplyCheckpointWork::CheckpointReader::readNext(PreparedLedger& ledger)
+{
+    ZoneScoped;
+    ledger = PreparedLedger{};
+    if (!mHdrIn || !mHdrIn.readOne(ledger.mHeader))
+    {
+        return false;
     }
 
+    auto seq = ledger.mHeader.header.ledgerSeq;
+    if (seq <= mLastSkipped)
+    {
+        return true;
+    }
+
+    ledger.mTxSet = readTxSet(seq);
+    if (ledger.mTxSet)
+    {
+        try
+        {
+            ledger.mTxFrames = ledger.mTxSet->createTransactionFrames(
+                mInternTable);
+        }
+        catch (std::exception const& e)
+        {
+            // The frames are only built ahead of time; a malformed tx set
+            // is reported when it is prepared for apply.
+            CLOG_DEBUG(History, "Could not read transactions of ledger {}: {}",
+                       seq, e.what());
+            ledger.mTxFrames.clear();
+        }
+    }
+    if (mUseKnownResults)
+    {
+        ledger.mResults = readTxResultSet(seq);
+    }
+    return true;
+}
+
+void
+ApplyCheckpointWork::closeFiles()
+{
+    // A read in flight is dropped when it completes, see `readAhead`
+    mReader.reset();
+    mReadAhead.clear();
+    mReading = false;
+    mReaderDone = false;
+    mReadError.reset();
+}
+
+void
+ApplyCheckpointWork::onReset()
+{
+    mConditionalWork.reset();
+    closeFiles();
+}
+
+void
+ApplyCheckpointWork::openInputFiles()
+{
+    ZoneScoped;
+    closeFiles();
+    mReader = std::make_shared<CheckpointReader>(mApp, mDownloadDir,
+                                                 mCheckpoint, mUseKnownResults);
+    mHeaderHistoryEntry = LedgerHeaderHistoryEntry();
+}
+
+void
+ApplyCheckpointWork::readAhead()
+{
+    ZoneScoped;
+    if (mReading || mReaderDone || mReadAhead.size() >= READ_AHEAD_LEDGERS)
+    {
+        return;
+    }
+
+    auto reader = mReader;
+    auto count = READ_AHEAD_LEDGERS - mReadAhead.size();
+    std::weak_ptr<ApplyCheckpointWork> weak(
+        std::static_pointer_cast<ApplyCheckpointWork>(shared_from_this()));
+    Application& app = mApp;
+    mReading = true;
+    app.postOnBackgroundThread(
+        [&app, reader, count, weak]() {
+            auto ledgers = std::make_shared<std::vector<PreparedLedger>>();
+            bool done = false;
+            std::optional<std::string> error;
+            try
+            {
+                while (!done && ledgers->size() < count)
+                {
+                    auto& ledger = ledgers->emplace_back();
+                    if (!reader->readNext(ledger))
+                    {
+                        ledgers->pop_back();
+                        done = true;
+                    }
+                }
+            }
+            catch (std::exception const& e)
+            {
+                // Ledgers read before the error are applied first
+                ledgers->pop_back();
+                error = e.what();
+                done = true;
+            }
+
+            // BasicWork's state is not thread-safe, so it is only updated on
+            // the main thread
+            app.postOnMainThread(
+                [weak, reader, ledgers, done, error]() {
+                    auto self = weak.lock();
+                    // Drop the ledgers if the work was reset in the meantime
+                    if (!self || self->mReader != reader)
+                    {
+                        return;
+                    }
+                    self->mReading = false;
+                    self->mReaderDone = done;
+                    self->mReadError = error;
+                    for (auto& ledger : *ledgers)
+                    {
+                        self->mReadAhead.emplace_back(std::move(ledger));
+                    }
+                    if (!self->isAborting())
+                    {
+                        self->wakeUp();
+                    }
+                },
+                "ApplyCheckpointWork: ledgers read");
+        },
+        "ApplyCheckpointWork: read ledgers");
+}
+
+std::shared_ptr<LedgerCloseData>
+ApplyCheckpointWork::getNextLedgerCloseData(PreparedLedger&& ledger)
+{
+    ZoneScoped;
+    mHeaderHistoryEntry = ledger.mHeader;
     LedgerHeader& header = mHeaderHistoryEntry.header;
 
     auto& lm = mApp.getLedgerManager();
@@ -214,7 +386,13 @@ ApplyCheckpointWork::getNextLedgerCloseData()
             LedgerManager::ledgerAbbrev(lclHeader)));
     }
 
-    auto txset = getCurrentTxSet();
+    auto txset = ledger.mTxSet;
+    if (!txset)
+    {
+        CLOG_DEBUG(History, "Using empty txset for ledger {}",
+                   header.ledgerSeq);
+        txset = TxSetXDRFrame::makeEmpty(lclHeader);
+    }
     CLOG_DEBUG(History, "Ledger {} has {} transactions", header.ledgerSeq,
                txset->sizeTxTotal());
 
@@ -246,9 +424,24 @@ ApplyCheckpointWork::getNextLedgerCloseData()
     }
 #endif
 
+    std::optional<TransactionResultSet> expectedResults;
+    if (mUseKnownResults)
+    {
+        releaseAssert(ledger.mResults);
+        expectedResults = std::move(ledger.mResults);
+        if (expectedResults->results.size() != txset->sizeTxTotal())
+        {
+            throw std::runtime_error(fmt::format(
+                FMT_STRING("replay results for {:d} have {:d} entries, txset "
+                           "has {:d} transactions"),
+                header.ledgerSeq, expectedResults->results.size(),
+                txset->sizeTxTotal()));
+        }
+    }
+
     return std::make_shared<LedgerCloseData>(
         header.ledgerSeq, txset, header.scpValue,
-        std::make_optional<Hash>(mHeaderHistoryEntry.hash));
+        std::make_optional<Hash>(mHeaderHistoryEntry.hash), expectedResults);
 }
 
 BasicWork::State
@@ -297,12 +490,30 @@ ApplyCheckpointWork::onRun()
         return State::WORK_SUCCESS;
     }
 
-    if (!mFilesOpen)
+    if (!mReader)
     {
         openInputFiles();
     }
 
-    auto lcd = getNextLedgerCloseData();
+    if (mReadAhead.empty())
+    {
+        if (mReaderDone)
+        {
+            if (mReadError)
+            {
+                throw std::runtime_error(*mReadError);
+            }
+            throw std::runtime_error("No more ledgers to replay!");
+        }
+        readAhead();
+        return State::WORK_WAITING;
+    }
+
+    auto ledger = std::move(mReadAhead.front());
+    mReadAhead.pop_front();
+    readAhead();
+
+    auto lcd = getNextLedgerCloseData(std::move(ledger));
     if (!lcd)
     {
         return State::WORK_RUNNING;
@@ -348,7 +559,8 @@ ApplyCheckpointWork::onAbort()
         mConditionalWork->crankWork();
         return false;
     }
-    return true;
+    // Don't let the read in flight outlive the download directory
+    return !mReading;
 }
 
 void
@@ -14,6 +14,10 @@
 #include "xdr/Stellar-SCP.h"
 #include "xdr/Stellar-ledger.h"
 
+#include <deque>
+#include <optional>
+#include <string>
+
 namespace stellar
 {
 
@@ -38,34 +42,66 @@ struct LedgerHeaderHistoryEntry;
  * * downloadDir - directory containing ledger and transaction files
  * * range - LedgerRange to apply, must be checkpoint-aligned,
  * and cover at most one checkpoint.
+ * * useKnownResults - whether the results file of the checkpoint, already
+ * verified against the ledger headers, is used to skip signature checks and
+ * the operations of failed transactions. Ledger hashes are still checked.
+ *
+ * Reading the files is pipelined with apply: a background job decodes up to
+ * READ_AHEAD_LEDGERS ledgers ahead of the one being applied, hashes their tx
+ * sets and builds (interns) their transaction frames, so that apply doesn't
+ * wait on XDR decoding. All the checks against the LCL are still made on the
+ * main thread, right before each ledger is applied.
  */
 
 class ApplyCheckpointWork : public BasicWork
 {
+  public:
+    // A ledger read from the checkpoint files ahead of apply
+    struct PreparedLedger
+    {
+        LedgerHeaderHistoryEntry mHeader;
+        // Null if the ledger is skipped or has no transactions; empty tx
+        // sets depend on the LCL and are made when the ledger is applied.
+        TxSetXDRFrameConstPtr mTxSet;
+        std::optional<TransactionResultSet> mResults;
+        // Keeps the interned frames of `mTxSet` alive until it is prepared
+        // for apply.
+        TxSetPhaseTransactions mTxFrames;
+    };
+
+    static size_t const READ_AHEAD_LEDGERS;
+
+  private:
+    class CheckpointReader;
+
     TmpDir const& mDownloadDir;
     LedgerRange const mLedgerRange;
     uint32_t const mCheckpoint;
 
-    XDRInputFileStream mHdrIn;
-    XDRInputFileStream mTxIn;
-    TransactionHistoryEntry mTxHistoryEntry;
     LedgerHeaderHistoryEntry mHeaderHistoryEntry;
     OnFailureCallback mOnFailure;
+    bool const mUseKnownResults;
 
-    bool mFilesOpen{false};
+    std::shared_ptr<CheckpointReader> mReader;
+    std::deque<PreparedLedger> mReadAhead;
+    bool mReading{false};
+    bool mReaderDone{false};
+    std::optional<std::string> mReadError;
 
     std::shared_ptr<ConditionalWork> mConditionalWork;
 
-    TxSetXDRFrameConstPtr getCurrentTxSet();
     void openInputFiles();
+    void readAhead();
 
-    std::shared_ptr<LedgerCloseData> getNextLedgerCloseData();
+    std::shared_ptr<LedgerCloseData>
+    getNextLedgerCloseData(PreparedLedger&& ledger);
 
     void closeFiles();
 
   public:
     ApplyCheckpointWork(Application& app, TmpDir const& downloadDir,
-                        LedgerRange const& range, OnFailureCallback cb);
+                        LedgerRange const& range, OnFailureCallback cb,
+                        bool useKnownResults = false);
     ~ApplyCheckpointWork() = default;
     std::string getStatus() const override;
     void onFailureRaise() override;
@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "catchup/CatchupPerformanceReport.h"
 #include "catchup/CatchupWork.h"
 #include "herder/LedgerCloseData.h"
 #include <functional>
@@ -73,6 +74,12 @@ class CatchupManager
     virtual bool catchupWorkIsDone() const = 0;
     virtual bool isCatchupInitialized() const = 0;
 
+    // Return the verified ledger the current catchup replays from, once it is
+    // known: the ledger buckets are applied at, or the last ledger of the
+    // first verified checkpoint when replaying from genesis
+    virtual std::optional<LedgerHeaderHistoryEntry>
+    getVerifiedLedgerRangeStart() const = 0;
+
     // Emit a log message and set StatusManager HISTORY_CATCHUP status to
     // describe current catchup state. The `contiguous` argument is passed in
     // to describe whether the ledger-manager's view of current catchup tasks
@@ -108,6 +115,10 @@ class CatchupManager
 
     virtual CatchupMetrics const& getCatchupMetrics() = 0;
 
+    // Per-stage timings of the current or last catchup. Thread-safe, so that
+    // background jobs can record their operations in it.
+    virtual CatchupPerformanceReport& getPerformanceReport() = 0;
+
     virtual ~CatchupManager(){};
 
     virtual void historyArchiveStatesDownloaded(uint32_t num = 1) = 0;
@@ -268,6 +268,10 @@ CatchupManagerImpl::startCatchup(
     // which means we don't "really" start catchup.
     mCatchupWork = mApp.getWorkScheduler().scheduleWork<CatchupWork>(
         configuration, bucketsToRetain, archive);
+    if (mCatchupWork)
+    {
+        mPerformanceReport.start();
+    }
 }
 
 std::string
@@ -295,6 +299,20 @@ CatchupManagerImpl::isCatchupInitialized() const
     return mCatchupWork != nullptr;
 }
 
+std::optional<LedgerHeaderHistoryEntry>
+CatchupManagerImpl::getVerifiedLedgerRangeStart() const
+{
+    if (mCatchupWork)
+    {
+        auto const& start = mCatchupWork->getVerifiedLedgerRangeStart();
+        if (start.header.ledgerSeq != 0)
+        {
+            return start;
+        }
+    }
+    return std::nullopt;
+}
+
 void
 CatchupManagerImpl::logAndUpdateCatchupStatus(bool contiguous,
                                               std::string const& message)
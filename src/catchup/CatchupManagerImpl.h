@@ -51,6 +51,7 @@ class CatchupManagerImpl : public CatchupManager
     uint32_t getCatchupCount();
     uint32_t mLargestLedgerSeqHeard;
     CatchupMetrics mMetrics;
+    CatchupPerformanceReport mPerformanceReport;
 
     // Check if catchup can't be performed due to local version incompatibility
     // or state corruption. Once this flag is set, core won't attempt catchup as
@@ -72,6 +73,8 @@ class CatchupManagerImpl : public CatchupManager
     BasicWork::State getCatchupWorkState() const override;
     bool catchupWorkIsDone() const override;
     bool isCatchupInitialized() const override;
+    std::optional<LedgerHeaderHistoryEntry>
+    getVerifiedLedgerRangeStart() const override;
 
     void logAndUpdateCatchupStatus(bool contiguous,
                                    std::string const& message) override;
@@ -89,6 +92,12 @@ class CatchupManagerImpl : public CatchupManager
         return mMetrics;
     }
 
+    CatchupPerformanceReport&
+    getPerformanceReport() override
+    {
+        return mPerformanceReport;
+    }
+
     void historyArchiveStatesDownloaded(uint32_t num) override;
     void ledgersVerified(uint32_t num) override;
     void ledgerChainsVerificationFailed(uint32_t num) override;
@@ -0,0 +1,126 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "catchup/CatchupPerformanceReport.h"
+#include "util/GlobalChecks.h"
+
+#include <stdexcept>
+
+namespace stellar
+{
+
+namespace
+{
+double
+toSeconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+Json::Int64
+toMilliseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+        .count();
+}
+}
+
+char const*
+CatchupPerformanceReport::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::DOWNLOAD:
+        return "download";
+    case Stage::DECOMPRESS:
+        return "decompress";
+    case Stage::VERIFY:
+        return "verify";
+    case Stage::INDEX:
+        return "index";
+    case Stage::APPLY_BUCKETS:
+        return "apply_buckets";
+    case Stage::APPLY_LEDGERS:
+        return "apply_ledgers";
+    case Stage::COMMIT:
+        return "commit";
+    default:
+        releaseAssert(false);
+        throw std::runtime_error("unexpected catchup stage");
+    }
+}
+
+void
+CatchupPerformanceReport::start()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStarted = true;
+    mRunning = true;
+    mSuccess = false;
+    mStartTime = std::chrono::steady_clock::now();
+    mStages.fill(StageStats{});
+}
+
+void
+CatchupPerformanceReport::finish(bool success)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRunning)
+    {
+        mRunning = false;
+        mSuccess = success;
+        mFinishTime = std::chrono::steady_clock::now();
+    }
+}
+
+void
+CatchupPerformanceReport::record(Stage stage,
+                                 std::chrono::nanoseconds duration,
+                                 uint64_t bytes, uint64_t entries)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mRunning)
+    {
+        return;
+    }
+    auto& stats = mStages.at(static_cast<size_t>(stage));
+    ++stats.mOperations;
+    stats.mDuration += duration;
+    stats.mBytes += bytes;
+    stats.mEntries += entries;
+}
+
+Json::Value
+CatchupPerformanceReport::getJsonInfo() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Json::Value res;
+    if (!mStarted)
+    {
+        return res;
+    }
+
+    auto end = mRunning ? std::chrono::steady_clock::now() : mFinishTime;
+    res["state"] = mRunning ? "running" : (mSuccess ? "succeeded" : "failed");
+    res["elapsed_ms"] = toMilliseconds(end - mStartTime);
+
+    auto& stages = res["stages"];
+    for (size_t i = 0; i < mStages.size(); ++i)
+    {
+        auto const& stats = mStages[i];
+        auto& stage = stages[getStageName(static_cast<Stage>(i))];
+        stage["operations"] = static_cast<Json::UInt64>(stats.mOperations);
+        stage["time_ms"] = toMilliseconds(stats.mDuration);
+        stage["bytes"] = static_cast<Json::UInt64>(stats.mBytes);
+        stage["entries"] = static_cast<Json::UInt64>(stats.mEntries);
+
+        // Throughput while the stage was busy, across parallel operations
+        auto seconds = toSeconds(stats.mDuration);
+        stage["bytes_per_second"] = seconds > 0 ? stats.mBytes / seconds : 0.0;
+        stage["entries_per_second"] =
+            seconds > 0 ? stats.mEntries / seconds : 0.0;
+    }
+    return res;
+}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/json/json.h"
+#include "util/NonCopyable.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace stellar
+{
+
+/**
+ * Accounts for the time spent in each stage of a catchup, and for the data it
+ * processed, to see which stage bounds catchup on a given node.
+ *
+ * Stages record their operations as they finish, from the main thread or from
+ * background jobs. Operations are only recorded between `start` and `finish`,
+ * as most of the code recording them (closing a ledger, applying buckets) also
+ * runs outside of catchup.
+ *
+ * The time of a stage is the sum of the times of its operations. Operations of
+ * a stage may run in parallel (as downloads do), and stages overlap, so stage
+ * times don't add up to the catchup time.
+ */
+class CatchupPerformanceReport : public NonMovableOrCopyable
+{
+  public:
+    enum class Stage
+    {
+        // Files downloaded from archives: bytes downloaded, files
+        DOWNLOAD,
+        // Files unzipped: bytes unzipped, files
+        DECOMPRESS,
+        // Buckets hashed, as they're unzipped or on their own, and ledger
+        // chains checked: bytes hashed, ledgers
+        VERIFY,
+        // Buckets indexed: bytes indexed, buckets
+        INDEX,
+        // Buckets applied: bytes applied, ledger entries
+        APPLY_BUCKETS,
+        // Ledgers applied, up to their commit: transactions
+        APPLY_LEDGERS,
+        // Ledgers committed: ledgers
+        COMMIT,
+        STAGE_COUNT
+    };
+
+    static char const* getStageName(Stage stage);
+
+    // Clears the report and starts recording operations.
+    void start();
+
+    // Stops recording operations.
+    void finish(bool success);
+
+    void record(Stage stage, std::chrono::nanoseconds duration, uint64_t bytes,
+                uint64_t entries);
+
+    // Time, bytes and entries of each stage, with their throughput, for the
+    // current or last catchup. Null if no catchup started.
+    Json::Value getJsonInfo() const;
+
+  private:
+    struct StageStats
+    {
+        uint64_t mOperations{0};
+        std::chrono::nanoseconds mDuration{0};
+        uint64_t mBytes{0};
+        uint64_t mEntries{0};
+    };
+
+    mutable std::mutex mMutex;
+    bool mStarted{false};
+    bool mRunning{false};
+    bool mSuccess{false};
+    std::chrono::steady_clock::time_point mStartTime;
+    std::chrono::steady_clock::time_point mFinishTime;
+    std::array<StageStats, static_cast<size_t>(Stage::STAGE_COUNT)> mStages;
+};
+}
@@ -132,6 +132,33 @@ CatchupRange::CatchupRange(uint32_t lastClosedLedger,
     checkInvariants();
 }
 
+std::vector<uint32_t>
+CatchupRange::getSegmentEnds(uint32_t segments, HistoryManager const& hm) const
+{
+    releaseAssert(segments > 0);
+    std::vector<uint32_t> ends;
+    if (replayLedgers())
+    {
+        uint64_t start = getReplayFirst() - 1;
+        uint64_t step = (getReplayCount() + segments - 1) / segments;
+        for (uint32_t i = 1; i < segments; ++i)
+        {
+            auto end = hm.checkpointContainingLedger(
+                static_cast<uint32_t>(start + i * step));
+            if (end >= getReplayLast())
+            {
+                break;
+            }
+            if (ends.empty() || end > ends.back())
+            {
+                ends.emplace_back(end);
+            }
+        }
+    }
+    ends.emplace_back(last());
+    return ends;
+}
+
 void
 CatchupRange::checkInvariants()
 {
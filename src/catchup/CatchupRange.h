@@ -8,6 +8,7 @@
 #include "ledger/LedgerRange.h"
 #include "util/GlobalChecks.h"
 #include <stdexcept>
+#include <vector>
 
 namespace stellar
 {
@@ -161,6 +162,13 @@ class CatchupRange
         return mApplyBucketsAtLedger;
     }
 
+    // Split the replayed ledgers into at most `segments` consecutive
+    // segments and return the last ledger of each. Every segment but the last
+    // ends on a checkpoint boundary, so that the next one can start from the
+    // buckets published there and be replayed independently.
+    std::vector<uint32_t> getSegmentEnds(uint32_t segments,
+                                         HistoryManager const& hm) const;
+
     /**
      * Preconditions:
      * * lastClosedLedger > 0
@@ -9,6 +9,7 @@
 #include "catchup/ApplyBufferedLedgersWork.h"
 #include "catchup/ApplyCheckpointWork.h"
 #include "catchup/CatchupConfiguration.h"
+#include "catchup/CatchupManager.h"
 #include "catchup/CatchupRange.h"
 #include "catchup/DownloadApplyTxsWork.h"
 #include "catchup/VerifyLedgerChainWork.h"
@@ -303,9 +304,14 @@ CatchupWork::downloadApplyTransactions(CatchupRange const& catchupRange)
 {
     ZoneScoped;
     auto waitForPublish = mCatchupConfiguration.offline();
+    // Results are only known once downloadVerifyTxResults has verified them
+    auto useKnownResults = mCatchupConfiguration.mode() ==
+                               CatchupConfiguration::Mode::OFFLINE_COMPLETE &&
+                           mApp.getConfig().CATCHUP_SKIP_KNOWN_RESULTS;
     auto range = catchupRange.getReplayRange();
     mTransactionsVerifyApplySeq = std::make_shared<DownloadApplyTxsWork>(
-        mApp, *mDownloadDir, range, mLastApplied, waitForPublish, mArchive);
+        mApp, *mDownloadDir, range, mLastApplied, waitForPublish,
+        useKnownResults, mArchive);
 }
 
 BasicWork::State
@@ -672,6 +678,7 @@ void
 CatchupWork::onFailureRaise()
 {
     CLOG_WARNING(History, "Catchup failed");
+    reportPerformance(false);
     Work::onFailureRaise();
     if (mCatchupConfiguration.localBucketsOnly())
     {
@@ -683,6 +690,17 @@ void
 CatchupWork::onSuccess()
 {
     CLOG_INFO(History, "Catchup finished");
+    reportPerformance(true);
     Work::onSuccess();
 }
+
+void
+CatchupWork::reportPerformance(bool success)
+{
+    auto& report = mApp.getCatchupManager().getPerformanceReport();
+    report.finish(success);
+    Json::FastWriter fw;
+    CLOG_INFO(Perf, "Catchup performance report: {}",
+              fw.write(report.getJsonInfo()));
+}
 }
@@ -76,6 +76,12 @@ class CatchupWork : public Work
         return mCatchupConfiguration;
     }
 
+    LedgerHeaderHistoryEntry const&
+    getVerifiedLedgerRangeStart() const
+    {
+        return mVerifiedLedgerRangeStart;
+    }
+
     bool
     fatalFailure()
     {
@@ -121,6 +127,7 @@ class CatchupWork : public Work
     void downloadApplyTransactions(CatchupRange const& catchupRange);
     void downloadVerifyTxResults(CatchupRange const& catchupRange);
     BasicWork::State runCatchupStep();
+    void reportPerformance(bool success);
 
     BasicWork::State getAndMaybeSetHistoryArchiveState();
     BasicWork::State
@@ -23,7 +23,7 @@ namespace stellar
 DownloadApplyTxsWork::DownloadApplyTxsWork(
     Application& app, TmpDir const& downloadDir, LedgerRange const& range,
     LedgerHeaderHistoryEntry& lastApplied, bool waitForPublish,
-    std::shared_ptr<HistoryArchive> archive)
+    bool useKnownResults, std::shared_ptr<HistoryArchive> archive)
     : BatchWork(app, "download-apply-ledgers")
     , mRange(range)
     , mDownloadDir(downloadDir)
@@ -31,6 +31,7 @@ DownloadApplyTxsWork::DownloadApplyTxsWork(
     , mCheckpointToQueue(
           app.getHistoryManager().checkpointContainingLedger(range.mFirst))
     , mWaitForPublish(waitForPublish)
+    , mUseKnownResults(useKnownResults)
     , mArchive(archive)
 {
 }
@@ -76,7 +77,8 @@ DownloadApplyTxsWork::yieldMoreWork()
     };
 
     auto apply = std::make_shared<ApplyCheckpointWork>(
-        mApp, mDownloadDir, LedgerRange::inclusive(low, high), cb);
+        mApp, mDownloadDir, LedgerRange::inclusive(low, high), cb,
+        mUseKnownResults);
 
     std::vector<std::shared_ptr<BasicWork>> seq{getAndUnzip};
 
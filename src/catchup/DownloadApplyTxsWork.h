@@ -29,13 +29,14 @@ class DownloadApplyTxsWork : public BatchWork
     uint32_t mCheckpointToQueue;
     std::shared_ptr<BasicWork> mLastYieldedWork;
     bool const mWaitForPublish;
+    bool const mUseKnownResults;
     std::shared_ptr<HistoryArchive> mArchive;
 
   public:
     DownloadApplyTxsWork(Application& app, TmpDir const& downloadDir,
                          LedgerRange const& range,
                          LedgerHeaderHistoryEntry& lastApplied,
-                         bool waitForPublish,
+                         bool waitForPublish, bool useKnownResults,
                          std::shared_ptr<HistoryArchive> archive = nullptr);
 
     std::string getStatus() const override;
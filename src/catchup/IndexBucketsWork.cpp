@@ -5,101 +5,69 @@
 #include "IndexBucketsWork.h"
 #include "bucket/BucketIndex.h"
 #include "bucket/BucketManager.h"
+#include "catchup/CatchupManager.h"
+#include "main/Application.h"
 #include "util/HashOfHash.h"
 #include "util/UnorderedSet.h"
 #include "util/types.h"
 #include "work/WorkWithCallback.h"
 #include <Tracy.hpp>
+#include <chrono>
 
 namespace stellar
 {
 IndexBucketsWork::IndexWork::IndexWork(Application& app,
                                        std::shared_ptr<Bucket> b)
-    : BasicWork(app, "index-work", BasicWork::RETRY_NEVER), mBucket(b)
+    : RunInBackgroundWork(app, "index-work", "index-bucket",
+                          BasicWork::RETRY_NEVER)
+    , mBucket(b)
 {
 }
 
-BasicWork::State
-IndexBucketsWork::IndexWork::onRun()
-{
-    if (mDone)
-    {
-        return State::WORK_SUCCESS;
-    }
-
-    postWork();
-    return State::WORK_WAITING;
-}
-
-bool
-IndexBucketsWork::IndexWork::onAbort()
-{
-    return true;
-};
-
-void
-IndexBucketsWork::IndexWork::postWork()
+std::function<void()>
+IndexBucketsWork::IndexWork::getJob()
 {
-    Application& app = this->mApp;
+    auto index = std::make_shared<std::unique_ptr<BucketIndex const>>();
+    mIndex = index;
+    return [&bm = mApp.getBucketManager(),
+            &report = mApp.getCatchupManager().getPerformanceReport(),
+            bucket = mBucket, index]() {
+        auto start = std::chrono::steady_clock::now();
+        auto indexFilename = bm.bucketIndexFilename(bucket->getHash());
+
+        if (bm.getConfig().isPersistingBucketListDBIndexes() &&
+            fs::exists(indexFilename))
+        {
+            *index = BucketIndex::load(bm, indexFilename, bucket->getSize());
 
-    std::weak_ptr<IndexWork> weak(
-        std::static_pointer_cast<IndexWork>(shared_from_this()));
-    app.postOnBackgroundThread(
-        [&app, weak]() {
-            auto self = weak.lock();
-            if (!self || self->isAborting())
+            // If we could not load the index from the file, file is out of
+            // date. Delete and create a new index.
+            if (!*index)
             {
-                return;
+                CLOG_WARNING(Bucket, "Outdated index file: {}", indexFilename);
+                std::remove(indexFilename.c_str());
             }
-
-            auto& bm = app.getBucketManager();
-            auto indexFilename =
-                bm.bucketIndexFilename(self->mBucket->getHash());
-
-            if (bm.getConfig().isPersistingBucketListDBIndexes() &&
-                fs::exists(indexFilename))
+            else
             {
-                self->mIndex = BucketIndex::load(bm, indexFilename,
-                                                 self->mBucket->getSize());
-
-                // If we could not load the index from the file, file is out of
-                // date. Delete and create a new index.
-                if (!self->mIndex)
-                {
-                    CLOG_WARNING(Bucket, "Outdated index file: {}",
-                                 indexFilename);
-                    std::remove(indexFilename.c_str());
-                }
-                else
-                {
-                    CLOG_DEBUG(Bucket, "Loaded index from file: {}",
-                               indexFilename);
-                }
+                CLOG_DEBUG(Bucket, "Loaded index from file: {}", indexFilename);
             }
+        }
 
-            if (!self->mIndex)
-            {
-                self->mIndex = BucketIndex::createIndex(
-                    bm, self->mBucket->getFilename(), self->mBucket->getHash());
-            }
+        if (!*index)
+        {
+            *index = BucketIndex::createIndex(bm, bucket->getFilename(),
+                                              bucket->getHash());
+        }
+        report.record(CatchupPerformanceReport::Stage::INDEX,
+                      std::chrono::steady_clock::now() - start,
+                      bucket->getSize(), 1);
+    };
+}
 
-            app.postOnMainThread(
-                [weak]() {
-                    auto self = weak.lock();
-                    if (self)
-                    {
-                        self->mDone = true;
-                        if (!self->isAborting())
-                        {
-                            self->mApp.getBucketManager().maybeSetIndex(
-                                self->mBucket, std::move(self->mIndex));
-                        }
-                        self->wakeUp();
-                    }
-                },
-                "IndexWork: finished");
-        },
-        "IndexWork: starting in background");
+void
+IndexBucketsWork::IndexWork::onSuccess()
+{
+    mApp.getBucketManager().maybeSetIndex(mBucket, std::move(*mIndex));
 }
 
 IndexBucketsWork::IndexBucketsWork(
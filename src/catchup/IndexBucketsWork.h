@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "work/RunInBackgroundWork.h"
 #include "work/Work.h"
 #include <memory>
 
@@ -16,20 +17,18 @@ class BucketManager;
 
 class IndexBucketsWork : public Work
 {
-    class IndexWork : public BasicWork
+    class IndexWork : public RunInBackgroundWork
     {
         std::shared_ptr<Bucket> mBucket;
-        std::unique_ptr<BucketIndex const> mIndex;
-        bool mDone{false};
-
-        void postWork();
+        // Filled by the job
+        std::shared_ptr<std::unique_ptr<BucketIndex const>> mIndex;
+        std::function<void()> getJob() override;
 
       public:
         IndexWork(Application& app, std::shared_ptr<Bucket> b);
 
       protected:
-        State onRun() override;
-        bool onAbort() override;
+        void onSuccess() override;
     };
 
     std::vector<std::shared_ptr<Bucket>> const& mBuckets;
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "catchup/VerifyLedgerChainWork.h"
+#include "catchup/CatchupManager.h"
 #include "history/FileTransferInfo.h"
 #include "historywork/Progress.h"
 #include "ledger/LedgerManager.h"
@@ -15,6 +16,7 @@
 #include "util/types.h"
 #include <Tracy.hpp>
 #include <fmt/format.h>
+#include <algorithm>
 #include <fstream>
 
 namespace stellar
@@ -154,22 +156,29 @@ VerifyLedgerChainWork::onReset()
                                 mRange.last());
     mChainDisagreesWithLocalState.reset();
     mHasTrustedHash = false;
+    mCheckpointVerifications.clear();
+    mNextCheckpointToCheck.reset();
+    if (mRange.mCount != 0)
+    {
+        mNextCheckpointToCheck = mCurrCheckpoint;
+    }
+    ++mGeneration;
 }
 
-HistoryManager::LedgerVerificationStatus
-VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
+VerifyLedgerChainWork::CheckpointVerification
+VerifyLedgerChainWork::verifyLedgersOfCheckpoint(
+    std::string const& path, uint32_t checkpoint, uint32_t rangeLast,
+    LedgerNumHashPair const& lastClosed, uint32_t maxLedgerVersion)
 {
     ZoneScoped;
-    // When verifying a checkpoint, we rely on the fact that the next checkpoint
-    // has been verified (unless there's 1 checkpoint).
-    // Once the end of the range is reached, ensure that the chain agrees with
-    // trusted hash passed in. If LCL is reached, verify that it agrees with
-    // the chain.
-
-    FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_LEDGER,
-                        mCurrCheckpoint);
+    // This runs on a background thread, so it must only use its arguments.
+    // When verifying a checkpoint, we rely on the fact that the next
+    // checkpoint will be verified and linked to it in `verifyCheckpointLinks`
+    // (unless there's 1 checkpoint). If LCL is reached, verify that it agrees
+    // with the chain.
+    CheckpointVerification res;
     XDRInputFileStream hdrIn;
-    hdrIn.open(ft.localPath_nogz());
+    hdrIn.open(path);
 
     bool beginCheckpoint = true;
 
@@ -178,12 +187,12 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
     // stream; `first` will be set to `curr` only on the first iteration, and
     // `prev` will be set to `curr` at the end of the loop to make the previous
     // iteration's `curr` available during the loop.
-    LedgerHeaderHistoryEntry curr;
-    LedgerHeaderHistoryEntry first;
+    LedgerHeaderHistoryEntry& curr = res.mLast;
+    LedgerHeaderHistoryEntry& first = res.mFirst;
     LedgerHeaderHistoryEntry prev;
 
     CLOG_DEBUG(History, "Verifying ledger headers from {} for checkpoint {}",
-               ft.localPath_nogz(), mCurrCheckpoint);
+               path, checkpoint);
 
     while (hdrIn)
     {
@@ -196,48 +205,48 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
         }
         catch (xdr::xdr_bad_message_size&)
         {
-            return HistoryManager::VERIFY_STATUS_ERR_BAD_LEDGER_VERSION;
+            res.mStatus = HistoryManager::VERIFY_STATUS_ERR_BAD_LEDGER_VERSION;
+            return res;
         }
 
-        if (curr.header.ledgerVersion >
-            mApp.getConfig().LEDGER_PROTOCOL_VERSION)
+        if (curr.header.ledgerVersion > maxLedgerVersion)
         {
             // Note that local state does not agree with the archives; depending
             // on the presence of trusted hash
-            mChainDisagreesWithLocalState =
+            res.mChainDisagreesWithLocalState =
                 HistoryManager::VERIFY_STATUS_ERR_BAD_LEDGER_VERSION;
         }
 
         // Verify ledger with local state by comparing to LCL
         // When checking against LCL, see it the local node is in the bad state,
         // or if the archive is in a bad state (in which case, retry)
-        if (curr.header.ledgerSeq == mLastClosed.first)
+        if (curr.header.ledgerSeq == lastClosed.first)
         {
-            if (sha256(xdr::xdr_to_opaque(curr.header)) != *mLastClosed.second)
+            if (sha256(xdr::xdr_to_opaque(curr.header)) != *lastClosed.second)
             {
                 CLOG_ERROR(History,
                            "Bad ledger-header history entry: claimed ledger {} "
                            "does not agree with LCL {}",
                            LedgerManager::ledgerAbbrev(curr),
-                           LedgerManager::ledgerAbbrev(mLastClosed.first,
-                                                       *mLastClosed.second));
-                mChainDisagreesWithLocalState =
+                           LedgerManager::ledgerAbbrev(lastClosed.first,
+                                                       *lastClosed.second));
+                res.mChainDisagreesWithLocalState =
                     HistoryManager::VERIFY_STATUS_ERR_BAD_HASH;
             }
         }
         // Verify LCL that is just before the first ledger in range
-        else if (curr.header.ledgerSeq == mLastClosed.first + 1)
+        else if (curr.header.ledgerSeq == lastClosed.first + 1)
         {
-            auto lclResult = verifyLedgerHistoryLink(*mLastClosed.second, curr);
+            auto lclResult = verifyLedgerHistoryLink(*lastClosed.second, curr);
             if (lclResult != HistoryManager::VERIFY_STATUS_OK)
             {
                 CLOG_ERROR(History,
                            "Bad ledger-header history entry: claimed ledger {} "
                            "previous hash does not agree with LCL: {}",
                            LedgerManager::ledgerAbbrev(curr),
-                           LedgerManager::ledgerAbbrev(mLastClosed.first,
-                                                       *mLastClosed.second));
-                mChainDisagreesWithLocalState = lclResult;
+                           LedgerManager::ledgerAbbrev(lastClosed.first,
+                                                       *lastClosed.second));
+                res.mChainDisagreesWithLocalState = lclResult;
             }
         }
 
@@ -249,7 +258,8 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
             auto hashResult = verifyLedgerHistoryEntry(curr);
             if (hashResult != HistoryManager::VERIFY_STATUS_OK)
             {
-                return hashResult;
+                res.mStatus = hashResult;
+                return res;
             }
 
             // Save first ledger in the checkpoint, in case we use it below in
@@ -267,7 +277,8 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
                     "History chain undershot expected ledger seq {}, got "
                     "{} instead",
                     expectedSeq, curr.header.ledgerSeq);
-                return HistoryManager::VERIFY_STATUS_ERR_UNDERSHOT;
+                res.mStatus = HistoryManager::VERIFY_STATUS_ERR_UNDERSHOT;
+                return res;
             }
             else if (curr.header.ledgerSeq > expectedSeq)
             {
@@ -275,36 +286,136 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
                            "History chain overshot expected ledger seq {}, got "
                            "{} instead",
                            expectedSeq, curr.header.ledgerSeq);
-                return HistoryManager::VERIFY_STATUS_ERR_OVERSHOT;
+                res.mStatus = HistoryManager::VERIFY_STATUS_ERR_OVERSHOT;
+                return res;
             }
             auto linkResult = verifyLedgerHistoryLink(prev.hash, curr);
             if (linkResult != HistoryManager::VERIFY_STATUS_OK)
             {
-                return linkResult;
+                res.mStatus = linkResult;
+                return res;
             }
         }
 
-        mApp.getCatchupManager().ledgersVerified();
+        ++res.mLedgersVerified;
         prev = curr;
 
         // No need to keep verifying if the range is covered
-        if (curr.header.ledgerSeq == mRange.last())
+        if (curr.header.ledgerSeq == rangeLast)
         {
             break;
         }
     }
 
-    if (curr.header.ledgerSeq != mCurrCheckpoint &&
-        curr.header.ledgerSeq != mRange.last())
+    if (curr.header.ledgerSeq != checkpoint &&
+        curr.header.ledgerSeq != rangeLast)
     {
-        // We can end at mCurrCheckpoint if checkpoint was valid
-        // or at mRange.last() if history chain file was valid and we
+        // We can end at checkpoint if checkpoint was valid
+        // or at rangeLast if history chain file was valid and we
         // reached last ledger in the range. Any other ledger here means
         // that file is corrupted.
         CLOG_ERROR(History, "History chain did not end with {} or {}",
-                   mCurrCheckpoint, mRange.last());
-        return HistoryManager::VERIFY_STATUS_ERR_MISSING_ENTRIES;
+                   checkpoint, rangeLast);
+        res.mStatus = HistoryManager::VERIFY_STATUS_ERR_MISSING_ENTRIES;
     }
+    return res;
+}
+
+void
+VerifyLedgerChainWork::startCheckpointVerifications()
+{
+    ZoneScoped;
+    auto const& hm = mApp.getHistoryManager();
+    auto minCheckpoint = hm.checkpointContainingLedger(mRange.mFirst);
+    auto maxInFlight =
+        static_cast<size_t>(std::max(mApp.getConfig().WORKER_THREADS, 1));
+    std::weak_ptr<VerifyLedgerChainWork> weak(
+        std::static_pointer_cast<VerifyLedgerChainWork>(shared_from_this()));
+    Application& app = mApp;
+
+    // Checks started before a reset keep running in the background until
+    // they complete, so they count against the limit too.
+    while (mNextCheckpointToCheck &&
+           mCheckpointVerifications.size() < maxInFlight &&
+           mChecksInFlight < maxInFlight)
+    {
+        auto checkpoint = *mNextCheckpointToCheck;
+        FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_LEDGER,
+                            checkpoint);
+        mCheckpointVerifications.emplace(checkpoint, std::nullopt);
+        ++mChecksInFlight;
+#ifdef BUILD_TESTS
+        mMaxChecksInFlight = std::max(mMaxChecksInFlight, mChecksInFlight);
+#endif
+        app.postOnBackgroundThread(
+            [&app, weak, path = ft.localPath_nogz(), checkpoint,
+             rangeLast = mRange.last(), lastClosed = mLastClosed,
+             maxLedgerVersion = mApp.getConfig().LEDGER_PROTOCOL_VERSION,
+             generation = mGeneration]() {
+                auto start = std::chrono::steady_clock::now();
+                CheckpointVerification res;
+                try
+                {
+                    res = verifyLedgersOfCheckpoint(path, checkpoint, rangeLast,
+                                                    lastClosed,
+                                                    maxLedgerVersion);
+                }
+                catch (FileSystemException&)
+                {
+                    res.mFileSystemError = true;
+                }
+                catch (std::exception const& e)
+                {
+                    res.mError = e.what();
+                }
+                res.mDuration = std::chrono::steady_clock::now() - start;
+
+                // BasicWork's state is not thread-safe, so it is only updated
+                // on the main thread
+                app.postOnMainThread(
+                    [weak, checkpoint, generation, res]() {
+                        auto self = weak.lock();
+                        if (!self)
+                        {
+                            return;
+                        }
+                        --self->mChecksInFlight;
+                        // Results from before a reset are dropped, but the
+                        // work is still woken up as it may be waiting for a
+                        // slot to start its own checks.
+                        if (generation == self->mGeneration)
+                        {
+                            self->mCheckpointVerifications[checkpoint] = res;
+                        }
+                        if (!self->isAborting())
+                        {
+                            self->wakeUp();
+                        }
+                    },
+                    "VerifyLedgerChainWork: checkpoint verified");
+            },
+            "VerifyLedgerChainWork: verify checkpoint");
+
+        if (checkpoint == minCheckpoint)
+        {
+            mNextCheckpointToCheck.reset();
+        }
+        else
+        {
+            mNextCheckpointToCheck = checkpoint - hm.getCheckpointFrequency();
+        }
+    }
+}
+
+HistoryManager::LedgerVerificationStatus
+VerifyLedgerChainWork::verifyCheckpointLinks(
+    CheckpointVerification const& verification)
+{
+    ZoneScoped;
+    // Once the end of the range is reached, ensure that the chain agrees with
+    // trusted hash passed in.
+    auto const& curr = verification.mLast;
+    auto const& first = verification.mFirst;
 
     // We just finished scanning a checkpoint. We first grab the _incoming_
     // hash-link our caller (or previous call to this method) saved for us.
@@ -439,14 +550,24 @@ VerifyLedgerChainWork::onRun()
             "Verification undershot first ledger in the range.");
     }
 
-    HistoryManager::LedgerVerificationStatus result;
+    startCheckpointVerifications();
+    auto it = mCheckpointVerifications.find(mCurrCheckpoint);
+    if (it == mCheckpointVerifications.end() || !it->second)
+    {
+        // Either still running, or not started yet because checks from
+        // before a reset are still occupying the worker threads
+        return BasicWork::State::WORK_WAITING;
+    }
+    auto verification = std::move(*it->second);
+    mCheckpointVerifications.erase(it);
 
-    // Catch FS-related errors to gracefully fail Work instead of crashing
-    try
+    if (verification.mError)
     {
-        result = verifyHistoryOfSingleCheckpoint();
+        throw std::runtime_error(*verification.mError);
     }
-    catch (FileSystemException&)
+
+    // FS-related errors gracefully fail Work instead of crashing
+    if (verification.mFileSystemError)
     {
         CLOG_ERROR(History, "Catchup material failed verification");
         CLOG_ERROR(History, "{}", POSSIBLY_CORRUPTED_LOCAL_FS);
@@ -454,6 +575,22 @@ VerifyLedgerChainWork::onRun()
         return BasicWork::State::WORK_FAILURE;
     }
 
+    mApp.getCatchupManager().ledgersVerified(verification.mLedgersVerified);
+    mApp.getCatchupManager().getPerformanceReport().record(
+        CatchupPerformanceReport::Stage::VERIFY, verification.mDuration, 0,
+        verification.mLedgersVerified);
+    if (verification.mChainDisagreesWithLocalState)
+    {
+        mChainDisagreesWithLocalState =
+            verification.mChainDisagreesWithLocalState;
+    }
+
+    auto result = verification.mStatus;
+    if (result == HistoryManager::VERIFY_STATUS_OK)
+    {
+        result = verifyCheckpointLinks(verification);
+    }
+
     // If we verified ledger chain against trusted SCP hash, but observed a
     // failure related to local state (bad LCL, bad local ledger version, etc),
     // then there is no point retrying catchup - core will never be able to
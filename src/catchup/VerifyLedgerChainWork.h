@@ -7,8 +7,12 @@
 #include "history/HistoryManager.h"
 #include "ledger/LedgerRange.h"
 #include "work/Work.h"
+#include <chrono>
 #include <future>
 #include <iosfwd>
+#include <map>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace stellar
@@ -20,8 +24,31 @@ struct LedgerHeaderHistoryEntry;
 // This class verifies ledger chain of a given range by checking the hashes.
 // Note that verification is done starting with the latest checkpoint in the
 // range, and working its way backwards to the beginning of the range.
+//
+// The checks that only involve the ledgers of a single checkpoint (header
+// hashes, links between consecutive ledgers, agreement with LCL) don't
+// depend on each other, so they run on background threads for several
+// checkpoints at a time. Only the links between checkpoints, which carry
+// the trust from the trusted hash down the range, are checked in order on
+// the main thread.
 class VerifyLedgerChainWork : public BasicWork
 {
+    // Outcome of the checks of a single checkpoint made in the background
+    struct CheckpointVerification
+    {
+        HistoryManager::LedgerVerificationStatus mStatus{
+            HistoryManager::VERIFY_STATUS_OK};
+        std::optional<HistoryManager::LedgerVerificationStatus>
+            mChainDisagreesWithLocalState;
+        // First and last ledgers of the checkpoint read from the file
+        LedgerHeaderHistoryEntry mFirst;
+        LedgerHeaderHistoryEntry mLast;
+        uint32_t mLedgersVerified{0};
+        std::chrono::nanoseconds mDuration{0};
+        bool mFileSystemError{false};
+        std::optional<std::string> mError;
+    };
+
     TmpDir const& mDownloadDir;
     LedgerRange const mRange;
     uint32_t mCurrCheckpoint;
@@ -58,8 +85,8 @@ class VerifyLedgerChainWork : public BasicWork
     // a shared_future from the result of that call on construction.
     std::shared_future<LedgerNumHashPair> mVerifiedMinLedgerPrevFuture;
 
-    // Propagation link written on each call to verifyHistoryOfSingleCheckpoint,
-    // must match max ledger in current call to verifyHistoryOfSingleCheckpoint.
+    // Propagation link written on each call to verifyCheckpointLinks, must
+    // match max ledger in current call to verifyCheckpointLinks.
     LedgerNumHashPair mVerifiedAhead;
 
     // Max ledger of the min checkpoint in the verified range. This is the
@@ -72,7 +99,30 @@ class VerifyLedgerChainWork : public BasicWork
     std::vector<LedgerNumHashPair> mVerifiedLedgers;
     std::shared_ptr<std::ofstream> mOutputStream;
 
-    HistoryManager::LedgerVerificationStatus verifyHistoryOfSingleCheckpoint();
+    // Background checks of the checkpoints following (numerically lower
+    // than) `mCurrCheckpoint`, keyed by checkpoint. Entries are empty while
+    // the checks are running, and erased once the links to the checkpoint
+    // ahead are checked.
+    std::map<uint32_t, std::optional<CheckpointVerification>>
+        mCheckpointVerifications;
+    // Next checkpoint to start the background checks for, if any
+    std::optional<uint32_t> mNextCheckpointToCheck;
+    // Checks from before a reset are dropped when they complete
+    uint64_t mGeneration{0};
+    // Checks running in the background, including those from before a reset
+    size_t mChecksInFlight{0};
+#ifdef BUILD_TESTS
+    size_t mMaxChecksInFlight{0};
+#endif
+
+    static CheckpointVerification
+    verifyLedgersOfCheckpoint(std::string const& path, uint32_t checkpoint,
+                              uint32_t rangeLast,
+                              LedgerNumHashPair const& lastClosed,
+                              uint32_t maxLedgerVersion);
+    void startCheckpointVerifications();
+    HistoryManager::LedgerVerificationStatus
+    verifyCheckpointLinks(CheckpointVerification const& verification);
 
   public:
     VerifyLedgerChainWork(
@@ -96,6 +146,14 @@ class VerifyLedgerChainWork : public BasicWork
         return mMaxVerifiedLedgerOfMinCheckpoint;
     }
 
+#ifdef BUILD_TESTS
+    size_t
+    getMaxChecksInFlightForTesting() const
+    {
+        return mMaxChecksInFlight;
+    }
+#endif
+
   protected:
     void onReset() override;
 
@@ -105,7 +163,7 @@ class VerifyLedgerChainWork : public BasicWork
     bool
     onAbort() override
     {
-        return true;
+        return mChecksInFlight == 0;
     };
 };
 }
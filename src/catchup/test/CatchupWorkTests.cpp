@@ -235,4 +235,54 @@ TEST_CASE("CatchupRange starting on checkpoint boundary still replays it",
     REQUIRE(crange2.getBucketApplyLedger() == 63);
     REQUIRE(crange2.getReplayFirst() == 64);
     REQUIRE(crange2.getReplayCount() == 3);
-}
\ No newline at end of file
+}
+
+TEST_CASE("CatchupRange split into segments", "[catchup]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& historyManager = app->getHistoryManager();
+    auto const mode = CatchupConfiguration::Mode::OFFLINE_BASIC;
+
+    auto checkSegments = [&](CatchupConfiguration const& conf,
+                             uint32_t segments,
+                             std::vector<uint32_t> const& expected) {
+        CatchupRange range{1, conf, historyManager};
+        auto ends = range.getSegmentEnds(segments, historyManager);
+        REQUIRE(ends == expected);
+
+        // Every segment after the first starts from the buckets published at
+        // the end of the previous one
+        for (size_t i = 1; i < ends.size(); ++i)
+        {
+            CatchupConfiguration segConf{ends[i], ends[i] - ends[i - 1], mode};
+            CatchupRange segRange{1, segConf, historyManager};
+            REQUIRE(segRange.applyBuckets());
+            REQUIRE(segRange.getBucketApplyLedger() == ends[i - 1]);
+            REQUIRE(segRange.last() == ends[i]);
+        }
+    };
+
+    SECTION("full replay")
+    {
+        checkSegments({640, maxCount, mode}, 4, {191, 383, 511, 640});
+    }
+    SECTION("replay after buckets")
+    {
+        CatchupRange range{1, {640, 200, mode}, historyManager};
+        REQUIRE(range.getBucketApplyLedger() == 383);
+        checkSegments({640, 200, mode}, 2, {575, 640});
+    }
+    SECTION("more segments than checkpoints")
+    {
+        checkSegments({100, maxCount, mode}, 10, {63, 100});
+    }
+    SECTION("single segment")
+    {
+        checkSegments({640, maxCount, mode}, 1, {640});
+    }
+    SECTION("no replay")
+    {
+        checkSegments({639, 0, mode}, 4, {639});
+    }
+}
@@ -41,8 +41,15 @@ namespace stellar
 // makes all signature-verification in the program faster and
 // has no effect on correctness.
 
+//
+// Signatures are verified (and cached) from background threads too, so the
+// cache is only accessed under its mutex, and evicts with its own random
+// engine rather than gRandomEngine.
+
 static std::mutex gVerifySigCacheMutex;
-static RandomEvictionCache<Hash, bool> gVerifySigCache(0xffff);
+static stellar_default_random_engine gVerifySigCacheRandomEngine;
+static RandomEvictionCache<Hash, bool>
+    gVerifySigCache(0xffff, gVerifySigCacheRandomEngine);
 static uint64_t gVerifyCacheHit = 0;
 static uint64_t gVerifyCacheMiss = 0;
 
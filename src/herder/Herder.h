@@ -21,6 +21,7 @@ namespace stellar
 {
 class Application;
 class XDROutputFileStream;
+class TxFrameInternTable;
 
 /*
  * Public Interface to the Herder module
@@ -126,6 +127,13 @@ class Herder
     // We are learning about a new transaction.
     virtual TransactionQueue::AddResult
     recvTransaction(TransactionFrameBasePtr tx, bool submittedFromSelf) = 0;
+    // Same as `recvTransaction`, but when BACKGROUND_TX_SIG_VERIFICATION is
+    // enabled the signatures of `tx` are verified on a background thread
+    // first, and `onResult` is called later on the main thread. Otherwise
+    // `onResult` is called before returning.
+    virtual void recvTransactionAsync(
+        TransactionFrameBasePtr tx, bool submittedFromSelf,
+        std::function<void(TransactionQueue::AddResult)> onResult) = 0;
     virtual void peerDoesntHave(stellar::MessageType type,
                                 uint256 const& itemID, Peer::pointer peer) = 0;
     virtual TxSetXDRFrameConstPtr getTxSet(Hash const& hash) = 0;
@@ -221,5 +229,10 @@ class Herder
 
     virtual bool isBannedTx(Hash const& hash) const = 0;
     virtual TransactionFrameBaseConstPtr getTx(Hash const& hash) const = 0;
+
+    // Frames of the transactions known to this node; transactions coming
+    // from the overlay and from tx sets are looked up there so that they
+    // share a single frame.
+    virtual TxFrameInternTable& getTxFrameInternTable() = 0;
 };
 }
@@ -6,13 +6,18 @@
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
 #include "crypto/SHA.h"
+#include "bucket/BucketListSnapshot.h"
+#include "bucket/BucketManager.h"
 #include "crypto/SecretKey.h"
 #include "herder/HerderPersistence.h"
 #include "herder/HerderUtils.h"
 #include "herder/LedgerCloseData.h"
 #include "herder/QuorumIntersectionChecker.h"
+#include "herder/SCPStateJournal.h"
 #include "herder/TxSetFrame.h"
 #include "herder/TxSetUtils.h"
+#include "history/CheckpointBuilder.h"
+#include "history/HistoryManager.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
@@ -25,6 +30,7 @@
 #include "overlay/OverlayManager.h"
 #include "scp/LocalNode.h"
 #include "scp/Slot.h"
+#include "transactions/SignatureUtils.h"
 #include "transactions/TransactionUtils.h"
 #include "util/DebugMetaUtils.h"
 #include "util/LogSlowExecution.h"
@@ -56,6 +62,9 @@ constexpr uint32 const TRANSACTION_QUEUE_TIMEOUT_LEDGERS = 4;
 constexpr uint32 const TRANSACTION_QUEUE_BAN_LEDGERS = 10;
 constexpr uint32 const TRANSACTION_QUEUE_SIZE_MULTIPLIER = 2;
 constexpr uint32 const SOROBAN_TRANSACTION_QUEUE_SIZE_MULTIPLIER = 2;
+// Bounds the number of times candidates are pulled again from the queues to
+// replace invalid transactions when building a tx set to nominate.
+constexpr uint32 const NOMINATION_TX_MAX_ROUNDS = 4;
 
 std::unique_ptr<Herder>
 Herder::create(Application& app)
@@ -75,11 +84,18 @@ HerderImpl::SCPMetrics::SCPMetrics(Application& app)
           {"scp", "envelope", "validsig"}, "envelope"))
     , mEnvelopeInvalidSig(app.getMetrics().NewMeter(
           {"scp", "envelope", "invalidsig"}, "envelope"))
+    , mTxSetCandidateBuild(
+          app.getMetrics().NewTimer({"herder", "tx-set-candidate", "build"}))
+    , mTxSetCandidateHit(app.getMetrics().NewMeter(
+          {"herder", "tx-set-candidate", "hit"}, "txset"))
+    , mTxSetCandidateMiss(app.getMetrics().NewMeter(
+          {"herder", "tx-set-candidate", "miss"}, "txset"))
 {
 }
 
 HerderImpl::HerderImpl(Application& app)
-    : mTransactionQueue(app, TRANSACTION_QUEUE_TIMEOUT_LEDGERS,
+    : mTxFrameInternTable(app)
+    , mTransactionQueue(app, TRANSACTION_QUEUE_TIMEOUT_LEDGERS,
                         TRANSACTION_QUEUE_BAN_LEDGERS,
                         TRANSACTION_QUEUE_SIZE_MULTIPLIER)
     , mPendingEnvelopes(app, *this)
@@ -88,8 +104,10 @@ HerderImpl::HerderImpl(Application& app)
     , mTrackingTimer(app)
     , mLastExternalize(app.getClock().now())
     , mTriggerTimer(app)
+    , mTxSetCandidateTimer(app)
     , mOutOfSyncTimer(app)
     , mTxSetGarbageCollectTimer(app)
+    , mSCPStateJournal(app)
     , mApp(app)
     , mLedgerManager(app.getLedgerManager())
     , mSCPMetrics(app)
@@ -267,6 +285,7 @@ HerderImpl::shutdown()
     mTrackingTimer.cancel();
     mOutOfSyncTimer.cancel();
     mTriggerTimer.cancel();
+    mTxSetCandidateTimer.cancel();
     if (mLastQuorumMapIntersectionState.mRecalculating)
     {
         // We want to interrupt any calculation-in-progress at shutdown to
@@ -282,6 +301,7 @@ HerderImpl::shutdown()
     }
 
     mTxSetGarbageCollectTimer.cancel();
+    mSCPStateJournal.close();
 }
 
 void
@@ -305,11 +325,20 @@ HerderImpl::processExternalized(uint64 slotIndex, StellarValue const& value,
     TxSetXDRFrameConstPtr externalizedSet =
         mPendingEnvelopes.getTxSet(value.txSetHash);
 
-    // save the SCP messages in the database
+    // save the SCP messages in the checkpoint files if the ledger is streamed
+    // to them, and in the database otherwise
+    auto builder = mApp.getHistoryManager().getCheckpointBuilder();
+    bool streamed = false;
+    if (builder)
+    {
+        builder->appendSCPHistory(static_cast<uint32>(slotIndex),
+                                  getSCP().getExternalizingState(slotIndex));
+        streamed = builder->streams(static_cast<uint32>(slotIndex));
+    }
     if (mApp.getConfig().MODE_STORES_HISTORY_MISC)
     {
         ZoneNamedN(updateSCPHistoryZone, "update SCP history", true);
-        if (slotIndex != 0)
+        if (slotIndex != 0 && !streamed)
         {
             // Save any new SCP messages received about the previous ledger.
             // NOTE: This call uses an empty `QuorumTracker::QuorumMap` because
@@ -322,7 +351,8 @@ HerderImpl::processExternalized(uint64 slotIndex, StellarValue const& value,
         // Store SCP messages received about the current ledger being closed.
         mApp.getHerderPersistence().saveSCPHistory(
             static_cast<uint32>(slotIndex),
-            getSCP().getExternalizingState(slotIndex),
+            streamed ? std::vector<SCPEnvelope>{}
+                     : getSCP().getExternalizingState(slotIndex),
             mPendingEnvelopes.getCurrentlyTrackedQuorum());
     }
 
@@ -428,6 +458,8 @@ HerderImpl::valueExternalized(uint64 slotIndex, StellarValue const& value,
         // we do not want it to trigger while downloading the current set
         // and there is no point in taking a position after the round is over
         mTriggerTimer.cancel();
+        mTxSetCandidateTimer.cancel();
+        mTxSetCandidate.reset();
 
         // This call may cause LedgerManager to close ledger and trigger next
         // ledger
@@ -539,7 +571,8 @@ HerderImpl::emitEnvelope(SCPEnvelope const& envelope)
 
     persistSCPState(slotIndex);
 
-    broadcast(envelope);
+    // Peers must not see a statement that the node could forget by crashing
+    mSCPStateJournal.whenSynced([this, envelope]() { broadcast(envelope); });
 }
 
 TransactionQueue::AddResult
@@ -590,6 +623,82 @@ HerderImpl::recvTransaction(TransactionFrameBasePtr tx, bool submittedFromSelf)
     return result;
 }
 
+namespace
+{
+std::vector<PublicKey>
+loadEd25519Signers(SearchableBucketListSnapshot& snapshot,
+                   AccountID const& accountID)
+{
+    std::vector<PublicKey> signers;
+    auto entry = snapshot.getLedgerEntry(accountKey(accountID));
+    if (entry)
+    {
+        for (auto const& signer : entry->data.account().signers)
+        {
+            if (signer.key.type() == SIGNER_KEY_TYPE_ED25519)
+            {
+                signers.emplace_back(
+                    KeyUtils::convertKey<PublicKey>(signer.key));
+            }
+        }
+    }
+    return signers;
+}
+}
+
+void
+HerderImpl::recvTransactionAsync(
+    TransactionFrameBasePtr tx, bool submittedFromSelf,
+    std::function<void(TransactionQueue::AddResult)> onResult)
+{
+    ZoneScoped;
+    auto const& cfg = mApp.getConfig();
+    if (!cfg.BACKGROUND_TX_SIG_VERIFICATION)
+    {
+        onResult(recvTransaction(tx, submittedFromSelf));
+        return;
+    }
+
+    // Compute the hashes while the frame is only accessed by this thread, so
+    // that the background thread only reads it.
+    tx->getFullHash();
+    tx->getContentsHash();
+
+    BucketSnapshotManager const* snapshotManager = nullptr;
+    if (cfg.isUsingBucketListDB())
+    {
+        snapshotManager = &mApp.getBucketManager().getBucketSnapshotManager();
+    }
+
+    auto& app = mApp;
+    app.postOnBackgroundThread(
+        [&app, tx, submittedFromSelf, onResult, snapshotManager]() {
+            // Transaction admission needs LedgerTxn and hence stays on the
+            // main thread. Verifying the signatures here (against the
+            // account signers from a BucketList snapshot, when available)
+            // lets it hit the signature cache instead.
+            std::unique_ptr<SearchableBucketListSnapshot> snapshot;
+            SignatureUtils::AccountSignersLoader loadSigners;
+            if (snapshotManager)
+            {
+                snapshot = snapshotManager->getSearchableBucketListSnapshot();
+                loadSigners = [&snapshot](AccountID const& accountID) {
+                    return loadEd25519Signers(*snapshot, accountID);
+                };
+            }
+            SignatureUtils::populateSignatureCache(*tx, app.getNetworkID(),
+                                                   loadSigners);
+
+            app.postOnMainThread(
+                [&app, tx, submittedFromSelf, onResult]() {
+                    onResult(
+                        app.getHerder().recvTransaction(tx, submittedFromSelf));
+                },
+                "recvTransactionAsync: add to queue");
+        },
+        "recvTransactionAsync: verify signatures");
+}
+
 bool
 HerderImpl::checkCloseTime(SCPEnvelope const& envelope, bool enforceRecent)
 {
@@ -1038,6 +1147,12 @@ HerderImpl::getPendingEnvelopes()
     return mPendingEnvelopes;
 }
 
+SCPStateJournal&
+HerderImpl::getSCPStateJournal()
+{
+    return mSCPStateJournal;
+}
+
 ClassicTransactionQueue&
 HerderImpl::getTransactionQueue()
 {
@@ -1162,6 +1277,20 @@ HerderImpl::setupTriggerNextLedger()
         triggerTime += ctOffset;
     }
 
+    mTxSetCandidateTimer.cancel();
+    mTxSetCandidate.reset();
+    auto lead = std::chrono::milliseconds(
+        mApp.getConfig().TX_SET_CANDIDATE_LEAD_TIME_MS);
+    if (lead > std::chrono::milliseconds::zero() &&
+        !mApp.getConfig().MANUAL_CLOSE)
+    {
+        // Fires right away if the trigger is less than `lead` away
+        mTxSetCandidateTimer.expires_at(triggerTime - lead);
+        mTxSetCandidateTimer.async_wait(
+            [this, lead]() { buildTxSetCandidate(lead); },
+            &VirtualTimer::onFailureNoop);
+    }
+
     // even if ballot protocol started before triggering, we just use that
     // time as reference point for triggering again (this may trigger right
     // away if externalizing took a long time)
@@ -1302,19 +1431,7 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
         return;
     }
 
-    // our first choice for this round's set is all the tx we have collected
-    // during last few ledger closes
     auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
-    TxSetPhaseTransactions txPhases;
-    txPhases.emplace_back(mTransactionQueue.getTransactions(lcl.header));
-
-    if (protocolVersionStartsFrom(lcl.header.ledgerVersion,
-                                  SOROBAN_PROTOCOL_VERSION))
-    {
-        releaseAssert(mSorobanTransactionQueue);
-        txPhases.emplace_back(
-            mSorobanTransactionQueue->getTransactions(lcl.header));
-    }
 
     // We pick as next close time the current time unless it's before the last
     // close time. We don't know how much time it will take to reach consensus
@@ -1347,23 +1464,32 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
     upperBoundCloseTimeOffset = nextCloseTime - lcl.header.scpValue.closeTime;
     lowerBoundCloseTimeOffset = upperBoundCloseTimeOffset;
 
+    TxSetXDRFrameConstPtr proposedSet;
     TxSetPhaseTransactions invalidTxPhases;
-    invalidTxPhases.resize(txPhases.size());
-
-    auto [proposedSet, applicableProposedSet] =
-        makeTxSetFromTransactions(txPhases, mApp, lowerBoundCloseTimeOffset,
-                                  upperBoundCloseTimeOffset, invalidTxPhases);
-
-    if (protocolVersionStartsFrom(lcl.header.ledgerVersion,
-                                  SOROBAN_PROTOCOL_VERSION))
+    if (mTxSetCandidate && mTxSetCandidate->mLclHash == lcl.hash &&
+        nextCloseTime >= mTxSetCandidate->mMinCloseTime &&
+        nextCloseTime <= mTxSetCandidate->mMaxCloseTime)
     {
-        releaseAssert(mSorobanTransactionQueue);
-        mSorobanTransactionQueue->ban(
-            invalidTxPhases[static_cast<size_t>(TxSetPhase::SOROBAN)]);
+        mSCPMetrics.mTxSetCandidateHit.Mark();
+        proposedSet = mTxSetCandidate->mTxSet;
+        invalidTxPhases = std::move(mTxSetCandidate->mInvalidTxPhases);
     }
+    else
+    {
+        if (mApp.getConfig().TX_SET_CANDIDATE_LEAD_TIME_MS > 0)
+        {
+            mSCPMetrics.mTxSetCandidateMiss.Mark();
+        }
 
-    mTransactionQueue.ban(
-        invalidTxPhases[static_cast<size_t>(TxSetPhase::CLASSIC)]);
+        // our first choice for this round's set is all the tx we have
+        // collected during last few ledger closes
+        proposedSet = makeTxSetToNominate(lcl.header, lowerBoundCloseTimeOffset,
+                                          upperBoundCloseTimeOffset,
+                                          invalidTxPhases);
+    }
+    mTxSetCandidate.reset();
+
+    banInvalidTxs(invalidTxPhases, lcl.header.ledgerVersion);
 
     auto txSetHash = proposedSet->getContentsHash();
 
@@ -1424,6 +1550,116 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
                               lcl.header.scpValue);
 }
 
+TxSetPhaseTransactions
+HerderImpl::getTransactionsToNominate(LedgerHeader const& lcl,
+                                      UnorderedSet<Hash> const& exclude) const
+{
+    auto multiplier = mApp.getConfig().NOMINATION_TX_LEDGER_MULTIPLIER;
+    TxSetPhaseTransactions txPhases;
+    txPhases.emplace_back(
+        mTransactionQueue.getTopTransactions(lcl, multiplier, exclude));
+
+    if (protocolVersionStartsFrom(lcl.ledgerVersion, SOROBAN_PROTOCOL_VERSION))
+    {
+        releaseAssert(mSorobanTransactionQueue);
+        txPhases.emplace_back(mSorobanTransactionQueue->getTopTransactions(
+            lcl, multiplier, exclude));
+    }
+    return txPhases;
+}
+
+TxSetXDRFrameConstPtr
+HerderImpl::makeTxSetToNominate(LedgerHeader const& lcl,
+                                uint64_t lowerBoundCloseTimeOffset,
+                                uint64_t upperBoundCloseTimeOffset,
+                                TxSetPhaseTransactions& invalidTxPhases) const
+{
+    ZoneScoped;
+    UnorderedSet<Hash> invalidTxs;
+    invalidTxPhases.clear();
+    for (uint32 round = 1;; ++round)
+    {
+        auto txPhases = getTransactionsToNominate(lcl, invalidTxs);
+        invalidTxPhases.resize(txPhases.size());
+        TxSetPhaseTransactions newInvalidTxPhases(txPhases.size());
+        auto [txSet, applicableTxSet] = makeTxSetFromTransactions(
+            txPhases, mApp, lowerBoundCloseTimeOffset,
+            upperBoundCloseTimeOffset, newInvalidTxPhases);
+
+        // Invalid transactions only need to be replaced if the set holds all
+        // the valid ones: otherwise surge pricing already left some out
+        bool hasRoom = false;
+        for (size_t i = 0; i < txPhases.size(); ++i)
+        {
+            auto const& newInvalid = newInvalidTxPhases[i];
+            for (auto const& tx : newInvalid)
+            {
+                invalidTxs.emplace(tx->getFullHash());
+                invalidTxPhases[i].emplace_back(tx);
+            }
+            if (!newInvalid.empty() &&
+                applicableTxSet->sizeTx(static_cast<TxSetPhase>(i)) ==
+                    txPhases[i].size() - newInvalid.size())
+            {
+                hasRoom = true;
+            }
+        }
+        if (!hasRoom || round == NOMINATION_TX_MAX_ROUNDS)
+        {
+            return txSet;
+        }
+        CLOG_DEBUG(Herder,
+                   "Pulling more transactions to nominate after {} invalid "
+                   "ones",
+                   invalidTxs.size());
+    }
+}
+
+void
+HerderImpl::banInvalidTxs(TxSetPhaseTransactions const& invalidTxPhases,
+                          uint32_t ledgerVersion)
+{
+    if (protocolVersionStartsFrom(ledgerVersion, SOROBAN_PROTOCOL_VERSION))
+    {
+        releaseAssert(mSorobanTransactionQueue);
+        mSorobanTransactionQueue->ban(
+            invalidTxPhases[static_cast<size_t>(TxSetPhase::SOROBAN)]);
+    }
+
+    mTransactionQueue.ban(
+        invalidTxPhases[static_cast<size_t>(TxSetPhase::CLASSIC)]);
+}
+
+void
+HerderImpl::buildTxSetCandidate(std::chrono::milliseconds lead)
+{
+    ZoneScoped;
+    if (!isTracking() || !mLedgerManager.isSynced())
+    {
+        return;
+    }
+
+    auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
+    auto lastCloseTime = lcl.header.scpValue.closeTime;
+
+    // The close time is only known once the trigger timer fires, so validate
+    // against the whole range it can fall in: from now until the expected
+    // trigger, plus a second of slack in case the timer fires late.
+    auto now = mApp.getClock().system_now();
+    TxSetCandidate candidate;
+    candidate.mLclHash = lcl.hash;
+    candidate.mMinCloseTime =
+        std::max<uint64_t>(VirtualClock::to_time_t(now), lastCloseTime + 1);
+    candidate.mMaxCloseTime = std::max<uint64_t>(
+        VirtualClock::to_time_t(now + lead) + 1, candidate.mMinCloseTime);
+
+    auto timer = mSCPMetrics.mTxSetCandidateBuild.TimeScope();
+    candidate.mTxSet = makeTxSetToNominate(
+        lcl.header, candidate.mMinCloseTime - lastCloseTime,
+        candidate.mMaxCloseTime - lastCloseTime, candidate.mInvalidTxPhases);
+    mTxSetCandidate = std::move(candidate);
+}
+
 void
 HerderImpl::setUpgrades(Upgrades::UpgradeParameters const& upgrades)
 {
@@ -1523,6 +1759,30 @@ HerderImpl::getJsonTransitiveQuorumIntersectionInfo(bool fullKeys) const
         static_cast<Json::UInt64>(mLastQuorumMapIntersectionState.mNumNodes);
     ret["last_check_ledger"] = static_cast<Json::UInt64>(
         mLastQuorumMapIntersectionState.mLastCheckLedger);
+
+    auto const& lastProgress =
+        mLastQuorumMapIntersectionState.mLastCheckProgress;
+    Json::Value& lastCheck = ret["last_check"];
+    lastCheck["duration_ms"] = static_cast<Json::UInt64>(
+        mLastQuorumMapIntersectionState.mLastCheckDuration.count());
+    lastCheck["threads"] = static_cast<Json::UInt64>(lastProgress.mThreads);
+    lastCheck["subproblems"] =
+        static_cast<Json::UInt64>(lastProgress.mSubproblems);
+    lastCheck["cached"] = lastProgress.mCachedResult;
+    if (auto const& checker = mLastQuorumMapIntersectionState.mChecker)
+    {
+        auto progress = checker->getProgress();
+        Json::Value& recalc = ret["recalculating"];
+        recalc["elapsed_ms"] = static_cast<Json::UInt64>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() -
+                mLastQuorumMapIntersectionState.mCheckStart)
+                .count());
+        recalc["subproblems"] =
+            static_cast<Json::UInt64>(progress.mSubproblems);
+        recalc["subproblems_done"] =
+            static_cast<Json::UInt64>(progress.mSubproblemsDone);
+    }
     if (mLastQuorumMapIntersectionState.enjoysQuorunIntersection())
     {
         Json::Value critical;
@@ -1789,14 +2049,19 @@ HerderImpl::checkAndMaybeReanalyzeQuorumMap()
         auto& cfg = mApp.getConfig();
         releaseAssert(threadIsMain());
         auto seed = gRandomEngine();
+        auto sccCache = mLastQuorumMapIntersectionState.mSCCCache;
         auto qic = QuorumIntersectionChecker::create(
-            qmap, cfg, mLastQuorumMapIntersectionState.mInterruptFlag, seed);
+            qmap, cfg, mLastQuorumMapIntersectionState.mInterruptFlag, seed,
+            /* quiet */ false, sccCache);
+        mLastQuorumMapIntersectionState.mChecker = qic;
+        mLastQuorumMapIntersectionState.mCheckStart =
+            std::chrono::steady_clock::now();
         auto ledger = trackingConsensusLedgerIndex();
         auto nNodes = qmap.size();
         auto& hState = mLastQuorumMapIntersectionState;
         auto& app = mApp;
-        auto worker = [curr, ledger, nNodes, qic, qmap, cfg, seed, &app,
-                       &hState] {
+        auto worker = [curr, ledger, nNodes, qic, qmap, cfg, seed, sccCache,
+                       &app, &hState] {
             try
             {
                 ZoneScoped;
@@ -1810,7 +2075,7 @@ HerderImpl::checkAndMaybeReanalyzeQuorumMap()
                     // and raise an alarm.
                     critical = QuorumIntersectionChecker::
                         getIntersectionCriticalGroups(
-                            qmap, cfg, hState.mInterruptFlag, seed);
+                            qmap, cfg, hState.mInterruptFlag, seed, sccCache);
                 }
                 app.postOnMainThread(
                     [ok, curr, ledger, nNodes, split, critical, &hState] {
@@ -1822,6 +2087,14 @@ HerderImpl::checkAndMaybeReanalyzeQuorumMap()
                         hState.mCheckingQuorumMapHash = Hash{};
                         hState.mPotentialSplit = split;
                         hState.mIntersectionCriticalNodes = critical;
+                        hState.mLastCheckDuration =
+                            std::chrono::duration_cast<
+                                std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() -
+                                hState.mCheckStart);
+                        hState.mLastCheckProgress =
+                            hState.mChecker->getProgress();
+                        hState.mChecker.reset();
                         if (ok)
                         {
                             hState.mLastGoodLedger = ledger;
@@ -1838,6 +2111,7 @@ HerderImpl::checkAndMaybeReanalyzeQuorumMap()
                         hState.mRecalculating = false;
                         hState.mInterruptFlag = false;
                         hState.mCheckingQuorumMapHash = Hash{};
+                        hState.mChecker.reset();
                     },
                     "QuorumIntersectionChecker interrupted");
             }
@@ -1850,7 +2124,8 @@ void
 HerderImpl::persistSCPState(uint64 slot)
 {
     ZoneScoped;
-    if (slot < mLastSlotSaved)
+    // The journal is opened in `start`
+    if (slot < mLastSlotSaved || !mSCPStateJournal.isOpen())
     {
         return;
     }
@@ -1858,9 +2133,9 @@ HerderImpl::persistSCPState(uint64 slot)
     mLastSlotSaved = slot;
     // saves SCP messages and related data (transaction sets, quorum sets)
     PersistedSCPState scpState;
-    scpState.v(1);
+    scpState.v(0);
 
-    auto& latestEnvs = scpState.v1().scpEnvelopes;
+    auto& latestEnvs = scpState.v0().scpEnvelopes;
     std::map<Hash, TxSetXDRFrameConstPtr> txSets;
     std::map<Hash, SCPQuorumSetPtr> quorumSets;
 
@@ -1872,7 +2147,7 @@ HerderImpl::persistSCPState(uint64 slot)
         for (auto const& h : getTxSetHashes(e))
         {
             auto txSet = mPendingEnvelopes.getTxSet(h);
-            if (txSet && !mApp.getPersistentState().hasTxSet(h))
+            if (txSet && !mSCPStateJournal.hasTxSet(h))
             {
                 txSets.insert(std::make_pair(h, txSet));
             }
@@ -1885,41 +2160,102 @@ HerderImpl::persistSCPState(uint64 slot)
         }
     }
 
-    auto& latestQSets = scpState.v1().quorumSets;
+    auto& latestQSets = scpState.v0().quorumSets;
     for (auto it : quorumSets)
     {
         latestQSets.emplace_back(*it.second);
     }
 
-    stellar::Value latestSCPData;
-
-    std::unordered_map<Hash, std::string> txSetsToPersist;
+    std::vector<Hash> txSetHashes;
     for (auto it : txSets)
     {
         StoredTransactionSet tempTxSet;
         it.second->storeXDR(tempTxSet);
-        txSetsToPersist.emplace(
-            it.first, decoder::encode_b64(xdr::xdr_to_opaque(tempTxSet)));
+        scpState.v0().txSets.emplace_back(tempTxSet);
+        txSetHashes.emplace_back(it.first);
     }
 
-    latestSCPData = xdr::xdr_to_opaque(scpState);
+    mSCPStateJournal.append(scpState, txSetHashes);
+}
 
-    std::string encodedScpState = decoder::encode_b64(latestSCPData);
+void
+HerderImpl::restoreSCPState(std::vector<PersistedSCPState> const& states)
+{
+    ZoneScoped;
+
+    // Load all known tx sets first, as the envelopes may refer to tx sets
+    // stored along with other slots
+    for (auto const& scpState : states)
+    {
+        for (auto const& storedSet : scpState.v0().txSets)
+        {
+            try
+            {
+                TxSetXDRFrameConstPtr cur =
+                    TxSetXDRFrame::makeFromStoredTxSet(storedSet);
+                Hash h = cur->getContentsHash();
+                mPendingEnvelopes.addTxSet(h, 0, cur);
+            }
+            catch (std::exception& e)
+            {
+                // we may have exceptions when upgrading the protocol
+                // this should be the only time we get exceptions decoding old
+                // messages.
+                CLOG_INFO(Herder,
+                          "Error while restoring old tx sets, "
+                          "proceeding without them : {}",
+                          e.what());
+            }
+        }
+    }
 
-    mApp.getPersistentState().setSCPStateV1ForSlot(slot, encodedScpState,
-                                                   txSetsToPersist);
+    for (auto const& scpState : states)
+    {
+        try
+        {
+            for (auto const& qset : scpState.v0().quorumSets)
+            {
+                Hash hash = xdrSha256(qset);
+                mPendingEnvelopes.addSCPQuorumSet(hash, qset);
+            }
+            for (auto const& e : scpState.v0().scpEnvelopes)
+            {
+                auto envW = getHerderSCPDriver().wrapEnvelope(e);
+                getSCP().setStateFromEnvelope(e.statement.slotIndex, envW);
+                mLastSlotSaved =
+                    std::max<uint64>(mLastSlotSaved, e.statement.slotIndex);
+            }
+        }
+        catch (std::exception& e)
+        {
+            // we may have exceptions when upgrading the protocol
+            // this should be the only time we get exceptions decoding old
+            // messages.
+            CLOG_INFO(Herder,
+                      "Error while restoring old scp messages, "
+                      "proceeding without them : {}",
+                      e.what());
+        }
+    }
+    mPendingEnvelopes.rebuildQuorumTrackerState();
 }
 
 void
-HerderImpl::restoreSCPState()
+HerderImpl::migrateSCPStateFromDatabase()
 {
     ZoneScoped;
 
-    // Delete any old tx sets
-    purgeOldPersistedTxSets();
+    auto latest64 = mApp.getPersistentState().getSCPStateAllSlots();
+    auto latestTxSets = mApp.getPersistentState().getTxSetsForAllSlots();
+    if (latest64.empty() && latestTxSets.empty())
+    {
+        return;
+    }
+    CLOG_INFO(Herder, "Moving SCP state from the database to {}",
+              SCPStateJournal::getPath(mApp.getConfig()));
 
     // Load all known tx sets
-    auto latestTxSets = mApp.getPersistentState().getTxSetsForAllSlots();
+    std::map<Hash, StoredTransactionSet> storedSets;
     for (auto const& txSet : latestTxSets)
     {
         try
@@ -1933,6 +2269,7 @@ HerderImpl::restoreSCPState()
                 TxSetXDRFrame::makeFromStoredTxSet(storedSet);
             Hash h = cur->getContentsHash();
             mPendingEnvelopes.addTxSet(h, 0, cur);
+            storedSets.emplace(h, std::move(storedSet));
         }
         catch (std::exception& e)
         {
@@ -1947,8 +2284,6 @@ HerderImpl::restoreSCPState()
     }
 
     // load saved state from database
-    auto latest64 = mApp.getPersistentState().getSCPStateAllSlots();
-
     for (auto const& state : latest64)
     {
         try
@@ -1963,13 +2298,33 @@ HerderImpl::restoreSCPState()
                 Hash hash = xdrSha256(qset);
                 mPendingEnvelopes.addSCPQuorumSet(hash, qset);
             }
+
+            PersistedSCPState record;
+            record.v(0);
+            record.v0().scpEnvelopes = scpState.v1().scpEnvelopes;
+            record.v0().quorumSets = scpState.v1().quorumSets;
+            std::vector<Hash> txSetHashes;
             for (auto const& e : scpState.v1().scpEnvelopes)
             {
                 auto envW = getHerderSCPDriver().wrapEnvelope(e);
                 getSCP().setStateFromEnvelope(e.statement.slotIndex, envW);
                 mLastSlotSaved =
                     std::max<uint64>(mLastSlotSaved, e.statement.slotIndex);
+
+                for (auto const& h : getTxSetHashes(e))
+                {
+                    auto it = storedSets.find(h);
+                    if (it != storedSets.end() &&
+                        !mSCPStateJournal.hasTxSet(h) &&
+                        std::find(txSetHashes.begin(), txSetHashes.end(),
+                                  h) == txSetHashes.end())
+                    {
+                        record.v0().txSets.emplace_back(it->second);
+                        txSetHashes.emplace_back(h);
+                    }
+                }
             }
+            mSCPStateJournal.append(record, txSetHashes);
         }
         catch (std::exception& e)
         {
@@ -1981,8 +2336,12 @@ HerderImpl::restoreSCPState()
                       "proceeding without them : {}",
                       e.what());
         }
-        mPendingEnvelopes.rebuildQuorumTrackerState();
     }
+    mPendingEnvelopes.rebuildQuorumTrackerState();
+
+    // Only drop the state from the database once the journal is synced
+    mSCPStateJournal.compact();
+    mApp.getPersistentState().clearSCPStateAllSlots();
 }
 
 void
@@ -2115,6 +2474,8 @@ HerderImpl::start()
         throw std::runtime_error(msg);
     }
 
+    auto scpStates = mSCPStateJournal.open();
+
     // setup a sufficient state that we can participate in consensus
     auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
 
@@ -2131,8 +2492,10 @@ HerderImpl::start()
         setTrackingSCPState(lcl.header.ledgerSeq, lcl.header.scpValue,
                             /* isTrackingNetwork */ true);
         trackingHeartBeat();
-        // Load SCP state from the database
-        restoreSCPState();
+        // Load SCP state from the journal, and from the database if an older
+        // version left it there
+        restoreSCPState(scpStates);
+        migrateSCPStateFromDatabase();
     }
 
     restoreUpgrades();
@@ -2144,43 +2507,17 @@ HerderImpl::startTxSetGCTimer()
 {
     mTxSetGarbageCollectTimer.expires_from_now(TX_SET_GC_DELAY);
     mTxSetGarbageCollectTimer.async_wait(
-        [this]() { purgeOldPersistedTxSets(); }, &VirtualTimer::onFailureNoop);
+        [this]() { compactSCPStateJournal(); }, &VirtualTimer::onFailureNoop);
 }
 
 void
-HerderImpl::purgeOldPersistedTxSets()
+HerderImpl::compactSCPStateJournal()
 {
     ZoneScoped;
 
     try
     {
-        auto hashesToDelete =
-            mApp.getPersistentState().getTxSetHashesForAllSlots();
-        for (auto const& state :
-             mApp.getPersistentState().getSCPStateAllSlots())
-        {
-            try
-            {
-                std::vector<uint8_t> buffer;
-                decoder::decode_b64(state, buffer);
-
-                PersistedSCPState scpState;
-                xdr::xdr_from_opaque(buffer, scpState);
-                for (auto const& e : scpState.v1().scpEnvelopes)
-                {
-                    for (auto const& hash : getTxSetHashes(e))
-                    {
-                        hashesToDelete.erase(hash);
-                    }
-                }
-            }
-            catch (std::exception& e)
-            {
-                CLOG_ERROR(Herder, "Error while deleting old tx sets: {}",
-                           e.what());
-            }
-        }
-        mApp.getPersistentState().deleteTxSets(hashesToDelete);
+        mSCPStateJournal.compact();
         startTxSetGCTimer();
     }
     catch (std::exception& e)
@@ -2218,7 +2555,7 @@ HerderImpl::updateTransactionQueue(TxSetXDRFrameConstPtr externalizedTxSet)
         return;
     }
     auto txsPerPhase =
-        externalizedTxSet->createTransactionFrames(mApp.getNetworkID());
+        externalizedTxSet->createTransactionFrames(mTxFrameInternTable);
 
     auto lhhe = mLedgerManager.getLastClosedLedgerHeader();
 
@@ -2390,4 +2727,10 @@ HerderImpl::getTx(Hash const& hash) const
     return classic;
 }
 
+TxFrameInternTable&
+HerderImpl::getTxFrameInternTable()
+{
+    return mTxFrameInternTable;
+}
+
 }
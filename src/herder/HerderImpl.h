@@ -7,11 +7,15 @@
 #include "herder/Herder.h"
 #include "herder/HerderSCPDriver.h"
 #include "herder/PendingEnvelopes.h"
+#include "herder/QuorumIntersectionChecker.h"
+#include "herder/SCPStateJournal.h"
 #include "herder/TransactionQueue.h"
+#include "herder/TxFrameInternTable.h"
 #include "herder/Upgrades.h"
 #include "util/Timer.h"
 #include "util/UnorderedMap.h"
 #include "util/XDROperators.h"
+#include <chrono>
 #include <deque>
 #include <memory>
 #include <vector>
@@ -97,6 +101,9 @@ class HerderImpl : public Herder
     TransactionQueue::AddResult
     recvTransaction(TransactionFrameBasePtr tx,
                     bool submittedFromSelf) override;
+    void recvTransactionAsync(
+        TransactionFrameBasePtr tx, bool submittedFromSelf,
+        std::function<void(TransactionQueue::AddResult)> onResult) override;
 
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) override;
 #ifdef BUILD_TESTS
@@ -193,6 +200,7 @@ class HerderImpl : public Herder
 #ifdef BUILD_TESTS
     // used for testing
     PendingEnvelopes& getPendingEnvelopes();
+    SCPStateJournal& getSCPStateJournal();
 
     ClassicTransactionQueue& getTransactionQueue() override;
     SorobanTransactionQueue& getSorobanTransactionQueue() override;
@@ -213,6 +221,7 @@ class HerderImpl : public Herder
 
     bool isBannedTx(Hash const& hash) const override;
     TransactionFrameBaseConstPtr getTx(Hash const& hash) const override;
+    TxFrameInternTable& getTxFrameInternTable() override;
 
   private:
     // return true if values referenced by envelope have a valid close time:
@@ -228,6 +237,27 @@ class HerderImpl : public Herder
 
     void setupTriggerNextLedger();
 
+    // Transactions from the queues that are candidates for nomination on top
+    // of `lcl`, one entry per tx set phase, leaving out `exclude`.
+    TxSetPhaseTransactions
+    getTransactionsToNominate(LedgerHeader const& lcl,
+                              UnorderedSet<Hash> const& exclude) const;
+    // Builds the tx set to nominate on top of `lcl` from the candidates of
+    // `getTransactionsToNominate`. If some of them turn out to be invalid and
+    // leave room in the set, more candidates are pulled from the queues.
+    // Invalid transactions are returned in `invalidTxPhases`.
+    TxSetXDRFrameConstPtr
+    makeTxSetToNominate(LedgerHeader const& lcl,
+                        uint64_t lowerBoundCloseTimeOffset,
+                        uint64_t upperBoundCloseTimeOffset,
+                        TxSetPhaseTransactions& invalidTxPhases) const;
+    void banInvalidTxs(TxSetPhaseTransactions const& invalidTxPhases,
+                       uint32_t ledgerVersion);
+
+    // Builds the tx set to nominate for the next ledger ahead of the trigger
+    // timer, see TX_SET_CANDIDATE_LEAD_TIME_MS.
+    void buildTxSetCandidate(std::chrono::milliseconds lead);
+
     void startOutOfSyncTimer();
     void outOfSyncRecovery();
     void broadcast(SCPEnvelope const& e);
@@ -235,9 +265,10 @@ class HerderImpl : public Herder
     void processSCPQueueUpToIndex(uint64 slotIndex);
     void safelyProcessSCPQueue(bool synchronous);
     void newSlotExternalized(bool synchronous, StellarValue const& value);
-    void purgeOldPersistedTxSets();
+    void compactSCPStateJournal();
     void writeDebugTxSet(LedgerCloseData const& lcd);
 
+    TxFrameInternTable mTxFrameInternTable;
     ClassicTransactionQueue mTransactionQueue;
     std::unique_ptr<SorobanTransactionQueue> mSorobanTransactionQueue;
 
@@ -266,7 +297,10 @@ class HerderImpl : public Herder
     // saves the SCP messages that the instance sent out last
     void persistSCPState(uint64 slot);
     // restores SCP state based on the last messages saved on disk
-    void restoreSCPState();
+    void restoreSCPState(std::vector<PersistedSCPState> const& states);
+    // restores SCP state saved in the database by older versions and moves it
+    // to the journal
+    void migrateSCPStateFromDatabase();
 
     // saves upgrade parameters
     void persistUpgrades();
@@ -279,9 +313,23 @@ class HerderImpl : public Herder
 
     VirtualTimer mTriggerTimer;
 
+    // Tx set built ahead of mTriggerTimer. It is valid on top of the ledger
+    // `mLclHash` for any close time in [mMinCloseTime, mMaxCloseTime].
+    struct TxSetCandidate
+    {
+        Hash mLclHash;
+        uint64_t mMinCloseTime{0};
+        uint64_t mMaxCloseTime{0};
+        TxSetXDRFrameConstPtr mTxSet;
+        TxSetPhaseTransactions mInvalidTxPhases;
+    };
+    std::optional<TxSetCandidate> mTxSetCandidate;
+    VirtualTimer mTxSetCandidateTimer;
+
     VirtualTimer mOutOfSyncTimer;
 
     VirtualTimer mTxSetGarbageCollectTimer;
+    SCPStateJournal mSCPStateJournal;
 
     Application& mApp;
     LedgerManager& mLedgerManager;
@@ -301,6 +349,11 @@ class HerderImpl : public Herder
         medida::Meter& mEnvelopeValidSig;
         medida::Meter& mEnvelopeInvalidSig;
 
+        // tx sets built ahead of the trigger timer
+        medida::Timer& mTxSetCandidateBuild;
+        medida::Meter& mTxSetCandidateHit;
+        medida::Meter& mTxSetCandidateMiss;
+
         SCPMetrics(Application& app);
     };
 
@@ -328,6 +381,17 @@ class HerderImpl : public Herder
             mPotentialSplit{};
         std::set<std::set<PublicKey>> mIntersectionCriticalNodes{};
 
+        // Timing and progress of the checks, reported in the quorum info
+        std::chrono::milliseconds mLastCheckDuration{0};
+        QuorumIntersectionChecker::Progress mLastCheckProgress{};
+        std::chrono::steady_clock::time_point mCheckStart{};
+        std::shared_ptr<QuorumIntersectionChecker> mChecker;
+
+        // Shared by all checks, so that only changes within the SCC that
+        // contains the quorums trigger a new scan
+        std::shared_ptr<QuorumIntersectionChecker::SCCResultCache> mSCCCache{
+            std::make_shared<QuorumIntersectionChecker::SCCResultCache>()};
+
         bool
         hasAnyResults() const
         {
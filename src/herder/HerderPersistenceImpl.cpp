@@ -40,7 +40,9 @@ HerderPersistenceImpl::saveSCPHistory(uint32_t seq,
                                       QuorumTracker::QuorumMap const& qmap)
 {
     ZoneScoped;
-    if (envs.empty())
+    // Without envelopes (as for ledgers whose SCP messages are written to
+    // checkpoint files), only the quorum information is saved
+    if (envs.empty() && qmap.empty())
     {
         return;
     }
@@ -50,6 +52,7 @@ HerderPersistenceImpl::saveSCPHistory(uint32_t seq,
 
     soci::transaction txscope(db.getSession());
 
+    if (!envs.empty())
     {
         auto prepClean = db.getPreparedStatement(
             "DELETE FROM scphistory WHERE ledgerseq =:l");
@@ -5,8 +5,10 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "herder/QuorumTracker.h"
+#include "util/UnorderedMap.h"
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <optional>
 
 namespace stellar
@@ -19,34 +21,71 @@ class QuorumIntersectionChecker
   public:
     using QuorumSetMap =
         stellar::UnorderedMap<stellar::NodeID, stellar::SCPQuorumSetPtr>;
+    using PotentialSplit = std::pair<std::vector<NodeID>, std::vector<NodeID>>;
+
+    // Results of scanning the SCC that contains the quorums of a network,
+    // keyed by the nodes of the SCC and their qsets: the scan doesn't depend
+    // on anything else, so checkers sharing a cache only re-scan when the
+    // quorum map changed within that SCC. Safe to share between threads.
+    class SCCResultCache
+    {
+      public:
+        struct Result
+        {
+            bool mIntersects{true};
+            PotentialSplit mPotentialSplit;
+        };
+
+        std::optional<Result> get(Hash const& sccHash) const;
+        void put(Hash const& sccHash, Result const& result);
+
+      private:
+        static size_t const MAX_SIZE = 1024;
+        mutable std::mutex mMutex;
+        UnorderedMap<Hash, Result> mResults;
+    };
+
+    // Progress of the current (or last) networkEnjoysQuorumIntersection call,
+    // can be read from any thread while it runs.
+    struct Progress
+    {
+        size_t mThreads{0};
+        size_t mSubproblems{0};
+        size_t mSubproblemsDone{0};
+        bool mCachedResult{false};
+    };
 
     static std::shared_ptr<QuorumIntersectionChecker>
     create(QuorumTracker::QuorumMap const& qmap,
            std::optional<stellar::Config> const& cfg,
            std::atomic<bool>& interruptFlag,
-           stellar_default_random_engine::result_type seed, bool quiet = false);
+           stellar_default_random_engine::result_type seed, bool quiet = false,
+           std::shared_ptr<SCCResultCache> sccCache = nullptr);
 
     static std::shared_ptr<QuorumIntersectionChecker>
     create(QuorumSetMap const& qmap, std::optional<stellar::Config> const& cfg,
            std::atomic<bool>& interruptFlag,
-           stellar_default_random_engine::result_type seed, bool quiet = false);
+           stellar_default_random_engine::result_type seed, bool quiet = false,
+           std::shared_ptr<SCCResultCache> sccCache = nullptr);
 
     static std::set<std::set<NodeID>> getIntersectionCriticalGroups(
         QuorumTracker::QuorumMap const& qmap,
         std::optional<stellar::Config> const& cfg,
         std::atomic<bool>& interruptFlag,
-        stellar_default_random_engine::result_type seed);
+        stellar_default_random_engine::result_type seed,
+        std::shared_ptr<SCCResultCache> sccCache = nullptr);
 
     static std::set<std::set<NodeID>> getIntersectionCriticalGroups(
         QuorumSetMap const& qmap, std::optional<stellar::Config> const& cfg,
         std::atomic<bool>& interruptFlag,
-        stellar_default_random_engine::result_type seed);
+        stellar_default_random_engine::result_type seed,
+        std::shared_ptr<SCCResultCache> sccCache = nullptr);
 
     virtual ~QuorumIntersectionChecker(){};
     virtual bool networkEnjoysQuorumIntersection() const = 0;
     virtual size_t getMaxQuorumsFound() const = 0;
-    virtual std::pair<std::vector<NodeID>, std::vector<NodeID>>
-    getPotentialSplit() const = 0;
+    virtual PotentialSplit getPotentialSplit() const = 0;
+    virtual Progress getProgress() const = 0;
 
     // If any thread sets the atomic interruptFlag passed into any of the above
     // methods, any calculation-in-progress will throw InterruptedException and
@@ -5,9 +5,15 @@
 #include "QuorumIntersectionCheckerImpl.h"
 #include "QuorumIntersectionChecker.h"
 
+#include "crypto/SHA.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include "util/Math.h"
+#include "xdrpp/marshal.h"
+
+#include <map>
+#include <mutex>
+#include <thread>
 
 namespace
 {
@@ -124,11 +130,31 @@ MinQuorumEnumerator::MinQuorumEnumerator(
 bool
 MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
 {
-    if (mQic.mInterruptFlag)
+    return search(nullptr, 0);
+}
+
+bool
+MinQuorumEnumerator::splitIntoSubproblems(size_t depth,
+                                          std::vector<Subproblem>& subproblems)
+{
+    return search(&subproblems, depth);
+}
+
+bool
+MinQuorumEnumerator::search(std::vector<Subproblem>* subproblems, size_t depth)
+{
+    if (mQic.mInterruptFlag || (mQic.mStopFlag && *mQic.mStopFlag))
     {
         throw QuorumIntersectionChecker::InterruptedException();
     }
 
+    if (subproblems && depth == 0)
+    {
+        // Leave this call to whoever scans the subproblems.
+        subproblems->emplace_back(mCommitted, mRemaining);
+        return false;
+    }
+
     mQic.mStats.mCallsStarted++;
 
     // Emit a progress meter every million calls.
@@ -243,10 +269,11 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
         CLOG_TRACE(SCP, "recursing into subproblems, split={}", split);
     }
     mRemaining.unset(split);
+    size_t childDepth = subproblems ? depth - 1 : 0;
     MinQuorumEnumerator childExcludingSplit(mCommitted, mRemaining, mScanSCC,
                                             mQic);
     mQic.mStats.mFirstRecursionsTaken++;
-    if (childExcludingSplit.anyMinQuorumHasDisjointQuorum())
+    if (childExcludingSplit.search(subproblems, childDepth))
     {
         if (mQic.mLogTrace)
         {
@@ -259,7 +286,7 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
     MinQuorumEnumerator childIncludingSplit(mCommitted, mRemaining, mScanSCC,
                                             mQic);
     mQic.mStats.mSecondRecursionsTaken++;
-    return childIncludingSplit.anyMinQuorumHasDisjointQuorum();
+    return childIncludingSplit.search(subproblems, childDepth);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -269,12 +296,17 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
 QuorumIntersectionCheckerImpl::QuorumIntersectionCheckerImpl(
     QuorumIntersectionChecker::QuorumSetMap const& qmap,
     std::optional<Config> const& cfg, std::atomic<bool>& interruptFlag,
-    stellar_default_random_engine::result_type seed, bool quiet)
+    stellar_default_random_engine::result_type seed, bool quiet,
+    std::shared_ptr<SCCResultCache> sccCache)
     : mCfg(cfg)
     , mLogTrace(Logging::logTrace("SCP"))
     , mQuiet(quiet)
     , mTSC()
     , mInterruptFlag(interruptFlag)
+    , mNumThreads(
+          cfg ? std::max<size_t>(cfg->QUORUM_INTERSECTION_CHECKER_THREADS, 1)
+              : 1)
+    , mSCCCache(sccCache)
     , mCachedQuorums(MAX_CACHED_QUORUMS_SIZE)
     , mRand(seed)
 {
@@ -284,7 +316,27 @@ QuorumIntersectionCheckerImpl::QuorumIntersectionCheckerImpl(
     buildSCCs();
 }
 
-std::pair<std::vector<NodeID>, std::vector<NodeID>>
+QuorumIntersectionCheckerImpl::QuorumIntersectionCheckerImpl(
+    QuorumIntersectionCheckerImpl const& parent,
+    stellar_default_random_engine::result_type seed,
+    std::atomic<bool> const& stopFlag)
+    : mCfg(parent.mCfg)
+    , mLogTrace(parent.mLogTrace)
+    , mQuiet(true)
+    , mBitNumPubKeys(parent.mBitNumPubKeys)
+    , mBitNumQSets(parent.mBitNumQSets)
+    , mPubKeyBitNums(parent.mPubKeyBitNums)
+    , mGraph(parent.mGraph)
+    , mTSC()
+    , mInterruptFlag(parent.mInterruptFlag)
+    , mStopFlag(&stopFlag)
+    , mNumThreads(1)
+    , mCachedQuorums(MAX_CACHED_QUORUMS_SIZE)
+    , mRand(seed)
+{
+}
+
+QuorumIntersectionChecker::PotentialSplit
 QuorumIntersectionCheckerImpl::getPotentialSplit() const
 {
     return mPotentialSplit;
@@ -296,6 +348,33 @@ QuorumIntersectionCheckerImpl::getMaxQuorumsFound() const
     return mStats.mMaxQuorumsSeen;
 }
 
+QuorumIntersectionChecker::Progress
+QuorumIntersectionCheckerImpl::getProgress() const
+{
+    Progress progress;
+    progress.mThreads = mNumThreads;
+    progress.mSubproblems = mSubproblems;
+    progress.mSubproblemsDone = mSubproblemsDone;
+    progress.mCachedResult = mCachedResult;
+    return progress;
+}
+
+void
+QuorumIntersectionCheckerImpl::Stats::merge(Stats const& other)
+{
+    mCallsStarted += other.mCallsStarted;
+    mFirstRecursionsTaken += other.mFirstRecursionsTaken;
+    mSecondRecursionsTaken += other.mSecondRecursionsTaken;
+    mMaxQuorumsSeen += other.mMaxQuorumsSeen;
+    mMinQuorumsSeen += other.mMinQuorumsSeen;
+    mTerminations += other.mTerminations;
+    mEarlyExit1s += other.mEarlyExit1s;
+    mEarlyExit21s += other.mEarlyExit21s;
+    mEarlyExit22s += other.mEarlyExit22s;
+    mEarlyExit31s += other.mEarlyExit31s;
+    mEarlyExit32s += other.mEarlyExit32s;
+}
+
 void
 QuorumIntersectionCheckerImpl::Stats::log() const
 {
@@ -397,6 +476,12 @@ QuorumIntersectionCheckerImpl::isAQuorum(BitSet const& nodes) const
     if (pRes == nullptr)
     {
         bool result = !contractToMaximalQuorum(nodes).empty();
+        // Start over rather than evicting: eviction draws from the global
+        // random engine, which the worker threads must not touch.
+        if (mCachedQuorums.size() >= mCachedQuorums.maxSize())
+        {
+            mCachedQuorums.clear();
+        }
         mCachedQuorums.put(nodes, result);
         return result;
     }
@@ -490,6 +575,7 @@ QuorumIntersectionCheckerImpl::noteFoundDisjointQuorums(
 {
     mPotentialSplit.first.clear();
     mPotentialSplit.second.clear();
+    mDisjointQuorums = std::make_pair(nodes, disj);
 
     // Show internal node IDs only in DEBUG message; user is going to care
     // more about the translated names printed in the ERROR below.
@@ -547,6 +633,25 @@ toShortString(std::optional<Config> const& cfg, NodeID const& id)
     }
 }
 
+std::string
+groupString(std::optional<Config> const& cfg, std::set<NodeID> const& group)
+{
+    std::ostringstream out;
+    bool first = true;
+    out << '[';
+    for (auto const& k : group)
+    {
+        if (!first)
+        {
+            out << ", ";
+        }
+        first = false;
+        out << toShortString(cfg, k);
+    }
+    out << ']';
+    return out.str();
+}
+
 QBitSet
 QuorumIntersectionCheckerImpl::convertSCPQuorumSet(SCPQuorumSet const& sqs)
 {
@@ -604,6 +709,7 @@ QuorumIntersectionCheckerImpl::buildGraph(
 {
     mPubKeyBitNums.clear();
     mBitNumPubKeys.clear();
+    mBitNumQSets.clear();
     mGraph.clear();
 
     for (auto const& pair : qmap)
@@ -613,6 +719,7 @@ QuorumIntersectionCheckerImpl::buildGraph(
             size_t n = mBitNumPubKeys.size();
             mPubKeyBitNums.insert(std::make_pair(pair.first, n));
             mBitNumPubKeys.emplace_back(pair.first);
+            mBitNumQSets.emplace_back(pair.second);
         }
         else
         {
@@ -724,15 +831,170 @@ QuorumIntersectionCheckerImpl::networkEnjoysQuorumIntersection() const
     // Second stage: scan the scan-SCC powerset, potentially expensive.
     if (!foundDisjoint)
     {
-        BitSet committed;
-        BitSet remaining = scanSCC;
-        MinQuorumEnumerator mqe(committed, remaining, scanSCC, *this);
-        foundDisjoint = mqe.anyMinQuorumHasDisjointQuorum();
-        mStats.log();
+        std::optional<SCCResultCache::Result> cached;
+        Hash sccHash;
+        if (mSCCCache)
+        {
+            sccHash = getSCCHash(scanSCC);
+            cached = mSCCCache->get(sccHash);
+        }
+        if (cached)
+        {
+            CLOG_DEBUG(SCP, "Using cached result for scan SCC");
+            mCachedResult = true;
+            foundDisjoint = !cached->mIntersects;
+            mPotentialSplit = cached->mPotentialSplit;
+            if (foundDisjoint && !mQuiet)
+            {
+                auto const& split = mPotentialSplit;
+                CLOG_ERROR(
+                    SCP, "Found potential disjoint quorums: {} vs. {}",
+                    groupString(mCfg, std::set<NodeID>(split.first.begin(),
+                                                       split.first.end())),
+                    groupString(mCfg, std::set<NodeID>(split.second.begin(),
+                                                       split.second.end())));
+            }
+        }
+        else
+        {
+            foundDisjoint = scanSCCHasDisjointQuorums(scanSCC);
+            mStats.log();
+            if (mSCCCache)
+            {
+                SCCResultCache::Result result;
+                result.mIntersects = !foundDisjoint;
+                result.mPotentialSplit = mPotentialSplit;
+                mSCCCache->put(sccHash, result);
+            }
+        }
     }
     return !foundDisjoint;
 }
 
+Hash
+QuorumIntersectionCheckerImpl::getSCCHash(BitSet const& scc) const
+{
+    std::map<NodeID, size_t> nodes;
+    for (size_t i = 0; scc.nextSet(i); ++i)
+    {
+        nodes.emplace(mBitNumPubKeys.at(i), i);
+    }
+    SHA256 hasher;
+    for (auto const& node : nodes)
+    {
+        hasher.add(xdr::xdr_to_opaque(node.first));
+        hasher.add(xdr::xdr_to_opaque(*mBitNumQSets.at(node.second)));
+    }
+    return hasher.finish();
+}
+
+bool
+QuorumIntersectionCheckerImpl::scanSCCHasDisjointQuorums(
+    BitSet const& scanSCC) const
+{
+    BitSet committed;
+    BitSet remaining = scanSCC;
+    MinQuorumEnumerator mqe(committed, remaining, scanSCC, *this);
+    if (mNumThreads <= 1)
+    {
+        mSubproblems = 1;
+        bool found = mqe.anyMinQuorumHasDisjointQuorum();
+        mSubproblemsDone = 1;
+        return found;
+    }
+
+    size_t depth = 0;
+    while ((size_t(1) << depth) < mNumThreads * SUBPROBLEMS_PER_THREAD)
+    {
+        ++depth;
+    }
+    std::vector<MinQuorumEnumerator::Subproblem> subproblems;
+    if (mqe.splitIntoSubproblems(depth, subproblems))
+    {
+        return true;
+    }
+    CLOG_DEBUG(SCP, "Scanning {} subproblems on {} threads",
+               subproblems.size(), mNumThreads);
+    return scanSubproblemsInParallel(scanSCC, subproblems);
+}
+
+bool
+QuorumIntersectionCheckerImpl::scanSubproblemsInParallel(
+    BitSet const& scanSCC,
+    std::vector<MinQuorumEnumerator::Subproblem> const& subproblems) const
+{
+    mSubproblems = subproblems.size();
+    std::atomic<size_t> next{0};
+    std::atomic<bool> stop{false};
+    std::mutex mutex;
+    std::optional<std::pair<BitSet, BitSet>> found;
+    bool interrupted = false;
+
+    auto scan = [&](stellar_default_random_engine::result_type seed) {
+        QuorumIntersectionCheckerImpl worker(*this, seed, stop);
+        try
+        {
+            // Idle workers pick up the next pending subproblem, so that a
+            // few expensive subproblems don't hold up the others.
+            for (size_t i = next++; i < subproblems.size(); i = next++)
+            {
+                MinQuorumEnumerator mqe(subproblems[i].first,
+                                        subproblems[i].second, scanSCC,
+                                        worker);
+                if (mqe.anyMinQuorumHasDisjointQuorum())
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    if (!found)
+                    {
+                        found = worker.mDisjointQuorums;
+                    }
+                    stop = true;
+                    break;
+                }
+                ++mSubproblemsDone;
+            }
+        }
+        catch (QuorumIntersectionChecker::InterruptedException&)
+        {
+            // Either interrupted, or stopped by another worker.
+            if (mInterruptFlag)
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                interrupted = true;
+            }
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        mStats.merge(worker.mStats);
+    };
+
+    std::vector<stellar_default_random_engine::result_type> seeds;
+    for (size_t i = 0; i < mNumThreads; ++i)
+    {
+        seeds.emplace_back(mRand());
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < mNumThreads; ++i)
+    {
+        threads.emplace_back(scan, seeds.at(i));
+    }
+    scan(seeds.at(0));
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (interrupted)
+    {
+        throw QuorumIntersectionChecker::InterruptedException();
+    }
+    if (found)
+    {
+        noteFoundDisjointQuorums(found->first, found->second);
+        return true;
+    }
+    return false;
+}
+
 bool
 pointsToCandidate(SCPQuorumSet const& p, NodeID const& candidate)
 {
@@ -783,25 +1045,6 @@ findCriticalityCandidates(SCPQuorumSet const& p,
     }
 }
 
-std::string
-groupString(std::optional<Config> const& cfg, std::set<NodeID> const& group)
-{
-    std::ostringstream out;
-    bool first = true;
-    out << '[';
-    for (auto const& k : group)
-    {
-        if (!first)
-        {
-            out << ", ";
-        }
-        first = false;
-        out << toShortString(cfg, k);
-    }
-    out << ']';
-    return out.str();
-}
-
 QuorumIntersectionChecker::QuorumSetMap
 toQuorumIntersectionMap(QuorumTracker::QuorumMap const& qmap)
 {
@@ -816,41 +1059,69 @@ toQuorumIntersectionMap(QuorumTracker::QuorumMap const& qmap)
 
 namespace stellar
 {
+std::optional<QuorumIntersectionChecker::SCCResultCache::Result>
+QuorumIntersectionChecker::SCCResultCache::get(Hash const& sccHash) const
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    auto it = mResults.find(sccHash);
+    if (it == mResults.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void
+QuorumIntersectionChecker::SCCResultCache::put(Hash const& sccHash,
+                                               Result const& result)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    if (mResults.size() >= MAX_SIZE)
+    {
+        mResults.clear();
+    }
+    mResults[sccHash] = result;
+}
+
 std::shared_ptr<QuorumIntersectionChecker>
 QuorumIntersectionChecker::create(
     QuorumTracker::QuorumMap const& qmap, std::optional<Config> const& cfg,
     std::atomic<bool>& interruptFlag,
-    stellar_default_random_engine::result_type seed, bool quiet)
+    stellar_default_random_engine::result_type seed, bool quiet,
+    std::shared_ptr<SCCResultCache> sccCache)
 {
     return create(toQuorumIntersectionMap(qmap), cfg, interruptFlag, seed,
-                  quiet);
+                  quiet, sccCache);
 }
 
 std::shared_ptr<QuorumIntersectionChecker>
 QuorumIntersectionChecker::create(
     QuorumSetMap const& qmap, std::optional<Config> const& cfg,
     std::atomic<bool>& interruptFlag,
-    stellar_default_random_engine::result_type seed, bool quiet)
+    stellar_default_random_engine::result_type seed, bool quiet,
+    std::shared_ptr<SCCResultCache> sccCache)
 {
     return std::make_shared<QuorumIntersectionCheckerImpl>(
-        qmap, cfg, interruptFlag, seed, quiet);
+        qmap, cfg, interruptFlag, seed, quiet, sccCache);
 }
 
 std::set<std::set<NodeID>>
 QuorumIntersectionChecker::getIntersectionCriticalGroups(
     QuorumTracker::QuorumMap const& qmap, std::optional<Config> const& cfg,
     std::atomic<bool>& interruptFlag,
-    stellar_default_random_engine::result_type seed)
+    stellar_default_random_engine::result_type seed,
+    std::shared_ptr<SCCResultCache> sccCache)
 {
     return getIntersectionCriticalGroups(toQuorumIntersectionMap(qmap), cfg,
-                                         interruptFlag, seed);
+                                         interruptFlag, seed, sccCache);
 }
 
 std::set<std::set<NodeID>>
 QuorumIntersectionChecker::getIntersectionCriticalGroups(
     QuorumSetMap const& qmap, std::optional<Config> const& cfg,
     std::atomic<bool>& interruptFlag,
-    stellar_default_random_engine::result_type seed)
+    stellar_default_random_engine::result_type seed,
+    std::shared_ptr<SCCResultCache> sccCache)
 {
     // We're going to search for "intersection-critical" groups, by considering
     // each SCPQuorumSet S that (a) has no innerSets of its own and (b) occurs
@@ -936,9 +1207,8 @@ QuorumIntersectionChecker::getIntersectionCriticalGroups(
         }
 
         // Check to see if this modified config is vulnerable to splitting.
-        auto checker = QuorumIntersectionChecker::create(test_qmap, cfg,
-                                                         interruptFlag, seed,
-                                                         /*quiet=*/true);
+        auto checker = QuorumIntersectionChecker::create(
+            test_qmap, cfg, interruptFlag, seed, /*quiet=*/true, sccCache);
         if (checker->networkEnjoysQuorumIntersection())
         {
             CLOG_DEBUG(SCP,
@@ -349,6 +349,23 @@
 //
 // Remaining details of the implementation are noted as we go, but the above
 // explanation ought to give you a good idea what you're looking at.
+//
+//
+// Coda 2: parallelism and caching
+// ===============================
+//
+// The two recursive calls of the enumeration share nothing but the (read
+// only) graph, so the top few levels of the recursion tree are expanded up
+// front (running the early exits as usual) and every pending call left at
+// that depth becomes an independent subproblem. A pool of threads, each with
+// its own copy of the checker's mutable state (stats, caches, random engine),
+// then keeps picking the next pending subproblem until they're all done or
+// one of them finds a disjoint quorum, at which point the others stop.
+//
+// Since the second stage only looks at the scan SCC, its result is also
+// cached (optionally, across checkers) by the nodes of the scan SCC and
+// their qsets, so that changes to the network that don't touch the scan SCC
+// don't need another enumeration.
 
 #include "QuorumIntersectionChecker.h"
 #include "main/Config.h"
@@ -359,6 +376,7 @@
 #include "xdr/Stellar-types.h"
 #include <functional>
 #include <optional>
+#include <utility>
 
 namespace
 {
@@ -401,6 +419,11 @@ struct QBitSet
 // recursive cases.
 class MinQuorumEnumerator
 {
+  public:
+    // (committed, remaining) sets of a pending call of the recursion.
+    using Subproblem = std::pair<BitSet, BitSet>;
+
+  private:
 
     // Set of nodes "committed to" in this branch of the recurrence. In other
     // words: set of nodes that this enumerator and its children will definitely
@@ -433,6 +456,10 @@ class MinQuorumEnumerator
     // Size limit for mCommitted beyond which we should stop scanning.
     size_t maxCommit() const;
 
+    // The recursion itself: if `subproblems` is set, calls `depth` levels
+    // below this one are not made but appended to `subproblems` instead.
+    bool search(std::vector<Subproblem>* subproblems, size_t depth);
+
   public:
     MinQuorumEnumerator(BitSet const& committed, BitSet const& remaining,
                         BitSet const& scanSCC,
@@ -440,6 +467,12 @@ class MinQuorumEnumerator
 
     bool hasDisjointQuorum(BitSet const& nodes) const;
     bool anyMinQuorumHasDisjointQuorum();
+
+    // Runs the first `depth` levels of the recursion, collecting the calls
+    // pending at that depth into `subproblems`. Returns true if a disjoint
+    // quorum was already found on the way.
+    bool splitIntoSubproblems(size_t depth,
+                              std::vector<Subproblem>& subproblems);
 };
 
 // Quorum intersection checking is done by establishing a root
@@ -469,6 +502,8 @@ class QuorumIntersectionCheckerImpl : public stellar::QuorumIntersectionChecker
         size_t mEarlyExit31s = {0};
         size_t mEarlyExit32s = {0};
         void log() const;
+        // Adds the enumeration stats of a worker checker.
+        void merge(Stats const& other);
     };
 
     // We use our own stats and a local cached flag to control tracing because
@@ -483,13 +518,13 @@ class QuorumIntersectionCheckerImpl : public stellar::QuorumIntersectionChecker
 
     // State to capture a counterexample found during search, for later
     // reporting.
-    mutable std::pair<std::vector<stellar::NodeID>,
-                      std::vector<stellar::NodeID>>
-        mPotentialSplit;
+    mutable PotentialSplit mPotentialSplit;
+    mutable std::pair<BitSet, BitSet> mDisjointQuorums;
 
     // These are the key state of the checker: the mapping from node public keys
     // to graph node numbers, and the graph of QBitSets itself.
     std::vector<stellar::NodeID> mBitNumPubKeys;
+    std::vector<stellar::SCPQuorumSetPtr> mBitNumQSets;
     std::unordered_map<stellar::NodeID, size_t> mPubKeyBitNums;
     QGraph mGraph;
 
@@ -508,6 +543,21 @@ class QuorumIntersectionCheckerImpl : public stellar::QuorumIntersectionChecker
     // InterruptedException at the nearest convenient moment.
     std::atomic<bool>& mInterruptFlag;
 
+    // Set on the worker copies of a checker: stops the worker (by throwing
+    // InterruptedException) once another worker found a disjoint quorum.
+    std::atomic<bool> const* mStopFlag{nullptr};
+
+    // Number of threads scanning the subproblems of the scan SCC, and the
+    // number of subproblems to aim for per thread.
+    size_t const mNumThreads;
+    static size_t const SUBPROBLEMS_PER_THREAD = 16;
+
+    std::shared_ptr<SCCResultCache> mSCCCache;
+
+    mutable std::atomic<size_t> mSubproblems{0};
+    mutable std::atomic<size_t> mSubproblemsDone{0};
+    mutable std::atomic<bool> mCachedResult{false};
+
     QBitSet convertSCPQuorumSet(stellar::SCPQuorumSet const& sqs);
     void
     buildGraph(stellar::QuorumIntersectionChecker::QuorumSetMap const& qmap);
@@ -526,6 +576,18 @@ class QuorumIntersectionCheckerImpl : public stellar::QuorumIntersectionChecker
                                   BitSet const& disj) const;
     std::string nodeName(size_t node) const;
 
+    stellar::Hash getSCCHash(BitSet const& scc) const;
+    bool scanSCCHasDisjointQuorums(BitSet const& scanSCC) const;
+    bool scanSubproblemsInParallel(
+        BitSet const& scanSCC,
+        std::vector<MinQuorumEnumerator::Subproblem> const& subproblems) const;
+
+    // Worker copy of `parent`, see mStopFlag.
+    QuorumIntersectionCheckerImpl(
+        QuorumIntersectionCheckerImpl const& parent,
+        stellar::stellar_default_random_engine::result_type seed,
+        std::atomic<bool> const& stopFlag);
+
     friend class MinQuorumEnumerator;
 
     mutable stellar::stellar_default_random_engine mRand;
@@ -536,11 +598,11 @@ class QuorumIntersectionCheckerImpl : public stellar::QuorumIntersectionChecker
         std::optional<stellar::Config> const& cfg,
         std::atomic<bool>& interruptFlag,
         stellar::stellar_default_random_engine::result_type seed,
-        bool quiet = false);
+        bool quiet = false, std::shared_ptr<SCCResultCache> sccCache = nullptr);
     bool networkEnjoysQuorumIntersection() const override;
 
-    std::pair<std::vector<stellar::NodeID>, std::vector<stellar::NodeID>>
-    getPotentialSplit() const override;
+    PotentialSplit getPotentialSplit() const override;
     size_t getMaxQuorumsFound() const override;
+    Progress getProgress() const override;
 };
 }
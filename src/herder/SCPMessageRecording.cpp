@@ -0,0 +1,315 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/SCPMessageRecording.h"
+#include "crypto/SHA.h"
+#include "herder/Herder.h"
+#include "herder/TxSetFrame.h"
+#include "lib/json/json.h"
+#include "main/Application.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include "util/Thread.h"
+
+#include <Tracy.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace stellar
+{
+
+SCPMessageRecorder::SCPMessageRecorder(Application& app,
+                                       std::string const& path)
+    : mClock(app.getClock())
+    , mStart(mClock.now())
+    , mOut(app.getClock().getIOContext(), /* fsyncOnClose */ true)
+{
+    // Timestamps are relative to the start of this recording, so a previous
+    // recording can't be continued
+    if (std::remove(path.c_str()) == 0)
+    {
+        CLOG_INFO(Herder, "Replacing the SCP recording in {}", path);
+    }
+    mOut.open(path);
+    CLOG_INFO(Herder, "Recording received SCP messages to {}", path);
+}
+
+bool
+SCPMessageRecorder::isRecorded(StellarMessage const& msg)
+{
+    switch (msg.type())
+    {
+    case SCP_MESSAGE:
+    case TX_SET:
+    case GENERALIZED_TX_SET:
+    case SCP_QUORUMSET:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void
+SCPMessageRecorder::record(StellarMessage const& msg)
+{
+    ZoneScoped;
+    if (!isRecorded(msg))
+    {
+        return;
+    }
+    uint64 time = std::chrono::duration_cast<std::chrono::microseconds>(
+                      mClock.now() - mStart)
+                      .count();
+    mOut.writeOne(time);
+    mOut.writeOne(msg);
+    // Keep the recording usable if the node does not shut down gracefully
+    mOut.flush();
+}
+
+// The latency is reported in milliseconds
+std::chrono::milliseconds const SCPMessageReplayer::CHECK_PERIOD(1);
+// About one ledger
+std::chrono::seconds const SCPMessageReplayer::EXTERNALIZE_GRACE(5);
+
+SCPMessageReplayer::SCPMessageReplayer(Application& app,
+                                       std::string const& path, double speed)
+    : mApp(app), mSpeed(speed), mTimer(app), mCheckTimer(app)
+{
+    releaseAssert(mSpeed >= 0);
+    mIn.open(path);
+}
+
+void
+SCPMessageReplayer::start()
+{
+    mStart = mApp.getClock().now();
+    mLastFed = mStart;
+    if (readNext())
+    {
+        scheduleNext();
+    }
+    else
+    {
+        mFedAll = true;
+    }
+    scheduleCheck();
+}
+
+bool
+SCPMessageReplayer::isDone() const
+{
+    return mDone;
+}
+
+bool
+SCPMessageReplayer::readNext()
+{
+    try
+    {
+        if (!mIn.readOne(mNextTime))
+        {
+            return false;
+        }
+        if (!mIn.readOne(mNext))
+        {
+            CLOG_WARNING(Herder, "SCP recording ends with a timestamp");
+            return false;
+        }
+    }
+    catch (xdr::xdr_runtime_error const& e)
+    {
+        // The recording node may have stopped in the middle of a write
+        CLOG_WARNING(Herder, "Ignoring the end of the SCP recording: {}",
+                     e.what());
+        return false;
+    }
+    return true;
+}
+
+void
+SCPMessageReplayer::scheduleNext()
+{
+    if (mSpeed == 0)
+    {
+        mTimer.expires_from_now(std::chrono::microseconds::zero());
+    }
+    else
+    {
+        std::chrono::duration<double, std::micro> offset(mNextTime / mSpeed);
+        mTimer.expires_at(
+            mStart +
+            std::chrono::duration_cast<VirtualClock::duration>(offset));
+    }
+    mTimer.async_wait(
+        [this]() {
+            feed(mNext);
+            if (readNext())
+            {
+                scheduleNext();
+            }
+            else
+            {
+                mFedAll = true;
+            }
+        },
+        &VirtualTimer::onFailureNoop);
+}
+
+void
+SCPMessageReplayer::feed(StellarMessage const& msg)
+{
+    ZoneScoped;
+    ++mMessages;
+    mLastFed = mApp.getClock().now();
+    auto& herder = mApp.getHerder();
+    auto cpuStart = threadCpuTime();
+    switch (msg.type())
+    {
+    case SCP_MESSAGE:
+    {
+        auto const& envelope = msg.envelope();
+        mCurrentSlot = envelope.statement.slotIndex;
+        // Slots that are already externalized when their first envelope shows
+        // up are not measured
+        auto it = mSlots.find(mCurrentSlot);
+        if (it == mSlots.end() &&
+            (herder.getState() == Herder::HERDER_BOOTING_STATE ||
+             mCurrentSlot > herder.trackingConsensusLedgerIndex()))
+        {
+            it = mSlots.emplace(mCurrentSlot, SlotStats{}).first;
+            it->second.mFirstEnvelope = mApp.getClock().now();
+        }
+        if (it != mSlots.end())
+        {
+            ++it->second.mEnvelopes;
+        }
+        herder.recvSCPEnvelope(envelope);
+        break;
+    }
+    case TX_SET:
+    {
+        auto frame = TxSetXDRFrame::makeFromWire(msg.txSet());
+        herder.recvTxSet(frame->getContentsHash(), frame);
+        break;
+    }
+    case GENERALIZED_TX_SET:
+    {
+        auto frame = TxSetXDRFrame::makeFromWire(msg.generalizedTxSet());
+        herder.recvTxSet(frame->getContentsHash(), frame);
+        break;
+    }
+    case SCP_QUORUMSET:
+        herder.recvSCPQuorumSet(xdrSha256(msg.qSet()), msg.qSet());
+        break;
+    default:
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("Unexpected message in SCP recording: {}"),
+                        xdr::xdr_traits<MessageType>::enum_name(msg.type())));
+    }
+
+    auto it = mSlots.find(mCurrentSlot);
+    if (it != mSlots.end())
+    {
+        it->second.mCPUTime += threadCpuTime() - cpuStart;
+    }
+    checkExternalized();
+}
+
+void
+SCPMessageReplayer::scheduleCheck()
+{
+    mCheckTimer.expires_from_now(CHECK_PERIOD);
+    mCheckTimer.async_wait(
+        [this]() {
+            bool allExternalized = checkExternalized();
+            if (mFedAll &&
+                (allExternalized ||
+                 mApp.getClock().now() >= mLastFed + EXTERNALIZE_GRACE))
+            {
+                mDone = true;
+            }
+            else
+            {
+                scheduleCheck();
+            }
+        },
+        &VirtualTimer::onFailureNoop);
+}
+
+bool
+SCPMessageReplayer::checkExternalized()
+{
+    auto& herder = mApp.getHerder();
+    if (herder.getState() == Herder::HERDER_BOOTING_STATE)
+    {
+        return mSlots.empty();
+    }
+    auto consensusIndex = herder.trackingConsensusLedgerIndex();
+    auto now = mApp.getClock().now();
+    bool allExternalized = true;
+    for (auto& [slot, stats] : mSlots)
+    {
+        if (!stats.mExternalized)
+        {
+            if (slot > consensusIndex)
+            {
+                allExternalized = false;
+                break;
+            }
+            stats.mExternalized = now;
+        }
+    }
+    return allExternalized;
+}
+
+Json::Value
+SCPMessageReplayer::getReport() const
+{
+    auto toMs = [](VirtualClock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    auto cpuToMs = [](std::chrono::nanoseconds c) {
+        return std::chrono::duration<double, std::milli>(c).count();
+    };
+
+    Json::Value res;
+    res["messages"] = static_cast<Json::UInt64>(mMessages);
+    res["speed"] = mSpeed;
+
+    std::vector<double> latencies;
+    double totalCPU = 0;
+    auto& slots = res["slots"];
+    slots = Json::arrayValue;
+    for (auto const& [slot, stats] : mSlots)
+    {
+        Json::Value s;
+        s["slot"] = static_cast<Json::UInt64>(slot);
+        s["envelopes"] = static_cast<Json::UInt64>(stats.mEnvelopes);
+        s["cpu_ms"] = cpuToMs(stats.mCPUTime);
+        totalCPU += cpuToMs(stats.mCPUTime);
+        if (stats.mExternalized)
+        {
+            auto latency = toMs(*stats.mExternalized - stats.mFirstEnvelope);
+            s["externalize_ms"] = latency;
+            latencies.emplace_back(latency);
+        }
+        slots.append(s);
+    }
+
+    res["externalized"] = static_cast<Json::UInt64>(latencies.size());
+    res["cpu_ms"] = totalCPU;
+    if (!latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        auto& l = res["externalize_ms"];
+        l["min"] = latencies.front();
+        l["median"] = latencies[latencies.size() / 2];
+        l["p99"] = latencies[(latencies.size() - 1) * 99 / 100];
+        l["max"] = latencies.back();
+    }
+    return res;
+}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Timer.h"
+#include "util/XDRStream.h"
+#include "xdr/Stellar-overlay.h"
+
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace Json
+{
+class Value;
+}
+
+namespace stellar
+{
+
+class Application;
+
+// Recording of the consensus messages (SCP envelopes, tx sets and quorum sets)
+// received by a node, used to benchmark the herder and SCP offline.
+//
+// The recording is a sequence of pairs of XDR records: the time at which the
+// message was received, in microseconds since the recording started, followed
+// by the `StellarMessage` itself.
+class SCPMessageRecorder
+{
+  public:
+    // Replaces any file at `path`.
+    SCPMessageRecorder(Application& app, std::string const& path);
+
+    // Appends `msg` if it is a consensus message, ignores it otherwise.
+    void record(StellarMessage const& msg);
+
+    static bool isRecorded(StellarMessage const& msg);
+
+  private:
+    VirtualClock& mClock;
+    VirtualClock::time_point const mStart;
+    XDROutputFileStream mOut;
+};
+
+// Feeds a recording made by `SCPMessageRecorder` to the herder of `app`,
+// bypassing the overlay, either at the recorded pace scaled by `speed` or as
+// fast as possible if `speed` is 0. While doing so, it measures for every slot
+// the time between the first envelope of the slot being fed and the slot
+// externalizing, as well as the CPU time spent by the main thread in the herder
+// processing the messages of the slot.
+//
+// Slots can externalize on herder timers between two messages, so
+// externalization is also checked every `CHECK_PERIOD`, and for
+// `EXTERNALIZE_GRACE` after the last message before the replay is done.
+//
+// The node has to be at the last closed ledger the recording node was at when
+// the recording started for the slots to externalize.
+class SCPMessageReplayer
+{
+  public:
+    static std::chrono::milliseconds const CHECK_PERIOD;
+    static std::chrono::seconds const EXTERNALIZE_GRACE;
+
+    SCPMessageReplayer(Application& app, std::string const& path,
+                       double speed);
+
+    void start();
+    bool isDone() const;
+
+    Json::Value getReport() const;
+
+  private:
+    struct SlotStats
+    {
+        size_t mEnvelopes{0};
+        VirtualClock::time_point mFirstEnvelope;
+        std::optional<VirtualClock::time_point> mExternalized;
+        std::chrono::nanoseconds mCPUTime{0};
+    };
+
+    Application& mApp;
+    double const mSpeed;
+    XDRInputFileStream mIn;
+    VirtualTimer mTimer;
+    VirtualTimer mCheckTimer;
+    VirtualClock::time_point mStart;
+    VirtualClock::time_point mLastFed;
+    bool mFedAll{false};
+    bool mDone{false};
+
+    StellarMessage mNext;
+    uint64 mNextTime{0};
+    size_t mMessages{0};
+
+    // Slot that the tx sets and quorum sets are accounted to, which is the
+    // slot of the last envelope fed.
+    uint64 mCurrentSlot{0};
+    std::map<uint64, SlotStats> mSlots;
+
+    bool readNext();
+    void scheduleNext();
+    void feed(StellarMessage const& msg);
+    void scheduleCheck();
+    // Returns whether all the measured slots are externalized
+    bool checkExternalized();
+};
+}
@@ -0,0 +1,328 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/SCPStateJournal.h"
+#include "herder/HerderUtils.h"
+#include "herder/TxSetFrame.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "util/Fs.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include <Tracy.hpp>
+
+#include <cstdio>
+
+namespace stellar
+{
+
+SCPStateJournal::SCPStateJournal(Application& app)
+    : mApp(app)
+    , mPath(getPath(app.getConfig()))
+    , mSyncTimer(app)
+    , mAppendMeter(app.getMetrics().NewMeter(
+          {"herder", "scp-journal", "append"}, "record"))
+    , mSyncTimerMetric(
+          app.getMetrics().NewTimer({"herder", "scp-journal", "sync"}))
+    , mCompactTimer(
+          app.getMetrics().NewTimer({"herder", "scp-journal", "compact"}))
+{
+}
+
+SCPStateJournal::~SCPStateJournal()
+{
+}
+
+std::string
+SCPStateJournal::getPath(Config const& cfg)
+{
+    return cfg.BUCKET_DIR_PATH + "/scp-state.journal";
+}
+
+std::vector<PersistedSCPState>
+SCPStateJournal::open()
+{
+    ZoneScoped;
+    releaseAssert(!mOut);
+
+    std::map<Hash, StoredTransactionSet> txSets;
+    if (fs::exists(mPath))
+    {
+        forEachRecord([&](PersistedSCPState& record) {
+            for (auto& storedSet : record.v0().txSets)
+            {
+                try
+                {
+                    auto txSet = TxSetXDRFrame::makeFromStoredTxSet(storedSet);
+                    txSets.emplace(txSet->getContentsHash(),
+                                   std::move(storedSet));
+                }
+                catch (std::exception& e)
+                {
+                    // we may have exceptions when upgrading the protocol
+                    // this should be the only time we get exceptions
+                    // decoding old messages.
+                    CLOG_INFO(Herder,
+                              "Error while restoring old tx sets, "
+                              "proceeding without them : {}",
+                              e.what());
+                }
+            }
+            record.v0().txSets.clear();
+            auto const& envs = record.v0().scpEnvelopes;
+            if (!envs.empty())
+            {
+                mSlots[envs.front().statement.slotIndex] = std::move(record);
+            }
+        });
+    }
+    return rewrite(txSets);
+}
+
+bool
+SCPStateJournal::isOpen() const
+{
+    return mOut != nullptr;
+}
+
+void
+SCPStateJournal::append(PersistedSCPState const& state,
+                        std::vector<Hash> const& txSetHashes)
+{
+    ZoneScoped;
+    releaseAssert(mOut);
+    releaseAssert(state.v() == 0);
+    releaseAssert(state.v0().txSets.size() == txSetHashes.size());
+
+    auto const& envs = state.v0().scpEnvelopes;
+    if (envs.empty())
+    {
+        return;
+    }
+
+    mOut->writeOne(state);
+    mOut->flush();
+    mTxSets.insert(txSetHashes.begin(), txSetHashes.end());
+
+    auto& slotState = mSlots[envs.front().statement.slotIndex];
+    slotState.v(0);
+    slotState.v0().scpEnvelopes = envs;
+    slotState.v0().quorumSets = state.v0().quorumSets;
+
+    ++mRecordsSinceCompaction;
+    mAppendMeter.Mark();
+    scheduleSync();
+}
+
+void
+SCPStateJournal::whenSynced(std::function<void()> f)
+{
+    if (mSyncPending)
+    {
+        mSyncCallbacks.emplace_back(std::move(f));
+    }
+    else
+    {
+        f();
+    }
+}
+
+bool
+SCPStateJournal::hasTxSet(Hash const& txSetHash) const
+{
+    return mTxSets.find(txSetHash) != mTxSets.end();
+}
+
+void
+SCPStateJournal::compact()
+{
+    ZoneScoped;
+    if (!mOut || mRecordsSinceCompaction == 0)
+    {
+        return;
+    }
+    auto timer = mCompactTimer.TimeScope();
+    mOut->flush();
+
+    // Tx sets are only kept in the journal, so read back the ones that are
+    // still referenced.
+    UnorderedSet<Hash> referenced;
+    for (auto const& slotState : mSlots)
+    {
+        for (auto const& env : slotState.second.v0().scpEnvelopes)
+        {
+            for (auto const& hash : getTxSetHashes(env))
+            {
+                referenced.insert(hash);
+            }
+        }
+    }
+    std::map<Hash, StoredTransactionSet> txSets;
+    forEachRecord([&](PersistedSCPState& record) {
+        for (auto& storedSet : record.v0().txSets)
+        {
+            try
+            {
+                auto txSet = TxSetXDRFrame::makeFromStoredTxSet(storedSet);
+                auto const& hash = txSet->getContentsHash();
+                if (referenced.find(hash) != referenced.end())
+                {
+                    txSets.emplace(hash, std::move(storedSet));
+                }
+            }
+            catch (std::exception& e)
+            {
+                // Same as in `open`: tx sets that can't be decoded anymore
+                // are dropped
+                CLOG_INFO(Herder,
+                          "Error while compacting old tx sets, "
+                          "proceeding without them : {}",
+                          e.what());
+            }
+        }
+    });
+    rewrite(txSets);
+}
+
+void
+SCPStateJournal::close()
+{
+    mSyncTimer.cancel();
+    mSyncPending = false;
+    mSyncCallbacks.clear();
+    if (mOut)
+    {
+        // Syncs on close
+        mOut->close();
+        mOut.reset();
+    }
+}
+
+void
+SCPStateJournal::forEachRecord(
+    std::function<void(PersistedSCPState&)> const& f) const
+{
+    XDRInputFileStream in;
+    in.open(mPath);
+    PersistedSCPState record;
+    try
+    {
+        while (in.readOne(record))
+        {
+            if (record.v() == 0)
+            {
+                f(record);
+            }
+        }
+    }
+    catch (xdr::xdr_runtime_error& e)
+    {
+        // A crash may leave an incomplete record at the end of the journal;
+        // it's dropped by the next compaction.
+        CLOG_WARNING(Herder, "Ignoring the tail of SCP state journal {}: {}",
+                     mPath, e.what());
+    }
+}
+
+std::vector<PersistedSCPState>
+SCPStateJournal::rewrite(std::map<Hash, StoredTransactionSet> const& txSets)
+{
+    ZoneScoped;
+    // Only keep the slots SCP remembers
+    if (!mSlots.empty())
+    {
+        uint64 const slotsToKeep = mApp.getConfig().MAX_SLOTS_TO_REMEMBER + 1;
+        auto lastSlot = mSlots.rbegin()->first;
+        if (lastSlot >= slotsToKeep)
+        {
+            mSlots.erase(mSlots.begin(),
+                         mSlots.lower_bound(lastSlot - slotsToKeep + 1));
+        }
+    }
+
+    if (mOut)
+    {
+        mOut->close();
+        mOut.reset();
+    }
+
+    auto const tmpPath = mPath + ".tmp";
+    std::remove(tmpPath.c_str());
+
+    std::vector<PersistedSCPState> records;
+    UnorderedSet<Hash> writtenTxSets;
+    {
+        XDROutputFileStream out(mApp.getClock().getIOContext(),
+                                /* fsyncOnClose */ true);
+        out.open(tmpPath);
+        for (auto const& slotState : mSlots)
+        {
+            auto record = slotState.second;
+            for (auto const& env : record.v0().scpEnvelopes)
+            {
+                for (auto const& hash : getTxSetHashes(env))
+                {
+                    auto it = txSets.find(hash);
+                    if (it != txSets.end() &&
+                        writtenTxSets.insert(hash).second)
+                    {
+                        record.v0().txSets.emplace_back(it->second);
+                    }
+                }
+            }
+            out.writeOne(record);
+            records.emplace_back(std::move(record));
+        }
+        out.close();
+    }
+    if (!fs::durableRename(tmpPath, mPath, mApp.getConfig().BUCKET_DIR_PATH))
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to rename {} to {}", tmpPath, mPath));
+    }
+
+    mTxSets = std::move(writtenTxSets);
+    mRecordsSinceCompaction = 0;
+    mOut = std::make_unique<XDROutputFileStream>(mApp.getClock().getIOContext(),
+                                                 /* fsyncOnClose */ true);
+    mOut->open(mPath);
+    return records;
+}
+
+void
+SCPStateJournal::scheduleSync()
+{
+    if (mSyncPending)
+    {
+        return;
+    }
+    mSyncPending = true;
+    // Fires at the end of the current crank
+    mSyncTimer.expires_from_now(std::chrono::milliseconds(0));
+    mSyncTimer.async_wait([this]() { sync(); }, &VirtualTimer::onFailureNoop);
+}
+
+void
+SCPStateJournal::sync()
+{
+    ZoneScoped;
+    mSyncPending = false;
+    if (mOut)
+    {
+        auto timer = mSyncTimerMetric.TimeScope();
+        fs::flushFileChanges(mOut->getHandle());
+    }
+    auto callbacks = std::move(mSyncCallbacks);
+    mSyncCallbacks.clear();
+    for (auto const& f : callbacks)
+    {
+        f();
+    }
+}
+}
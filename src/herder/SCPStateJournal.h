@@ -0,0 +1,105 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Timer.h"
+#include "util/UnorderedSet.h"
+#include "xdr/Stellar-internal.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace medida
+{
+class Meter;
+class Timer;
+}
+
+namespace stellar
+{
+
+class Application;
+class Config;
+class XDROutputFileStream;
+
+// Append-only file that persists the SCP state of the node (the latest
+// envelopes it sent and their quorum sets) together with the tx sets the
+// envelopes refer to, so that it can be restored on restart.
+//
+// Every `append` writes one `PersistedSCPState` (v0) record holding the state
+// of a slot and the tx sets that are not in the journal yet. Records are
+// flushed to the OS right away, while fsync is deferred to the end of the
+// current crank, so that all the envelopes emitted at once share a single
+// fsync; `whenSynced` lets callers wait for it (envelopes must not be sent
+// before they are on disk). When restoring, the journal is read sequentially and the latest
+// record of every slot wins. `compact` rewrites the journal keeping only the
+// last MAX_SLOTS_TO_REMEMBER + 1 slots and the tx sets they refer to.
+class SCPStateJournal
+{
+  public:
+    explicit SCPStateJournal(Application& app);
+    ~SCPStateJournal();
+
+    static std::string getPath(Config const& cfg);
+
+    // Reads the journal (if it exists), compacts it and opens it for
+    // appending. Returns the latest state of every remembered slot ordered
+    // by slot. Every tx set that is still referenced is attached to one of
+    // the returned states.
+    std::vector<PersistedSCPState> open();
+
+    bool isOpen() const;
+
+    // Appends the state of a slot. `state` has to be a v0 state and
+    // `txSetHashes` has to contain the hashes of `state.v0().txSets`.
+    void append(PersistedSCPState const& state,
+                std::vector<Hash> const& txSetHashes);
+
+    // Calls `f` once everything appended so far is synced to disk, right away
+    // if it already is. Callbacks still pending when the journal is closed
+    // are dropped.
+    void whenSynced(std::function<void()> f);
+
+    // Returns whether the journal has a tx set with the given hash.
+    bool hasTxSet(Hash const& txSetHash) const;
+
+    // Rewrites the journal with only the remembered slots and the tx sets
+    // referenced by them. This is a no-op if nothing has been appended since
+    // the last compaction.
+    void compact();
+
+    // Syncs and closes the journal.
+    void close();
+
+  private:
+    Application& mApp;
+    std::string const mPath;
+    std::unique_ptr<XDROutputFileStream> mOut;
+
+    // Latest state of every slot in the journal (without the tx sets)
+    std::map<uint64, PersistedSCPState> mSlots;
+    // Tx sets in the journal
+    UnorderedSet<Hash> mTxSets;
+    size_t mRecordsSinceCompaction{0};
+
+    VirtualTimer mSyncTimer;
+    bool mSyncPending{false};
+    std::vector<std::function<void()>> mSyncCallbacks;
+
+    medida::Meter& mAppendMeter;
+    medida::Timer& mSyncTimerMetric;
+    medida::Timer& mCompactTimer;
+
+    void
+    forEachRecord(std::function<void(PersistedSCPState&)> const& f) const;
+    std::vector<PersistedSCPState>
+    rewrite(std::map<Hash, StoredTransactionSet> const& txSets);
+    void scheduleSync();
+    void sync();
+};
+}
@@ -527,6 +527,70 @@ SurgePricingPriorityQueue::laneResources(size_t lane) const
     return mLaneCurrentCount[lane];
 }
 
+std::vector<TransactionFrameBasePtr>
+SurgePricingPriorityQueue::getTopTxsInPlace(
+    std::vector<Resource> const& laneLimits,
+    std::function<bool(TransactionFrameBase const&)> const& filter) const
+{
+    ZoneScoped;
+    releaseAssert(!mComparator.isGreater());
+    releaseAssert(laneLimits.size() == mTxStackSets.size());
+
+    // The lanes are ordered from the lowest to the highest fee rate, so walk
+    // them backwards and merge the lane tails.
+    using ReverseLaneIter =
+        std::pair<size_t, TxStackSet::const_reverse_iterator>;
+    std::vector<ReverseLaneIter> iters;
+    for (size_t lane = 0; lane < mTxStackSets.size(); ++lane)
+    {
+        if (!mTxStackSets[lane].empty())
+        {
+            iters.emplace_back(lane, mTxStackSets[lane].rbegin());
+        }
+    }
+
+    auto laneLeftUntilLimit = laneLimits;
+    std::vector<TransactionFrameBasePtr> txs;
+    // Every transaction has at least one operation, so nothing else can fit
+    // once the generic lane runs out of operations.
+    while (!iters.empty() &&
+           laneLeftUntilLimit[GENERIC_LANE].getVal(
+               Resource::Type::OPERATIONS) > 0)
+    {
+        auto best = iters.begin();
+        for (auto it = std::next(iters.begin()); it != iters.end(); ++it)
+        {
+            if (mComparator(*best->second, *it->second))
+            {
+                best = it;
+            }
+        }
+
+        auto lane = best->first;
+        auto tx = (*best->second)->getTopTx();
+        if (filter(*tx))
+        {
+            auto curr = mLaneConfig->getTxResources(*tx);
+            if (!anyGreater(curr, laneLeftUntilLimit[lane]) &&
+                !anyGreater(curr, laneLeftUntilLimit[GENERIC_LANE]))
+            {
+                txs.push_back(tx);
+                laneLeftUntilLimit[GENERIC_LANE] -= curr;
+                if (lane != GENERIC_LANE)
+                {
+                    laneLeftUntilLimit[lane] -= curr;
+                }
+            }
+        }
+
+        if (++best->second == mTxStackSets[lane].rend())
+        {
+            iters.erase(best);
+        }
+    }
+    return txs;
+}
+
 void
 SurgePricingPriorityQueue::popTopTx(SurgePricingPriorityQueue::Iterator iter)
 {
@@ -185,6 +185,22 @@ class SurgePricingPriorityQueue
         std::function<VisitTxStackResult(TxStack const&)> const& visitor,
         std::vector<Resource>& laneResourcesLeftUntilLimit);
 
+    // Returns the highest fee rate transactions from this queue that fit into
+    // `laneLimits` without modifying the queue. Transactions that don't fit
+    // are skipped (i.e. gaps are allowed), as well as the transactions for
+    // which `filter` returns `false`; the latter are not counted towards the
+    // limits.
+    // Unlike the helpers above, this doesn't rebuild the queue and stops as
+    // soon as the generic lane is full, so its cost is proportional to the
+    // number of visited transactions and not to the queue size. This is meant
+    // for the queues that are maintained incrementally, and hence may only be
+    // called on the queues with the lowest fee rate transaction at the top
+    // (`isHighestPriority == false`). Only the top transaction of every stack
+    // is considered.
+    std::vector<TransactionFrameBasePtr> getTopTxsInPlace(
+        std::vector<Resource> const& laneLimits,
+        std::function<bool(TransactionFrameBase const&)> const& filter) const;
+
     // Creates a `SurgePricingPriorityQueue` for the provided lane
     // configuration.
     // `isHighestPriority` defines the comparison order: when it's `true` the
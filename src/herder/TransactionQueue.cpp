@@ -25,6 +25,7 @@
 #include "util/TarjanSCCCalculator.h"
 #include "util/XDROperators.h"
 #include "util/numeric128.h"
+#include "xdrpp/marshal.h"
 
 #include <Tracy.hpp>
 #include <algorithm>
@@ -52,7 +53,8 @@ TransactionQueue::TransactionQueue(Application& app, uint32 pendingDepth,
                                    bool isSoroban)
     : mApp(app)
     , mPendingDepth(pendingDepth)
-    , mBannedTransactions(banDepth)
+    , mAccountsByAge(pendingDepth)
+    , mBannedByGeneration(banDepth)
     , mBroadcastTimer(app)
 {
     mTxQueueLimiter =
@@ -86,7 +88,13 @@ ClassicTransactionQueue::ClassicTransactionQueue(Application& app,
         sizeByAge,
         app.getMetrics().NewCounter({"herder", "pending-txs", "banned"}),
         app.getMetrics().NewTimer({"herder", "pending-txs", "delay"}),
-        app.getMetrics().NewTimer({"herder", "pending-txs", "self-delay"}));
+        app.getMetrics().NewTimer({"herder", "pending-txs", "self-delay"}),
+        app.getMetrics().NewMeter({"herder", "pending-txs", "applied-known"},
+                                  "transaction"),
+        app.getMetrics().NewMeter({"herder", "pending-txs", "applied-unknown"},
+                                  "transaction"),
+        app.getMetrics().NewMeter(
+            {"herder", "pending-txs", "applied-known-bytes"}, "byte"));
     mBroadcastOpCarryover.resize(1,
                                  Resource::makeEmpty(NUM_CLASSIC_TX_RESOURCES));
 }
@@ -403,6 +411,91 @@ TransactionQueue::prepareDropTransaction(AccountState& as)
     releaseFeeMaybeEraseAccountState(as.mTransaction->mTx);
 }
 
+uint32_t
+TransactionQueue::getAge(AccountState const& as) const
+{
+    return static_cast<uint32_t>(mGeneration - as.mAgeGeneration);
+}
+
+void
+TransactionQueue::addToAgeBucket(AccountStates::iterator stateIter)
+{
+    stateIter->second.mAgeGeneration = mGeneration;
+    mAccountsByAge.front().emplace(stateIter->first);
+    mQueueMetrics->mSizeByAge[0]->inc();
+}
+
+void
+TransactionQueue::removeFromAgeBucket(AccountStates::iterator stateIter)
+{
+    auto age = getAge(stateIter->second);
+    mAccountsByAge.at(age).erase(stateIter->first);
+    mQueueMetrics->mSizeByAge[age]->dec();
+}
+
+bool
+TransactionQueue::addBan(Hash const& hash)
+{
+    auto res = mBannedTransactions.emplace(hash, mGeneration);
+    if (!res.second)
+    {
+        if (res.first->second == mGeneration)
+        {
+            return false;
+        }
+        res.first->second = mGeneration;
+    }
+    mBannedByGeneration.front().emplace_back(hash);
+    return true;
+}
+
+namespace
+{
+// Appends to `edges` the edges of `walk` (a sequence of asset numbers) that
+// lie on a loop. In a single walk an asset can only be strongly connected to
+// the assets visited between two of its occurrences, so the loops are the
+// union of the spans from the first to the last occurrence of every asset,
+// and a single left-to-right sweep finds them. A span that only repeats one
+// asset is not a loop (the Tarjan-based check ignores such self-edges too).
+void
+findLoopEdgesInWalk(std::vector<size_t> const& walk, size_t numAssets,
+                    std::vector<std::pair<size_t, size_t>>& edges)
+{
+    std::vector<size_t> lastPos(numAssets);
+    for (size_t i = 0; i < walk.size(); ++i)
+    {
+        lastPos[walk[i]] = i;
+    }
+
+    size_t i = 0;
+    while (i + 1 < walk.size())
+    {
+        size_t reach = lastPos[walk[i]];
+        if (reach <= i)
+        {
+            ++i;
+            continue;
+        }
+
+        // Extend the span while it overlaps the span of a visited asset.
+        size_t const begin = i;
+        bool distinctAssets = false;
+        for (; i < reach; ++i)
+        {
+            reach = std::max(reach, lastPos[walk[i]]);
+            distinctAssets = distinctAssets || walk[i] != walk[i + 1];
+        }
+        if (distinctAssets)
+        {
+            for (size_t j = begin; j < reach; ++j)
+            {
+                edges.emplace_back(walk[j], walk[j + 1]);
+            }
+        }
+    }
+}
+}
+
 // Heuristic: an "arbitrage transaction" as identified by this function as
 // any tx that has 1 or more path payments in it that collectively form a
 // payment _loop_. That is: a tx that performs a sequence of order-book
@@ -428,36 +521,33 @@ std::vector<AssetPair>
 TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
     TransactionFrameBasePtr tx)
 {
-    std::map<Asset, size_t> assetToNum;
-    std::vector<Asset> numToAsset;
-    std::vector<BitSet> graph;
+    ZoneScoped;
+    UnorderedMap<Asset, size_t> assetToNum;
+    std::vector<Asset const*> numToAsset;
+    // Every path payment is a walk through the graph of assets.
+    std::vector<std::vector<size_t>> walks;
+    size_t numVisits = 0;
 
     auto internAsset = [&](Asset const& a) -> size_t {
-        size_t n = numToAsset.size();
-        auto pair = assetToNum.emplace(a, n);
+        auto pair = assetToNum.emplace(a, numToAsset.size());
         if (pair.second)
         {
-            numToAsset.emplace_back(a);
-            graph.emplace_back(BitSet());
+            numToAsset.emplace_back(&a);
         }
         return pair.first->second;
     };
 
-    auto internEdge = [&](Asset const& src, Asset const& dst) {
-        auto si = internAsset(src);
-        auto di = internAsset(dst);
-        graph.at(si).set(di);
-    };
-
     auto internSegment = [&](Asset const& src, Asset const& dst,
                              std::vector<Asset> const& path) {
-        Asset const* prev = &src;
+        auto& walk = walks.emplace_back();
+        walk.reserve(path.size() + 2);
+        walk.emplace_back(internAsset(src));
         for (auto const& a : path)
         {
-            internEdge(*prev, a);
-            prev = &a;
+            walk.emplace_back(internAsset(a));
         }
-        internEdge(*prev, dst);
+        walk.emplace_back(internAsset(dst));
+        numVisits += walk.size();
     };
 
     for (auto const& op : tx->getRawOperations())
@@ -481,36 +571,71 @@ TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
         }
     }
 
-    // We build a TarjanSCCCalculator for the graph of all the edges we've
-    // seen, and return the set of edges that participate in nontrivial SCCs
-    // (which are loops). This is O(|v| + |e|) and just operations on a
-    // vector of pairs of integers.
-
-    TarjanSCCCalculator tsc;
-    tsc.calculateSCCs(graph.size(), [&graph](size_t i) -> BitSet const& {
-        // NB: this closure must be written with the explicit const&
-        // returning type signature, otherwise it infers wrong and
-        // winds up returning a dangling reference at its site of use.
-        return graph.at(i);
-    });
+    // A loop has to visit some asset twice. This rules out most path
+    // payments that aren't arbitrage in time linear in their path length.
+    if (numVisits == numToAsset.size())
+    {
+        return {};
+    }
 
-    std::vector<AssetPair> ret;
-    for (BitSet const& scc : tsc.mSCCs)
+    std::vector<std::pair<size_t, size_t>> edges;
+    if (walks.size() == 1)
     {
-        if (scc.count() > 1)
+        // The usual single path payment loop.
+        findLoopEdgesInWalk(walks.front(), numToAsset.size(), edges);
+    }
+    else
+    {
+        // We build a TarjanSCCCalculator for the graph of all the edges
+        // we've seen, and return the set of edges that participate in
+        // nontrivial SCCs (which are loops). This is O(|v| + |e|) and just
+        // operations on a vector of pairs of integers.
+        std::vector<BitSet> graph(numToAsset.size());
+        for (auto const& walk : walks)
+        {
+            for (size_t i = 0; i + 1 < walk.size(); ++i)
+            {
+                graph.at(walk[i]).set(walk[i + 1]);
+            }
+        }
+
+        TarjanSCCCalculator tsc;
+        tsc.calculateSCCs(graph.size(), [&graph](size_t i) -> BitSet const& {
+            // NB: this closure must be written with the explicit const&
+            // returning type signature, otherwise it infers wrong and
+            // winds up returning a dangling reference at its site of use.
+            return graph.at(i);
+        });
+
+        for (BitSet const& scc : tsc.mSCCs)
         {
-            for (size_t src = 0; scc.nextSet(src); ++src)
+            if (scc.count() > 1)
             {
-                BitSet edgesFromSrcInSCC = graph.at(src);
-                edgesFromSrcInSCC.inplaceIntersection(scc);
-                for (size_t dst = 0; edgesFromSrcInSCC.nextSet(dst); ++dst)
+                for (size_t src = 0; scc.nextSet(src); ++src)
                 {
-                    ret.emplace_back(
-                        AssetPair{numToAsset.at(src), numToAsset.at(dst)});
+                    BitSet edgesFromSrcInSCC = graph.at(src);
+                    edgesFromSrcInSCC.inplaceIntersection(scc);
+                    for (size_t dst = 0; edgesFromSrcInSCC.nextSet(dst);
+                         ++dst)
+                    {
+                        edges.emplace_back(src, dst);
+                    }
                 }
             }
         }
     }
+
+    // A walk may go through the same pair more than once
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::vector<AssetPair> ret;
+    ret.reserve(edges.size());
+    for (auto const& edge : edges)
+    {
+        ret.emplace_back(
+            AssetPair{*numToAsset.at(edge.first), *numToAsset.at(edge.second)});
+    }
     return ret;
 }
 
@@ -560,10 +685,10 @@ TransactionQueue::tryAdd(TransactionFrameBasePtr tx, bool submittedFromSelf)
     }
     else
     {
-        // New transaction for this account, insert it and update age
+        // New transaction for this account, insert it and start its age
         stateIter->second.mTransaction = {tx, false, mApp.getClock().now(),
                                           submittedFromSelf};
-        mQueueMetrics->mSizeByAge[stateIter->second.mAge]->inc();
+        addToAgeBucket(stateIter);
     }
 
     // Update fee accounting
@@ -593,22 +718,18 @@ TransactionQueue::dropTransaction(AccountStates::iterator stateIter)
     // least one transaction (otherwise we couldn't reach that line).
     releaseAssert(stateIter->second.mTransaction);
 
+    removeFromAgeBucket(stateIter);
     prepareDropTransaction(stateIter->second);
 
     // Actually erase the transaction to be dropped.
     stateIter->second.mTransaction.reset();
 
-    // If the queue for stateIter is now empty, then (1) erase it if it is
-    // not the fee-source for some other transaction or (2) reset the age
-    // otherwise.
+    // If the queue for stateIter is now empty, then erase it if it is not
+    // the fee-source for some other transaction.
     if (stateIter->second.mTotalFees == 0)
     {
         mAccountStates.erase(stateIter);
     }
-    else
-    {
-        stateIter->second.mAge = 0;
-    }
 }
 
 void
@@ -616,68 +737,87 @@ TransactionQueue::removeApplied(Transactions const& appliedTxs)
 {
     ZoneScoped;
 
-    auto now = mApp.getClock().now();
+    // Only the highest applied sequence number of every source account
+    // matters for the queue, so the applied transactions are grouped by
+    // source account and each account state is looked up once.
+    UnorderedMap<AccountID, SequenceNumber> appliedSeqNums;
+    UnorderedSet<Hash> appliedKnownTxs;
     for (auto const& appliedTx : appliedTxs)
     {
-        // If the source account is not in mAccountStates, then it has no
-        // transactions in the queue so there is nothing to do
-        auto stateIter = mAccountStates.find(appliedTx->getSourceID());
-        if (stateIter != mAccountStates.end())
+        if (mKnownTxHashes.find(appliedTx->getFullHash()) !=
+            mKnownTxHashes.end())
         {
-            // If there are no transactions in the queue for this source
-            // account, then there is nothing to do
-            auto const& transaction = stateIter->second.mTransaction;
-            if (transaction)
-            {
-                // We care about matching the sequence number rather than
-                // the hash, because any transaction with a sequence number
-                // less-than-or-equal to the highest applied sequence number
-                // for this source account has either (1) been applied, or
-                // (2) become invalid.
-                if (transaction->mTx->getSeqNum() <= appliedTx->getSeqNum())
-                {
-                    auto& age = stateIter->second.mAge;
-                    mQueueMetrics->mSizeByAge[age]->dec();
-                    age = 0;
-
-                    // update the metric for the time spent for applied
-                    // transactions using exact match
-                    if (transaction->mTx->getFullHash() ==
-                        appliedTx->getFullHash())
-                    {
-                        auto elapsed = now - transaction->mInsertionTime;
-                        mQueueMetrics->mTransactionsDelay.Update(elapsed);
-                        if (transaction->mSubmittedFromSelf)
-                        {
-                            mQueueMetrics->mTransactionsSelfDelay.Update(
-                                elapsed);
-                        }
-                    }
+            mQueueMetrics->mAppliedKnown.Mark();
+            mQueueMetrics->mAppliedKnownBytes.Mark(
+                xdr::xdr_size(appliedTx->getEnvelope()));
+            appliedKnownTxs.emplace(appliedTx->getFullHash());
+        }
+        else
+        {
+            mQueueMetrics->mAppliedUnknown.Mark();
+        }
 
-                    // WARNING: stateIter and everything that references it
-                    // may be invalid from this point onward and should not
-                    // be used.
-                    dropTransaction(stateIter);
-                }
-            }
+        auto res = appliedSeqNums.emplace(appliedTx->getSourceID(),
+                                          appliedTx->getSeqNum());
+        if (!res.second)
+        {
+            res.first->second =
+                std::max(res.first->second, appliedTx->getSeqNum());
         }
 
         // Ban applied tx
-        auto& bannedFront = mBannedTransactions.front();
-        bannedFront.emplace(appliedTx->getFullHash());
+        addBan(appliedTx->getFullHash());
         CLOG_DEBUG(Tx, "Ban applied transaction {}",
                    hexAbbrev(appliedTx->getFullHash()));
 
         // do not mark metric for banning as this is the result of normal
         // flow of operations
     }
+
+    auto now = mApp.getClock().now();
+    for (auto const& [accountID, appliedSeqNum] : appliedSeqNums)
+    {
+        // If the source account is not in mAccountStates, then it has no
+        // transactions in the queue so there is nothing to do
+        auto stateIter = mAccountStates.find(accountID);
+        if (stateIter == mAccountStates.end())
+        {
+            continue;
+        }
+
+        // If there are no transactions in the queue for this source
+        // account, then there is nothing to do
+        auto const& transaction = stateIter->second.mTransaction;
+        // We care about matching the sequence number rather than the hash,
+        // because any transaction with a sequence number less-than-or-equal
+        // to the highest applied sequence number for this source account has
+        // either (1) been applied, or (2) become invalid.
+        if (transaction && transaction->mTx->getSeqNum() <= appliedSeqNum)
+        {
+            // update the metric for the time spent for applied transactions
+            // using exact match
+            if (appliedKnownTxs.find(transaction->mTx->getFullHash()) !=
+                appliedKnownTxs.end())
+            {
+                auto elapsed = now - transaction->mInsertionTime;
+                mQueueMetrics->mTransactionsDelay.Update(elapsed);
+                if (transaction->mSubmittedFromSelf)
+                {
+                    mQueueMetrics->mTransactionsSelfDelay.Update(elapsed);
+                }
+            }
+
+            // WARNING: stateIter and everything that references it may be
+            // invalid from this point onward and should not be used.
+            dropTransaction(stateIter);
+        }
+    }
 }
 
 void
 TransactionQueue::ban(Transactions const& banTxs)
 {
     ZoneScoped;
-    auto& bannedFront = mBannedTransactions.front();
 
     // Group the transactions by source account and ban all the transactions
     // that are explicitly listed
@@ -688,7 +828,7 @@ TransactionQueue::ban(Transactions const& banTxs)
         releaseAssert(
             transactionsByAccount.emplace(tx->getSourceID(), tx).second);
         CLOG_DEBUG(Tx, "Ban transaction {}", hexAbbrev(tx->getFullHash()));
-        if (bannedFront.emplace(tx->getFullHash()).second)
+        if (addBan(tx->getFullHash()))
         {
             mQueueMetrics->mBannedTransactionsCounter.inc();
         }
@@ -708,7 +848,6 @@ TransactionQueue::ban(Transactions const& banTxs)
             if (transaction &&
                 transaction->mTx->getFullHash() == kv.second->getFullHash())
             {
-                mQueueMetrics->mSizeByAge[stateIter->second.mAge]->dec();
                 // WARNING: stateIter and everything that references it may
                 // be invalid from this point onward and should not be used.
                 dropTransaction(stateIter);
@@ -718,22 +857,24 @@ TransactionQueue::ban(Transactions const& banTxs)
 }
 
 #ifdef BUILD_TESTS
-TransactionQueue::AccountState
+TransactionQueue::AccountTransactionQueueInfo
 TransactionQueue::getAccountTransactionQueueInfo(
     AccountID const& accountID) const
 {
     auto i = mAccountStates.find(accountID);
     if (i == std::end(mAccountStates))
     {
-        return AccountState{};
+        return AccountTransactionQueueInfo{};
     }
-    return i->second;
+    auto const& as = i->second;
+    return AccountTransactionQueueInfo{
+        as.mTotalFees, as.mTransaction ? getAge(as) : 0, as.mTransaction};
 }
 
 size_t
 TransactionQueue::countBanned(int index) const
 {
-    return mBannedTransactions[index].size();
+    return mBannedByGeneration[index].size();
 }
 #endif
 
@@ -741,62 +882,55 @@ void
 TransactionQueue::shift()
 {
     ZoneScoped;
-    mBannedTransactions.pop_back();
-    mBannedTransactions.emplace_front();
+    ++mGeneration;
     mArbitrageFloodDamping.clear();
 
-    auto sizes = std::vector<int64_t>{};
-    sizes.resize(mPendingDepth);
-
-    auto& bannedFront = mBannedTransactions.front();
-    auto end = std::end(mAccountStates);
-    auto it = std::begin(mAccountStates);
-    while (it != end)
+    // Unban the transactions banned banDepth generations ago, unless they
+    // have been banned again since.
+    auto const banDepth = mBannedByGeneration.size();
+    for (auto const& hash : mBannedByGeneration.back())
     {
-        // If mTransactions is empty then mAge is always 0. This can occur
-        // if an account is the fee-source for at least one transaction but
-        // not the sequence-number-source for any transaction in the
-        // TransactionQueue.
-        if (it->second.mTransaction)
-        {
-            ++it->second.mAge;
-        }
-
-        if (mPendingDepth == it->second.mAge)
+        auto it = mBannedTransactions.find(hash);
+        if (it != mBannedTransactions.end() &&
+            it->second + banDepth <= mGeneration)
         {
-            if (it->second.mTransaction)
-            {
-                // This never invalidates it because
-                //     it->second.mTransaction
-                // otherwise we couldn't have reached this line.
-                prepareDropTransaction(it->second);
-                CLOG_DEBUG(
-                    Tx, "Ban transaction {}",
-                    hexAbbrev(it->second.mTransaction->mTx->getFullHash()));
-                bannedFront.insert(it->second.mTransaction->mTx->getFullHash());
-                mQueueMetrics->mBannedTransactionsCounter.inc();
-                it->second.mTransaction.reset();
-            }
-            if (it->second.mTotalFees == 0)
-            {
-                it = mAccountStates.erase(it);
-            }
-            else
-            {
-                it->second.mAge = 0;
-            }
+            mBannedTransactions.erase(it);
         }
-        else
+    }
+    auto expiredBans = std::move(mBannedByGeneration.back());
+    mBannedByGeneration.pop_back();
+    expiredBans.clear();
+    mBannedByGeneration.emplace_front(std::move(expiredBans));
+
+    // Every account with a transaction gets one generation older; the ones
+    // in the oldest bucket reach pendingDepth and their transactions are
+    // banned.
+    auto expiredAccounts = std::move(mAccountsByAge.back());
+    mAccountsByAge.pop_back();
+    mAccountsByAge.emplace_front();
+    for (auto const& accountID : expiredAccounts)
+    {
+        auto it = mAccountStates.find(accountID);
+        releaseAssert(it != mAccountStates.end() && it->second.mTransaction);
+
+        // This never invalidates it because
+        //     it->second.mTransaction
+        // otherwise we couldn't have reached this line.
+        prepareDropTransaction(it->second);
+        CLOG_DEBUG(Tx, "Ban transaction {}",
+                   hexAbbrev(it->second.mTransaction->mTx->getFullHash()));
+        addBan(it->second.mTransaction->mTx->getFullHash());
+        mQueueMetrics->mBannedTransactionsCounter.inc();
+        it->second.mTransaction.reset();
+        if (it->second.mTotalFees == 0)
         {
-            sizes[it->second.mAge] +=
-                static_cast<int>(it->second.mTransaction.has_value());
-            ++it;
+            mAccountStates.erase(it);
         }
     }
 
-    for (size_t i = 0; i < sizes.size(); i++)
+    for (size_t i = 0; i < mAccountsByAge.size(); i++)
     {
-        mQueueMetrics->mSizeByAge[i]->set_count(sizes[i]);
+        mQueueMetrics->mSizeByAge[i]->set_count(mAccountsByAge[i].size());
     }
     mTxQueueLimiter->resetEvictionState();
     // pick a new randomizing seed for tie breaking
@@ -807,11 +941,7 @@ TransactionQueue::shift()
 bool
 TransactionQueue::isBanned(Hash const& hash) const
 {
-    return std::any_of(
-        std::begin(mBannedTransactions), std::end(mBannedTransactions),
-        [&](UnorderedSet<Hash> const& transactions) {
-            return transactions.find(hash) != std::end(transactions);
-        });
+    return mBannedTransactions.find(hash) != mBannedTransactions.end();
 }
 
 TxSetTransactions
@@ -834,6 +964,22 @@ TransactionQueue::getTransactions(LedgerHeader const& lcl) const
     return txs;
 }
 
+TxSetTransactions
+TransactionQueue::getTopTransactions(LedgerHeader const& lcl,
+                                     double ledgerMultiplier,
+                                     UnorderedSet<Hash> const& exclude) const
+{
+    ZoneScoped;
+    uint32_t const nextLedgerSeq = lcl.ledgerSeq + 1;
+    int64_t const startingSeq = getStartingSequenceNumber(nextLedgerSeq);
+    return mTxQueueLimiter->getTopTxs(
+        ledgerMultiplier,
+        [startingSeq, &exclude](TransactionFrameBase const& tx) {
+            return tx.getSeqNum() != startingSeq &&
+                   exclude.find(tx.getFullHash()) == exclude.end();
+        });
+}
+
 TransactionFrameBaseConstPtr
 TransactionQueue::getTx(Hash const& hash) const
 {
@@ -853,7 +999,12 @@ void
 TransactionQueue::clearAll()
 {
     mAccountStates.clear();
-    for (auto& b : mBannedTransactions)
+    for (auto& b : mAccountsByAge)
+    {
+        b.clear();
+    }
+    mBannedTransactions.clear();
+    for (auto& b : mBannedByGeneration)
     {
         b.clear();
     }
@@ -1018,7 +1169,14 @@ SorobanTransactionQueue::SorobanTransactionQueue(Application& app,
             {"herder", "pending-soroban-txs", "banned"}),
         app.getMetrics().NewTimer({"herder", "pending-soroban-txs", "delay"}),
         app.getMetrics().NewTimer(
-            {"herder", "pending-soroban-txs", "self-delay"}));
+            {"herder", "pending-soroban-txs", "self-delay"}),
+        app.getMetrics().NewMeter(
+            {"herder", "pending-soroban-txs", "applied-known"}, "transaction"),
+        app.getMetrics().NewMeter(
+            {"herder", "pending-soroban-txs", "applied-unknown"},
+            "transaction"),
+        app.getMetrics().NewMeter(
+            {"herder", "pending-soroban-txs", "applied-known-bytes"}, "byte"));
     mBroadcastOpCarryover.resize(1, Resource::makeEmptySoroban());
 }
 
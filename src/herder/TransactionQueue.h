@@ -24,6 +24,7 @@
 namespace medida
 {
 class Counter;
+class Meter;
 class Timer;
 }
 
@@ -56,6 +57,10 @@ class Application;
  *   pendingDepth, all transactions for that source account are banned. It also
  *   unbans any transactions that have been banned for more than banDepth
  *   ledgers.
+ *
+ * Every shift() starts a new generation. Ages and bans are tracked by the
+ * generation they started in, so that shift() only touches the accounts and
+ * transactions that expire and its cost doesn't depend on the queue size.
  */
 class TransactionQueue
 {
@@ -77,9 +82,11 @@ class TransactionQueue
      * - mTotalFees: the sum of feeBid() over every transaction for which this
      *   account is the fee-source (this may include transactions that are not
      *   in mTransactions)
-     * - mAge: the number of ledgers that have closed since the last ledger in
-     *   which a transaction in mTransactions was included. This is always 0 if
-     *   mTransactions is empty
+     * - mAgeGeneration: the generation in which the age of the account was
+     *   last reset. The age is the number of ledgers that have closed since
+     *   the last ledger in which a transaction in mTransactions was included,
+     *   i.e. the number of generations since mAgeGeneration. It is only
+     *   meaningful if mTransactions is not empty
      * - mTransactions: the list of transactions for which this account is the
      *   sequence-number-source, ordered by sequence number
      */
@@ -93,11 +100,20 @@ class TransactionQueue
     };
     using Transactions = std::vector<TransactionFrameBasePtr>;
     struct AccountState
+    {
+        int64_t mTotalFees{0};
+        uint64_t mAgeGeneration{0};
+        std::optional<TimestampedTx> mTransaction;
+    };
+
+#ifdef BUILD_TESTS
+    struct AccountTransactionQueueInfo
     {
         int64_t mTotalFees{0};
         uint32_t mAge{0};
         std::optional<TimestampedTx> mTransaction;
     };
+#endif
 
     explicit TransactionQueue(Application& app, uint32 pendingDepth,
                               uint32 banDepth, uint32 poolLedgerMultiplier,
@@ -126,12 +142,20 @@ class TransactionQueue
     bool isBanned(Hash const& hash) const;
     TransactionFrameBaseConstPtr getTx(Hash const& hash) const;
     TxSetTransactions getTransactions(LedgerHeader const& lcl) const;
+    // Like `getTransactions`, but only returns the highest fee rate
+    // transactions that fit into `ledgerMultiplier` times the ledger limits,
+    // leaving out the transactions in `exclude`. This is answered from the
+    // incrementally maintained fee index of the queue, so the cost depends on
+    // the number of returned transactions and not on the queue size.
+    TxSetTransactions
+    getTopTransactions(LedgerHeader const& lcl, double ledgerMultiplier,
+                       UnorderedSet<Hash> const& exclude = {}) const;
     bool sourceAccountPending(AccountID const& accountID) const;
 
     virtual size_t getMaxQueueSizeOps() const = 0;
 
 #ifdef BUILD_TESTS
-    AccountState
+    AccountTransactionQueueInfo
     getAccountTransactionQueueInfo(AccountID const& accountID) const;
     size_t countBanned(int index) const;
 #endif
@@ -147,16 +171,28 @@ class TransactionQueue
     using AccountStates = UnorderedMap<AccountID, AccountState>;
 
     /**
-     * Banned transactions are stored in deque of depth banDepth, so it is easy
-     * to unban all transactions that were banned for long enough.
+     * Banned transactions map to the generation in which they were last
+     * banned. The hashes banned in each of the last banDepth generations are
+     * kept in a deque (newest first), so it is easy to unban all transactions
+     * that were banned for long enough.
+     */
+    using BannedTransactions = UnorderedMap<Hash, uint64_t>;
+    using BannedByGeneration = std::deque<std::vector<Hash>>;
+
+    /**
+     * Accounts with a transaction in the queue, bucketed by age (the front
+     * bucket holds the accounts of age 0). There are pendingDepth buckets.
      */
-    using BannedTransactions = std::deque<UnorderedSet<Hash>>;
+    using AccountsByAge = std::deque<UnorderedSet<AccountID>>;
 
     Application& mApp;
     uint32 const mPendingDepth;
 
+    uint64_t mGeneration{0};
     AccountStates mAccountStates;
+    AccountsByAge mAccountsByAge;
     BannedTransactions mBannedTransactions;
+    BannedByGeneration mBannedByGeneration;
 
     // counters
     struct QueueMetrics
@@ -164,17 +200,32 @@ class TransactionQueue
         QueueMetrics(std::vector<medida::Counter*> sizeByAge,
                      medida::Counter& bannedTransactionsCounter,
                      medida::Timer& transactionsDelay,
-                     medida::Timer& transactionsSelfDelay)
+                     medida::Timer& transactionsSelfDelay,
+                     medida::Meter& appliedKnown,
+                     medida::Meter& appliedUnknown,
+                     medida::Meter& appliedKnownBytes)
             : mSizeByAge(std::move(sizeByAge))
             , mBannedTransactionsCounter(bannedTransactionsCounter)
             , mTransactionsDelay(transactionsDelay)
             , mTransactionsSelfDelay(transactionsSelfDelay)
+            , mAppliedKnown(appliedKnown)
+            , mAppliedUnknown(appliedUnknown)
+            , mAppliedKnownBytes(appliedKnownBytes)
         {
         }
         std::vector<medida::Counter*> mSizeByAge;
         medida::Counter& mBannedTransactionsCounter;
         medida::Timer& mTransactionsDelay;
         medida::Timer& mTransactionsSelfDelay;
+        // Applied transactions that were (or were not) already in the queue,
+        // i.e. that could have been reconstructed locally from their hash
+        // instead of being transferred as part of the tx set. This only
+        // measures the potential savings: tx sets are still always fetched
+        // in full, as a hash-only tx set message would need a new
+        // StellarMessage type in the XDR definitions.
+        medida::Meter& mAppliedKnown;
+        medida::Meter& mAppliedUnknown;
+        medida::Meter& mAppliedKnownBytes;
     };
 
     std::unique_ptr<QueueMetrics> mQueueMetrics;
@@ -206,6 +257,12 @@ class TransactionQueue
 
     void releaseFeeMaybeEraseAccountState(TransactionFrameBasePtr tx);
 
+    uint32_t getAge(AccountState const& as) const;
+    void addToAgeBucket(AccountStates::iterator stateIter);
+    void removeFromAgeBucket(AccountStates::iterator stateIter);
+    // Bans `hash` in the current generation, returns false if it already is.
+    bool addBan(Hash const& hash);
+
     void prepareDropTransaction(AccountState& as);
     void dropTransaction(AccountStates::iterator stateIter);
 
@@ -0,0 +1,127 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/TxFrameInternTable.h"
+#include "crypto/SHA.h"
+#include "main/Application.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include <Tracy.hpp>
+
+#include <algorithm>
+
+namespace stellar
+{
+
+size_t const TxFrameInternTable::MIN_SWEEP_THRESHOLD = 1024;
+
+TxFrameInternTable::TxFrameInternTable(Application& app)
+    : mNetworkID(app.getNetworkID())
+    , mSweepThreshold(MIN_SWEEP_THRESHOLD)
+    , mHitMeter(app.getMetrics().NewMeter({"herder", "tx-intern", "hit"},
+                                          "transaction"))
+    , mMissMeter(app.getMetrics().NewMeter({"herder", "tx-intern", "miss"},
+                                           "transaction"))
+{
+}
+
+TransactionFrameBasePtr
+TxFrameInternTable::intern(TransactionEnvelope const& env)
+{
+    ZoneScoped;
+    auto fullHash = xdrSha256(env);
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        auto res = findLocked(fullHash);
+        if (res)
+        {
+            mHitMeter.Mark();
+            return res;
+        }
+    }
+    mMissMeter.Mark();
+
+    auto tx = TransactionFrameBase::makeTransactionFromWire(mNetworkID, env);
+    tx->precomputeHashesAndSize();
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    // Another thread may have interned the same transaction meanwhile.
+    auto res = findLocked(fullHash);
+    if (res)
+    {
+        return res;
+    }
+    insertLocked(tx);
+    return tx;
+}
+
+TransactionFrameBasePtr
+TxFrameInternTable::intern(TransactionFrameBasePtr const& tx)
+{
+    ZoneScoped;
+    tx->precomputeHashesAndSize();
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    auto res = findLocked(tx->getFullHash());
+    if (res)
+    {
+        mHitMeter.Mark();
+        return res;
+    }
+    mMissMeter.Mark();
+    insertLocked(tx);
+    return tx;
+}
+
+Hash const&
+TxFrameInternTable::getNetworkID() const
+{
+    return mNetworkID;
+}
+
+size_t
+TxFrameInternTable::size() const
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mFrames.size();
+}
+
+TransactionFrameBasePtr
+TxFrameInternTable::findLocked(Hash const& fullHash)
+{
+    auto it = mFrames.find(fullHash);
+    if (it != mFrames.end())
+    {
+        return it->second.lock();
+    }
+    return nullptr;
+}
+
+void
+TxFrameInternTable::insertLocked(TransactionFrameBasePtr const& tx)
+{
+    mFrames[tx->getFullHash()] = tx;
+    if (mFrames.size() < mSweepThreshold)
+    {
+        return;
+    }
+
+    // Drop the frames that are not referenced anymore. The threshold grows
+    // with the number of live frames so that sweeping stays amortized O(1)
+    // per insertion.
+    for (auto it = mFrames.begin(); it != mFrames.end();)
+    {
+        if (it->second.expired())
+        {
+            it = mFrames.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    mSweepThreshold = std::max(MIN_SWEEP_THRESHOLD, 2 * mFrames.size());
+}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "transactions/TransactionFrameBase.h"
+#include "util/NonCopyable.h"
+#include "util/UnorderedMap.h"
+
+#include <memory>
+#include <mutex>
+
+namespace medida
+{
+class Meter;
+}
+
+namespace stellar
+{
+
+class Application;
+
+// Table of the transaction frames that are alive in the process, keyed by
+// their full hash. A transaction is received from the overlay, admitted to
+// the queue, nominated, validated as a part of the tx sets and finally
+// applied; all of these stages look the transaction up here instead of
+// building a new frame from the XDR, so its hashes and size are computed only
+// once.
+//
+// The table only holds weak references: a frame is dropped as soon as the
+// last queue or tx set referring to it goes away. Frames are registered with
+// their hashes and size already computed, so other threads may read these
+// (and the envelope) while the main thread validates or applies the frame.
+class TxFrameInternTable : public NonMovableOrCopyable
+{
+  public:
+    explicit TxFrameInternTable(Application& app);
+
+    // Returns the live frame for `env`, or a new frame registered in the
+    // table if there is none.
+    TransactionFrameBasePtr intern(TransactionEnvelope const& env);
+
+    // Returns the live frame with the same full hash as `tx`, or registers
+    // and returns `tx` if there is none. Use this when a frame has to be
+    // built anyway, as it hashes the envelope only once.
+    TransactionFrameBasePtr intern(TransactionFrameBasePtr const& tx);
+
+    Hash const& getNetworkID() const;
+
+    // Number of entries in the table, including the ones that are not
+    // swept yet.
+    size_t size() const;
+
+  private:
+    // Below this size the expired entries are not swept.
+    static size_t const MIN_SWEEP_THRESHOLD;
+
+    Hash const& mNetworkID;
+    mutable std::mutex mMutex;
+    UnorderedMap<Hash, std::weak_ptr<TransactionFrameBase>> mFrames;
+    size_t mSweepThreshold;
+
+    medida::Meter& mHitMeter;
+    medida::Meter& mMissMeter;
+
+    TransactionFrameBasePtr findLocked(Hash const& fullHash);
+    void insertLocked(TransactionFrameBasePtr const& tx);
+};
+}
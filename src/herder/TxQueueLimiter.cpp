@@ -67,6 +67,25 @@ TxQueueLimiter::maxScaledLedgerResources(bool isSoroban) const
                             mPoolLedgerMultiplier);
 }
 
+std::vector<TransactionFrameBasePtr>
+TxQueueLimiter::getTopTxs(
+    double ledgerMultiplier,
+    std::function<bool(TransactionFrameBase const&)> const& filter) const
+{
+    if (!mTxs)
+    {
+        return {};
+    }
+    // Lane limits of the limiter are already scaled by the pool multiplier.
+    std::vector<Resource> laneLimits;
+    for (auto const& limit : mSurgePricingLaneConfig->getLaneLimits())
+    {
+        laneLimits.emplace_back(
+            multiplyByDouble(limit, ledgerMultiplier / mPoolLedgerMultiplier));
+    }
+    return mTxs->getTopTxsInPlace(laneLimits, filter);
+}
+
 void
 TxQueueLimiter::addTransaction(TransactionFrameBasePtr const& tx)
 {
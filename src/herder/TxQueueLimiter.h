@@ -95,6 +95,14 @@ class TxQueueLimiter
 #endif
     Resource maxScaledLedgerResources(bool isSoroban) const;
 
+    // Returns the highest fee rate transactions known to the limiter that fit
+    // into `ledgerMultiplier` times the ledger limits, skipping the
+    // transactions rejected by `filter`. This doesn't rebuild the queue and
+    // only visits the transactions until the limit is reached.
+    std::vector<TransactionFrameBasePtr> getTopTxs(
+        double ledgerMultiplier,
+        std::function<bool(TransactionFrameBase const&)> const& filter) const;
+
     // Evict `txsToEvict` from the limiter by calling `evict`.
     // `txsToEvict` should be provided by the `canAddTx` call.
     // Note that evict must call `removeTransaction` as to make space.
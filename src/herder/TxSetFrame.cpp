@@ -9,7 +9,9 @@
 #include "crypto/Random.h"
 #include "crypto/SHA.h"
 #include "database/Database.h"
+#include "herder/Herder.h"
 #include "herder/SurgePricingUtils.h"
+#include "herder/TxFrameInternTable.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
@@ -25,6 +27,10 @@
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
 
+#include "medida/histogram.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
 #include <Tracy.hpp>
 #include <algorithm>
 #include <list>
@@ -222,6 +228,25 @@ transactionsToGeneralizedTransactionSetXDR(
         }
     }
 }
+
+// Frames are interned, so the same frame is shared by the queues and all the
+// tx sets containing the transaction. A tx set that contains a transaction
+// more than once (invalid, but present in the old history) gets a separate
+// frame for every copy, so that applying one copy doesn't overwrite the
+// result of the other.
+TransactionFrameBasePtr
+internTxSetTransaction(TxFrameInternTable& internTable,
+                       TransactionEnvelope const& env,
+                       UnorderedSet<TransactionFrameBase const*>& seenTxs)
+{
+    auto tx = internTable.intern(env);
+    if (!seenTxs.insert(tx.get()).second)
+    {
+        tx = TransactionFrameBase::makeTransactionFromWire(
+            internTable.getNetworkID(), env);
+    }
+    return tx;
+}
 } // namespace
 
 TxSetXDRFrame::TxSetXDRFrame(TransactionSet const& xdrTxSet)
@@ -499,6 +524,8 @@ TxSetXDRFrame::prepareForApply(Application& app) const
 #endif
     ZoneScoped;
     std::unique_ptr<ApplicableTxSetFrame> txSet{};
+    auto& internTable = app.getHerder().getTxFrameInternTable();
+    UnorderedSet<TransactionFrameBase const*> seenTxs;
     if (isGeneralizedTxSet())
     {
         auto const& xdrTxSet = std::get<GeneralizedTransactionSet>(mXDRTxSet);
@@ -537,7 +564,7 @@ TxSetXDRFrame::prepareForApply(Application& app) const
                         baseFee = *component.txsMaybeDiscountedFee().baseFee;
                     }
                     if (!txSet->addTxsFromXdr(
-                            app.getNetworkID(),
+                            internTable, seenTxs,
                             component.txsMaybeDiscountedFee().txs, true,
                             baseFee, static_cast<TxSetPhase>(phaseId)))
                     {
@@ -557,7 +584,7 @@ TxSetXDRFrame::prepareForApply(Application& app) const
         auto const& xdrTxSet = std::get<TransactionSet>(mXDRTxSet);
         txSet = std::unique_ptr<ApplicableTxSetFrame>(new ApplicableTxSetFrame(
             app, false, previousLedgerHash(), {TxSetTransactions{}}, mHash));
-        if (!txSet->addTxsFromXdr(app.getNetworkID(), xdrTxSet.txs, false,
+        if (!txSet->addTxsFromXdr(internTable, seenTxs, xdrTxSet.txs, false,
                                   std::nullopt, TxSetPhase::CLASSIC))
         {
             CLOG_DEBUG(Herder,
@@ -662,9 +689,10 @@ TxSetXDRFrame::sizeOpTotalForLogging() const
 }
 
 TxSetPhaseTransactions
-TxSetXDRFrame::createTransactionFrames(Hash const& networkID) const
+TxSetXDRFrame::createTransactionFrames(TxFrameInternTable& internTable) const
 {
     TxSetPhaseTransactions phaseTxs;
+    UnorderedSet<TransactionFrameBase const*> seenTxs;
     if (isGeneralizedTxSet())
     {
         auto const& txSet =
@@ -677,8 +705,7 @@ TxSetXDRFrame::createTransactionFrames(Hash const& networkID) const
                 for (auto const& tx : component.txsMaybeDiscountedFee().txs)
                 {
                     txs.emplace_back(
-                        TransactionFrameBase::makeTransactionFromWire(networkID,
-                                                                      tx));
+                        internTxSetTransaction(internTable, tx, seenTxs));
                 }
             }
         }
@@ -689,8 +716,7 @@ TxSetXDRFrame::createTransactionFrames(Hash const& networkID) const
         auto const& txSet = std::get<TransactionSet>(mXDRTxSet).txs;
         for (auto const& tx : txSet)
         {
-            txs.emplace_back(
-                TransactionFrameBase::makeTransactionFromWire(networkID, tx));
+            txs.emplace_back(internTxSetTransaction(internTable, tx, seenTxs));
         }
     }
     return phaseTxs;
@@ -960,9 +986,16 @@ ApplicableTxSetFrame::checkValid(Application& app,
         }
     }
 
+    // Only the tx set check is timed, not the revalidation of the queues
+    // after each ledger, which also goes through getInvalidTxList
+    auto timer =
+        app.getMetrics().NewTimer({"herder", "tx-set", "validate"}).TimeScope();
+    auto& validateTxs =
+        app.getMetrics().NewHistogram({"herder", "tx-set", "validate-txs"});
     bool allValid = true;
     for (auto const& txs : mTxPhases)
     {
+        validateTxs.Update(txs.size());
         if (!TxSetUtils::getInvalidTxList(txs, app, lowerBoundCloseTimeOffset,
                                           upperBoundCloseTimeOffset, true)
                  .empty())
@@ -1337,8 +1370,10 @@ ApplicableTxSetFrame::isGeneralizedTxSet() const
 
 bool
 ApplicableTxSetFrame::addTxsFromXdr(
-    Hash const& networkID, xdr::xvector<TransactionEnvelope> const& txs,
-    bool useBaseFee, std::optional<int64_t> baseFee, TxSetPhase phase)
+    TxFrameInternTable& internTable,
+    UnorderedSet<TransactionFrameBase const*>& seenTxs,
+    xdr::xvector<TransactionEnvelope> const& txs, bool useBaseFee,
+    std::optional<int64_t> baseFee, TxSetPhase phase)
 {
     auto& phaseTxs = mTxPhases.at(static_cast<int>(phase));
     size_t oldSize = phaseTxs.size();
@@ -1346,7 +1381,7 @@ ApplicableTxSetFrame::addTxsFromXdr(
 
     for (auto const& env : txs)
     {
-        auto tx = TransactionFrameBase::makeTransactionFromWire(networkID, env);
+        auto tx = internTxSetTransaction(internTable, env, seenTxs);
         if (!tx->XDRProvidesValidFee())
         {
             return false;
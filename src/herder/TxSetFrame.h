@@ -9,6 +9,7 @@
 #include "overlay/StellarXDR.h"
 #include "transactions/TransactionFrame.h"
 #include "util/NonCopyable.h"
+#include "util/UnorderedSet.h"
 #include "xdr/Stellar-internal.h"
 
 #include <deque>
@@ -22,6 +23,7 @@ namespace stellar
 class Application;
 class TxSetXDRFrame;
 class ApplicableTxSetFrame;
+class TxFrameInternTable;
 using TxSetXDRFrameConstPtr = std::shared_ptr<TxSetXDRFrame const>;
 using ApplicableTxSetFrameConstPtr =
     std::unique_ptr<ApplicableTxSetFrame const>;
@@ -47,8 +49,9 @@ std::string getTxSetPhaseName(TxSetPhase phase);
 // The result is guaranteed to pass `checkValid` check with the same
 // arguments as in this method, so additional validation is not needed.
 //
-// **Note**: the output `ApplicableTxSetFrame` will *not* contain the input
-// transaction pointers.
+// **Note**: the output `ApplicableTxSetFrame` will not necessarily contain
+// the input transaction pointers: its frames are looked up in the Herder's
+// `TxFrameInternTable`.
 std::pair<TxSetXDRFrameConstPtr, ApplicableTxSetFrameConstPtr>
 makeTxSetFromTransactions(
     TxSetPhaseTransactions const& txPhases, Application& app,
@@ -165,12 +168,14 @@ class TxSetXDRFrame : public NonMovableOrCopyable
     // Returns the size of this transaction set when encoded to XDR.
     size_t encodedSize() const;
 
-    // Creates transaction frames for all the transactions in the set, grouped
-    // by phase.
-    // This is only necessary to serve a very specific use case of updating
-    // the transaction queue with wired tx sets. Otherwise, use
+    // Creates (or looks up in `internTable`) transaction frames for all the
+    // transactions in the set, grouped by phase.
+    // This is only necessary to serve the specific use cases of updating
+    // the transaction queue with wired tx sets and of building the frames of
+    // replayed tx sets ahead of apply. Otherwise, use
     // getTransactionsForPhase() in `ApplicableTxSetFrame`.
-    TxSetPhaseTransactions createTransactionFrames(Hash const& networkID) const;
+    TxSetPhaseTransactions
+    createTransactionFrames(TxFrameInternTable& internTable) const;
 
 #ifdef BUILD_TESTS
     mutable ApplicableTxSetFrameConstPtr mApplicableTxSetOverride;
@@ -312,7 +317,8 @@ class ApplicableTxSetFrame
     // sets won't exist in the network anymore.
     void computeTxFeesForNonGeneralizedSet(LedgerHeader const& lclHeader) const;
 
-    bool addTxsFromXdr(Hash const& networkID,
+    bool addTxsFromXdr(TxFrameInternTable& internTable,
+                       UnorderedSet<TransactionFrameBase const*>& seenTxs,
                        xdr::xvector<TransactionEnvelope> const& txs,
                        bool useBaseFee, std::optional<int64_t> baseFee,
                        TxSetPhase phase);
@@ -14,6 +14,7 @@
 #include "ledger/LedgerTxnHeader.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "transactions/SignatureUtils.h"
 #include "transactions/TransactionUtils.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
@@ -23,9 +24,14 @@
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
 
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include <Tracy.hpp>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <list>
+#include <mutex>
 #include <numeric>
 
 namespace stellar
@@ -56,6 +62,80 @@ removeTxs(TxSetTransactions const& txs, TxSetTransactions const& txsToRemove)
 
     return newTxs;
 }
+
+// Below this many transactions handing signature checks to worker threads
+// costs more than it saves.
+size_t const PARALLEL_SIGNATURE_CHECK_MIN_TXS = 64;
+
+// Shared between the main thread and the worker threads helping it. Each
+// worker claims whole account queues, so every transaction frame is only
+// touched by one thread. Workers that start after all queues are claimed
+// return right away.
+struct ParallelSignatureCheck
+{
+    std::vector<std::shared_ptr<AccountTransactionQueue>> const mQueues;
+    Hash const mNetworkID;
+    std::atomic<size_t> mNextQueue{0};
+    std::atomic<size_t> mQueuesDone{0};
+    std::mutex mMutex;
+    std::condition_variable mDoneCV;
+
+    ParallelSignatureCheck(
+        std::vector<std::shared_ptr<AccountTransactionQueue>> const& queues,
+        Hash const& networkID)
+        : mQueues(queues), mNetworkID(networkID)
+    {
+    }
+
+    void
+    run()
+    {
+        size_t i;
+        while ((i = mNextQueue.fetch_add(1)) < mQueues.size())
+        {
+            for (auto const& tx : mQueues[i]->mTxs)
+            {
+                SignatureUtils::populateSignatureCache(*tx, mNetworkID,
+                                                       nullptr);
+            }
+            if (mQueuesDone.fetch_add(1) + 1 == mQueues.size())
+            {
+                std::lock_guard<std::mutex> guard(mMutex);
+                mDoneCV.notify_all();
+            }
+        }
+    }
+
+    void
+    waitForWorkers()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCV.wait(lock, [this] { return mQueuesDone == mQueues.size(); });
+    }
+};
+
+// Signature verification is the bulk of the CPU cost of checkValid and does
+// not depend on ledger state, so it is done here ahead of time on the worker
+// threads, with the main thread pitching in. The sequential checkValid pass
+// that follows then finds the results in the signature verification cache.
+void
+verifySignaturesInParallel(
+    std::vector<std::shared_ptr<AccountTransactionQueue>> const& queues,
+    Application& app)
+{
+    ZoneScoped;
+    auto workers = std::min<size_t>(
+        std::max(app.getConfig().WORKER_THREADS, 1), queues.size() - 1);
+    auto check =
+        std::make_shared<ParallelSignatureCheck>(queues, app.getNetworkID());
+    for (size_t i = 0; i < workers; ++i)
+    {
+        app.postOnBackgroundThread([check]() { check->run(); },
+                                   "verifySignaturesInParallel");
+    }
+    check->run();
+    check->waitForWorkers();
+}
 } // namespace
 
 AccountTransactionQueue::AccountTransactionQueue(
@@ -176,6 +256,16 @@ TxSetUtils::getInvalidTxList(TxSetTransactions const& txs, Application& app,
     TxSetTransactions invalidTxs;
 
     auto accountTxQueues = buildAccountTxQueues(txs);
+    if (txs.size() >= PARALLEL_SIGNATURE_CHECK_MIN_TXS &&
+        accountTxQueues.size() > 1)
+    {
+        auto sigTimer =
+            app.getMetrics()
+                .NewTimer({"herder", "tx-set", "validate-signatures"})
+                .TimeScope();
+        verifySignaturesInParallel(accountTxQueues, app);
+    }
+
     for (auto& accountQueue : accountTxQueues)
     {
         int64_t lastSeq = 0;
@@ -4,6 +4,8 @@
 
 #include "herder/HerderImpl.h"
 #include "herder/LedgerCloseData.h"
+#include "herder/SCPMessageRecording.h"
+#include "herder/SCPStateJournal.h"
 #include "herder/test/TestTxSetUtils.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -26,6 +28,9 @@
 #include "ledger/LedgerTxnHeader.h"
 #include "lib/catch.hpp"
 #include "main/CommandHandler.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/OverlayMetrics.h"
 #include "test/TxTests.h"
@@ -34,10 +39,15 @@
 #include "transactions/TransactionBridge.h"
 #include "transactions/TransactionFrame.h"
 #include "transactions/TransactionUtils.h"
+#include "util/Decoder.h"
+#include "util/Fs.h"
 #include "util/Math.h"
 #include "util/ProtocolVersion.h"
+#include "util/TmpDir.h"
+#include "util/XDRStream.h"
 
 #include "crypto/Hex.h"
+#include "crypto/Random.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "test/TxTests.h"
 #include "xdr/Stellar-ledger.h"
@@ -45,8 +55,10 @@
 #include "xdrpp/marshal.h"
 #include <algorithm>
 #include <fmt/format.h>
+#include <fstream>
 #include <numeric>
 #include <optional>
+#include <set>
 
 using namespace stellar;
 using namespace stellar::txbridge;
@@ -3070,7 +3082,7 @@ TEST_CASE("SCP State", "[herder]")
                     for (auto const& h : getTxSetHashes(msg))
                     {
                         REQUIRE(herder.getPendingEnvelopes().getTxSet(h));
-                        REQUIRE(app->getPersistentState().hasTxSet(h));
+                        REQUIRE(herder.getSCPStateJournal().hasTxSet(h));
                         hashes.insert(h);
                     }
                 }
@@ -3079,6 +3091,61 @@ TEST_CASE("SCP State", "[herder]")
             return hashes;
         };
 
+    // Saves the SCP state of `app` in the database, as versions without the
+    // journal did, and removes the journal
+    bool migrateFromDatabase = false;
+    auto moveJournalToDatabase = [&](Application& app) {
+        auto& journal =
+            static_cast<HerderImpl&>(app.getHerder()).getSCPStateJournal();
+        journal.close();
+
+        auto& session = app.getDatabase().getSession();
+        auto path = SCPStateJournal::getPath(app.getConfig());
+        std::map<uint64, PersistedSCPState> slots;
+        {
+            XDRInputFileStream in;
+            in.open(path);
+            PersistedSCPState record;
+            while (in.readOne(record))
+            {
+                for (auto const& storedSet : record.v0().txSets)
+                {
+                    auto txSet = TxSetXDRFrame::makeFromStoredTxSet(storedSet);
+                    std::string name =
+                        "txset" + binToHex(txSet->getContentsHash());
+                    std::string value =
+                        decoder::encode_b64(xdr::xdr_to_opaque(storedSet));
+                    session << "INSERT INTO storestate (statename, state) "
+                               "VALUES (:n, :v);",
+                        soci::use(name), soci::use(value);
+                }
+                auto& state =
+                    slots[record.v0().scpEnvelopes.front().statement.slotIndex];
+                state.v(1);
+                state.v1().scpEnvelopes = record.v0().scpEnvelopes;
+                state.v1().quorumSets = record.v0().quorumSets;
+            }
+        }
+        for (auto const& slotState : slots)
+        {
+            auto index = static_cast<uint32>(
+                slotState.first % (app.getConfig().MAX_SLOTS_TO_REMEMBER + 1));
+            std::string name = "lastscpdataxdr";
+            if (index > 0)
+            {
+                name += std::to_string(index);
+            }
+            std::string value =
+                decoder::encode_b64(xdr::xdr_to_opaque(slotState.second));
+            session << "DELETE FROM storestate WHERE statename = :n;",
+                soci::use(name);
+            session << "INSERT INTO storestate (statename, state) "
+                       "VALUES (:n, :v);",
+                soci::use(name), soci::use(value);
+        }
+        REQUIRE(std::remove(path.c_str()) == 0);
+    };
+
     auto doTest = [&](bool forceSCP) {
         SECTION("sqlite")
         {
@@ -3143,6 +3210,11 @@ TEST_CASE("SCP State", "[herder]")
             }
         }
 
+        if (migrateFromDatabase)
+        {
+            moveJournalToDatabase(*sim->getNode(nodeIDs[0]));
+        }
+
         // restart simulation
         sim.reset();
 
@@ -3184,6 +3256,13 @@ TEST_CASE("SCP State", "[herder]")
         // Check that node0 restored state correctly
         knownTxSetHashes =
             checkTxSetHashesPersisted(sim->getNode(nodeIDs[0]), nodeSCPState);
+        if (migrateFromDatabase)
+        {
+            // The state moved to the journal
+            auto& ps = sim->getNode(nodeIDs[0])->getPersistentState();
+            REQUIRE(ps.getSCPStateAllSlots().empty());
+            REQUIRE(ps.getTxSetsForAllSlots().empty());
+        }
 
         if (forceSCP)
         {
@@ -3232,6 +3311,16 @@ TEST_CASE("SCP State", "[herder]")
         }
     }
 
+    SECTION("SCP State migrated from the database")
+    {
+        migrateFromDatabase = true;
+        doTest(true);
+
+        sim->crankUntil(
+            [&]() { return sim->haveAllExternalized(expectedLedger + 1, 5); },
+            2 * numLedgers * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+    }
+
     SECTION("No Force SCP")
     {
         // node 0 and 1 don't try to close, causing all nodes
@@ -3299,10 +3388,12 @@ TEST_CASE("SCP State", "[herder]")
         // First,  check that node removed all persisted state for ledgers <=
         // expectedLedger
         auto app = sim->getNode(nodeIDs[0]);
+        auto& journal =
+            static_cast<HerderImpl&>(app->getHerder()).getSCPStateJournal();
 
         for (auto const& txSetHash : knownTxSetHashes)
         {
-            REQUIRE(!app->getPersistentState().hasTxSet(txSetHash));
+            REQUIRE(!journal.hasTxSet(txSetHash));
         }
 
         // Now, ensure all new tx sets have been persisted
@@ -3310,6 +3401,176 @@ TEST_CASE("SCP State", "[herder]")
     }
 }
 
+TEST_CASE("SCP state journal", "[herder]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.MAX_SLOTS_TO_REMEMBER = 3;
+    // The herder doesn't open its journal until the application starts
+    auto app = createTestApplication(clock, cfg, /* newDB */ true,
+                                     /* startApp */ false);
+    auto const path = SCPStateJournal::getPath(app->getConfig());
+
+    // State of `slot` externalizing a new tx set, identified by `seed`
+    std::map<std::string, Hash> txSetHashes;
+    auto makeState = [&](uint64 slot, std::string const& seed) {
+        LedgerHeaderHistoryEntry lcl;
+        lcl.hash = sha256(seed);
+        auto txSet = TxSetXDRFrame::makeEmpty(lcl);
+        txSetHashes[seed] = txSet->getContentsHash();
+
+        StellarValue sv;
+        sv.txSetHash = txSet->getContentsHash();
+        sv.closeTime = slot;
+        SCPEnvelope env;
+        env.statement.slotIndex = slot;
+        env.statement.pledges.type(SCP_ST_EXTERNALIZE);
+        auto& ext = env.statement.pledges.externalize();
+        ext.commit.counter = 1;
+        ext.commit.value = xdr::xdr_to_opaque(sv);
+
+        PersistedSCPState state;
+        state.v(0);
+        state.v0().scpEnvelopes.emplace_back(env);
+        state.v0().txSets.emplace_back();
+        txSet->storeXDR(state.v0().txSets.back());
+        return state;
+    };
+    auto append = [&](SCPStateJournal& journal, uint64 slot,
+                      std::string const& seed) {
+        journal.append(makeState(slot, seed), {txSetHashes[seed]});
+    };
+    auto slotsOf = [](std::vector<PersistedSCPState> const& states) {
+        std::vector<uint64> slots;
+        for (auto const& state : states)
+        {
+            slots.emplace_back(
+                state.v0().scpEnvelopes.front().statement.slotIndex);
+        }
+        return slots;
+    };
+
+    SECTION("torn record at the end is dropped")
+    {
+        {
+            SCPStateJournal journal(*app);
+            REQUIRE(journal.open().empty());
+            for (uint64 slot = 1; slot <= 3; ++slot)
+            {
+                append(journal, slot, std::to_string(slot));
+            }
+            journal.close();
+        }
+        // A record whose size says it's longer than what was written
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::app);
+            out.write("\x80\x00\x01\x00\x00\x00", 6);
+        }
+
+        SCPStateJournal journal(*app);
+        auto states = journal.open();
+        REQUIRE(slotsOf(states) == std::vector<uint64>{1, 2, 3});
+        for (auto const& state : states)
+        {
+            REQUIRE(state.v0().txSets.size() == 1);
+        }
+        for (auto const& hash : txSetHashes)
+        {
+            REQUIRE(journal.hasTxSet(hash.second));
+        }
+
+        // The journal was rewritten without the torn record, so new
+        // records can be read back
+        append(journal, 4, "4");
+        journal.close();
+        SCPStateJournal reopened(*app);
+        REQUIRE(slotsOf(reopened.open()) == std::vector<uint64>{1, 2, 3, 4});
+        reopened.close();
+    }
+
+    SECTION("compaction keeps the remembered slots and their tx sets")
+    {
+        SCPStateJournal journal(*app);
+        journal.open();
+        for (uint64 slot = 1; slot <= 8; ++slot)
+        {
+            append(journal, slot, std::to_string(slot));
+        }
+        // The latest state of a slot replaces the previous one
+        append(journal, 8, "8b");
+        auto sizeBefore = fs::size(path);
+
+        journal.compact();
+        REQUIRE(fs::size(path) < sizeBefore);
+        for (auto const& seed : {"1", "2", "3", "4", "8"})
+        {
+            REQUIRE(!journal.hasTxSet(txSetHashes[seed]));
+        }
+        for (auto const& seed : {"5", "6", "7", "8b"})
+        {
+            REQUIRE(journal.hasTxSet(txSetHashes[seed]));
+        }
+
+        // Records appended after the compaction are kept
+        append(journal, 9, "9");
+        journal.close();
+
+        SCPStateJournal reopened(*app);
+        auto states = reopened.open();
+        REQUIRE(slotsOf(states) == std::vector<uint64>{6, 7, 8, 9});
+        auto const& lastEnv = states[2].v0().scpEnvelopes.front();
+        REQUIRE(getTxSetHashes(lastEnv) ==
+                std::vector<Hash>{txSetHashes["8b"]});
+        REQUIRE(!reopened.hasTxSet(txSetHashes["5"]));
+        REQUIRE(reopened.hasTxSet(txSetHashes["9"]));
+        reopened.close();
+    }
+}
+
+TEST_CASE("SCP envelopes are broadcast once journaled", "[herder]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    // Envelopes are not broadcast when closing ledgers manually
+    cfg.MANUAL_CLOSE = false;
+    auto app = createTestApplication(clock, cfg);
+    auto& herder = static_cast<HerderImpl&>(app->getHerder());
+    auto& lm = app->getLedgerManager();
+
+    auto timeout = clock.now() + std::chrono::minutes(1);
+    while (lm.getLastClosedLedgerNum() < 3)
+    {
+        clock.crank(true);
+        REQUIRE(clock.now() < timeout);
+    }
+
+    // Re-emit the latest envelope the node sent, so that it is journaled
+    // again
+    auto slot = lm.getLastClosedLedgerNum() + 1;
+    auto envs = herder.getSCP().getLatestMessagesSend(slot);
+    if (envs.empty())
+    {
+        envs = herder.getSCP().getLatestMessagesSend(--slot);
+    }
+    REQUIRE(!envs.empty());
+
+    auto& emitted =
+        app->getMetrics().NewMeter({"scp", "envelope", "emit"}, "envelope");
+    auto& synced =
+        app->getMetrics().NewTimer({"herder", "scp-journal", "sync"});
+    auto emittedBefore = emitted.count();
+    auto syncedBefore = synced.count();
+
+    herder.emitEnvelope(envs.back());
+    // Held back until the journal is synced at the end of the crank
+    REQUIRE(emitted.count() == emittedBefore);
+    REQUIRE(synced.count() == syncedBefore);
+
+    clock.crank(false);
+    REQUIRE(synced.count() > syncedBefore);
+    REQUIRE(emitted.count() > emittedBefore);
+}
+
 TEST_CASE("SCP checkpoint", "[catchup][herder]")
 {
     auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
@@ -4590,6 +4851,154 @@ TEST_CASE("herder externalizes values", "[herder]")
     }
 }
 
+TEST_CASE("tx set candidate built ahead of ledger trigger", "[herder]")
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto simulation =
+        Topologies::pair(Simulation::OVER_LOOPBACK, networkID, [](int i) {
+            auto cfg = getTestConfig(i);
+            cfg.TX_SET_CANDIDATE_LEAD_TIME_MS = 500;
+            cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 100;
+            return cfg;
+        });
+    simulation->startAllNodes();
+    simulation->crankUntil(
+        [&]() { return simulation->haveAllExternalized(3, 1); },
+        2 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto nodes = simulation->getNodes();
+    auto& loadGen = nodes[0]->getLoadGenerator();
+    auto& loadGenDone =
+        nodes[0]->getMetrics().NewMeter({"loadgen", "run", "complete"}, "run");
+    loadGen.generateLoad(GeneratedLoadConfig::createAccountsLoad(
+        /* nAccounts */ 50, /* txRate */ 5));
+    simulation->crankUntil([&]() { return loadGenDone.count() == 1; },
+                           10 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    // Accounts were created using tx sets built ahead of the trigger
+    for (auto const& node : nodes)
+    {
+        auto& hit = node->getMetrics().NewMeter(
+            {"herder", "tx-set-candidate", "hit"}, "txset");
+        auto& build = node->getMetrics().NewTimer(
+            {"herder", "tx-set-candidate", "build"});
+        REQUIRE(hit.count() > 0);
+        REQUIRE(build.count() >= hit.count());
+    }
+}
+
+TEST_CASE("nomination replaces invalid txs at the head of the queue",
+          "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 3;
+    // Only one ledger worth of transactions is validated at first
+    cfg.NOMINATION_TX_LEDGER_MULTIPLIER = 1.0;
+    auto app = createTestApplication(clock, cfg);
+
+    auto root = TestAccount::createRoot(*app);
+    auto minBalance = app->getLedgerManager().getLastMinBalance(2);
+    auto lclCloseTime = [&]() {
+        return app->getLedgerManager()
+            .getLastClosedLedgerHeader()
+            .header.scpValue.closeTime;
+    };
+
+    std::vector<TestAccount> expiringAccounts;
+    std::vector<TestAccount> validAccounts;
+    for (uint32_t i = 0; i < cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE; ++i)
+    {
+        expiringAccounts.emplace_back(
+            root.create(fmt::format("expiring-{}", i), minBalance));
+        validAccounts.emplace_back(
+            root.create(fmt::format("valid-{}", i), minBalance));
+    }
+
+    // The highest fee transactions expire before the next ledger closes
+    PreconditionsV2 cond;
+    cond.timeBounds.activate().maxTime = lclCloseTime() + 1;
+    std::vector<TransactionFrameBasePtr> expiring;
+    for (auto& account : expiringAccounts)
+    {
+        expiring.emplace_back(
+            transactionWithV2Precondition(*app, account, 1, 1000, cond));
+    }
+    std::vector<std::pair<TestAccount, TransactionFrameBasePtr>> valid;
+    for (auto& account : validAccounts)
+    {
+        valid.emplace_back(account,
+                           account.tx({payment(account.getPublicKey(), 1)}));
+    }
+    for (auto const& tx : expiring)
+    {
+        REQUIRE(app->getHerder().recvTransaction(tx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    }
+    for (auto const& [account, tx] : valid)
+    {
+        REQUIRE(app->getHerder().recvTransaction(tx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    }
+
+    auto now = VirtualClock::to_time_t(app->getClock().system_now());
+    app->manualClose(std::nullopt,
+                     std::max<TimePoint>(now, lclCloseTime() + 1) + 100);
+
+    // The expired transactions were banned, and replaced by the next ones in
+    // the queue
+    for (auto const& tx : expiring)
+    {
+        REQUIRE(app->getHerder().isBannedTx(tx->getFullHash()));
+    }
+    for (auto& [account, tx] : valid)
+    {
+        REQUIRE(account.loadSequenceNumber() == tx->getSeqNum());
+    }
+}
+
+TEST_CASE("transaction signatures verified in background",
+          "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.BACKGROUND_TX_SIG_VERIFICATION = true;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = TestAccount{*app, getAccount("A")};
+    auto tx = root.tx({createAccount(
+        a1.getPublicKey(), app->getLedgerManager().getLastMinBalance(2))});
+
+    auto recv = [&](TransactionFrameBasePtr txToAdd) {
+        std::optional<TransactionQueue::AddResult> res;
+        app->getHerder().recvTransactionAsync(
+            txToAdd, false, [&res](TransactionQueue::AddResult r) { res = r; });
+        // The result is delivered on the main thread once the background
+        // verification is done
+        REQUIRE(!res);
+        while (!res)
+        {
+            clock.crank(true);
+        }
+        return *res;
+    };
+
+    SECTION("valid signature")
+    {
+        REQUIRE(recv(tx) == TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        REQUIRE(app->getHerder().recvTransaction(tx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_DUPLICATE);
+    }
+    SECTION("bad signature")
+    {
+        tx->getEnvelope().v1().signatures[0].signature[0] ^= 1;
+        tx->clearCached();
+        REQUIRE(recv(tx) == TransactionQueue::AddResult::ADD_STATUS_ERROR);
+        REQUIRE(tx->getResultCode() == txBAD_AUTH);
+    }
+}
+
 TEST_CASE("quick restart", "[herder][quickRestart]")
 {
     auto mode = Simulation::OVER_LOOPBACK;
@@ -6002,4 +6411,83 @@ TEST_CASE("SCP message capture from previous ledger", "[herder]")
     // check ensures that C does not double count messages from ledger 2 when
     // closing ledger 3.
     REQUIRE(checkSCPHistoryEntries(C, 2, expectedTypes));
-}
\ No newline at end of file
+}
+
+TEST_CASE("SCP messages recorded and replayed", "[herder]")
+{
+    TmpDirManager tdm(std::string("scp-recording-") +
+                      binToHex(randomBytes(8)));
+    TmpDir td = tdm.tmpDir("scp-recording");
+
+    // Fully connected, so that every node receives the envelopes of the
+    // others from several peers
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto simulation = Topologies::core(
+        3, 1.0, Simulation::OVER_LOOPBACK, networkID, [&](int i) {
+            auto cfg = getTestConfig(i);
+            cfg.RECORD_SCP_MESSAGES_PATH =
+                fmt::format("{}/scp-{}.xdr", td.getName(), i);
+            // A recording left by a previous run is replaced, not appended to
+            std::ofstream(cfg.RECORD_SCP_MESSAGES_PATH, std::ofstream::binary)
+                << "previous recording";
+            return cfg;
+        });
+    simulation->startAllNodes();
+    simulation->crankUntil(
+        [&]() { return simulation->haveAllExternalized(4, 1); },
+        4 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto nodes = simulation->getNodes();
+    auto recordingPath = nodes[0]->getConfig().RECORD_SCP_MESSAGES_PATH;
+    auto peerID = nodes[1]->getConfig().NODE_SEED.getPublicKey();
+    simulation->stopAllNodes();
+
+    // Flooded copies of an envelope are recorded once
+    {
+        XDRInputFileStream in;
+        in.open(recordingPath);
+        std::set<Hash> envelopes;
+        uint64 time;
+        StellarMessage msg;
+        while (in.readOne(time) && in.readOne(msg))
+        {
+            if (msg.type() == SCP_MESSAGE)
+            {
+                REQUIRE(envelopes.insert(xdrSha256(msg.envelope())).second);
+            }
+        }
+        REQUIRE(!envelopes.empty());
+    }
+
+    // Replay the messages received by the first node on a watcher that only
+    // trusts the node that sent them
+    VirtualClock clock;
+    auto cfg = getTestConfig(3);
+    cfg.NODE_IS_VALIDATOR = false;
+    cfg.FORCE_SCP = false;
+    cfg.QUORUM_SET = SCPQuorumSet{};
+    cfg.QUORUM_SET.threshold = 1;
+    cfg.QUORUM_SET.validators.emplace_back(peerID);
+    auto app = createTestApplication(clock, cfg);
+
+    SCPMessageReplayer replayer(*app, recordingPath, 1.0);
+    replayer.start();
+    while (!replayer.isDone() && clock.crank(true))
+    {
+    }
+
+    // Slots that externalize after their last message are measured too
+    auto lcl = app->getLedgerManager().getLastClosedLedgerNum();
+    REQUIRE(lcl >= 3);
+    auto report = replayer.getReport();
+    REQUIRE(report["messages"].asUInt64() > 0);
+    REQUIRE(report["externalized"].asUInt64() >= 2);
+    for (auto const& slot : report["slots"])
+    {
+        if (slot["slot"].asUInt64() <= lcl)
+        {
+            REQUIRE(slot.isMember("externalize_ms"));
+            REQUIRE(slot["envelopes"].asUInt64() > 0);
+        }
+    }
+}
@@ -1051,3 +1051,94 @@ TEST_CASE("quorum intersection finds smaller SCC with quorums",
     REQUIRE(qic->networkEnjoysQuorumIntersection());
     REQUIRE(qic->getMaxQuorumsFound() != 0);
 }
+
+TEST_CASE("quorum intersection parallel scan", "[herder][quorumintersection]")
+{
+    auto orgs = generateOrgs(6, {3});
+    Config cfg(getTestConfig());
+    cfg = configureShortNames(cfg, orgs);
+
+    auto check = [&](QuorumTracker::QuorumMap const& qm, int threads) {
+        cfg.QUORUM_INTERSECTION_CHECKER_THREADS = threads;
+        std::atomic<bool> flag{false};
+        auto qic =
+            QuorumIntersectionChecker::create(qm, cfg, flag, gRandomEngine());
+        bool ok = qic->networkEnjoysQuorumIntersection();
+        auto progress = qic->getProgress();
+        REQUIRE(progress.mThreads == static_cast<size_t>(threads));
+        REQUIRE(!progress.mCachedResult);
+        if (ok)
+        {
+            REQUIRE(progress.mSubproblemsDone == progress.mSubproblems);
+        }
+        else
+        {
+            auto split = qic->getPotentialSplit();
+            REQUIRE(!split.first.empty());
+            REQUIRE(!split.second.empty());
+            for (auto const& node : split.first)
+            {
+                REQUIRE(std::find(split.second.begin(), split.second.end(),
+                                  node) == split.second.end());
+            }
+        }
+        return ok;
+    };
+
+    SECTION("intersecting")
+    {
+        auto qm =
+            interconnectOrgs(orgs, [](size_t i, size_t j) { return true; });
+        REQUIRE(check(qm, 1));
+        REQUIRE(check(qm, 4));
+    }
+    SECTION("not intersecting")
+    {
+        // Every org is a quorum on its own.
+        auto qm = interconnectOrgs(
+            orgs, [](size_t i, size_t j) { return true; },
+            /* ownThreshPct */ 34);
+        REQUIRE(!check(qm, 1));
+        REQUIRE(!check(qm, 4));
+    }
+}
+
+TEST_CASE("quorum intersection SCC result cache",
+          "[herder][quorumintersection]")
+{
+    auto orgs = generateOrgs(4, {3});
+    auto qm = interconnectOrgs(orgs, [](size_t i, size_t j) { return true; });
+    Config cfg(getTestConfig());
+    cfg = configureShortNames(cfg, orgs);
+    auto cache = std::make_shared<QuorumIntersectionChecker::SCCResultCache>();
+    std::atomic<bool> flag{false};
+
+    // Returns whether the network enjoys quorum intersection and whether the
+    // result came from the cache.
+    auto check = [&]() {
+        auto qic = QuorumIntersectionChecker::create(
+            qm, cfg, flag, gRandomEngine(), /* quiet */ false, cache);
+        bool ok = qic->networkEnjoysQuorumIntersection();
+        return std::make_pair(ok, qic->getProgress().mCachedResult);
+    };
+
+    REQUIRE(check() == std::make_pair(true, false));
+    REQUIRE(check() == std::make_pair(true, true));
+
+    SECTION("watcher added outside of the scan SCC")
+    {
+        auto watcher = SecretKey::pseudoRandomForTesting().getPublicKey();
+        qm[watcher] =
+            QuorumTracker::NodeInfo{make_shared<QS>(2, orgs[0], VQ{}), 0};
+        REQUIRE(check() == std::make_pair(true, true));
+    }
+    SECTION("qset changed within the scan SCC")
+    {
+        // A node with threshold 1 is a quorum on its own.
+        auto qs = make_shared<QS>(*qm[orgs[0][0]].mQuorumSet);
+        qs->threshold = 1;
+        qm[orgs[0][0]].mQuorumSet = qs;
+        REQUIRE(check() == std::make_pair(false, false));
+        REQUIRE(check() == std::make_pair(false, true));
+    }
+}
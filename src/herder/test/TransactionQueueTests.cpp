@@ -11,6 +11,8 @@
 #include "herder/TxSetFrame.h"
 #include "herder/TxSetUtils.h"
 #include "ledger/LedgerHashUtils.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 #include "test/TestAccount.h"
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
@@ -18,11 +20,13 @@
 #include "transactions/SignatureUtils.h"
 #include "transactions/TransactionBridge.h"
 #include "transactions/TransactionUtils.h"
+#include "util/Math.h"
 #include "util/Timer.h"
 #include "util/numeric128.h"
 #include "xdr/Stellar-transaction.h"
 
 #include "xdrpp/autocheck.h"
+#include "xdrpp/marshal.h"
 
 #include <chrono>
 #include <fmt/chrono.h>
@@ -2043,6 +2047,94 @@ TEST_CASE("transaction queue starting sequence boundary",
     }
 }
 
+TEST_CASE("transaction queue generations", "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto const minBalance2 = app->getLedgerManager().getLastMinBalance(2);
+
+    auto root = TestAccount::createRoot(*app);
+    auto acc1 = root.create("a1", minBalance2);
+    auto acc2 = root.create("a2", minBalance2);
+
+    ClassicTransactionQueue tq(*app, 4, 3, 4);
+    auto tx1 = transaction(*app, acc1, 1, 1, 100);
+    auto tx2 = transaction(*app, acc2, 1, 1, 100);
+    auto info = [&](TestAccount& acc) {
+        return tq.getAccountTransactionQueueInfo(acc.getPublicKey());
+    };
+
+    SECTION("accounts age until their transactions are banned")
+    {
+        REQUIRE(tq.tryAdd(tx1, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        tq.shift();
+        tq.shift();
+        REQUIRE(tq.tryAdd(tx2, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        tq.shift();
+        REQUIRE(info(acc1).mAge == 3);
+        REQUIRE(info(acc2).mAge == 1);
+
+        tq.shift();
+        REQUIRE(!info(acc1).mTransaction);
+        REQUIRE(tq.isBanned(tx1->getFullHash()));
+        REQUIRE(tq.countBanned(0) == 1);
+        REQUIRE(info(acc2).mAge == 2);
+
+        // Applying a transaction removes it regardless of its age
+        tq.removeApplied({tx2});
+        REQUIRE(!info(acc2).mTransaction);
+        REQUIRE(tq.isBanned(tx2->getFullHash()));
+        REQUIRE(tq.countBanned(0) == 2);
+    }
+    SECTION("banning again extends the ban")
+    {
+        tq.ban({tx1});
+        REQUIRE(tq.countBanned(0) == 1);
+        tq.ban({tx1});
+        REQUIRE(tq.countBanned(0) == 1);
+
+        tq.shift();
+        tq.ban({tx1});
+        REQUIRE(tq.countBanned(0) == 1);
+        REQUIRE(tq.countBanned(1) == 1);
+
+        tq.shift();
+        tq.shift();
+        REQUIRE(tq.isBanned(tx1->getFullHash()));
+        REQUIRE(tq.countBanned(2) == 1);
+        tq.shift();
+        REQUIRE(!tq.isBanned(tx1->getFullHash()));
+        REQUIRE(tq.tryAdd(tx1, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    }
+    SECTION("applied transactions are counted as known or unknown")
+    {
+        auto& metrics = app->getMetrics();
+        auto& known =
+            metrics.NewMeter({"herder", "pending-txs", "applied-known"},
+                             "transaction");
+        auto& knownBytes = metrics.NewMeter(
+            {"herder", "pending-txs", "applied-known-bytes"}, "byte");
+        auto& unknown =
+            metrics.NewMeter({"herder", "pending-txs", "applied-unknown"},
+                             "transaction");
+        auto knownBefore = known.count();
+        auto knownBytesBefore = knownBytes.count();
+        auto unknownBefore = unknown.count();
+
+        REQUIRE(tq.tryAdd(tx1, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        tq.removeApplied({tx1, tx2});
+
+        REQUIRE(known.count() == knownBefore + 1);
+        REQUIRE(knownBytes.count() ==
+                knownBytesBefore + xdr::xdr_size(tx1->getEnvelope()));
+        REQUIRE(unknown.count() == unknownBefore + 1);
+    }
+}
+
 TEST_CASE("transaction queue with fee-bump", "[herder][transactionqueue]")
 {
     VirtualClock clock;
@@ -2778,6 +2870,48 @@ TEST_CASE("arbitrage tx identification",
     REQUIRE(
         apVecToSet(TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
             tx7f)) == UnorderedSet<AssetPair, AssetPairHash>{});
+
+    TransactionEnvelope tx8, tx9, tx10;
+    tx8.type(ENVELOPE_TYPE_TX);
+    tx9.type(ENVELOPE_TYPE_TX);
+    tx10.type(ENVELOPE_TYPE_TX);
+
+    // Tx8 is a one-op XLM->XLM payment without a path.
+    tx8.v1().tx.operations.emplace_back(
+        txtest::pathPayment(bobPub, xlm, 100, xlm, 100, {}));
+
+    // Tx9 is a one-op USD->EUR->CNY->EUR->MXN path with a loop in the
+    // middle.
+    tx9.v1().tx.operations.emplace_back(
+        txtest::pathPayment(bobPub, usd, 100, mxn, 100, {eur, cny, eur}));
+
+    // Tx10 is a one-op XLM->USD->USD->XLM loop.
+    tx10.v1().tx.operations.emplace_back(
+        txtest::pathPayment(bobPub, xlm, 100, xlm, 100, {usd, usd}));
+
+    auto tx8f = std::make_shared<TransactionFrame>(Hash(), tx8);
+    auto tx9f = std::make_shared<TransactionFrame>(Hash(), tx9);
+    auto tx10f = std::make_shared<TransactionFrame>(Hash(), tx10);
+
+    LOG_TRACE(DEFAULT_LOG, "Tx8 - 1 op / 1 asset non-loop");
+    REQUIRE(
+        apVecToSet(TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
+            tx8f)) == UnorderedSet<AssetPair, AssetPairHash>{});
+
+    LOG_TRACE(DEFAULT_LOG, "Tx9 - 1 op / 4 asset inner loop");
+    REQUIRE(
+        apVecToSet(TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
+            tx9f)) ==
+        UnorderedSet<AssetPair, AssetPairHash>{{eur, cny}, {cny, eur}});
+
+    LOG_TRACE(DEFAULT_LOG, "Tx10 - 1 op / 2 asset loop with a self-edge");
+    REQUIRE(
+        apVecToSet(TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
+            tx10f)) == UnorderedSet<AssetPair, AssetPairHash>{
+                           {xlm, usd}, {usd, usd}, {usd, xlm}});
+    REQUIRE(
+        TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(tx10f)
+            .size() == 3);
 }
 
 TEST_CASE("arbitrage tx identification benchmark",
@@ -2836,4 +2970,278 @@ TEST_CASE("arbitrage tx identification benchmark",
     auto end = clock::now();
     LOG_INFO(DEFAULT_LOG, "executed 100 loop-checks of 600-op tx loop in {}",
              ch::duration_cast<ch::milliseconds>(end - start));
+
+    // Then a mix resembling the DEX traffic in a full queue: mostly path
+    // payments through a few popular assets, a fraction of single-op
+    // arbitrage loops and a few multi-op loops.
+    size_t const numTxs = 5000;
+    std::vector<Asset> assets{xlm};
+    for (size_t i = 0; i < 50; ++i)
+    {
+        SecretKey issuerSec = txtest::getAccount(fmt::format("issuer{}", i));
+        assets.emplace_back(txtest::makeAsset(issuerSec, "USD"));
+    }
+    auto randomPath = [&](size_t maxLength) {
+        std::vector<Asset> path;
+        auto length = rand_uniform<size_t>(0, maxLength);
+        for (size_t i = 0; i < length; ++i)
+        {
+            path.emplace_back(rand_element(assets));
+        }
+        return path;
+    };
+
+    std::vector<TransactionFrameBasePtr> txs;
+    size_t numLoops = 0;
+    for (size_t i = 0; i < numTxs; ++i)
+    {
+        TransactionEnvelope env;
+        env.type(ENVELOPE_TYPE_TX);
+        auto& ops = env.v1().tx.operations;
+        auto kind = rand_uniform<size_t>(0, 99);
+        if (kind < 60)
+        {
+            // Regular path payment
+            ops.emplace_back(txtest::pathPayment(bobPub, rand_element(assets),
+                                                 100, rand_element(assets),
+                                                 100, randomPath(5)));
+        }
+        else if (kind < 90)
+        {
+            // Single-op arbitrage
+            auto const& asset = rand_element(assets);
+            ops.emplace_back(txtest::pathPayment(bobPub, asset, 100, asset, 100,
+                                                 randomPath(5)));
+        }
+        else
+        {
+            // Multi-op arbitrage through an intermediate asset
+            auto const& asset = rand_element(assets);
+            auto const& mid = rand_element(assets);
+            ops.emplace_back(txtest::pathPayment(bobPub, asset, 100, mid, 100,
+                                                 randomPath(3)));
+            ops.emplace_back(txtest::pathPayment(bobPub, mid, 100, asset, 100,
+                                                 randomPath(3)));
+        }
+        txs.emplace_back(std::make_shared<TransactionFrame>(Hash(), env));
+    }
+
+    start = clock::now();
+    for (auto const& tx : txs)
+    {
+        if (!TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(tx)
+                 .empty())
+        {
+            ++numLoops;
+        }
+    }
+    end = clock::now();
+    LOG_INFO(DEFAULT_LOG,
+             "executed loop-checks of {} DEX txs ({} loops) in {} ({} per tx)",
+             numTxs, numLoops, ch::duration_cast<usec>(end - start),
+             ch::duration_cast<ch::nanoseconds>(end - start) / numTxs);
+}
+
+namespace
+{
+// Builds a transaction with `numOps` operations and the inclusion fee rate of
+// `feeRate` per operation from a unique source account. These transactions
+// are only used for fee ordering, so they're not signed.
+TransactionFrameBasePtr
+makeFeeIndexTx(Hash const& networkID, Asset const& dexAsset, uint32_t id,
+               uint32_t feeRate, uint32_t numOps, bool isDex)
+{
+    PublicKey source;
+    source.ed25519() = sha256(fmt::format("fee-index-{}", id));
+
+    TransactionEnvelope env;
+    env.type(ENVELOPE_TYPE_TX);
+    auto& tx = env.v1().tx;
+    tx.sourceAccount = toMuxedAccount(source);
+    tx.fee = feeRate * numOps;
+    tx.seqNum = 1;
+    for (uint32_t i = 0; i < numOps; ++i)
+    {
+        if (isDex)
+        {
+            tx.operations.emplace_back(txtest::manageOffer(
+                0, txtest::makeNativeAsset(), dexAsset, Price{1, 1}, 1));
+        }
+        else
+        {
+            tx.operations.emplace_back(txtest::payment(source, 1));
+        }
+    }
+    return TransactionFrameBase::makeTransactionFromWire(networkID, env);
+}
+
+std::vector<TransactionFrameBasePtr>
+makeFeeIndexTxs(size_t count)
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto dexAsset = txtest::makeAsset(txtest::getAccount("issuer"), "USD");
+    // Use distinct fee rates so that the selected set doesn't depend on the
+    // tie breaking.
+    std::vector<uint32_t> feeRates(count);
+    std::iota(feeRates.begin(), feeRates.end(), 100);
+    stellar::shuffle(feeRates.begin(), feeRates.end(), gRandomEngine);
+
+    std::vector<TransactionFrameBasePtr> txs;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        txs.emplace_back(makeFeeIndexTx(networkID, dexAsset, i, feeRates[i],
+                                        rand_uniform<uint32_t>(1, 5),
+                                        i % 3 == 0));
+    }
+    return txs;
+}
+
+std::vector<TxStackPtr>
+makeSingleTxStacks(std::vector<TransactionFrameBasePtr> const& txs)
+{
+    std::vector<TxStackPtr> stacks;
+    for (auto const& tx : txs)
+    {
+        stacks.emplace_back(std::make_shared<SingleTxStack>(tx));
+    }
+    return stacks;
+}
+
+void
+requireSameTxs(std::vector<TransactionFrameBasePtr> a,
+               std::vector<TransactionFrameBasePtr> b)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    REQUIRE(a == b);
+}
+}
+
+TEST_CASE("surge pricing fee index top transactions",
+          "[herder][transactionqueue]")
+{
+    auto laneConfig = std::make_shared<DexLimitingLaneConfig>(
+        Resource(1000), std::make_optional<Resource>(300));
+    auto txs = makeFeeIndexTxs(2000);
+
+    SurgePricingPriorityQueue index(/* isHighestPriority */ false, laneConfig,
+                                    0);
+    for (auto const& stack : makeSingleTxStacks(txs))
+    {
+        index.add(stack);
+    }
+    auto totalResources = index.totalResources();
+
+    SECTION("matches full rebuild")
+    {
+        std::vector<bool> hadTxNotFittingLane;
+        auto expected = SurgePricingPriorityQueue::getMostTopTxsWithinLimits(
+            makeSingleTxStacks(txs), laneConfig, hadTxNotFittingLane);
+        auto actual = index.getTopTxsInPlace(
+            laneConfig->getLaneLimits(),
+            [](TransactionFrameBase const&) { return true; });
+        requireSameTxs(expected, actual);
+    }
+    SECTION("with filter")
+    {
+        auto isPayment = [](TransactionFrameBase const& tx) {
+            return !tx.hasDexOperations();
+        };
+        std::vector<TransactionFrameBasePtr> paymentTxs;
+        std::copy_if(txs.begin(), txs.end(), std::back_inserter(paymentTxs),
+                     [&](TransactionFrameBasePtr const& tx) {
+                         return isPayment(*tx);
+                     });
+        std::vector<bool> hadTxNotFittingLane;
+        auto expected = SurgePricingPriorityQueue::getMostTopTxsWithinLimits(
+            makeSingleTxStacks(paymentTxs), laneConfig, hadTxNotFittingLane);
+        auto actual =
+            index.getTopTxsInPlace(laneConfig->getLaneLimits(), isPayment);
+        requireSameTxs(expected, actual);
+    }
+    SECTION("larger limits")
+    {
+        std::vector<Resource> limits = {Resource(1500), Resource(450)};
+        auto largerConfig = std::make_shared<DexLimitingLaneConfig>(
+            limits[0], std::make_optional<Resource>(limits[1]));
+        std::vector<bool> hadTxNotFittingLane;
+        auto expected = SurgePricingPriorityQueue::getMostTopTxsWithinLimits(
+            makeSingleTxStacks(txs), largerConfig, hadTxNotFittingLane);
+        auto actual = index.getTopTxsInPlace(
+            limits, [](TransactionFrameBase const&) { return true; });
+        requireSameTxs(expected, actual);
+    }
+    // The index is not modified by the queries.
+    REQUIRE(index.totalResources() == totalResources);
+}
+
+TEST_CASE("surge pricing fee index benchmark",
+          "[herder][transactionqueue][bench][!hide]")
+{
+    // Compares selecting the top transactions for a tx set from a queue of
+    // 100k transactions by rebuilding the priority queue from scratch (as tx
+    // set building used to do) against querying the incrementally maintained
+    // fee index of the transaction queue.
+    size_t const numTxs = 100'000;
+    size_t const iterations = 100;
+    auto laneConfig = std::make_shared<DexLimitingLaneConfig>(
+        Resource(1000), std::make_optional<Resource>(300));
+    auto txs = makeFeeIndexTxs(numTxs);
+
+    namespace ch = std::chrono;
+    using clock = ch::high_resolution_clock;
+
+    SurgePricingPriorityQueue index(/* isHighestPriority */ false, laneConfig,
+                                    0);
+    auto stacks = makeSingleTxStacks(txs);
+    auto start = clock::now();
+    for (auto const& stack : stacks)
+    {
+        index.add(stack);
+    }
+    auto end = clock::now();
+    LOG_INFO(DEFAULT_LOG, "added {} txs to the fee index in {}", numTxs,
+             ch::duration_cast<ch::milliseconds>(end - start));
+
+    size_t selected = 0;
+    start = clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        std::vector<bool> hadTxNotFittingLane;
+        selected += SurgePricingPriorityQueue::getMostTopTxsWithinLimits(
+                        makeSingleTxStacks(txs), laneConfig,
+                        hadTxNotFittingLane)
+                        .size();
+    }
+    end = clock::now();
+    LOG_INFO(DEFAULT_LOG, "{} full rebuilds selected {} txs in {}", iterations,
+             selected, ch::duration_cast<ch::milliseconds>(end - start));
+
+    selected = 0;
+    start = clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        selected +=
+            index
+                .getTopTxsInPlace(
+                    laneConfig->getLaneLimits(),
+                    [](TransactionFrameBase const&) { return true; })
+                .size();
+    }
+    end = clock::now();
+    LOG_INFO(DEFAULT_LOG, "{} fee index queries selected {} txs in {}",
+             iterations, selected,
+             ch::duration_cast<ch::milliseconds>(end - start));
+
+    // Replacing a small fraction of the queue (as happens on every ledger
+    // close) only costs logarithmic time per transaction.
+    start = clock::now();
+    for (size_t i = 0; i < numTxs / 10; ++i)
+    {
+        index.erase(stacks[i]);
+        index.add(stacks[i]);
+    }
+    end = clock::now();
+    LOG_INFO(DEFAULT_LOG, "updated {} fee index entries in {}", numTxs / 10,
+             ch::duration_cast<ch::milliseconds>(end - start));
 }
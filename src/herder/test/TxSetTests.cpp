@@ -2,7 +2,10 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "herder/Herder.h"
+#include "herder/TxFrameInternTable.h"
 #include "herder/TxSetFrame.h"
+#include "herder/TxSetUtils.h"
 #include "herder/test/TestTxSetUtils.h"
 #include "ledger/LedgerManager.h"
 #include "lib/catch.hpp"
@@ -14,6 +17,9 @@
 #include "test/test.h"
 #include "util/ProtocolVersion.h"
 
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
 namespace stellar
 {
 namespace
@@ -810,6 +816,135 @@ TEST_CASE("generalized tx set with multiple txs per source account",
     }
 }
 
+TEST_CASE("tx set validation verifies signatures in parallel", "[txset]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    auto root = TestAccount::createRoot(*app);
+
+    int const numAccounts = 80;
+    std::vector<Operation> createOps;
+    std::vector<TestAccount> accounts;
+    for (int i = 0; i < numAccounts; ++i)
+    {
+        auto sk = getAccount("sig-check " + std::to_string(i));
+        createOps.emplace_back(createAccount(
+            sk.getPublicKey(), app->getLedgerManager().getLastMinBalance(1)));
+        accounts.emplace_back(*app, sk);
+    }
+    closeLedger(*app, {root.tx(createOps)});
+
+    std::vector<TransactionFramePtr> frames;
+    TxSetTransactions txs;
+    for (auto& account : accounts)
+    {
+        frames.emplace_back(account.tx({payment(root.getPublicKey(), 1)}));
+        txs.emplace_back(frames.back());
+    }
+
+    auto& sigTimer = app->getMetrics().NewTimer(
+        {"herder", "tx-set", "validate-signatures"});
+    auto sigChecks = sigTimer.count();
+
+    SECTION("all valid")
+    {
+        REQUIRE(TxSetUtils::getInvalidTxList(txs, *app, 0, 0, false).empty());
+        REQUIRE(sigTimer.count() == sigChecks + 1);
+    }
+    SECTION("bad signature")
+    {
+        auto badTx = frames[numAccounts / 2];
+        badTx->getEnvelope().v1().signatures[0].signature[0] ^= 1;
+        badTx->clearCached();
+
+        auto invalid = TxSetUtils::getInvalidTxList(txs, *app, 0, 0, false);
+        REQUIRE(invalid.size() == 1);
+        REQUIRE(invalid[0] == badTx);
+        REQUIRE(badTx->getResultCode() == txBAD_AUTH);
+        REQUIRE(sigTimer.count() == sigChecks + 1);
+    }
+    SECTION("small tx sets are checked on the main thread only")
+    {
+        TxSetTransactions smallTxs(txs.begin(), txs.begin() + 10);
+        REQUIRE(
+            TxSetUtils::getInvalidTxList(smallTxs, *app, 0, 0, false).empty());
+        REQUIRE(sigTimer.count() == sigChecks);
+    }
+}
+
+TEST_CASE("tx set transaction frames are interned", "[txset]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    auto root = TestAccount::createRoot(*app);
+    auto& internTable = app->getHerder().getTxFrameInternTable();
+
+    TxSetTransactions txs;
+    for (int i = 0; i < 3; ++i)
+    {
+        txs.emplace_back(root.tx({payment(root.getPublicKey(), i + 1)}));
+    }
+    auto txSet = makeTxSetFromTransactions(txs, *app, 0, 0);
+    auto const& applyTxs = txSet.second->getTxsForPhase(TxSetPhase::CLASSIC);
+    REQUIRE(applyTxs.size() == txs.size());
+
+    SECTION("tx sets share frames")
+    {
+        auto frames = txSet.first->createTransactionFrames(internTable);
+        REQUIRE(frames[0].size() == applyTxs.size());
+        auto applicableTxSet = txSet.first->prepareForApply(*app);
+        auto const& otherApplyTxs =
+            applicableTxSet->getTxsForPhase(TxSetPhase::CLASSIC);
+        for (auto const& tx : frames[0])
+        {
+            REQUIRE(std::find(applyTxs.begin(), applyTxs.end(), tx) !=
+                    applyTxs.end());
+            REQUIRE(std::find(otherApplyTxs.begin(), otherApplyTxs.end(),
+                              tx) != otherApplyTxs.end());
+        }
+    }
+    SECTION("frames built elsewhere are registered")
+    {
+        auto tx = root.tx({payment(root.getPublicKey(), 10)});
+        REQUIRE(internTable.intern(tx) == tx);
+        REQUIRE(internTable.intern(tx->getEnvelope()) == tx);
+
+        auto copy = TransactionFrameBase::makeTransactionFromWire(
+            app->getNetworkID(), tx->getEnvelope());
+        REQUIRE(internTable.intern(copy) == tx);
+
+        // the tx set frames win over the ones that are interned later
+        auto applyTx = applyTxs[0];
+        copy = TransactionFrameBase::makeTransactionFromWire(
+            app->getNetworkID(), applyTx->getEnvelope());
+        REQUIRE(internTable.intern(copy) == applyTx);
+    }
+    SECTION("frames are dropped with the last reference")
+    {
+        auto tx = root.tx({payment(root.getPublicKey(), 10)});
+        std::weak_ptr<TransactionFrameBase> weakTx =
+            internTable.intern(tx->getEnvelope());
+        REQUIRE(weakTx.expired());
+        auto interned = internTable.intern(tx->getEnvelope());
+        REQUIRE(interned != tx);
+        REQUIRE(interned->getFullHash() == tx->getFullHash());
+    }
+    SECTION("duplicate transactions get separate frames")
+    {
+        TransactionSet xdrTxSet;
+        xdrTxSet.previousLedgerHash =
+            app->getLedgerManager().getLastClosedLedgerHeader().hash;
+        xdrTxSet.txs.emplace_back(applyTxs[0]->getEnvelope());
+        xdrTxSet.txs.emplace_back(applyTxs[0]->getEnvelope());
+        auto frames = TxSetXDRFrame::makeFromWire(xdrTxSet)
+                          ->createTransactionFrames(internTable);
+        REQUIRE(frames[0].size() == 2);
+        REQUIRE(frames[0][0] == applyTxs[0]);
+        REQUIRE(frames[0][1] != applyTxs[0]);
+        REQUIRE(frames[0][1]->getFullHash() == applyTxs[0]->getFullHash());
+    }
+}
+
 TEST_CASE("generalized tx set fees", "[txset][soroban]")
 {
     VirtualClock clock;
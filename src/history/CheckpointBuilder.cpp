@@ -0,0 +1,495 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/CheckpointBuilder.h"
+#include "bucket/BucketManager.h"
+#include "crypto/SHA.h"
+#include "herder/Herder.h"
+#include "herder/TxSetFrame.h"
+#include "history/FileTransferInfo.h"
+#include "history/HistoryManager.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "scp/Slot.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+#include "util/UnorderedSet.h"
+#include "util/XDRStream.h"
+
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <regex>
+#include <set>
+#include <system_error>
+
+namespace stellar
+{
+
+namespace
+{
+// The ledger headers file is renamed last, so that its presence means that
+// the checkpoint is finished
+char const* const FILE_TYPES[] = {
+    HISTORY_FILE_TYPE_TRANSACTIONS, HISTORY_FILE_TYPE_RESULTS,
+    HISTORY_FILE_TYPE_SCP, HISTORY_FILE_TYPE_LEDGER};
+
+std::string const DIRTY_SUFFIX = ".dirty";
+
+std::regex const&
+checkpointFileRegex()
+{
+    static std::regex re("^[a-z]+-([0-9a-f]{8})\\.xdr(\\.dirty(\\.tmp)?)?$");
+    return re;
+}
+
+bool
+isCheckpointFile(std::string const& name)
+{
+    return std::regex_match(name, checkpointFileRegex());
+}
+
+// Rewrites the file at `path` without the entries of ledgers after `lcl`, and
+// returns the ledgers of the entries kept.
+template <typename T, typename LedgerSeqFn>
+std::vector<uint32_t>
+truncateToLedger(Application& app, std::string const& dir,
+                 std::string const& path, uint32_t lcl, LedgerSeqFn ledgerSeq)
+{
+    ZoneScoped;
+    std::vector<uint32_t> kept;
+    if (!fs::exists(path))
+    {
+        return kept;
+    }
+
+    auto tmp = path + ".tmp";
+    std::remove(tmp.c_str());
+    {
+        XDRInputFileStream in;
+        in.open(path);
+        XDROutputFileStream out(app.getClock().getIOContext(),
+                                !app.getConfig().DISABLE_XDR_FSYNC);
+        out.open(tmp);
+        T entry;
+        try
+        {
+            while (in.readOne(entry) && ledgerSeq(entry) <= lcl)
+            {
+                out.writeOne(entry);
+                kept.emplace_back(ledgerSeq(entry));
+            }
+        }
+        catch (std::exception const& e)
+        {
+            // A crash may have left part of an entry at the end of the file
+            CLOG_WARNING(History, "Truncating {} after read error: {}", path,
+                         e.what());
+        }
+        out.close();
+    }
+    if (!fs::durableRename(tmp, path, dir))
+    {
+        throw std::runtime_error("Failed to rename " + tmp);
+    }
+    return kept;
+}
+}
+
+CheckpointBuilder::CheckpointBuilder(Application& app)
+    : mApp(app)
+    , mDir(app.getBucketManager().getBucketDir() + "/checkpoints")
+    , mAppendTimer(
+          app.getMetrics().NewTimer({"history", "checkpoint", "append"}))
+{
+    if (!fs::mkpath(mDir))
+    {
+        throw std::runtime_error("Failed to create checkpoint directory " +
+                                 mDir);
+    }
+}
+
+CheckpointBuilder::~CheckpointBuilder()
+{
+}
+
+std::string
+CheckpointBuilder::pathOf(std::string const& type, uint32_t checkpoint,
+                          bool dirty) const
+{
+    auto path =
+        mDir + "/" + fs::baseName(type, fs::hexStr(checkpoint), "xdr");
+    return dirty ? path + DIRTY_SUFFIX : path;
+}
+
+void
+CheckpointBuilder::openStreams(uint32_t checkpoint)
+{
+    ZoneScoped;
+    bool doFsync = !mApp.getConfig().DISABLE_XDR_FSYNC;
+    asio::io_context& ctx = mApp.getClock().getIOContext();
+    auto open = [&](std::unique_ptr<XDROutputFileStream>& out,
+                    char const* type) {
+        out = std::make_unique<XDROutputFileStream>(ctx, doFsync);
+        // Files are opened for appending, to resume them after a restart
+        out->open(pathOf(type, checkpoint, true));
+    };
+    open(mLedgerOut, HISTORY_FILE_TYPE_LEDGER);
+    open(mTxOut, HISTORY_FILE_TYPE_TRANSACTIONS);
+    open(mResultOut, HISTORY_FILE_TYPE_RESULTS);
+    open(mSCPOut, HISTORY_FILE_TYPE_SCP);
+    if (doFsync)
+    {
+        fs::flushDirectoryChanges(mDir);
+    }
+}
+
+void
+CheckpointBuilder::closeStreams()
+{
+    ZoneScoped;
+    for (auto out : {&mLedgerOut, &mTxOut, &mResultOut, &mSCPOut})
+    {
+        if (*out && (*out)->isOpen())
+        {
+            (*out)->close();
+        }
+        out->reset();
+    }
+}
+
+void
+CheckpointBuilder::removeFiles(uint32_t checkpoint, bool dirty)
+{
+    for (auto type : FILE_TYPES)
+    {
+        std::remove(pathOf(type, checkpoint, dirty).c_str());
+    }
+}
+
+bool
+CheckpointBuilder::truncateFiles(uint32_t checkpoint, uint32_t lcl)
+{
+    ZoneScoped;
+    auto headers = truncateToLedger<LedgerHeaderHistoryEntry>(
+        mApp, mDir, pathOf(HISTORY_FILE_TYPE_LEDGER, checkpoint, true), lcl,
+        [](LedgerHeaderHistoryEntry const& e) { return e.header.ledgerSeq; });
+    truncateToLedger<TransactionHistoryEntry>(
+        mApp, mDir, pathOf(HISTORY_FILE_TYPE_TRANSACTIONS, checkpoint, true),
+        lcl, [](TransactionHistoryEntry const& e) { return e.ledgerSeq; });
+    truncateToLedger<TransactionHistoryResultEntry>(
+        mApp, mDir, pathOf(HISTORY_FILE_TYPE_RESULTS, checkpoint, true), lcl,
+        [](TransactionHistoryResultEntry const& e) { return e.ledgerSeq; });
+    auto scp = truncateToLedger<SCPHistoryEntry>(
+        mApp, mDir, pathOf(HISTORY_FILE_TYPE_SCP, checkpoint, true), lcl,
+        [](SCPHistoryEntry const& e) {
+            return e.v0().ledgerMessages.ledgerSeq;
+        });
+    mHasSCPMessages = !scp.empty();
+
+    // The files must hold every ledger of the checkpoint up to `lcl`
+    auto first =
+        mApp.getHistoryManager().firstLedgerInCheckpointContaining(checkpoint);
+    if (headers.size() != lcl - first + 1)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < headers.size(); ++i)
+    {
+        if (headers[i] != first + i)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+CheckpointBuilder::finishCheckpoint(uint32_t checkpoint)
+{
+    ZoneScoped;
+    closeStreams();
+    if (!mHasSCPMessages)
+    {
+        // don't publish empty files
+        std::remove(pathOf(HISTORY_FILE_TYPE_SCP, checkpoint, true).c_str());
+    }
+    for (auto type : FILE_TYPES)
+    {
+        auto dirty = pathOf(type, checkpoint, true);
+        if (fs::exists(dirty) &&
+            !fs::durableRename(dirty, pathOf(type, checkpoint, false), mDir))
+        {
+            throw std::runtime_error("Failed to rename " + dirty);
+        }
+    }
+    mHasSCPMessages = false;
+    CLOG_DEBUG(History, "Finished writing history files of checkpoint {}",
+               checkpoint);
+}
+
+void
+CheckpointBuilder::restore(uint32_t lcl)
+{
+    ZoneScoped;
+    auto& hm = mApp.getHistoryManager();
+    closeStreams();
+    mPendingSCPMessages.clear();
+    mNextLedger = lcl + 1;
+    auto current = hm.checkpointContainingLedger(mNextLedger);
+
+    // A crash between finishing a checkpoint and committing its last ledger
+    // leaves its files finished; their last ledger is dropped below. Entries
+    // of uncommitted ledgers are dropped the same way in dirty files.
+    for (auto type : FILE_TYPES)
+    {
+        auto path = pathOf(type, current, false);
+        if (fs::exists(path) &&
+            !fs::durableRename(path, pathOf(type, current, true), mDir))
+        {
+            throw std::runtime_error("Failed to rename " + path);
+        }
+    }
+
+    std::set<uint32_t> queued;
+    for (auto const& has : hm.getPublishQueueStates())
+    {
+        queued.insert(has.currentLedger);
+    }
+    for (auto const& name : fs::findfiles(mDir, isCheckpointFile))
+    {
+        std::smatch match;
+        std::regex_match(name, match, checkpointFileRegex());
+        auto checkpoint =
+            static_cast<uint32_t>(std::stoul(match[1].str(), nullptr, 16));
+        bool dirty = match[2].matched;
+        if (checkpoint != current &&
+            (dirty || queued.find(checkpoint) == queued.end()))
+        {
+            CLOG_DEBUG(History, "Deleting stale checkpoint file {}", name);
+            std::remove((mDir + "/" + name).c_str());
+        }
+    }
+
+    if (hm.isFirstLedgerInCheckpoint(mNextLedger))
+    {
+        removeFiles(current, true);
+        mHasSCPMessages = false;
+        mComplete = true;
+    }
+    else
+    {
+        // Checkpoints that are not streamed have no files, and their history
+        // is in the database. Ledgers of a streamed checkpoint are only in its
+        // files: if some are missing, which only happens if the OS crashed
+        // before they were synced, the checkpoint can't be published.
+        bool streamed =
+            std::any_of(std::begin(FILE_TYPES), std::end(FILE_TYPES),
+                        [&](char const* type) {
+                            return fs::exists(pathOf(type, current, true));
+                        });
+        mComplete = streamed && truncateFiles(current, lcl);
+        if (streamed && !mComplete)
+        {
+            throw std::runtime_error(fmt::format(
+                FMT_STRING("History files of checkpoint {:d} in {} are "
+                           "missing ledgers up to {:d}, which are not in the "
+                           "database either; the node must catch up again "
+                           "with a new database"),
+                current, mDir, lcl));
+        }
+        if (!mComplete)
+        {
+            CLOG_INFO(History,
+                      "Checkpoint {} will be published from the database",
+                      current);
+        }
+    }
+}
+
+bool
+CheckpointBuilder::streams(uint32_t ledgerSeq) const
+{
+    return mApp.getHistoryManager().isFirstLedgerInCheckpoint(ledgerSeq) ||
+           (ledgerSeq == mNextLedger && mComplete);
+}
+
+void
+CheckpointBuilder::appendSCPHistory(uint32_t ledgerSeq,
+                                    std::vector<SCPEnvelope> const& envs)
+{
+    ZoneScoped;
+    if (envs.empty())
+    {
+        return;
+    }
+
+    SCPHistoryEntry entry;
+    entry.v(0);
+    auto& v0 = entry.v0();
+    v0.ledgerMessages.ledgerSeq = ledgerSeq;
+    v0.ledgerMessages.messages = envs;
+
+    UnorderedSet<Hash> qSetHashes;
+    for (auto const& env : envs)
+    {
+        auto const& qSetHash =
+            Slot::getCompanionQuorumSetHashFromStatement(env.statement);
+        if (qSetHashes.insert(qSetHash).second)
+        {
+            auto qSet = mApp.getHerder().getQSet(qSetHash);
+            if (qSet)
+            {
+                v0.quorumSets.emplace_back(*qSet);
+            }
+        }
+    }
+    mPendingSCPMessages[ledgerSeq] = std::move(entry);
+}
+
+void
+CheckpointBuilder::appendLedger(LedgerHeader const& header,
+                                TxSetXDRFrame const& txSet,
+                                TransactionResultSet const& results)
+{
+    ZoneScoped;
+    auto timer = mAppendTimer.TimeScope();
+    auto& hm = mApp.getHistoryManager();
+    auto ledgerSeq = header.ledgerSeq;
+    auto checkpoint = hm.checkpointContainingLedger(ledgerSeq);
+
+    if (ledgerSeq != mNextLedger)
+    {
+        // The node jumped to another ledger, so the checkpoint being written
+        // can't be finished
+        closeStreams();
+        if (mNextLedger != 0)
+        {
+            removeFiles(hm.checkpointContainingLedger(mNextLedger), true);
+        }
+        removeFiles(checkpoint, true);
+        mHasSCPMessages = false;
+        if (!streams(ledgerSeq))
+        {
+            CLOG_INFO(History,
+                      "Checkpoint {} will be published from the database",
+                      checkpoint);
+        }
+    }
+    mComplete = streams(ledgerSeq);
+    mNextLedger = ledgerSeq + 1;
+
+    if (mComplete)
+    {
+        if (!mLedgerOut)
+        {
+            openStreams(checkpoint);
+        }
+
+        LedgerHeaderHistoryEntry lhe;
+        lhe.header = header;
+        lhe.hash = xdrSha256(header);
+        mLedgerOut->writeOne(lhe);
+
+        // Ledgers without transactions have no entries, as in the database
+        if (!results.results.empty())
+        {
+            TransactionHistoryEntry hist;
+            hist.ledgerSeq = ledgerSeq;
+            if (txSet.isGeneralizedTxSet())
+            {
+                hist.ext.v(1);
+                txSet.toXDR(hist.ext.generalizedTxSet());
+            }
+            else
+            {
+                txSet.toXDR(hist.txSet);
+            }
+            mTxOut->writeOne(hist);
+
+            TransactionHistoryResultEntry histResults;
+            histResults.ledgerSeq = ledgerSeq;
+            histResults.txResultSet = results;
+            mResultOut->writeOne(histResults);
+        }
+
+        auto it = mPendingSCPMessages.find(ledgerSeq);
+        if (it != mPendingSCPMessages.end())
+        {
+            mSCPOut->writeOne(it->second);
+            mHasSCPMessages = true;
+        }
+
+        // Hand the entries to the OS so that they survive a crash of the
+        // process; the files are synced once, when the checkpoint is finished
+        for (auto out : {&mLedgerOut, &mTxOut, &mResultOut, &mSCPOut})
+        {
+            (*out)->flush();
+        }
+
+        if (hm.isLastLedgerInCheckpoint(ledgerSeq))
+        {
+            finishCheckpoint(checkpoint);
+        }
+    }
+
+    mPendingSCPMessages.erase(mPendingSCPMessages.begin(),
+                              mPendingSCPMessages.upper_bound(ledgerSeq));
+}
+
+bool
+CheckpointBuilder::hasCheckpoint(uint32_t checkpoint) const
+{
+    return fs::exists(pathOf(HISTORY_FILE_TYPE_LEDGER, checkpoint, false));
+}
+
+void
+CheckpointBuilder::linkCheckpointFile(uint32_t checkpoint,
+                                      FileTransferInfo const& file)
+{
+    ZoneScoped;
+    auto src = pathOf(file.getType(), checkpoint, false);
+    if (!fs::exists(src))
+    {
+        return;
+    }
+
+    auto dst = file.localPath_nogz();
+    std::error_code ec;
+    std::filesystem::remove(dst, ec);
+    std::filesystem::create_hard_link(src, dst, ec);
+    if (ec)
+    {
+        fs::copyFile(src, dst);
+    }
+}
+
+void
+CheckpointBuilder::removeCheckpointsFrom(uint32_t checkpoint)
+{
+    ZoneScoped;
+    for (auto const& name : fs::findfiles(mDir, isCheckpointFile))
+    {
+        std::smatch match;
+        std::regex_match(name, match, checkpointFileRegex());
+        auto fileCheckpoint =
+            static_cast<uint32_t>(std::stoul(match[1].str(), nullptr, 16));
+        if (!match[2].matched && fileCheckpoint >= checkpoint)
+        {
+            std::remove((mDir + "/" + name).c_str());
+        }
+    }
+}
+
+void
+CheckpointBuilder::removeCheckpoint(uint32_t checkpoint)
+{
+    removeFiles(checkpoint, false);
+}
+}
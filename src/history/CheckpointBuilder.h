@@ -0,0 +1,126 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace medida
+{
+class Timer;
+}
+
+namespace stellar
+{
+
+class Application;
+class FileTransferInfo;
+class TxSetXDRFrame;
+class XDROutputFileStream;
+
+/**
+ * Writes the history files of a checkpoint (ledger headers, transactions,
+ * results and SCP messages) as ledgers close, instead of reading them back
+ * from the database when the checkpoint is published.
+ *
+ * Entries are appended to "dirty" files in a directory next to the buckets,
+ * which are flushed to the OS after each ledger, before it commits, and synced
+ * once, when the last ledger of the checkpoint closes and they're renamed to
+ * their final names. Publishing then only has to link these files into the
+ * snapshot. They're deleted once the checkpoint is published.
+ *
+ * The database doesn't hold the history of streamed ledgers, so if the OS
+ * crashes before the files of a checkpoint are synced, committed ledgers may be
+ * lost and `restore` fails.
+ *
+ * A checkpoint is only streamed if the node closes all of its ledgers, from the
+ * first one; otherwise (after a catchup landing in the middle of a checkpoint,
+ * or for the first checkpoint, whose first ledger is the genesis ledger) its
+ * history is stored in the database and published from there, as before. Use
+ * `streams` to know which is the case.
+ *
+ * As ledgers are appended before they're committed to the database, `restore`
+ * must be called on startup to drop the entries of a ledger that failed to
+ * commit.
+ */
+class CheckpointBuilder : public NonMovableOrCopyable
+{
+    Application& mApp;
+    std::string const mDir;
+
+    // Next ledger to be appended, 0 if unknown
+    uint32_t mNextLedger{0};
+    // Whether the dirty files hold every ledger of the checkpoint before
+    // mNextLedger
+    bool mComplete{false};
+    bool mHasSCPMessages{false};
+
+    std::unique_ptr<XDROutputFileStream> mLedgerOut;
+    std::unique_ptr<XDROutputFileStream> mTxOut;
+    std::unique_ptr<XDROutputFileStream> mResultOut;
+    std::unique_ptr<XDROutputFileStream> mSCPOut;
+
+    // SCP messages of ledgers that externalized but didn't close yet
+    std::map<uint32_t, SCPHistoryEntry> mPendingSCPMessages;
+
+    medida::Timer& mAppendTimer;
+
+    std::string pathOf(std::string const& type, uint32_t checkpoint,
+                       bool dirty) const;
+    void openStreams(uint32_t checkpoint);
+    void closeStreams();
+    void removeFiles(uint32_t checkpoint, bool dirty);
+    bool truncateFiles(uint32_t checkpoint, uint32_t lcl);
+    void finishCheckpoint(uint32_t checkpoint);
+
+  public:
+    explicit CheckpointBuilder(Application& app);
+    ~CheckpointBuilder();
+
+    // Drops the entries of ledgers after `lcl` and resumes writing the
+    // checkpoint containing `lcl + 1`. Files of checkpoints that are not
+    // queued for publication are deleted. Throws if the files of the
+    // checkpoint are missing ledgers up to `lcl`, as they can't be found
+    // anywhere else.
+    void restore(uint32_t lcl);
+
+    // Whether the history of `ledgerSeq`, if it's the next ledger to close, is
+    // written to checkpoint files rather than to the database.
+    bool streams(uint32_t ledgerSeq) const;
+
+    // Records the SCP messages that externalized `ledgerSeq`, to be written
+    // when it closes.
+    void appendSCPHistory(uint32_t ledgerSeq,
+                          std::vector<SCPEnvelope> const& envs);
+
+    // Appends the history of a closed ledger, finishing its checkpoint if it's
+    // the last ledger of it. Ledgers that don't follow the previously appended
+    // one start a new checkpoint, which is only complete if `header` is its
+    // first ledger.
+    void appendLedger(LedgerHeader const& header, TxSetXDRFrame const& txSet,
+                      TransactionResultSet const& results);
+
+    // Whether all the files of `checkpoint` were written.
+    bool hasCheckpoint(uint32_t checkpoint) const;
+
+    // Makes the finished file of `checkpoint` matching `file` available at its
+    // local path, by hard-linking it if possible and copying it otherwise. Does
+    // nothing if there's no such file (as for checkpoints without SCP
+    // messages).
+    void linkCheckpointFile(uint32_t checkpoint, FileTransferInfo const& file);
+
+    // Deletes the finished files of checkpoints from `checkpoint` on.
+    void removeCheckpointsFrom(uint32_t checkpoint);
+
+    // Deletes the finished files of `checkpoint`.
+    void removeCheckpoint(uint32_t checkpoint);
+};
+}
@@ -27,6 +27,7 @@
 #include <cereal/cereal.hpp>
 #include <cereal/types/vector.hpp>
 #include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <future>
 #include <iostream>
@@ -460,19 +461,19 @@ HistoryArchive::~HistoryArchive()
 bool
 HistoryArchive::hasGetCmd() const
 {
-    return !mConfig.mGetCmd.empty();
+    return !mConfig.mGetCmd.empty() || isLocal();
 }
 
 bool
 HistoryArchive::hasPutCmd() const
 {
-    return !mConfig.mPutCmd.empty();
+    return !mConfig.mPutCmd.empty() || (isLocal() && mConfig.mWritable);
 }
 
 bool
 HistoryArchive::hasMkdirCmd() const
 {
-    return !mConfig.mMkdirCmd.empty();
+    return !mConfig.mMkdirCmd.empty() || (isLocal() && mConfig.mWritable);
 }
 
 std::string const&
@@ -506,4 +507,55 @@ HistoryArchive::mkdirCmd(std::string const& remoteDir) const
         return "";
     return formatString(mConfig.mMkdirCmd, remoteDir);
 }
+
+bool
+HistoryArchive::isLocal() const
+{
+    return !mConfig.mPath.empty();
+}
+
+void
+HistoryArchive::getFileLocal(std::string const& remote,
+                             std::string const& local) const
+{
+    ZoneScoped;
+    releaseAssert(isLocal());
+    fs::copyFile(mConfig.mPath + "/" + remote, local);
+}
+
+void
+HistoryArchive::putFileLocal(std::string const& local,
+                             std::string const& remote) const
+{
+    ZoneScoped;
+    releaseAssert(isLocal() && mConfig.mWritable);
+    // Readers of the archive must never see a partial file
+    auto dst = mConfig.mPath + "/" + remote;
+    auto tmp = dst + ".tmp";
+    fs::copyFile(local, tmp);
+
+    // ... nor, after a crash, an empty or truncated one
+    fs::flushFileChanges(tmp);
+
+    auto dir = dst.substr(0, dst.find_last_of('/'));
+    if (!fs::durableRename(tmp, dst, dir))
+    {
+        std::remove(tmp.c_str());
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("Error renaming {} to {}"), tmp, dst));
+    }
+}
+
+void
+HistoryArchive::mkdirLocal(std::string const& remoteDir) const
+{
+    ZoneScoped;
+    releaseAssert(isLocal() && mConfig.mWritable);
+    auto dir = mConfig.mPath + "/" + remoteDir;
+    if (!fs::mkpath(dir))
+    {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("Error creating directory {}"), dir));
+    }
+}
 }
@@ -155,6 +155,8 @@ class HistoryArchive : public std::enable_shared_from_this<HistoryArchive>
     explicit HistoryArchive(Application& app,
                             HistoryArchiveConfiguration const& config);
     ~HistoryArchive();
+    // Whether files can be fetched from, put to and directories made in this
+    // archive, with commands or in-process for local archives.
     bool hasGetCmd() const;
     bool hasPutCmd() const;
     bool hasMkdirCmd() const;
@@ -166,6 +168,17 @@ class HistoryArchive : public std::enable_shared_from_this<HistoryArchive>
                            std::string const& remote) const;
     std::string mkdirCmd(std::string const& remoteDir) const;
 
+    // Local archives are directories on the local filesystem, configured
+    // with a `path`, that are accessed in-process instead of through the
+    // commands above. These functions throw on failure; they don't use the
+    // application, so they can run on background threads.
+    bool isLocal() const;
+    void getFileLocal(std::string const& remote,
+                      std::string const& local) const;
+    void putFileLocal(std::string const& local,
+                      std::string const& remote) const;
+    void mkdirLocal(std::string const& remoteDir) const;
+
   private:
     HistoryArchiveConfiguration mConfig;
 };
@@ -0,0 +1,241 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/HistoryFileCache.h"
+#include "main/Application.h"
+#include "util/Fs.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include <Tracy.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace stellar
+{
+
+namespace stdfs = std::filesystem;
+
+namespace
+{
+// Suffix of files being copied into the cache, which are not cached yet
+std::string const TMP_SUFFIX = ".tmp";
+
+bool
+isTmpFile(std::string const& name)
+{
+    return name.size() >= TMP_SUFFIX.size() &&
+           name.compare(name.size() - TMP_SUFFIX.size(), TMP_SUFFIX.size(),
+                        TMP_SUFFIX) == 0;
+}
+}
+
+HistoryFileCache::HistoryFileCache(Application& app, std::string const& dir,
+                                   uint64_t maxSize)
+    : mDir(dir)
+    , mMaxSize(maxSize)
+    , mHit(app.getMetrics().NewMeter({"history", "cache", "hit"}, "file"))
+    , mMiss(app.getMetrics().NewMeter({"history", "cache", "miss"}, "file"))
+    , mEvicted(
+          app.getMetrics().NewMeter({"history", "cache", "evicted"}, "file"))
+    , mSizeCounter(app.getMetrics().NewCounter({"history", "cache", "size"}))
+{
+    ZoneScoped;
+    if (!fs::mkpath(mDir))
+    {
+        throw std::runtime_error("Failed to create history cache directory " +
+                                 mDir);
+    }
+
+    // Index the files left by previous runs, least recently used first
+    std::vector<std::pair<stdfs::file_time_type, std::string>> files;
+    for (auto const& entry : stdfs::directory_iterator(mDir))
+    {
+        std::error_code ec;
+        auto name = entry.path().filename().string();
+        if (!entry.is_regular_file(ec) || isTmpFile(name))
+        {
+            continue;
+        }
+        auto time = entry.last_write_time(ec);
+        if (!ec)
+        {
+            files.emplace_back(time, name);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    for (auto const& [time, name] : files)
+    {
+        std::error_code ec;
+        auto size = stdfs::file_size(pathOf(name), ec);
+        if (!ec)
+        {
+            add(name, size);
+        }
+    }
+    CLOG_INFO(History, "History cache {} holds {} files ({} bytes)", mDir,
+              mEntries.size(), mSize);
+    evict();
+}
+
+std::string
+HistoryFileCache::pathOf(std::string const& key) const
+{
+    return mDir + "/" + key;
+}
+
+void
+HistoryFileCache::add(std::string const& key, uint64_t size)
+{
+    releaseAssert(mEntries.find(key) == mEntries.end());
+    auto position = mRecency.insert(mRecency.end(), key);
+    mEntries.emplace(key, Entry{size, position});
+    mSize += size;
+    mSizeCounter.set_count(mSize);
+}
+
+void
+HistoryFileCache::erase(std::string const& key)
+{
+    auto it = mEntries.find(key);
+    if (it != mEntries.end())
+    {
+        mSize -= it->second.mSize;
+        mRecency.erase(it->second.mPosition);
+        mEntries.erase(it);
+        mSizeCounter.set_count(mSize);
+    }
+}
+
+void
+HistoryFileCache::touch(std::string const& key)
+{
+    auto it = mEntries.find(key);
+    releaseAssert(it != mEntries.end());
+    mRecency.splice(mRecency.end(), mRecency, it->second.mPosition);
+
+    // Keep the order across restarts; failing to do so is harmless
+    std::error_code ec;
+    stdfs::last_write_time(pathOf(key), stdfs::file_time_type::clock::now(),
+                           ec);
+}
+
+void
+HistoryFileCache::evict()
+{
+    while (mSize > mMaxSize && !mRecency.empty())
+    {
+        auto key = mRecency.front();
+        CLOG_DEBUG(History, "Evicting {} from history cache", key);
+        std::error_code ec;
+        stdfs::remove(pathOf(key), ec);
+        erase(key);
+        mEvicted.Mark();
+    }
+}
+
+bool
+HistoryFileCache::fetch(std::string const& key, std::string const& path)
+{
+    ZoneScoped;
+    if (mEntries.find(key) == mEntries.end())
+    {
+        mMiss.Mark();
+        return false;
+    }
+
+    std::error_code ec;
+    stdfs::remove(path, ec);
+    stdfs::create_hard_link(pathOf(key), path, ec);
+    if (ec)
+    {
+        ec.clear();
+        stdfs::copy_file(pathOf(key), path, ec);
+    }
+    if (ec)
+    {
+        // Another node sharing the directory may have evicted the file
+        CLOG_DEBUG(History, "Could not fetch {} from history cache: {}", key,
+                   ec.message());
+        erase(key);
+        mMiss.Mark();
+        return false;
+    }
+
+    touch(key);
+    mHit.Mark();
+    return true;
+}
+
+void
+HistoryFileCache::insert(std::string const& key, std::string const& path)
+{
+    ZoneScoped;
+    std::error_code ec;
+    if (mEntries.find(key) != mEntries.end() && fs::exists(pathOf(key)))
+    {
+        stdfs::remove(path, ec);
+        touch(key);
+        return;
+    }
+    erase(key);
+
+    auto size = stdfs::file_size(path, ec);
+    if (ec)
+    {
+        CLOG_WARNING(History, "Could not add {} to history cache: {}", path,
+                     ec.message());
+        return;
+    }
+
+    // Files only show up in the cache directory once complete, as other nodes
+    // may be reading it
+    stdfs::rename(path, pathOf(key), ec);
+    if (ec)
+    {
+        // The cache may be on another filesystem
+        auto tmp = pathOf(key) + TMP_SUFFIX;
+        ec.clear();
+        stdfs::copy_file(path, tmp, stdfs::copy_options::overwrite_existing,
+                         ec);
+        if (!ec)
+        {
+            stdfs::rename(tmp, pathOf(key), ec);
+        }
+        if (ec)
+        {
+            CLOG_WARNING(History, "Could not add {} to history cache: {}",
+                         path, ec.message());
+            stdfs::remove(tmp, ec);
+            return;
+        }
+        stdfs::remove(path, ec);
+    }
+
+    add(key, size);
+    evict();
+}
+
+void
+HistoryFileCache::remove(std::string const& key)
+{
+    ZoneScoped;
+    std::error_code ec;
+    stdfs::remove(pathOf(key), ec);
+    erase(key);
+}
+
+uint64_t
+HistoryFileCache::size() const
+{
+    return mSize;
+}
+}
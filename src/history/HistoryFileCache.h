@@ -0,0 +1,84 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+#include "util/UnorderedMap.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+
+namespace medida
+{
+class Counter;
+class Meter;
+}
+
+namespace stellar
+{
+
+class Application;
+
+/**
+ * A size-bounded cache of downloaded history files, kept in a directory that
+ * outlives catchups (and that several nodes on one host can share). Files are
+ * keyed by names that include a hash of their content, so a cached file never
+ * goes stale; callers still verify the content they get, and remove entries
+ * that fail verification. When the cache grows over its size limit, the least
+ * recently used files are deleted.
+ *
+ * The cache index is built from the directory when the cache is created, and
+ * the modification time of files is used to order them, so that recency
+ * survives restarts. Files deleted by another process sharing the directory
+ * are treated as misses.
+ */
+class HistoryFileCache : public NonMovableOrCopyable
+{
+    struct Entry
+    {
+        uint64_t mSize;
+        std::list<std::string>::iterator mPosition;
+    };
+
+    std::string const mDir;
+    uint64_t const mMaxSize;
+    uint64_t mSize{0};
+    // Keys from the least to the most recently used
+    std::list<std::string> mRecency;
+    UnorderedMap<std::string, Entry> mEntries;
+
+    medida::Meter& mHit;
+    medida::Meter& mMiss;
+    medida::Meter& mEvicted;
+    medida::Counter& mSizeCounter;
+
+    std::string pathOf(std::string const& key) const;
+    void add(std::string const& key, uint64_t size);
+    void erase(std::string const& key);
+    void touch(std::string const& key);
+    void evict();
+
+  public:
+    HistoryFileCache(Application& app, std::string const& dir,
+                     uint64_t maxSize);
+
+    // Makes the file cached under `key` available at `path`, by hard-linking
+    // it if possible and copying it otherwise. Returns false if there is no
+    // such file.
+    bool fetch(std::string const& key, std::string const& path);
+
+    // Moves the file at `path` into the cache under `key`, then evicts files
+    // over the size limit. If `key` is already cached, the file at `path` is
+    // deleted instead.
+    void insert(std::string const& key, std::string const& path);
+
+    // Deletes the file cached under `key`, if any.
+    void remove(std::string const& key);
+
+    // Total size of the cached files, in bytes.
+    uint64_t size() const;
+};
+}
@@ -184,6 +184,8 @@ class BucketList;
 class Config;
 class Database;
 class HistoryArchive;
+class CheckpointBuilder;
+class HistoryFileCache;
 struct StateSnapshot;
 
 class HistoryManager
@@ -366,6 +368,15 @@ class HistoryManager
     // tmpdir.
     virtual std::string localFilename(std::string const& basename) = 0;
 
+    // Return the cache of downloaded history files kept in HISTORY_CACHE_DIR,
+    // or null if HISTORY_CACHE_DIR is not set.
+    virtual HistoryFileCache* getFileCache() = 0;
+
+    // Return the writer of checkpoint files at ledger close, or null if
+    // STREAM_HISTORY_CHECKPOINTS is not set or no history archive is
+    // writable.
+    virtual CheckpointBuilder* getCheckpointBuilder() = 0;
+
     // Return the number of checkpoints that have been enqueued for
     // publication. This may be less than the number "started", but every
     // enqueued checkpoint should eventually start.
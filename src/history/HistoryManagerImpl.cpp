@@ -151,6 +151,35 @@ HistoryManagerImpl::getTmpDir()
     return mWorkDir->getName();
 }
 
+HistoryFileCache*
+HistoryManagerImpl::getFileCache()
+{
+    auto const& cfg = mApp.getConfig();
+    if (!mFileCache && !cfg.HISTORY_CACHE_DIR.empty())
+    {
+        mFileCache = std::make_unique<HistoryFileCache>(
+            mApp, cfg.HISTORY_CACHE_DIR,
+            cfg.HISTORY_CACHE_MAX_SIZE_MB * 1024 * 1024);
+    }
+    return mFileCache.get();
+}
+
+CheckpointBuilder*
+HistoryManagerImpl::getCheckpointBuilder()
+{
+    // Checked once, as this is called for every ledger closed
+    if (!mCheckpointBuilderChecked)
+    {
+        mCheckpointBuilderChecked = true;
+        if (mApp.getConfig().STREAM_HISTORY_CHECKPOINTS &&
+            mApp.getHistoryArchiveManager().hasAnyWritableHistoryArchive())
+        {
+            mCheckpointBuilder = std::make_unique<CheckpointBuilder>(mApp);
+        }
+    }
+    return mCheckpointBuilder.get();
+}
+
 std::string
 HistoryManagerImpl::localFilename(std::string const& basename)
 {
@@ -451,6 +480,10 @@ HistoryManagerImpl::historyPublished(
         }
 
         mPublishQueueBuckets.removeBuckets(originalBuckets);
+        if (auto builder = getCheckpointBuilder())
+        {
+            builder->removeCheckpoint(ledgerSeq);
+        }
     }
     else
     {
@@ -471,6 +504,11 @@ HistoryManagerImpl::deleteCheckpointsNewerThan(uint32_t ledgerSeq)
     st.exchange(soci::use(ledgerSeq));
     st.define_and_bind();
     st.execute(true);
+
+    if (auto builder = getCheckpointBuilder())
+    {
+        builder->removeCheckpointsFrom(ledgerSeq);
+    }
 }
 
 uint64_t
@@ -5,6 +5,8 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "bucket/PublishQueueBuckets.h"
+#include "history/CheckpointBuilder.h"
+#include "history/HistoryFileCache.h"
 #include "history/HistoryManager.h"
 #include "util/TmpDir.h"
 #include "work/Work.h"
@@ -25,6 +27,9 @@ class HistoryManagerImpl : public HistoryManager
 {
     Application& mApp;
     std::unique_ptr<TmpDir> mWorkDir;
+    std::unique_ptr<HistoryFileCache> mFileCache;
+    std::unique_ptr<CheckpointBuilder> mCheckpointBuilder;
+    bool mCheckpointBuilderChecked{false};
     std::shared_ptr<BasicWork> mPublishWork;
 
     PublishQueueBuckets mPublishQueueBuckets;
@@ -79,6 +84,10 @@ class HistoryManagerImpl : public HistoryManager
 
     std::string const& getTmpDir() override;
 
+    HistoryFileCache* getFileCache() override;
+
+    CheckpointBuilder* getCheckpointBuilder() override;
+
     std::string localFilename(std::string const& basename) override;
 
     uint64_t getPublishQueueCount() const override;
@@ -9,6 +9,7 @@
 #include "crypto/Hex.h"
 #include "database/Database.h"
 #include "herder/HerderPersistence.h"
+#include "history/CheckpointBuilder.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryManager.h"
@@ -40,6 +41,7 @@ StateSnapshot::StateSnapshot(Application& app, HistoryArchiveState const& state)
     , mSCPHistorySnapFile(std::make_shared<FileTransferInfo>(
           mSnapDir, HISTORY_FILE_TYPE_SCP, mLocalState.currentLedger))
 
+    , mCheckpointBuilder(app.getHistoryManager().getCheckpointBuilder())
 {
     if (mLocalState.currentBuckets.size() != BucketList::kNumLevels)
     {
@@ -51,6 +53,21 @@ bool
 StateSnapshot::writeHistoryBlocks() const
 {
     ZoneScoped;
+    // Checkpoints written as their ledgers closed only need to be linked
+    auto checkpoint = mLocalState.currentLedger;
+    if (mCheckpointBuilder && mCheckpointBuilder->hasCheckpoint(checkpoint))
+    {
+        for (auto const& file : {mLedgerSnapFile, mTransactionSnapFile,
+                                 mTransactionResultSnapFile,
+                                 mSCPHistorySnapFile})
+        {
+            mCheckpointBuilder->linkCheckpointFile(checkpoint, *file);
+        }
+        CLOG_DEBUG(History, "Linked history files of checkpoint {}",
+                   checkpoint);
+        return true;
+    }
+
     std::unique_ptr<soci::session> snapSess(
         mApp.getDatabase().canUsePool()
             ? std::make_unique<soci::session>(mApp.getDatabase().getPool())
@@ -15,6 +15,7 @@
 namespace stellar
 {
 
+class CheckpointBuilder;
 class FileTransferInfo;
 
 struct StateSnapshot : public std::enable_shared_from_this<StateSnapshot>
@@ -26,6 +27,9 @@ struct StateSnapshot : public std::enable_shared_from_this<StateSnapshot>
     std::shared_ptr<FileTransferInfo> mTransactionSnapFile;
     std::shared_ptr<FileTransferInfo> mTransactionResultSnapFile;
     std::shared_ptr<FileTransferInfo> mSCPHistorySnapFile;
+    // Taken on the main thread, as the history blocks are written on a
+    // background thread
+    CheckpointBuilder* const mCheckpointBuilder;
 
     StateSnapshot(Application& app, HistoryArchiveState const& state);
     bool writeHistoryBlocks() const;
@@ -6,8 +6,12 @@
 #include "bucket/test/BucketTestUtils.h"
 #include "catchup/CatchupManagerImpl.h"
 #include "catchup/test/CatchupWorkTests.h"
+#include "crypto/SHA.h"
+#include "herder/TxSetFrame.h"
+#include "history/CheckpointBuilder.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryArchiveManager.h"
+#include "history/HistoryFileCache.h"
 #include "history/HistoryManager.h"
 #include "history/test/HistoryTestsUtils.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
@@ -22,16 +26,21 @@
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
+#include "transactions/TransactionSQL.h"
 #include "util/Fs.h"
 #include "util/Logging.h"
+#include "util/XDRStream.h"
 #include "work/WorkScheduler.h"
 
 #include "historywork/BatchDownloadWork.h"
 #include "historywork/DownloadBucketsWork.h"
 #include "historywork/DownloadVerifyTxResultsWork.h"
 #include "historywork/VerifyTxResultsWork.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 #include <fmt/format.h>
 #include <lib/catch.hpp>
+#include <fstream>
 
 using namespace stellar;
 using namespace historytestutils;
@@ -104,6 +113,65 @@ TEST_CASE("HistoryManager compress", "[history]")
     REQUIRE(!fs::exists(compressed));
 }
 
+TEST_CASE("HistoryManager gunzip verifies hash", "[history]")
+{
+    CatchupSimulation catchupSimulation{};
+
+    // Large enough to span several compression buffers
+    std::string s;
+    for (int i = 0; s.size() < 3 * fs::bufsz(); ++i)
+    {
+        s += fmt::format("line {}\n", i);
+    }
+    HistoryManager& hm = catchupSimulation.getApp().getHistoryManager();
+    std::string fname = hm.localFilename("verifyme");
+    {
+        std::ofstream out;
+        out.exceptions(std::ios::failbit | std::ios::badbit);
+        out.open(fname, std::ofstream::binary);
+        out.write(s.data(), s.size());
+    }
+    std::string compressed = fname + ".gz";
+    auto& wm = catchupSimulation.getApp().getWorkScheduler();
+    auto g = wm.executeWork<GzipFileWork>(fname, true);
+    REQUIRE(g->getState() == BasicWork::State::WORK_SUCCESS);
+    REQUIRE(fs::exists(fname));
+    REQUIRE(fs::exists(compressed));
+    std::remove(fname.c_str());
+
+    SECTION("matching hash")
+    {
+        auto u = wm.executeWork<GunzipFileWork>(
+            compressed, true, BasicWork::RETRY_NEVER, sha256(s));
+        REQUIRE(u->getState() == BasicWork::State::WORK_SUCCESS);
+        std::ifstream in(fname, std::ifstream::binary);
+        std::string res((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+        REQUIRE(res == s);
+        REQUIRE(fs::exists(compressed));
+    }
+    SECTION("mismatching hash")
+    {
+        auto u = wm.executeWork<GunzipFileWork>(
+            compressed, true, BasicWork::RETRY_NEVER, sha256("bad"));
+        REQUIRE(u->getState() == BasicWork::State::WORK_FAILURE);
+        REQUIRE(!fs::exists(fname));
+    }
+    SECTION("corrupt file")
+    {
+        {
+            std::ofstream out(compressed, std::ofstream::binary |
+                                              std::ofstream::in |
+                                              std::ofstream::out);
+            out.seekp(fs::size(compressed) / 2);
+            out.write("garbage", 7);
+        }
+        auto u = wm.executeWork<GunzipFileWork>(compressed);
+        REQUIRE(u->getState() == BasicWork::State::WORK_FAILURE);
+        REQUIRE(!fs::exists(fname));
+    }
+}
+
 TEST_CASE("HistoryArchiveState get_put", "[history]")
 {
     CatchupSimulation catchupSimulation{};
@@ -367,6 +435,50 @@ TEST_CASE("Ledger chain verification", "[ledgerheaderverification]")
             checkExpectedBehavior(BasicWork::State::WORK_FAILURE, lcl, last);
         REQUIRE(!w);
     }
+    SECTION("retry with checks still in flight")
+    {
+        std::tie(lcl, last) = ledgerChainGenerator.makeLedgerChainFiles(
+            HistoryManager::VERIFY_STATUS_OK);
+        FileTransferInfo ft(tmpDir, HISTORY_FILE_TYPE_LEDGER,
+                            last.header.ledgerSeq);
+        auto path = ft.localPath_nogz();
+        auto moved = path + ".moved";
+        REQUIRE(std::rename(path.c_str(), moved.c_str()) == 0);
+
+        std::promise<LedgerNumHashPair> trustedPromise;
+        trustedPromise.set_value(LedgerNumHashPair(
+            last.header.ledgerSeq, std::make_optional<Hash>(last.hash)));
+        auto w = std::make_shared<VerifyLedgerChainWork>(
+            *app, tmpDir, ledgerRange,
+            LedgerNumHashPair(lcl.header.ledgerSeq,
+                              std::make_optional<Hash>(lcl.hash)),
+            trustedPromise.get_future().share(), std::promise<bool>());
+        auto run = [&]() {
+            w->startWork(nullptr);
+            while (!w->isDone())
+            {
+                if (w->getState() == BasicWork::State::WORK_RUNNING)
+                {
+                    w->crankWork();
+                }
+                else
+                {
+                    clock.crank(true);
+                }
+            }
+        };
+
+        // The first checkpoint fails to open right away, leaving the checks
+        // of the following checkpoints running in the background when the
+        // work is restarted
+        run();
+        REQUIRE(w->getState() == BasicWork::State::WORK_FAILURE);
+        REQUIRE(std::rename(moved.c_str(), path.c_str()) == 0);
+        run();
+        REQUIRE(w->getState() == BasicWork::State::WORK_SUCCESS);
+        REQUIRE(w->getMaxChecksInFlightForTesting() <=
+                static_cast<size_t>(cfg.WORKER_THREADS));
+    }
 }
 
 TEST_CASE("Tx results verification", "[batching][resultsverification]")
@@ -507,6 +619,144 @@ TEST_CASE("History catchup with extra validation", "[history][publish]")
     REQUIRE(catchupSimulation.catchupOffline(app, checkpointLedger, true));
 }
 
+TEST_CASE("History catchup skipping known results", "[history][publish]")
+{
+    CatchupSimulation catchupSimulation{};
+    catchupSimulation.setGenerateFailedTransactions();
+    auto checkpointLedger = catchupSimulation.getLastCheckpointLedger(3);
+    catchupSimulation.ensureOfflineCatchupPossible(checkpointLedger);
+
+    auto app = catchupSimulation.createCatchupApplication(
+        std::numeric_limits<uint32_t>::max(), Config::TESTDB_ON_DISK_SQLITE,
+        "app", /* publish */ false, /* useBucketListDB */ false, std::nullopt,
+        /* skipKnownResults */ true);
+    // Every replayed ledger must still match the published one
+    REQUIRE(catchupSimulation.catchupOffline(app, checkpointLedger, true));
+
+    // Known results were used, for failed transactions too
+    auto& knownValid = app->getMetrics().NewMeter(
+        {"ledger", "transaction", "replay-known-valid"}, "transaction");
+    auto& knownFailed = app->getMetrics().NewMeter(
+        {"ledger", "transaction", "replay-known-failed"}, "transaction");
+    REQUIRE(knownFailed.count() > 0);
+    REQUIRE(knownValid.count() > knownFailed.count());
+}
+
+TEST_CASE("History catchup with a history file cache", "[history][catchup]")
+{
+    CatchupSimulation catchupSimulation{};
+    auto checkpointLedger = catchupSimulation.getLastCheckpointLedger(3);
+    catchupSimulation.ensureOfflineCatchupPossible(checkpointLedger);
+
+    auto cacheTmpDir =
+        catchupSimulation.getApp().getTmpDirManager().tmpDir("history-cache");
+    auto cacheDir = cacheTmpDir.getName() + "/cache";
+    catchupSimulation.setHistoryCacheDir(cacheDir);
+
+    auto meterCount = [](Application::pointer app, std::string const& name) {
+        return app->getMetrics()
+            .NewMeter({"history", "cache", name}, "file")
+            .count();
+    };
+
+    // Minimal catchups apply the buckets of the checkpoint, which are all
+    // downloaded by the first one
+    auto a = catchupSimulation.createCatchupApplication(
+        0, Config::TESTDB_IN_MEMORY_SQLITE, "first catchup");
+    REQUIRE(catchupSimulation.catchupOffline(a, checkpointLedger));
+    auto downloaded = meterCount(a, "miss");
+    REQUIRE(downloaded > 0);
+    REQUIRE(meterCount(a, "hit") == 0);
+
+    auto cached = fs::findfiles(cacheDir, [](std::string const& name) {
+        return name.find("bucket-") == 0;
+    });
+    REQUIRE(cached.size() == static_cast<size_t>(downloaded));
+
+    SECTION("cached files are used")
+    {
+        auto b = catchupSimulation.createCatchupApplication(
+            0, Config::TESTDB_IN_MEMORY_SQLITE, "cached catchup");
+        REQUIRE(catchupSimulation.catchupOffline(b, checkpointLedger));
+        REQUIRE(meterCount(b, "hit") == downloaded);
+        REQUIRE(meterCount(b, "miss") == 0);
+    }
+    SECTION("corrupt cached files are downloaded again")
+    {
+        auto corrupt = cacheDir + "/" + cached.front();
+        auto size = fs::size(corrupt);
+        {
+            std::ofstream out(corrupt,
+                              std::ofstream::binary | std::ofstream::trunc);
+            out << "not gzip";
+        }
+
+        auto b = catchupSimulation.createCatchupApplication(
+            0, Config::TESTDB_IN_MEMORY_SQLITE, "corrupt cache catchup");
+        REQUIRE(catchupSimulation.catchupOffline(b, checkpointLedger));
+        REQUIRE(meterCount(b, "miss") == 1);
+        // The downloaded file replaced the corrupt one in the cache
+        REQUIRE(fs::size(corrupt) == size);
+    }
+}
+
+TEST_CASE("History file cache", "[history]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto tmpDir = app->getTmpDirManager().tmpDir("history-cache-test");
+    auto cacheDir = tmpDir.getName() + "/cache";
+
+    auto writeFile = [&](std::string const& name, size_t size) {
+        auto path = tmpDir.getName() + "/" + name;
+        std::ofstream out(path, std::ofstream::binary);
+        out << std::string(size, 'x');
+        return path;
+    };
+    auto fetched = tmpDir.getName() + "/fetched";
+
+    {
+        HistoryFileCache cache(*app, cacheDir, 250);
+        REQUIRE(!cache.fetch("a", fetched));
+
+        cache.insert("a", writeFile("a", 100));
+        cache.insert("b", writeFile("b", 100));
+        REQUIRE(cache.size() == 200);
+        // Inserted files are moved into the cache
+        REQUIRE(!fs::exists(tmpDir.getName() + "/a"));
+
+        REQUIRE(cache.fetch("a", fetched));
+        REQUIRE(fs::size(fetched) == 100);
+
+        // "b" is the least recently used file
+        cache.insert("c", writeFile("c", 100));
+        REQUIRE(cache.size() == 200);
+        REQUIRE(cache.fetch("a", fetched));
+        REQUIRE(!cache.fetch("b", fetched));
+        REQUIRE(cache.fetch("c", fetched));
+
+        // Inserting a cached key keeps the cached file
+        cache.insert("c", writeFile("c", 10));
+        REQUIRE(cache.size() == 200);
+        REQUIRE(!fs::exists(tmpDir.getName() + "/c"));
+
+        cache.remove("a");
+        REQUIRE(cache.size() == 100);
+        REQUIRE(!cache.fetch("a", fetched));
+    }
+
+    // A new cache finds the files left in the directory
+    HistoryFileCache cache(*app, cacheDir, 250);
+    REQUIRE(cache.size() == 100);
+    REQUIRE(cache.fetch("c", fetched));
+    REQUIRE(fs::size(fetched) == 100);
+
+    // Files deleted behind the cache's back are misses
+    std::remove((cacheDir + "/c").c_str());
+    REQUIRE(!cache.fetch("c", fetched));
+    REQUIRE(cache.size() == 0);
+}
+
 TEST_CASE("Publish works correctly post shadow removal", "[history]")
 {
     // Given a HAS, verify that appropriate levels have "next" cleared, while
@@ -1174,6 +1424,221 @@ TEST_CASE("Publish catchup alternation with stall",
     REQUIRE(catchupSimulation.catchupOnline(minimalApp, targetLedger, 5));
 }
 
+TEST_CASE("Publish catchup via local directory archive", "[history]")
+{
+    CatchupSimulation catchupSimulation{
+        VirtualClock::VIRTUAL_TIME,
+        std::make_shared<LocalDirHistoryConfigurator>()};
+    auto checkpointLedger = catchupSimulation.getLastCheckpointLedger(3);
+    catchupSimulation.ensureOfflineCatchupPossible(checkpointLedger);
+
+    auto app = catchupSimulation.createCatchupApplication(
+        std::numeric_limits<uint32_t>::max(), Config::TESTDB_IN_MEMORY_SQLITE,
+        "local");
+    REQUIRE(catchupSimulation.catchupOnline(app, checkpointLedger, 5));
+}
+
+TEST_CASE("Publish catchup with streamed checkpoints", "[history]")
+{
+    CatchupSimulation catchupSimulation{
+        VirtualClock::VIRTUAL_TIME,
+        std::make_shared<StreamingHistoryConfigurator>()};
+    auto checkpointLedger = catchupSimulation.getLastCheckpointLedger(3);
+    catchupSimulation.ensureOfflineCatchupPossible(checkpointLedger);
+
+    // Only the first checkpoint, which starts with the genesis ledger, is
+    // published from the database
+    auto& publisher = catchupSimulation.getApp();
+    size_t ledgersWithTxs = 0;
+    for (auto ledger = publisher.getHistoryManager().getCheckpointFrequency();
+         ledger <= checkpointLedger; ++ledger)
+    {
+        if (catchupSimulation.getLedgerCloseData(ledger)
+                .getTxSet()
+                ->sizeTxTotal() > 0)
+        {
+            ++ledgersWithTxs;
+            REQUIRE(getTransactionHistoryResults(publisher.getDatabase(),
+                                                 ledger)
+                        .results.empty());
+        }
+    }
+    REQUIRE(ledgersWithTxs > 0);
+
+    auto app = catchupSimulation.createCatchupApplication(
+        std::numeric_limits<uint32_t>::max(), Config::TESTDB_IN_MEMORY_SQLITE,
+        "streamed");
+    REQUIRE(catchupSimulation.catchupOnline(app, checkpointLedger, 5));
+}
+
+TEST_CASE("Streamed checkpoints survive a restart", "[history]")
+{
+    Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+    // Keep checkpoints queued, so that their files are not deleted
+    cfg.MAX_CONCURRENT_SUBPROCESSES = 0;
+    StreamingHistoryConfigurator hcfg;
+    cfg = hcfg.configure(cfg, true);
+
+    auto readLedgers = [](std::string const& path) {
+        std::vector<LedgerHeaderHistoryEntry> res;
+        XDRInputFileStream in;
+        in.open(path);
+        LedgerHeaderHistoryEntry entry;
+        while (in.readOne(entry))
+        {
+            res.emplace_back(entry);
+        }
+        return res;
+    };
+    auto checkpointPath = [](Application& app, uint32_t checkpoint,
+                             bool dirty) {
+        auto path = app.getBucketManager().getBucketDir() + "/checkpoints/" +
+                    fs::baseName(HISTORY_FILE_TYPE_LEDGER,
+                                 fs::hexStr(checkpoint), "xdr");
+        return dirty ? path + ".dirty" : path;
+    };
+    // Writes the history of the ledger after the LCL, as closeLedger does
+    // before committing it, and stops the node as if it was killed then
+    auto appendUncommittedLedger = [](Application& app) {
+        auto const& lcl = app.getLedgerManager().getLastClosedLedgerHeader();
+        auto header = lcl.header;
+        ++header.ledgerSeq;
+        header.previousLedgerHash = lcl.hash;
+        app.getHistoryManager().getCheckpointBuilder()->appendLedger(
+            header, *TxSetXDRFrame::makeEmpty(lcl), TransactionResultSet{});
+    };
+    auto restart = [&](VirtualClock& clock) {
+        auto app = Application::create(clock, cfg, false);
+        app->start();
+        return app;
+    };
+
+    uint32_t freq;
+    uint32_t checkpoint;
+    std::string dirtyLedgerPath;
+    {
+        VirtualClock clock;
+        auto app = createTestApplication(clock, cfg);
+        auto& hm = app->getHistoryManager();
+        freq = hm.getCheckpointFrequency();
+        // The first checkpoint starts with the genesis ledger and is not
+        // streamed
+        checkpoint = 2 * freq - 1;
+        while (app->getLedgerManager().getLastClosedLedgerNum() < freq + 2)
+        {
+            closeLedger(*app);
+        }
+        appendUncommittedLedger(*app);
+        dirtyLedgerPath = checkpointPath(*app, checkpoint, true);
+        REQUIRE(readLedgers(dirtyLedgerPath).size() == 4);
+    }
+
+    SECTION("uncommitted ledgers are dropped on restart")
+    {
+        VirtualClock clock;
+        auto app = restart(clock);
+        auto ledgers = readLedgers(checkpointPath(*app, checkpoint, true));
+        REQUIRE(ledgers.size() == 3);
+        REQUIRE(ledgers.back().hash ==
+                app->getLedgerManager().getLastClosedLedgerHeader().hash);
+
+        while (!app->getHistoryManager().isLastLedgerInCheckpoint(
+            app->getLedgerManager().getLastClosedLedgerNum()))
+        {
+            closeLedger(*app);
+        }
+        auto cp = app->getHistoryManager().getCheckpointBuilder();
+        REQUIRE(cp->hasCheckpoint(checkpoint));
+        ledgers = readLedgers(checkpointPath(*app, checkpoint, false));
+        REQUIRE(ledgers.size() == freq);
+        for (size_t i = 1; i < ledgers.size(); ++i)
+        {
+            REQUIRE(ledgers[i].header.previousLedgerHash ==
+                    ledgers[i - 1].hash);
+        }
+    }
+
+    SECTION("checkpoint finished by an uncommitted ledger is resumed")
+    {
+        {
+            VirtualClock clock;
+            auto app = restart(clock);
+            while (app->getLedgerManager().getLastClosedLedgerNum() <
+                   checkpoint - 1)
+            {
+                closeLedger(*app);
+            }
+            appendUncommittedLedger(*app);
+            REQUIRE(app->getHistoryManager()
+                        .getCheckpointBuilder()
+                        ->hasCheckpoint(checkpoint));
+        }
+
+        VirtualClock clock;
+        auto app = restart(clock);
+        auto cp = app->getHistoryManager().getCheckpointBuilder();
+        REQUIRE(!cp->hasCheckpoint(checkpoint));
+        REQUIRE(readLedgers(checkpointPath(*app, checkpoint, true)).size() ==
+                freq - 1);
+
+        closeLedger(*app);
+        REQUIRE(cp->hasCheckpoint(checkpoint));
+        auto ledgers = readLedgers(checkpointPath(*app, checkpoint, false));
+        REQUIRE(ledgers.size() == freq);
+        REQUIRE(ledgers.back().hash ==
+                app->getLedgerManager().getLastClosedLedgerHeader().hash);
+    }
+
+    SECTION("checkpoint missing committed ledgers fails to restore")
+    {
+        VirtualClock clock;
+        // Keep only the first ledger of the checkpoint
+        auto ledgers = readLedgers(dirtyLedgerPath);
+        {
+            XDROutputFileStream out(clock.getIOContext(), false);
+            std::remove(dirtyLedgerPath.c_str());
+            out.open(dirtyLedgerPath);
+            out.writeOne(ledgers.front());
+        }
+
+        auto app = Application::create(clock, cfg, false);
+        REQUIRE_THROWS_AS(app->start(), std::runtime_error);
+    }
+}
+
+TEST_CASE("Catchup performance report", "[history][catchup]")
+{
+    CatchupSimulation catchupSimulation{};
+    auto checkpointLedger = catchupSimulation.getLastCheckpointLedger(3);
+    catchupSimulation.ensureOnlineCatchupPossible(checkpointLedger, 5);
+
+    // Catch up to a checkpoint by applying buckets, then buffered ledgers
+    auto app = catchupSimulation.createCatchupApplication(
+        0, Config::TESTDB_IN_MEMORY_SQLITE, "report");
+    auto& report = app->getCatchupManager().getPerformanceReport();
+    REQUIRE(report.getJsonInfo().isNull());
+    REQUIRE(catchupSimulation.catchupOnline(app, checkpointLedger, 5));
+
+    auto info = app->getJsonInfo(false)["info"];
+    REQUIRE(info.isMember("catchup"));
+    auto const& catchup = info["catchup"];
+    REQUIRE(catchup["state"].asString() == "succeeded");
+
+    auto const& stages = catchup["stages"];
+    for (auto const& name : {"download", "decompress", "verify",
+                             "apply_buckets", "apply_ledgers", "commit"})
+    {
+        INFO(name);
+        REQUIRE(stages[name]["operations"].asUInt64() > 0);
+    }
+    REQUIRE(stages["download"]["bytes"].asUInt64() > 0);
+    REQUIRE(stages["decompress"]["bytes"].asUInt64() > 0);
+    // Buckets are hashed as they're unzipped
+    REQUIRE(stages["verify"]["bytes"].asUInt64() > 0);
+    REQUIRE(stages["verify"]["entries"].asUInt64() > 0);
+    REQUIRE(stages["apply_buckets"]["entries"].asUInt64() > 0);
+}
+
 TEST_CASE("Publish catchup via s3", "[!hide][s3]")
 {
     CatchupSimulation catchupSimulation{
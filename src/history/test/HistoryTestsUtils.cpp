@@ -68,6 +68,23 @@ TmpDirHistoryConfigurator::configure(Config& cfg, bool writable) const
     return cfg;
 }
 
+Config&
+LocalDirHistoryConfigurator::configure(Config& cfg, bool writable) const
+{
+    std::string d = getArchiveDirName();
+    cfg.HISTORY[d] = HistoryArchiveConfiguration{d, "", "", "", d, writable};
+    cfg.TESTING_SOROBAN_HIGH_LIMIT_OVERRIDE = true;
+    return cfg;
+}
+
+Config&
+StreamingHistoryConfigurator::configure(Config& cfg, bool writable) const
+{
+    TmpDirHistoryConfigurator::configure(cfg, writable);
+    cfg.STREAM_HISTORY_CHECKPOINTS = writable;
+    return cfg;
+}
+
 MultiArchiveHistoryConfigurator::MultiArchiveHistoryConfigurator(
     uint32_t numArchives)
 {
@@ -408,6 +425,13 @@ CatchupSimulation::getLastCheckpointLedger(uint32_t checkpointIndex) const
            1;
 }
 
+LedgerCloseData const&
+CatchupSimulation::getLedgerCloseData(uint32_t ledger) const
+{
+    // Generated ledgers start at ledger 2
+    return mLedgerCloseDatas.at(ledger - 2);
+}
+
 void
 CatchupSimulation::generateRandomLedger(uint32_t version)
 {
@@ -424,17 +448,24 @@ CatchupSimulation::generateRandomLedger(uint32_t version)
     auto carol = TestAccount{mApp, getAccount("carol")};
     auto eve = TestAccount{mApp, getAccount("eve")};
     auto stroopy = TestAccount{mApp, getAccount("stroopy")};
+    auto dave = TestAccount{mApp, getAccount("dave")};
 
     std::vector<TransactionFrameBasePtr> txs;
     std::vector<TransactionFrameBasePtr> sorobanTxs;
     bool check = false;
+    size_t failedTxs = 0;
 
     if (ledgerSeq < 5)
     {
-        txs.push_back(root.tx(
-            {createAccount(alice, big), createAccount(bob, big),
-             createAccount(carol, big), createAccount(stroopy, big * 10),
-             createAccount(eve, big * 10)}));
+        std::vector<Operation> ops = {
+            createAccount(alice, big), createAccount(bob, big),
+            createAccount(carol, big), createAccount(stroopy, big * 10),
+            createAccount(eve, big * 10)};
+        if (mGenerateFailedTxs && ledgerSeq == 2)
+        {
+            ops.emplace_back(createAccount(dave, big));
+        }
+        txs.push_back(root.tx(ops));
     }
     // Allow an occasional empty ledger (but always have some transactions in
     // the upgrade ledger)
@@ -478,6 +509,13 @@ CatchupSimulation::generateRandomLedger(uint32_t version)
             txs.push_back(carol.tx({payment(bob, small)}));
         }
 
+        if (mGenerateFailedTxs)
+        {
+            // Underfunded, so it fails after passing validation
+            txs.push_back(dave.tx({payment(alice, big * 10)}));
+            ++failedTxs;
+        }
+
         // Add soroban transactions
         if (protocolVersionStartsFrom(
                 lm.getLastClosedLedgerHeader().header.ledgerVersion,
@@ -535,7 +573,8 @@ CatchupSimulation::generateRandomLedger(uint32_t version)
     {
         // Make sure all classic transactions and at least some Soroban
         // transactions succeeded
-        REQUIRE(txsSucceeded.count() > lastSucceeded + phases[0].size());
+        REQUIRE(txsSucceeded.count() >
+                lastSucceeded + phases[0].size() - failedTxs);
     }
 
     auto const& lclh = lm.getLastClosedLedgerHeader();
@@ -568,6 +607,19 @@ CatchupSimulation::generateRandomLedger(uint32_t version)
     stroopySeqs.push_back(stroopy.loadSequenceNumber());
 }
 
+void
+CatchupSimulation::setGenerateFailedTransactions()
+{
+    REQUIRE(mLedgerSeqs.empty());
+    mGenerateFailedTxs = true;
+}
+
+void
+CatchupSimulation::setHistoryCacheDir(std::string const& dir)
+{
+    mHistoryCacheDir = dir;
+}
+
 void
 CatchupSimulation::setUpgradeLedger(uint32_t ledger,
                                     ProtocolVersion upgradeProtocolVersion)
@@ -710,7 +762,8 @@ CatchupSimulation::crankUntil(Application::pointer app,
 Application::pointer
 CatchupSimulation::createCatchupApplication(
     uint32_t count, Config::TestDbMode dbMode, std::string const& appName,
-    bool publish, bool useBucketListDB, std::optional<uint32_t> ledgerVersion)
+    bool publish, bool useBucketListDB, std::optional<uint32_t> ledgerVersion,
+    bool skipKnownResults)
 {
     CLOG_INFO(History, "****");
     CLOG_INFO(History, "**** Create app for catchup: '{}'", appName);
@@ -722,6 +775,8 @@ CatchupSimulation::createCatchupApplication(
         count == std::numeric_limits<uint32_t>::max();
     mCfgs.back().CATCHUP_RECENT = count;
     mCfgs.back().EXPERIMENTAL_BUCKETLIST_DB = useBucketListDB;
+    mCfgs.back().CATCHUP_SKIP_KNOWN_RESULTS = skipKnownResults;
+    mCfgs.back().HISTORY_CACHE_DIR = mHistoryCacheDir;
     if (ledgerVersion)
     {
         mCfgs.back().TESTING_UPGRADE_LEDGER_PROTOCOL_VERSION = *ledgerVersion;
@@ -76,6 +76,22 @@ class TmpDirHistoryConfigurator : public HistoryConfigurator
     Config& configure(Config& cfg, bool writable) const override;
 };
 
+// Same as TmpDirHistoryConfigurator, but accesses the archive in-process
+// instead of through commands.
+class LocalDirHistoryConfigurator : public TmpDirHistoryConfigurator
+{
+  public:
+    Config& configure(Config& cfg, bool writable) const override;
+};
+
+// Same as TmpDirHistoryConfigurator, but publishing nodes write checkpoint
+// files as ledgers close.
+class StreamingHistoryConfigurator : public TmpDirHistoryConfigurator
+{
+  public:
+    Config& configure(Config& cfg, bool writable) const override;
+};
+
 class MultiArchiveHistoryConfigurator : public HistoryConfigurator
 {
     std::vector<std::shared_ptr<TmpDirHistoryConfigurator>> mConfigurators;
@@ -211,6 +227,8 @@ class CatchupSimulation
 
     uint32_t mUpgradeLedgerSeq{0};
     ProtocolVersion mUpgradeProtocolVersion;
+    bool mGenerateFailedTxs{false};
+    std::string mHistoryCacheDir;
 
   public:
     explicit CatchupSimulation(
@@ -246,7 +264,16 @@ class CatchupSimulation
 
     uint32_t getLastCheckpointLedger(uint32_t checkpointIndex) const;
 
+    // Close data of a ledger made by generateRandomLedger
+    LedgerCloseData const& getLedgerCloseData(uint32_t ledger) const;
+
     void generateRandomLedger(uint32_t version = 0);
+    // Makes generated ledgers also contain a transaction that fails, must be
+    // called before any ledger is generated
+    void setGenerateFailedTransactions();
+    // Makes catchup applications created from now on share a history file
+    // cache in `dir`
+    void setHistoryCacheDir(std::string const& dir);
 
     void ensurePublishesComplete();
     void ensureLedgerAvailable(uint32_t targetLedger);
@@ -260,7 +287,8 @@ class CatchupSimulation
     Application::pointer createCatchupApplication(
         uint32_t count, Config::TestDbMode dbMode, std::string const& appName,
         bool publish = false, bool useBucketListDB = false,
-        std::optional<uint32_t> ledgerVersion = std::nullopt);
+        std::optional<uint32_t> ledgerVersion = std::nullopt,
+        bool skipKnownResults = false);
     bool catchupOffline(Application::pointer app, uint32_t toLedger,
                         bool extraValidation = false);
     bool catchupOnline(Application::pointer app, uint32_t initLedger,
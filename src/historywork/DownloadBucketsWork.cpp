@@ -5,10 +5,10 @@
 #include "historywork/DownloadBucketsWork.h"
 #include "bucket/BucketManager.h"
 #include "catchup/CatchupManager.h"
+#include "crypto/Hex.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryArchive.h"
 #include "historywork/GetAndUnzipRemoteFileWork.h"
-#include "historywork/VerifyBucketWork.h"
 #include "work/WorkWithCallback.h"
 #include <Tracy.hpp>
 #include <fmt/format.h>
@@ -72,21 +72,10 @@ DownloadBucketsWork::yieldMoreWork()
 
     auto hash = *mNextBucketIter;
     FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
-    auto w1 = std::make_shared<GetAndUnzipRemoteFileWork>(mApp, ft, mArchive);
+    // The bucket is verified while it is unzipped, without reading it again
+    auto w1 = std::make_shared<GetAndUnzipRemoteFileWork>(
+        mApp, ft, mArchive, BasicWork::RETRY_A_LOT, hexToBin256(hash));
 
-    auto getFileWeak = std::weak_ptr<GetAndUnzipRemoteFileWork>(w1);
-    OnFailureCallback failureCb = [getFileWeak, hash]() {
-        auto getFile = getFileWeak.lock();
-        if (getFile)
-        {
-            auto ar = getFile->getArchive();
-            if (ar)
-            {
-                CLOG_INFO(History, "Bucket {} from archive {}", hash,
-                          ar->getName());
-            }
-        }
-    };
     std::weak_ptr<DownloadBucketsWork> weak(
         std::static_pointer_cast<DownloadBucketsWork>(shared_from_this()));
     auto successCb = [weak, ft, hash](Application& app) -> bool {
@@ -102,15 +91,13 @@ DownloadBucketsWork::yieldMoreWork()
         }
         return true;
     };
-    auto w2 = std::make_shared<VerifyBucketWork>(mApp, ft.localPath_nogz(),
-                                                 hexToBin256(hash), failureCb);
-    auto w3 = std::make_shared<WorkWithCallback>(mApp, "adopt-verified-bucket",
+    auto w2 = std::make_shared<WorkWithCallback>(mApp, "adopt-verified-bucket",
                                                  successCb);
-    std::vector<std::shared_ptr<BasicWork>> seq{w1, w2, w3};
-    auto w4 = std::make_shared<WorkSequence>(
+    std::vector<std::shared_ptr<BasicWork>> seq{w1, w2};
+    auto w3 = std::make_shared<WorkSequence>(
         mApp, "download-verify-sequence-" + hash, seq);
 
     ++mNextBucketIter;
-    return w4;
+    return w3;
 }
 }
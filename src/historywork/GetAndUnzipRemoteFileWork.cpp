@@ -4,7 +4,10 @@
 
 #include "historywork/GetAndUnzipRemoteFileWork.h"
 #include "catchup/CatchupManager.h"
+#include "crypto/Hex.h"
 #include "history/HistoryArchive.h"
+#include "history/HistoryFileCache.h"
+#include "history/HistoryManager.h"
 #include "historywork/GetRemoteFileWork.h"
 #include "historywork/GunzipFileWork.h"
 #include "util/GlobalChecks.h"
@@ -17,11 +20,13 @@ namespace stellar
 
 GetAndUnzipRemoteFileWork::GetAndUnzipRemoteFileWork(
     Application& app, FileTransferInfo ft,
-    std::shared_ptr<HistoryArchive> archive, size_t retry)
+    std::shared_ptr<HistoryArchive> archive, size_t retry,
+    std::optional<uint256> expectedHash)
     : Work(app, std::string("get-and-unzip-remote-file ") + ft.remoteName(),
            retry)
     , mFt(std::move(ft))
     , mArchive(archive)
+    , mExpectedHash(expectedHash)
 {
 }
 
@@ -47,6 +52,7 @@ GetAndUnzipRemoteFileWork::doReset()
     std::remove(mFt.localPath_gz_tmp().c_str());
     mGetRemoteFileWork.reset();
     mGunzipFileWork.reset();
+    mFromCache = false;
 }
 
 void
@@ -75,15 +81,42 @@ GetAndUnzipRemoteFileWork::doWork()
     ZoneScoped;
     if (mGunzipFileWork)
     {
-        // Download completed, unzipping started
-        releaseAssert(mGetRemoteFileWork);
-        releaseAssert(mGetRemoteFileWork->getState() == State::WORK_SUCCESS);
+        // Download completed (or file found in cache), unzipping started
+        releaseAssert(mFromCache || mGetRemoteFileWork);
+        releaseAssert(mFromCache || mGetRemoteFileWork->getState() ==
+                                        State::WORK_SUCCESS);
         auto state = mGunzipFileWork->getState();
         if (state == State::WORK_SUCCESS && !fs::exists(mFt.localPath_nogz()))
         {
             CLOG_ERROR(History, "Downloading and unzipping {}: .xdr not found",
                        mFt.remoteName());
-            return State::WORK_FAILURE;
+            state = State::WORK_FAILURE;
+        }
+
+        if (auto cache = getCache())
+        {
+            if (state == State::WORK_SUCCESS)
+            {
+                // The file is verified, keep it for later catchups
+                cache->insert(getCacheKey(), mFt.localPath_gz());
+            }
+            else if (state == State::WORK_FAILURE && mFromCache)
+            {
+                // Download the file on retry
+                CLOG_WARNING(History, "Removing {} from history cache",
+                             mFt.remoteName());
+                cache->remove(getCacheKey());
+            }
+        }
+        if (state == State::WORK_FAILURE && !mFromCache)
+        {
+            // The file may not match its hash: say where it came from, as the
+            // archive is picked again on retry
+            if (auto ar = getArchive())
+            {
+                CLOG_INFO(History, "File {} from archive {}", mFt.remoteName(),
+                          ar->getName());
+            }
         }
         return state;
     }
@@ -97,14 +130,23 @@ GetAndUnzipRemoteFileWork::doWork()
             {
                 return State::WORK_FAILURE;
             }
-            mGunzipFileWork = addWork<GunzipFileWork>(mFt.localPath_gz(), false,
-                                                      BasicWork::RETRY_NEVER);
+            startGunzip();
             return State::WORK_RUNNING;
         }
         return state;
     }
     else
     {
+        auto cache = getCache();
+        if (cache && cache->fetch(getCacheKey(), mFt.localPath_gz()))
+        {
+            CLOG_DEBUG(History, "Unzipping {} from history cache",
+                       mFt.remoteName());
+            mFromCache = true;
+            startGunzip();
+            return State::WORK_RUNNING;
+        }
+
         CLOG_DEBUG(History, "Downloading and unzipping {}", mFt.remoteName());
         mGetRemoteFileWork =
             addWork<GetRemoteFileWork>(mFt.remoteName(), mFt.localPath_gz_tmp(),
@@ -113,6 +155,33 @@ GetAndUnzipRemoteFileWork::doWork()
     }
 }
 
+HistoryFileCache*
+GetAndUnzipRemoteFileWork::getCache() const
+{
+    // Only files that are verified while they are unzipped are cached
+    if (!mExpectedHash)
+    {
+        return nullptr;
+    }
+    return mApp.getHistoryManager().getFileCache();
+}
+
+std::string
+GetAndUnzipRemoteFileWork::getCacheKey() const
+{
+    releaseAssert(mExpectedHash);
+    return fs::baseName(mFt.getType(), binToHex(*mExpectedHash), "xdr.gz");
+}
+
+void
+GetAndUnzipRemoteFileWork::startGunzip()
+{
+    // Keep the compressed file to add it to the cache once verified
+    mGunzipFileWork = addWork<GunzipFileWork>(
+        mFt.localPath_gz(), getCache() != nullptr, BasicWork::RETRY_NEVER,
+        mExpectedHash);
+}
+
 bool
 GetAndUnzipRemoteFileWork::validateFile()
 {
@@ -6,11 +6,15 @@
 
 #include "history/FileTransferInfo.h"
 #include "work/Work.h"
+#include "xdr/Stellar-types.h"
+
+#include <optional>
 
 namespace stellar
 {
 
 class HistoryArchive;
+class HistoryFileCache;
 class GetRemoteFileWork;
 
 class GetAndUnzipRemoteFileWork : public Work
@@ -20,16 +24,25 @@ class GetAndUnzipRemoteFileWork : public Work
 
     FileTransferInfo mFt;
     std::shared_ptr<HistoryArchive> const mArchive;
+    std::optional<uint256> const mExpectedHash;
+    bool mFromCache{false};
 
     bool validateFile();
+    HistoryFileCache* getCache() const;
+    std::string getCacheKey() const;
+    void startGunzip();
 
   public:
     // Passing `nullptr` for the archive argument will cause the work to
     // select a new readable history archive at random each time it runs /
-    // retries.
-    GetAndUnzipRemoteFileWork(Application& app, FileTransferInfo ft,
-                              std::shared_ptr<HistoryArchive> archive = nullptr,
-                              size_t retry = BasicWork::RETRY_A_LOT);
+    // retries. If `expectedHash` is set, the unzipped file is verified
+    // against it while it is unzipped, and the file is looked up in (and
+    // added to) the history file cache, if there is one.
+    GetAndUnzipRemoteFileWork(
+        Application& app, FileTransferInfo ft,
+        std::shared_ptr<HistoryArchive> archive = nullptr,
+        size_t retry = BasicWork::RETRY_A_LOT,
+        std::optional<uint256> expectedHash = std::nullopt);
     ~GetAndUnzipRemoteFileWork() = default;
     std::string getStatus() const override;
     std::shared_ptr<HistoryArchive> getArchive() const;
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/GetRemoteFileWork.h"
+#include "catchup/CatchupManager.h"
 #include "fmt/format.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryArchiveManager.h"
@@ -33,6 +34,7 @@ GetRemoteFileWork::GetRemoteFileWork(Application& app,
 CommandInfo
 GetRemoteFileWork::getCommand()
 {
+    mStartTime = std::chrono::steady_clock::now();
     mCurrentArchive = mArchive;
     if (!mCurrentArchive)
     {
@@ -41,6 +43,12 @@ GetRemoteFileWork::getCommand()
     }
     releaseAssert(mCurrentArchive);
     releaseAssert(mCurrentArchive->hasGetCmd());
+    if (mCurrentArchive->isLocal())
+    {
+        auto job = [archive = mCurrentArchive, remote = mRemote,
+                    local = mLocal]() { archive->getFileLocal(remote, local); };
+        return CommandInfo{std::string(), std::string(), job};
+    }
     auto cmdLine = mCurrentArchive->getFileCmd(mRemote, mLocal);
 
     return CommandInfo{cmdLine, std::string()};
@@ -57,7 +65,11 @@ void
 GetRemoteFileWork::onSuccess()
 {
     releaseAssert(mCurrentArchive);
-    mBytesPerSecond.Mark(fs::size(mLocal));
+    auto size = fs::size(mLocal);
+    mBytesPerSecond.Mark(size);
+    mApp.getCatchupManager().getPerformanceReport().record(
+        CatchupPerformanceReport::Stage::DOWNLOAD,
+        std::chrono::steady_clock::now() - mStartTime, size, 1);
     RunCommandWork::onSuccess();
 }
 
@@ -7,6 +7,8 @@
 #include "historywork/RunCommandWork.h"
 #include "medida/medida.h"
 
+#include <chrono>
+
 namespace stellar
 {
 
@@ -21,6 +23,7 @@ class GetRemoteFileWork : public RunCommandWork
     CommandInfo getCommand() override;
     medida::Meter& mFailuresPerSecond;
     medida::Meter& mBytesPerSecond;
+    std::chrono::steady_clock::time_point mStartTime;
 
   public:
     // Passing `nullptr` for the archive argument will cause the work to
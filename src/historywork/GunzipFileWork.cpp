@@ -3,32 +3,76 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/GunzipFileWork.h"
+#include "catchup/CatchupManager.h"
+#include "crypto/Hex.h"
+#include "crypto/SHA.h"
+#include "main/Application.h"
+#include "main/ErrorMessages.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
+#include "util/Logging.h"
+#include <chrono>
+#include <fmt/format.h>
 
 namespace stellar
 {
 
 GunzipFileWork::GunzipFileWork(Application& app, std::string const& filenameGz,
-                               bool keepExisting, size_t maxRetries)
-    : RunCommandWork(app, std::string("gunzip-file ") + filenameGz, maxRetries)
+                               bool keepExisting, size_t maxRetries,
+                               std::optional<uint256> expectedHash)
+    : RunInBackgroundWork(app, std::string("gunzip-file ") + filenameGz,
+                          "gunzip", maxRetries)
     , mFilenameGz(filenameGz)
     , mKeepExisting(keepExisting)
+    , mExpectedHash(expectedHash)
 {
     fs::checkGzipSuffix(mFilenameGz);
 }
 
-CommandInfo
-GunzipFileWork::getCommand()
+std::function<void()>
+GunzipFileWork::getJob()
 {
-    std::string cmdLine, outFile;
-    cmdLine = "gzip -d ";
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameGz.substr(0, mFilenameGz.size() - 3);
-    }
-    cmdLine += mFilenameGz;
-    return CommandInfo{cmdLine, outFile};
+    return [&report = mApp.getCatchupManager().getPerformanceReport(),
+            filenameGz = mFilenameGz, keepExisting = mKeepExisting,
+            expectedHash = mExpectedHash]() {
+        std::string filenameNoGz = filenameGz.substr(0, filenameGz.size() - 3);
+        SHA256 hasher;
+        std::chrono::nanoseconds hashDuration{0};
+        auto start = std::chrono::steady_clock::now();
+        gunzipFile(filenameGz, filenameNoGz,
+                   expectedHash ? &hasher : nullptr, &hashDuration);
+        auto size = fs::size(filenameNoGz);
+        // Hashing is accounted to verification, as for buckets that are
+        // verified on their own
+        report.record(CatchupPerformanceReport::Stage::DECOMPRESS,
+                      std::chrono::steady_clock::now() - start - hashDuration,
+                      size, 1);
+        if (expectedHash)
+        {
+            report.record(CatchupPerformanceReport::Stage::VERIFY,
+                          hashDuration, size, 0);
+            auto hash = hasher.finish();
+            if (hash != *expectedHash)
+            {
+                CLOG_WARNING(History, "FAILED verifying hash for {}",
+                             filenameNoGz);
+                CLOG_WARNING(History, "expected hash: {}",
+                             binToHex(*expectedHash));
+                CLOG_WARNING(History, "computed hash: {}", binToHex(hash));
+                CLOG_WARNING(History, "{}", POSSIBLY_CORRUPTED_HISTORY);
+                std::remove(filenameNoGz.c_str());
+                throw std::runtime_error(fmt::format(
+                    FMT_STRING("Hash mismatch for {}"), filenameNoGz));
+            }
+            CLOG_DEBUG(History, "Verified hash ({}) for {}",
+                       hexAbbrev(hash), filenameNoGz);
+        }
+        // Like `gzip -d`, replace the compressed file unless asked to keep it
+        if (!keepExisting)
+        {
+            std::remove(filenameGz.c_str());
+        }
+    };
 }
 
 void
@@ -36,5 +80,6 @@ GunzipFileWork::onReset()
 {
     std::string filenameNoGz = mFilenameGz.substr(0, mFilenameGz.size() - 3);
     std::remove(filenameNoGz.c_str());
+    RunInBackgroundWork::onReset();
 }
 }
@@ -4,21 +4,28 @@
 
 #pragma once
 
-#include "historywork/RunCommandWork.h"
+#include "work/RunInBackgroundWork.h"
+#include "xdr/Stellar-types.h"
+
+#include <optional>
 
 namespace stellar
 {
 
-class GunzipFileWork : public RunCommandWork
+class GunzipFileWork : public RunInBackgroundWork
 {
     std::string const mFilenameGz;
     bool const mKeepExisting;
-    CommandInfo getCommand() override;
+    std::optional<uint256> const mExpectedHash;
+    std::function<void()> getJob() override;
 
   public:
+    // If `expectedHash` is set, the work fails unless the SHA-256 of the
+    // decompressed file matches it. The hash is computed while decompressing.
     GunzipFileWork(Application& app, std::string const& filenameGz,
                    bool keepExisting = false,
-                   size_t maxRetries = Work::RETRY_NEVER);
+                   size_t maxRetries = Work::RETRY_NEVER,
+                   std::optional<uint256> expectedHash = std::nullopt);
     ~GunzipFileWork() = default;
 
   protected:
@@ -4,14 +4,15 @@
 
 #include "historywork/GzipFileWork.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
 
 namespace stellar
 {
 
 GzipFileWork::GzipFileWork(Application& app, std::string const& filenameNoGz,
                            bool keepExisting)
-    : RunCommandWork(app, std::string("gzip-file ") + filenameNoGz,
-                     BasicWork::RETRY_A_LOT)
+    : RunInBackgroundWork(app, std::string("gzip-file ") + filenameNoGz,
+                          "gzip", BasicWork::RETRY_A_LOT)
     , mFilenameNoGz(filenameNoGz)
     , mKeepExisting(keepExisting)
 {
@@ -23,20 +24,19 @@ GzipFileWork::onReset()
 {
     std::string filenameGz = mFilenameNoGz + ".gz";
     std::remove(filenameGz.c_str());
+    RunInBackgroundWork::onReset();
 }
 
-CommandInfo
-GzipFileWork::getCommand()
+std::function<void()>
+GzipFileWork::getJob()
 {
-    std::string cmdLine = "gzip ";
-    std::string outFile;
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameNoGz + ".gz";
-    }
-    cmdLine += mFilenameNoGz;
-
-    return CommandInfo{cmdLine, outFile};
+    return [filenameNoGz = mFilenameNoGz, keepExisting = mKeepExisting]() {
+        gzipFile(filenameNoGz, filenameNoGz + ".gz");
+        // Like `gzip`, replace the original file unless asked to keep it
+        if (!keepExisting)
+        {
+            std::remove(filenameNoGz.c_str());
+        }
+    };
 }
 }
@@ -24,7 +24,14 @@ CommandInfo
 MakeRemoteDirWork::getCommand()
 {
     std::string cmdLine;
-    if (mArchive->hasMkdirCmd())
+    if (mArchive->isLocal() && mArchive->hasMkdirCmd())
+    {
+        auto job = [archive = mArchive, dir = mDir]() {
+            archive->mkdirLocal(dir);
+        };
+        return CommandInfo{cmdLine, std::string(), job};
+    }
+    else if (mArchive->hasMkdirCmd())
     {
         cmdLine = mArchive->mkdirCmd(mDir);
     }
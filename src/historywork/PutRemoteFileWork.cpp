@@ -25,6 +25,13 @@ PutRemoteFileWork::PutRemoteFileWork(Application& app, std::string const& local,
 CommandInfo
 PutRemoteFileWork::getCommand()
 {
+    if (mArchive->isLocal())
+    {
+        auto job = [archive = mArchive, local = mLocal, remote = mRemote]() {
+            archive->putFileLocal(local, remote);
+        };
+        return CommandInfo{std::string(), std::string(), job};
+    }
     auto cmdLine = mArchive->putFileCmd(mLocal, mRemote);
     return CommandInfo{cmdLine, std::string()};
 }
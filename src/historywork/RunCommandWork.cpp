@@ -5,6 +5,7 @@
 #include "historywork/RunCommandWork.h"
 #include "main/Application.h"
 #include "process/ProcessManager.h"
+#include "util/Logging.h"
 #include <Tracy.hpp>
 
 namespace stellar
@@ -29,7 +30,12 @@ RunCommandWork::onRun()
         CommandInfo commandInfo = getCommand();
         auto cmd = commandInfo.mCommand;
         auto outfile = commandInfo.mOutFile;
-        if (!cmd.empty())
+        if (commandInfo.mJob)
+        {
+            runJob(commandInfo.mJob);
+            return State::WORK_WAITING;
+        }
+        else if (!cmd.empty())
         {
             mExitEvent = mApp.getProcessManager().runProcess(cmd, outfile);
             auto exit = mExitEvent.lock();
@@ -58,6 +64,48 @@ RunCommandWork::onRun()
     }
 }
 
+void
+RunCommandWork::runJob(std::function<void()> job)
+{
+    std::weak_ptr<RunCommandWork> weak(
+        std::static_pointer_cast<RunCommandWork>(shared_from_this()));
+    auto name = getName();
+    Application& app = mApp;
+    mJobRunning = true;
+    app.postOnBackgroundThread(
+        [&app, job, name, weak]() {
+            asio::error_code ec;
+            try
+            {
+                job();
+            }
+            catch (std::exception const& e)
+            {
+                CLOG_WARNING(Work, "{} failed: {}", name, e.what());
+                ec = std::make_error_code(std::errc::io_error);
+            }
+
+            // BasicWork's state is not thread-safe, so it is only updated on
+            // the main thread
+            app.postOnMainThread(
+                [weak, ec]() {
+                    auto self = weak.lock();
+                    if (self)
+                    {
+                        self->mJobRunning = false;
+                        self->mEc = ec;
+                        self->mDone = true;
+                        if (!self->isAborting())
+                        {
+                            self->wakeUp();
+                        }
+                    }
+                },
+                "RunCommandWork: finish job");
+        },
+        "RunCommandWork: start job");
+}
+
 void
 RunCommandWork::onReset()
 {
@@ -70,6 +118,11 @@ bool
 RunCommandWork::onAbort()
 {
     ZoneScoped;
+    if (mJobRunning)
+    {
+        // The job can't be interrupted, wait for it to finish
+        return false;
+    }
     auto process = mExitEvent.lock();
     if (!process)
     {
@@ -7,27 +7,35 @@
 #include "process/ProcessManager.h"
 #include "work/Work.h"
 
+#include <functional>
+
 namespace stellar
 {
 struct CommandInfo
 {
     std::string mCommand;
     std::string mOutFile;
+    // If set, run in-process on a background thread instead of `mCommand`.
+    // It must not refer to the work, and signals failure by throwing.
+    std::function<void()> mJob;
 };
 
 /**
  * This class helps run various commands, that require
- * process spawning. This work is not scheduled while it's
- * waiting for a process to exit, and wakes up when it's ready
- * to be scheduled again.
+ * process spawning (or an equivalent in-process job). This work is not
+ * scheduled while it's waiting for a process to exit, and wakes up when
+ * it's ready to be scheduled again.
  */
 class RunCommandWork : public BasicWork
 {
     bool mDone{false};
+    bool mJobRunning{false};
     asio::error_code mEc;
     virtual CommandInfo getCommand() = 0;
     std::weak_ptr<ProcessExitEvent> mExitEvent;
 
+    void runJob(std::function<void()> job);
+
   public:
     RunCommandWork(Application& app, std::string const& name,
                    size_t maxRetries = BasicWork::RETRY_A_FEW);
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/VerifyBucketWork.h"
+#include "catchup/CatchupManager.h"
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
 #include "main/Application.h"
@@ -12,9 +13,8 @@
 #include <fmt/format.h>
 
 #include <Tracy.hpp>
-#include <medida/meter.h>
-#include <medida/metrics_registry.h>
 
+#include <chrono>
 #include <fstream>
 
 namespace stellar
@@ -24,108 +24,54 @@ VerifyBucketWork::VerifyBucketWork(Application& app,
                                    std::string const& bucketFile,
                                    uint256 const& hash,
                                    OnFailureCallback failureCb)
-    : BasicWork(app, "verify-bucket-hash-" + bucketFile, BasicWork::RETRY_NEVER)
+    : RunInBackgroundWork(app, "verify-bucket-hash-" + bucketFile,
+                          "verify-bucket", BasicWork::RETRY_NEVER)
     , mBucketFile(bucketFile)
     , mHash(hash)
     , mOnFailure(failureCb)
 {
 }
 
-BasicWork::State
-VerifyBucketWork::onRun()
+std::function<void()>
+VerifyBucketWork::getJob()
 {
-    ZoneScoped;
-    if (mDone)
-    {
-        if (mEc)
+    return [&report = mApp.getCatchupManager().getPerformanceReport(),
+            filename = mBucketFile, hash = mHash]() {
+        ZoneNamedN(verifyZone, "bucket verify", true);
+        CLOG_INFO(History, "Verifying bucket {}", binToHex(hash));
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t bytes = 0;
+        SHA256 hasher;
+        std::ifstream in(filename, std::ifstream::binary);
+        if (!in)
         {
-            return State::WORK_FAILURE;
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Error opening file {}"), filename));
         }
-        return State::WORK_SUCCESS;
-    }
-
-    spawnVerifier();
-    return State::WORK_WAITING;
-}
-
-void
-VerifyBucketWork::spawnVerifier()
-{
-    std::string filename = mBucketFile;
-    uint256 hash = mHash;
-    Application& app = this->mApp;
-    std::weak_ptr<VerifyBucketWork> weak(
-        std::static_pointer_cast<VerifyBucketWork>(shared_from_this()));
-    app.postOnBackgroundThread(
-        [&app, filename, weak, hash]() {
-            SHA256 hasher;
-            asio::error_code ec;
-
-            // No point in verifying buckets if things are shutting down
-            auto self = weak.lock();
-            if (!self || self->isAborting())
-            {
-                return;
-            }
-
-            try
-            {
-                ZoneNamedN(verifyZone, "bucket verify", true);
-                CLOG_INFO(History, "Verifying bucket {}", binToHex(hash));
-
-                // ensure that the stream gets its own scope to avoid race with
-                // main thread
-                std::ifstream in(filename, std::ifstream::binary);
-                if (!in)
-                {
-                    throw std::runtime_error(fmt::format(
-                        FMT_STRING("Error opening file {}"), filename));
-                }
-                in.exceptions(std::ios::badbit);
-                char buf[4096];
-                while (in)
-                {
-                    in.read(buf, sizeof(buf));
-                    hasher.add(ByteSlice(buf, in.gcount()));
-                }
-                uint256 vHash = hasher.finish();
-                if (vHash == hash)
-                {
-                    CLOG_DEBUG(History, "Verified hash ({}) for {}",
-                               hexAbbrev(hash), filename);
-                }
-                else
-                {
-                    CLOG_WARNING(History, "FAILED verifying hash for {}",
-                                 filename);
-                    CLOG_WARNING(History, "expected hash: {}", binToHex(hash));
-                    CLOG_WARNING(History, "computed hash: {}", binToHex(vHash));
-                    CLOG_WARNING(History, "{}", POSSIBLY_CORRUPTED_HISTORY);
-                    ec = std::make_error_code(std::errc::io_error);
-                }
-            }
-            catch (std::exception const& e)
-            {
-                CLOG_WARNING(History, "Failed verification : {}", e.what());
-                ec = std::make_error_code(std::errc::io_error);
-            }
-
-            // Not ideal, but needed to prevent race conditions with
-            // main thread, since BasicWork's state is not thread-safe. This is
-            // a temporary workaround, as a cleaner solution is needed.
-            app.postOnMainThread(
-                [weak, ec]() {
-                    auto self = weak.lock();
-                    if (self)
-                    {
-                        self->mEc = ec;
-                        self->mDone = true;
-                        self->wakeUp();
-                    }
-                },
-                "VerifyBucket: finish");
-        },
-        "VerifyBucket: start in background");
+        in.exceptions(std::ios::badbit);
+        char buf[4096];
+        while (in)
+        {
+            in.read(buf, sizeof(buf));
+            hasher.add(ByteSlice(buf, in.gcount()));
+            bytes += in.gcount();
+        }
+        uint256 vHash = hasher.finish();
+        report.record(CatchupPerformanceReport::Stage::VERIFY,
+                      std::chrono::steady_clock::now() - start, bytes, 0);
+        if (vHash != hash)
+        {
+            CLOG_WARNING(History, "FAILED verifying hash for {}", filename);
+            CLOG_WARNING(History, "expected hash: {}", binToHex(hash));
+            CLOG_WARNING(History, "computed hash: {}", binToHex(vHash));
+            CLOG_WARNING(History, "{}", POSSIBLY_CORRUPTED_HISTORY);
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Hash mismatch for {}"), filename));
+        }
+        CLOG_DEBUG(History, "Verified hash ({}) for {}", hexAbbrev(hash),
+                   filename);
+    };
 }
 
 void
@@ -4,29 +4,18 @@
 
 #pragma once
 
-#include "work/Work.h"
+#include "work/RunInBackgroundWork.h"
 #include "xdr/Stellar-types.h"
 
-namespace medida
-{
-class Meter;
-}
-
 namespace stellar
 {
 
-class Bucket;
-
-class VerifyBucketWork : public BasicWork
+class VerifyBucketWork : public RunInBackgroundWork
 {
     std::string mBucketFile;
     uint256 mHash;
-    bool mDone{false};
-    std::error_code mEc;
-
-    void spawnVerifier();
-
     OnFailureCallback mOnFailure;
+    std::function<void()> getJob() override;
 
   public:
     VerifyBucketWork(Application& app, std::string const& bucketFile,
@@ -34,12 +23,6 @@ class VerifyBucketWork : public BasicWork
     ~VerifyBucketWork() = default;
 
   protected:
-    BasicWork::State onRun() override;
-    bool
-    onAbort() override
-    {
-        return true;
-    };
     void onFailureRaise() override;
 };
 }
@@ -6,6 +6,7 @@
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "catchup/AssumeStateWork.h"
+#include "catchup/CatchupManager.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
 #include "crypto/SHA.h"
@@ -17,6 +18,7 @@
 #include "herder/LedgerCloseData.h"
 #include "herder/TxSetFrame.h"
 #include "herder/Upgrades.h"
+#include "history/CheckpointBuilder.h"
 #include "history/HistoryManager.h"
 #include "ledger/FlushAndRotateMetaDebugWork.h"
 #include "ledger/LedgerHeaderUtils.h"
@@ -797,6 +799,7 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     LogSlowExecution closeLedgerTime{"closeLedger",
                                      LogSlowExecution::Mode::MANUAL, "",
                                      std::chrono::milliseconds::max()};
+    auto applyStart = std::chrono::steady_clock::now();
 
     LedgerTxn ltx(mApp.getLedgerTxnRoot());
     auto header = ltx.loadHeader();
@@ -905,8 +908,9 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
 
     TransactionResultSet txResultSet;
     txResultSet.results.reserve(txs.size());
-    applyTransactions(*applicableTxSet, txs, ltx, txResultSet, ledgerCloseMeta);
-    if (mApp.getConfig().MODE_STORES_HISTORY_MISC)
+    applyTransactions(*applicableTxSet, txs, ltx, txResultSet, ledgerCloseMeta,
+                      ledgerData.getExpectedResults());
+    if (storesTxHistoryInDatabase(ltx.loadHeader().current().ledgerSeq))
     {
         storeTxSet(mApp.getDatabase(), ltx.loadHeader().current().ledgerSeq,
                    *txSet);
@@ -1030,12 +1034,29 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     //
     // 5. GC unreferenced buckets. Only do this once publishes are in progress.
 
+    // Recorded only while catchup runs; writing the history of the ledger
+    // counts as part of its commit
+    auto& report = mApp.getCatchupManager().getPerformanceReport();
+    auto commitStart = std::chrono::steady_clock::now();
+    report.record(CatchupPerformanceReport::Stage::APPLY_LEDGERS,
+                  commitStart - applyStart, 0,
+                  applicableTxSet->sizeTxTotal());
+
     // step 1
     auto& hm = mApp.getHistoryManager();
+    if (auto builder = hm.getCheckpointBuilder())
+    {
+        // The checkpoint files are finished before the last ledger of the
+        // checkpoint commits; on restart, entries of uncommitted ledgers are
+        // dropped.
+        builder->appendLedger(mLastClosedLedger.header, *txSet, txResultSet);
+    }
     hm.maybeQueueHistoryCheckpoint();
 
     // step 2
     ltx.commit();
+    report.record(CatchupPerformanceReport::Stage::COMMIT,
+                  std::chrono::steady_clock::now() - commitStart, 0, 1);
 
     // step 3
     if (protocolVersionStartsFrom(initialLedgerVers,
@@ -1478,11 +1499,19 @@ LedgerManagerImpl::applyTransactions(
     ApplicableTxSetFrame const& txSet,
     std::vector<TransactionFrameBasePtr> const& txs, AbstractLedgerTxn& ltx,
     TransactionResultSet& txResultSet,
-    std::unique_ptr<LedgerCloseMetaFrame> const& ledgerCloseMeta)
+    std::unique_ptr<LedgerCloseMetaFrame> const& ledgerCloseMeta,
+    std::optional<TransactionResultSet> const& expectedResults)
 {
     ZoneNamedN(txsZone, "applyTransactions", true);
     int index = 0;
 
+    if (expectedResults && expectedResults->results.size() != txs.size())
+    {
+        throw std::runtime_error(fmt::format(
+            FMT_STRING("Expected {:d} transaction results, got {:d}"),
+            txs.size(), expectedResults->results.size()));
+    }
+
     // Record counts
     auto numTxs = txs.size();
     auto numOps = txSet.sizeOpTotal();
@@ -1505,6 +1534,8 @@ LedgerManagerImpl::applyTransactions(
     uint64_t txFailed{0};
     uint64_t sorobanTxSucceeded{0};
     uint64_t sorobanTxFailed{0};
+    auto ledgerSeq = ltx.loadHeader().current().ledgerSeq;
+    bool storeTxHistory = storesTxHistoryInDatabase(ledgerSeq);
     for (auto tx : txs)
     {
         ZoneNamedN(txZone, "applyTransaction", true);
@@ -1526,6 +1557,18 @@ LedgerManagerImpl::applyTransactions(
         }
         ++txNum;
 
+        if (expectedResults)
+        {
+            auto const& expected = expectedResults->results.at(index);
+            if (expected.transactionHash != tx->getContentsHash())
+            {
+                throw std::runtime_error(fmt::format(
+                    FMT_STRING("Expected result of transaction {:s}, got {:s}"),
+                    hexAbbrev(tx->getContentsHash()),
+                    hexAbbrev(expected.transactionHash)));
+            }
+            tx->setReplayResult(expected.result);
+        }
         tx->apply(mApp, ltx, tm, subSeed);
         tx->processPostApply(mApp, ltx, tm);
         TransactionResultPair results;
@@ -1570,9 +1613,8 @@ LedgerManagerImpl::applyTransactions(
         // txs counting from 1, not 0. We preserve this for the time being
         // in case anyone depends on it.
         ++index;
-        if (mApp.getConfig().MODE_STORES_HISTORY_MISC)
+        if (storeTxHistory)
         {
-            auto ledgerSeq = ltx.loadHeader().current().ledgerSeq;
             storeTransaction(mApp.getDatabase(), ledgerSeq, tx, tm.getXDR(),
                              txResultSet, mApp.getConfig());
         }
@@ -1630,6 +1672,16 @@ LedgerManagerImpl::storeCurrentLedger(LedgerHeader const& header,
     }
 }
 
+bool
+LedgerManagerImpl::storesTxHistoryInDatabase(uint32_t ledgerSeq)
+{
+    // Ledgers streamed to checkpoint files don't need their history in the
+    // database to be published
+    auto builder = mApp.getHistoryManager().getCheckpointBuilder();
+    return mApp.getConfig().MODE_STORES_HISTORY_MISC &&
+           !(builder && builder->streams(ledgerSeq));
+}
+
 // NB: This is a separate method so a testing subclass can override it.
 void
 LedgerManagerImpl::transferLedgerEntriesToBucketList(
@@ -17,11 +17,14 @@
 #include "bucket/Bucket.h"
 #include "bucket/BucketManager.h"
 #include "catchup/ApplyBucketsWork.h"
+#include "catchup/CatchupManager.h"
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "herder/Herder.h"
 #include "herder/HerderPersistence.h"
+#include "herder/SCPStateJournal.h"
+#include "history/CheckpointBuilder.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/HistoryArchiveReportWork.h"
 #include "history/HistoryManager.h"
@@ -392,6 +395,8 @@ void
 ApplicationImpl::newDB()
 {
     mDatabase->initialize();
+    // SCP state of the old database is not valid anymore
+    std::remove(SCPStateJournal::getPath(mConfig).c_str());
     upgradeToCurrentSchemaAndMaybeRebuildLedger(false, true);
     mLedgerManager->startNewLedger();
 }
@@ -537,6 +542,13 @@ ApplicationImpl::getJsonInfo(bool verbose)
         info["status"][counter++] = statusMessage.second;
     }
 
+    auto catchupReport =
+        getCatchupManager().getPerformanceReport().getJsonInfo();
+    if (!catchupReport.isNull())
+    {
+        info["catchup"] = catchupReport;
+    }
+
     auto& herder = getHerder();
 
     auto& quorumInfo = info["quorum"];
@@ -880,6 +892,10 @@ ApplicationImpl::start()
 
     mLedgerManager->loadLastKnownLedger(/* restoreBucketlist */ true,
                                         /* isLedgerStateReady */ true);
+    if (auto builder = getHistoryManager().getCheckpointBuilder())
+    {
+        builder->restore(mLedgerManager->getLastClosedLedgerNum());
+    }
     startServices();
 }
 
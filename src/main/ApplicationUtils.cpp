@@ -8,6 +8,7 @@
 #include "bucket/BucketManager.h"
 #include "catchup/ApplyBucketsWork.h"
 #include "catchup/CatchupConfiguration.h"
+#include "catchup/CatchupRange.h"
 #include "crypto/Hex.h"
 #include "database/Database.h"
 #include "herder/Herder.h"
@@ -15,6 +16,7 @@
 #include "history/HistoryArchive.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/HistoryArchiveReportWork.h"
+#include "history/HistoryManager.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
 #include "invariant/BucketListIsConsistentWithDatabase.h"
 #include "ledger/LedgerHeaderUtils.h"
@@ -25,7 +27,9 @@
 #include "main/PersistentState.h"
 #include "main/StellarCoreVersion.h"
 #include "overlay/OverlayManager.h"
+#include "process/ProcessManager.h"
 #include "scp/LocalNode.h"
+#include "util/Fs.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include "util/XDRCereal.h"
@@ -34,6 +38,7 @@
 
 #include <charconv>
 #include <filesystem>
+#include <fstream>
 #include <lib/http/HttpClient.h>
 #include <locale>
 #include <map>
@@ -1112,9 +1117,147 @@ catchup(Application::pointer app, CatchupConfiguration cc,
     LOG_INFO(DEFAULT_LOG, "*");
 
     catchupInfo = app->getJsonInfo(true);
+    auto start = app->getCatchupManager().getVerifiedLedgerRangeStart();
+    if (start)
+    {
+        catchupInfo["catchup_start"]["num"] = start->header.ledgerSeq;
+        catchupInfo["catchup_start"]["hash"] = binToHex(start->hash);
+    }
     return synced ? 0 : 3;
 }
 
+int
+segmentedCatchup(Config cfg, CatchupConfiguration cc, uint32_t segments,
+                 std::string const& workDir, std::string const& childCommand,
+                 std::string const& trustedHash, bool trustedCheckpoints,
+                 Json::Value& catchupInfo)
+{
+    if (!fs::mkpath(workDir))
+    {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("Could not create {}"), workDir));
+    }
+
+    // The coordinator only needs the history configuration and a process
+    // manager, the segments catch up in their own directories
+    cfg.setNoListen();
+    cfg.DATABASE = SecretValue{"sqlite3://:memory:"};
+    cfg.BUCKET_DIR_PATH = workDir + "/coordinator-buckets";
+    cfg.METADATA_OUTPUT_STREAM = "";
+    cfg.MAX_CONCURRENT_SUBPROCESSES =
+        std::max<size_t>(cfg.MAX_CONCURRENT_SUBPROCESSES, segments);
+    VirtualClock clock(VirtualClock::REAL_TIME);
+    auto app = Application::create(clock, cfg, true);
+    auto& hm = app->getHistoryManager();
+
+    CatchupRange range(LedgerManager::GENESIS_LEDGER_SEQ, cc, hm);
+    auto ends = range.getSegmentEnds(segments, hm);
+    uint32_t first =
+        range.replayLedgers() ? range.getReplayFirst() - 1 : range.first();
+
+    size_t running = 0;
+    bool failed = false;
+    std::vector<std::string> outputs;
+    for (size_t i = 0; i < ends.size(); ++i)
+    {
+        auto start = i == 0 ? first : ends[i - 1];
+        auto dir = fmt::format(FMT_STRING("{}/segment-{}"), workDir, i);
+        outputs.emplace_back(dir + ".json");
+        auto cmd = fmt::format(
+            FMT_STRING("{} {}/{} --work-dir \"{}\" --output-file \"{}\""),
+            childCommand, ends[i], ends[i] - start, dir, outputs.back());
+        if (i + 1 == ends.size() && !trustedHash.empty())
+        {
+            cmd += " --trusted-hash " + trustedHash;
+        }
+        else if (!trustedCheckpoints)
+        {
+            // Only the last segment is anchored to the trusted hash, the
+            // others are anchored to it by the boundary checks below
+            cmd += " --force-untrusted-catchup";
+        }
+
+        LOG_INFO(DEFAULT_LOG, "Catching up ledgers {}-{} in {}", start + 1,
+                 ends[i], dir);
+        auto exit = app->getProcessManager().runProcess(cmd, dir + ".log");
+        auto ev = exit.lock();
+        releaseAssert(ev);
+        ++running;
+        ev->async_wait([&running, &failed, dir](asio::error_code ec) {
+            --running;
+            if (ec)
+            {
+                LOG_ERROR(DEFAULT_LOG, "Catchup in {} failed, see {}.log", dir,
+                          dir);
+                failed = true;
+            }
+        });
+    }
+
+    asio::io_context::work mainWork(clock.getIOContext());
+    while (running > 0 && clock.crank(true))
+    {
+    }
+
+    // Each segment must end on the ledger the next one was bootstrapped from
+    catchupInfo = Json::Value{};
+    auto& segmentsInfo = catchupInfo["segments"];
+    segmentsInfo = Json::arrayValue;
+    std::string prevHash;
+    for (size_t i = 0; !failed && i < ends.size(); ++i)
+    {
+        Json::Value root;
+        Json::Reader rdr;
+        std::ifstream in(outputs[i]);
+        if (!in || !rdr.parse(in, root))
+        {
+            LOG_ERROR(DEFAULT_LOG, "Could not read catchup info {}",
+                      outputs[i]);
+            failed = true;
+            break;
+        }
+
+        auto const& ledger = root["info"]["ledger"];
+        auto const& start = root["catchup_start"];
+        if (ledger["num"].asUInt() != ends[i])
+        {
+            LOG_ERROR(DEFAULT_LOG, "Segment {} ended at ledger {}, expected {}",
+                      i, ledger["num"].asUInt(), ends[i]);
+            failed = true;
+        }
+        else if (i > 0 && (start["num"].asUInt() != ends[i - 1] ||
+                           start["hash"].asString() != prevHash))
+        {
+            LOG_ERROR(DEFAULT_LOG,
+                      "Segment {} started from ledger {} ({}), but segment {} "
+                      "ended at ledger {} ({})",
+                      i, start["num"].asUInt(), start["hash"].asString(),
+                      i - 1, ends[i - 1], prevHash);
+            failed = true;
+        }
+        prevHash = ledger["hash"].asString();
+
+        Json::Value segment;
+        segment["to"] = ends[i];
+        segment["hash"] = prevHash;
+        segment["output"] = outputs[i];
+        segmentsInfo.append(segment);
+        catchupInfo["info"] = root["info"];
+    }
+
+    LOG_INFO(DEFAULT_LOG, "*");
+    if (failed)
+    {
+        LOG_INFO(DEFAULT_LOG, "* Segmented catchup failed.");
+    }
+    else
+    {
+        LOG_INFO(DEFAULT_LOG, "* Segmented catchup finished.");
+    }
+    LOG_INFO(DEFAULT_LOG, "*");
+    return failed ? 3 : 0;
+}
+
 int
 publish(Application::pointer app)
 {
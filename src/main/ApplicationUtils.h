@@ -54,6 +54,16 @@ void writeCatchupInfo(Json::Value const& catchupInfo,
                       std::string const& outputFile);
 int catchup(Application::pointer app, CatchupConfiguration cc,
             Json::Value& catchupInfo, std::shared_ptr<HistoryArchive> archive);
+// Split the catchup into at most `segments` checkpoint-aligned segments and
+// replay them concurrently, each in a child process running `childCommand`
+// with its own database and buckets under `workDir`. Every segment after the
+// first starts from the buckets published at the end of the previous one,
+// whose final ledger hash must match the start it was bootstrapped from.
+int segmentedCatchup(Config cfg, CatchupConfiguration cc, uint32_t segments,
+                     std::string const& workDir,
+                     std::string const& childCommand,
+                     std::string const& trustedHash, bool trustedCheckpoints,
+                     Json::Value& catchupInfo);
 // Reduild ledger state based on the buckets. Ensure ledger state is properly
 // reset before calling this function.
 bool applyBucketsForLCL(Application& app);
@@ -6,6 +6,7 @@
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
 #include "herder/Herder.h"
+#include "herder/TxFrameInternTable.h"
 #include "history/HistoryArchiveManager.h"
 #include "ledger/InternalLedgerEntry.h"
 #include "ledger/LedgerManager.h"
@@ -984,6 +985,8 @@ CommandHandler::tx(std::string const& params, std::string& retStr)
             mApp.getNetworkID(), envelope);
         if (transaction)
         {
+            transaction =
+                mApp.getHerder().getTxFrameInternTable().intern(transaction);
             // Add it to our current set and make sure it is valid.
             TransactionQueue::AddResult status =
                 mApp.getHerder().recvTransaction(transaction, true);
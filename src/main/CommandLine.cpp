@@ -13,6 +13,7 @@
 #include "catchup/CatchupRange.h"
 #include "catchup/ReplayDebugMetaWork.h"
 #include "herder/Herder.h"
+#include "herder/SCPMessageRecording.h"
 #include "history/HistoryArchiveManager.h"
 #include "historywork/BatchDownloadWork.h"
 #include "historywork/WriteVerifiedCheckpointHashesWork.h"
@@ -30,6 +31,7 @@
 #include "rust/RustBridge.h"
 #include "scp/QuorumSetUtils.h"
 #include "transactions/TransactionUtils.h"
+#include "util/Fs.h"
 #include "util/Logging.h"
 #include "util/types.h"
 #include "work/WorkScheduler.h"
@@ -413,6 +415,14 @@ startAtHashParser(std::string& startAtHash)
         "start in-memory run with replay from historical ledger hash");
 }
 
+clara::Opt
+recordSCPParser(std::string& recordSCP)
+{
+    return clara::Opt{recordSCP, "FILE-NAME"}["--record-scp"](
+        "record the SCP messages received from peers to a file, to replay "
+        "with replay-scp");
+}
+
 clara::Opt
 filterQueryParser(std::optional<std::string>& filterQuery)
 {
@@ -768,6 +778,56 @@ runReplayDebugMeta(CommandLineArgs const& args)
         });
 }
 
+int
+runReplaySCP(CommandLineArgs const& args)
+{
+    CommandLine::ConfigOption configOption;
+    std::string file;
+    double speed = 1.0;
+
+    return runWithHelp(
+        args,
+        {configurationParser(configOption),
+         clara::Opt{file, "FILE-NAME"}["--file"](
+             "SCP recording made with run --record-scp")
+             .required(),
+         clara::Opt{speed, "SPEED"}["--speed"](
+             "replay speed relative to the recording, 0 to replay as fast as "
+             "possible (default 1)")},
+        [&] {
+            if (speed < 0)
+            {
+                LOG_ERROR(DEFAULT_LOG, "--speed can't be negative");
+                return 1;
+            }
+
+            VirtualClock clock(VirtualClock::REAL_TIME);
+            auto cfg = configOption.getConfig();
+
+            // Replay without networking, as a watcher, so that the only
+            // consensus messages are the recorded ones.
+            cfg.setNoListen();
+            cfg.RUN_STANDALONE = true;
+            cfg.NODE_IS_VALIDATOR = false;
+            cfg.FORCE_SCP = false;
+            cfg.MANUAL_CLOSE = false;
+            cfg.AUTOMATIC_SELF_CHECK_PERIOD = std::chrono::seconds::zero();
+
+            auto app = Application::create(clock, cfg, false);
+            app->start();
+
+            SCPMessageReplayer replayer(*app, file, speed);
+            replayer.start();
+            while (!replayer.isDone() && clock.crank(true))
+            {
+            }
+
+            LOG_INFO(DEFAULT_LOG, "Replay finished");
+            std::cout << replayer.getReport().toStyledString() << std::endl;
+            return 0;
+        });
+}
+
 int
 runCatchup(CommandLineArgs const& args)
 {
@@ -782,6 +842,9 @@ runCatchup(CommandLineArgs const& args)
     bool forceUntrusted = false;
     std::string hash;
     std::string stream;
+    std::string workDir;
+    uint32_t segments = 1;
+    bool skipKnownResults = false;
 
     auto validateCatchupString = [&] {
         try
@@ -832,6 +895,50 @@ runCatchup(CommandLineArgs const& args)
             "historical data");
     };
 
+    auto skipKnownResultsParser = [&] {
+        return ParserWithValidation{
+            clara::Opt{skipKnownResults}["--skip-known-results"](
+                "verify transaction results first (implies "
+                "--extra-verification), then use them to skip signature checks "
+                "and failed transactions while replaying"),
+            [&] {
+                // Meta is only streamed from full replays
+                if (skipKnownResults && !stream.empty())
+                {
+                    return std::string{"--skip-known-results can't be "
+                                       "combined with "
+                                       "--metadata-output-stream"};
+                }
+                return std::string{};
+            }};
+    };
+
+    auto workDirParser = [](std::string& dir) {
+        return clara::Opt{dir, "DIR-NAME"}["--work-dir"](
+            "catch up into a new database and bucket directory in DIR-NAME "
+            "instead of the configured ones");
+    };
+
+    auto validateSegments = [&] {
+        if (segments == 0)
+        {
+            return std::string{"--segments must be at least 1"};
+        }
+        if (segments > 1 &&
+            (workDir.empty() || inMemory || forceBack || !stream.empty()))
+        {
+            return std::string{
+                "--segments requires --work-dir and can't be combined with "
+                "--in-memory, --force-back or --metadata-output-stream"};
+        }
+        return std::string{};
+    };
+    auto segmentsParser = ParserWithValidation{
+        clara::Opt{segments, "SEGMENTS"}["--segments"](
+            "replay the range as this many segments in parallel, each in its "
+            "own subdirectory of --work-dir"),
+        validateSegments};
+
     return runWithHelp(
         args,
         {configurationParser(configOption), catchupStringParser,
@@ -840,7 +947,9 @@ runCatchup(CommandLineArgs const& args)
          outputFileParser(outputFile), disableBucketGCParser(disableBucketGC),
          validationParser(completeValidation), inMemoryParser(inMemory),
          ledgerHashParser(hash), forceUntrustedCatchup(forceUntrusted),
-         metadataOutputStreamParser(stream), forceBackParser(forceBack)},
+         metadataOutputStreamParser(stream), forceBackParser(forceBack),
+         workDirParser(workDir), segmentsParser,
+         skipKnownResultsParser()},
         [&] {
             auto config = configOption.getConfig();
             // Don't call config.setNoListen() here as we might want to
@@ -848,6 +957,32 @@ runCatchup(CommandLineArgs const& args)
             config.RUN_STANDALONE = true;
             config.MANUAL_CLOSE = true;
             config.DISABLE_BUCKET_GC = disableBucketGC;
+            config.CATCHUP_SKIP_KNOWN_RESULTS = skipKnownResults;
+            if (skipKnownResults)
+            {
+                completeValidation = true;
+            }
+
+            bool newDB = inMemory;
+            if (!workDir.empty() && segments == 1)
+            {
+                if (inMemory)
+                {
+                    throw std::runtime_error(
+                        "--work-dir can't be combined with --in-memory");
+                }
+                if (!fs::mkpath(workDir))
+                {
+                    throw std::runtime_error("Could not create " + workDir);
+                }
+                // Several catchups may run from the same configuration, so
+                // don't open any port
+                config.setNoListen();
+                config.DATABASE = SecretValue{fmt::format(
+                    FMT_STRING("sqlite3://{}/stellar.db"), workDir)};
+                config.BUCKET_DIR_PATH = workDir + "/buckets";
+                newDB = true;
+            }
 
             if (config.AUTOMATIC_MAINTENANCE_PERIOD.count() > 0 &&
                 config.AUTOMATIC_MAINTENANCE_COUNT > 0)
@@ -865,11 +1000,81 @@ runCatchup(CommandLineArgs const& args)
             maybeEnableInMemoryMode(config, inMemory, 0, "",
                                     /* persistMinimalData */ false);
             maybeSetMetadataOutputStream(config, stream);
+            if (skipKnownResults && !config.METADATA_OUTPUT_STREAM.empty())
+            {
+                throw std::runtime_error(
+                    "--skip-known-results can't be combined with "
+                    "METADATA_OUTPUT_STREAM");
+            }
+
+            if (segments > 1)
+            {
+                CatchupConfiguration cc =
+                    parseCatchup(catchupString, hash, completeValidation);
+                if (cc.toLedger() == CatchupConfiguration::CURRENT)
+                {
+                    throw std::runtime_error(
+                        "--segments requires a destination ledger number");
+                }
+                if (!trustedCheckpointHashesFile.empty() && !hash.empty())
+                {
+                    throw std::runtime_error(
+                        "Either --trusted-checkpoint-hashes or --trusted-hash "
+                        "should be specified, but not both");
+                }
+                if (hash.empty() && trustedCheckpointHashesFile.empty() &&
+                    !forceUntrusted)
+                {
+                    CLOG_WARNING(
+                        History,
+                        "Unsafe command: use --trusted-checkpoint-hashes or "
+                        "--trusted-hash to ensure catchup integrity. If you "
+                        "want to run untrusted catchup, use "
+                        "--force-untrusted-catchup.");
+                }
+
+                auto childCommand =
+                    fmt::format(FMT_STRING("\"{}\" catchup"), args.mExePath);
+                if (!configOption.mConfigFile.empty())
+                {
+                    childCommand += fmt::format(FMT_STRING(" --conf \"{}\""),
+                                                configOption.mConfigFile);
+                }
+                if (!archive.empty())
+                {
+                    childCommand += " --archive " + archive;
+                }
+                if (!trustedCheckpointHashesFile.empty())
+                {
+                    childCommand += fmt::format(
+                        FMT_STRING(" --trusted-checkpoint-hashes \"{}\""),
+                        trustedCheckpointHashesFile);
+                }
+                if (completeValidation)
+                {
+                    childCommand += " --extra-verification";
+                }
+                if (skipKnownResults)
+                {
+                    childCommand += " --skip-known-results";
+                }
+                if (disableBucketGC)
+                {
+                    childCommand += " --disable-bucket-gc";
+                }
+
+                Json::Value catchupInfo;
+                auto result = segmentedCatchup(
+                    config, cc, segments, workDir, childCommand, hash,
+                    !trustedCheckpointHashesFile.empty(), catchupInfo);
+                writeCatchupInfo(catchupInfo, outputFile);
+                return result;
+            }
 
             VirtualClock clock(VirtualClock::REAL_TIME);
             int result;
             {
-                auto app = Application::create(clock, config, inMemory);
+                auto app = Application::create(clock, config, newDB);
                 auto const& ham = app->getHistoryArchiveManager();
                 auto archivePtr = ham.getHistoryArchive(archive);
                 if (iequals(archive, "any"))
@@ -1502,6 +1707,7 @@ run(CommandLineArgs const& args)
     bool waitForConsensus = false;
     uint32_t startAtLedger = 0;
     std::string startAtHash;
+    std::string recordSCP;
 
     return runWithHelp(
         args,
@@ -1509,7 +1715,8 @@ run(CommandLineArgs const& args)
          disableBucketGCParser(disableBucketGC),
          metadataOutputStreamParser(stream), inMemoryParser(inMemory),
          waitForConsensusParser(waitForConsensus),
-         startAtLedgerParser(startAtLedger), startAtHashParser(startAtHash)},
+         startAtLedgerParser(startAtLedger), startAtHashParser(startAtHash),
+         recordSCPParser(recordSCP)},
         [&] {
             Config cfg;
             std::shared_ptr<VirtualClock> clock;
@@ -1536,6 +1743,7 @@ run(CommandLineArgs const& args)
                                         startAtHash,
                                         /* persistMinimalData */ true);
                 maybeSetMetadataOutputStream(cfg, stream);
+                cfg.RECORD_SCP_MESSAGES_PATH = recordSCP;
                 cfg.FORCE_SCP =
                     cfg.NODE_IS_VALIDATOR ? !waitForConsensus : false;
 
@@ -1827,6 +2035,9 @@ handleCommandLine(int argc, char* const* argv)
           runCatchup},
          {"replay-debug-meta", "apply ledgers from local debug metadata files",
           runReplayDebugMeta},
+         {"replay-scp",
+          "replay recorded SCP messages to benchmark the herder offline",
+          runReplaySCP},
          {"verify-checkpoints", "write verified checkpoint ledger hashes",
           runWriteVerifiedCheckpointHashes},
          {"convert-id", "displays ID in all known forms", runConvertId},
@@ -1898,7 +2109,7 @@ handleCommandLine(int argc, char* const* argv)
     auto commandName =
         fmt::format(FMT_STRING("{0} {1}"), exeName, command->name());
     auto args = CommandLineArgs{exeName, commandName, command->description(),
-                                adjustedCommandLine.second};
+                                adjustedCommandLine.second, argv[0]};
     if (command->name() == "run" || command->name() == "fuzz")
     {
         // run outside of catch block so that we properly capture crashes
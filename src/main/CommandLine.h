@@ -18,6 +18,8 @@ struct CommandLineArgs
     std::string mCommandName;
     std::string mCommandDescription;
     std::vector<std::string> mArgs;
+    // Path the process was started with, to start more instances of it
+    std::string mExePath;
 };
 
 int handleCommandLine(int argc, char* const* argv);
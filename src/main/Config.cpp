@@ -191,8 +191,11 @@ Config::Config() : NODE_SEED(SecretKey::random())
     FAILURE_SAFETY = -1;
     UNSAFE_QUORUM = false;
     DISABLE_BUCKET_GC = false;
+    CATCHUP_SKIP_KNOWN_RESULTS = false;
     DISABLE_XDR_FSYNC = false;
     MAX_SLOTS_TO_REMEMBER = 12;
+    TX_SET_CANDIDATE_LEAD_TIME_MS = 0;
+    NOMINATION_TX_LEDGER_MULTIPLIER = 1.5;
     // Configure MAXIMUM_LEDGER_CLOSETIME_DRIFT based on MAX_SLOTS_TO_REMEMBER
     // (plus a small buffer) to make sure we don't reject SCP state sent to us
     // by default. Limit allowed drift to 90 seconds as to not overwhelm the
@@ -203,12 +206,16 @@ Config::Config() : NODE_SEED(SecretKey::random())
                                Herder::EXP_LEDGER_TIMESPAN_SECONDS.count(),
                            CLOSETIME_DRIFT_LIMIT);
     METADATA_OUTPUT_STREAM = "";
+    RECORD_SCP_MESSAGES_PATH = "";
 
     // Store at least 1 checkpoint plus a buffer worth of debug meta
     METADATA_DEBUG_LEDGERS = 100;
 
     LOG_FILE_PATH = "stellar-core-{datetime:%Y-%m-%d_%H-%M-%S}.log";
     BUCKET_DIR_PATH = "buckets";
+    HISTORY_CACHE_DIR = "";
+    HISTORY_CACHE_MAX_SIZE_MB = 10240;
+    STREAM_HISTORY_CHECKPOINTS = false;
 
     LOG_COLOR = false;
 
@@ -258,6 +265,8 @@ Config::Config() : NODE_SEED(SecretKey::random())
     FLOW_CONTROL_SEND_MORE_BATCH_SIZE_BYTES = 0;
     OUTBOUND_TX_QUEUE_BYTE_LIMIT = 1024 * 1024 * 3;
     ENABLE_FLOW_CONTROL_BYTES = true;
+    ENABLE_ADAPTIVE_FLOW_CONTROL = false;
+    ADAPTIVE_FLOW_CONTROL_MAX_WINDOW_MULTIPLIER = 4;
 
     // WORKER_THREADS: setting this too low risks a form of priority inversion
     // where a long-running background task occupies all worker threads and
@@ -273,6 +282,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     MAX_CONCURRENT_SUBPROCESSES = 16;
     NODE_IS_VALIDATOR = false;
     QUORUM_INTERSECTION_CHECKER = true;
+    QUORUM_INTERSECTION_CHECKER_THREADS = 4;
     DATABASE = SecretValue{"sqlite3://:memory:"};
 
     ENTRY_CACHE_SIZE = 100000;
@@ -286,6 +296,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
 
     ENABLE_SOROBAN_DIAGNOSTIC_EVENTS = false;
     ENABLE_DIAGNOSTICS_FOR_TX_SUBMISSION = false;
+    BACKGROUND_TX_SIG_VERIFICATION = false;
     TESTING_MINIMUM_PERSISTENT_ENTRY_LIFETIME = 0;
     TESTING_SOROBAN_HIGH_LIMIT_OVERRIDE = false;
     OVERRIDE_EVICTION_PARAMS_FOR_TESTING = false;
@@ -545,10 +556,24 @@ Config::loadQset(std::shared_ptr<cpptoml::table> group, SCPQuorumSet& qset,
 
 void
 Config::addHistoryArchive(std::string const& name, std::string const& get,
-                          std::string const& put, std::string const& mkdir)
+                          std::string const& put, std::string const& mkdir,
+                          std::string const& path, bool writable)
 {
+    if (!path.empty() && (!get.empty() || !put.empty() || !mkdir.empty()))
+    {
+        throw std::invalid_argument(fmt::format(
+            FMT_STRING("Archive '{}' can't have both a path and commands"),
+            name));
+    }
+    if (writable && path.empty())
+    {
+        throw std::invalid_argument(fmt::format(
+            FMT_STRING("Archive '{}' can't be writable without a path"),
+            name));
+    }
     auto r = HISTORY.insert(std::make_pair(
-        name, HistoryArchiveConfiguration{name, get, put, mkdir}));
+        name,
+        HistoryArchiveConfiguration{name, get, put, mkdir, path, writable}));
     if (!r.second)
     {
         throw std::invalid_argument(
@@ -1035,6 +1060,16 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 OUTBOUND_TX_QUEUE_BYTE_LIMIT = readInt<uint32_t>(item, 1);
             }
+            else if (item.first == "ENABLE_ADAPTIVE_FLOW_CONTROL")
+            {
+                ENABLE_ADAPTIVE_FLOW_CONTROL = readBool(item);
+            }
+            else if (item.first ==
+                     "ADAPTIVE_FLOW_CONTROL_MAX_WINDOW_MULTIPLIER")
+            {
+                ADAPTIVE_FLOW_CONTROL_MAX_WINDOW_MULTIPLIER =
+                    readInt<uint32_t>(item, 1, 64);
+            }
             else if (item.first == "PEER_PORT")
             {
                 PEER_PORT = readInt<unsigned short>(item, 1);
@@ -1138,6 +1173,20 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 MAX_SLOTS_TO_REMEMBER = readInt<uint32>(item);
             }
+            else if (item.first == "TX_SET_CANDIDATE_LEAD_TIME_MS")
+            {
+                TX_SET_CANDIDATE_LEAD_TIME_MS =
+                    readInt<uint32_t>(item, 0, 5000);
+            }
+            else if (item.first == "NOMINATION_TX_LEDGER_MULTIPLIER")
+            {
+                NOMINATION_TX_LEDGER_MULTIPLIER = readDouble(item);
+                if (NOMINATION_TX_LEDGER_MULTIPLIER < 1.0)
+                {
+                    throw std::invalid_argument(
+                        "bad value for NOMINATION_TX_LEDGER_MULTIPLIER");
+                }
+            }
             else if (item.first ==
                      "ARTIFICIALLY_REPLAY_WITH_NEWEST_BUCKET_LOGIC_FOR_TESTING")
             {
@@ -1189,6 +1238,18 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 BUCKET_DIR_PATH = readString(item);
             }
+            else if (item.first == "HISTORY_CACHE_DIR")
+            {
+                HISTORY_CACHE_DIR = readString(item);
+            }
+            else if (item.first == "HISTORY_CACHE_MAX_SIZE_MB")
+            {
+                HISTORY_CACHE_MAX_SIZE_MB = readInt<uint64_t>(item);
+            }
+            else if (item.first == "STREAM_HISTORY_CHECKPOINTS")
+            {
+                STREAM_HISTORY_CHECKPOINTS = readBool(item);
+            }
             else if (item.first == "NODE_NAMES")
             {
                 auto names = readArray<std::string>(item);
@@ -1341,6 +1402,11 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 QUORUM_INTERSECTION_CHECKER = readBool(item);
             }
+            else if (item.first == "QUORUM_INTERSECTION_CHECKER_THREADS")
+            {
+                QUORUM_INTERSECTION_CHECKER_THREADS =
+                    readInt<int>(item, 1, 1000);
+            }
             else if (item.first == "HISTORY")
             {
                 auto hist = item.second->as_table();
@@ -1356,7 +1422,8 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                             throw std::invalid_argument(
                                 "malformed HISTORY config block");
                         }
-                        std::string get, put, mkdir;
+                        std::string get, put, mkdir, path;
+                        bool writable = false;
                         for (auto const& c : *tab)
                         {
                             if (c.first == "get")
@@ -1371,6 +1438,14 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                             {
                                 mkdir = c.second->as<std::string>()->get();
                             }
+                            else if (c.first == "path")
+                            {
+                                path = c.second->as<std::string>()->get();
+                            }
+                            else if (c.first == "writable")
+                            {
+                                writable = c.second->as<bool>()->get();
+                            }
                             else
                             {
                                 std::string err(
@@ -1381,7 +1456,8 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                                 throw std::invalid_argument(err);
                             }
                         }
-                        addHistoryArchive(archive.first, get, put, mkdir);
+                        addHistoryArchive(archive.first, get, put, mkdir,
+                                          path, writable);
                     }
                 }
                 else
@@ -1539,6 +1615,10 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 ENABLE_DIAGNOSTICS_FOR_TX_SUBMISSION = readBool(item);
             }
+            else if (item.first == "BACKGROUND_TX_SIG_VERIFICATION")
+            {
+                BACKGROUND_TX_SIG_VERIFICATION = readBool(item);
+            }
             else if (item.first == "TESTING_MINIMUM_PERSISTENT_ENTRY_LIFETIME")
             {
                 TESTING_MINIMUM_PERSISTENT_ENTRY_LIFETIME =
@@ -2256,6 +2336,7 @@ Config::setNoPublish()
     for (auto& item : HISTORY)
     {
         item.second.mPutCmd = "";
+        item.second.mWritable = false;
     }
 }
 
@@ -28,6 +28,10 @@ struct HistoryArchiveConfiguration
     std::string mGetCmd;
     std::string mPutCmd;
     std::string mMkdirCmd;
+    // Directory of an archive on the local filesystem, which is read (and
+    // written, if `mWritable`) in-process instead of through commands
+    std::string mPath;
+    bool mWritable{false};
 };
 
 enum class ValidationThresholdLevels : int
@@ -74,7 +78,9 @@ class Config : public std::enable_shared_from_this<Config>
     void addValidatorName(std::string const& pubKeyStr,
                           std::string const& name);
     void addHistoryArchive(std::string const& name, std::string const& get,
-                           std::string const& put, std::string const& mkdir);
+                           std::string const& put, std::string const& mkdir,
+                           std::string const& path = "",
+                           bool writable = false);
 
     std::string toString(ValidatorQuality q) const;
     ValidatorQuality parseQuality(std::string const& q) const;
@@ -326,6 +332,14 @@ class Config : public std::enable_shared_from_this<Config>
     // Byte limit for outbound transaction queue.
     uint32_t OUTBOUND_TX_QUEUE_BYTE_LIMIT;
 
+    // Size flow control windows per peer from the measured round trip time
+    // and drain rate instead of using the static values above. Reading
+    // windows may grow up to ADAPTIVE_FLOW_CONTROL_MAX_WINDOW_MULTIPLIER times
+    // their configured size, and the outbound transaction queue of a slow
+    // peer is kept below OUTBOUND_TX_QUEUE_BYTE_LIMIT.
+    bool ENABLE_ADAPTIVE_FLOW_CONTROL;
+    uint32_t ADAPTIVE_FLOW_CONTROL_MAX_WINDOW_MULTIPLIER;
+
     // A config parameter that allows a node to generate buckets. This should
     // be set to `false` only for testing purposes.
     bool MODE_ENABLES_BUCKETLIST;
@@ -411,6 +425,13 @@ class Config : public std::enable_shared_from_this<Config>
     // disk usage, but it is useful for recovering of nodes.
     bool DISABLE_BUCKET_GC;
 
+    // If set to true, a complete offline catchup (one that verifies the
+    // transaction results) uses the verified results while replaying: the
+    // signatures of transactions that passed validation are not checked again
+    // and the operations of failed transactions are not applied. The hash of
+    // every replayed ledger is still checked.
+    bool CATCHUP_SKIP_KNOWN_RESULTS;
+
     // If set to true, writing an XDR file (a bucket or a checkpoint) will not
     // be followed by an fsync on the file. This in turn means that XDR files
     // (which hold the canonical state of the ledger) may be corrupted if the
@@ -426,6 +447,21 @@ class Config : public std::enable_shared_from_this<Config>
     // approximately ~1 min of network activity.
     uint32 MAX_SLOTS_TO_REMEMBER;
 
+    // When non-zero, the transaction set to nominate is built this many
+    // milliseconds ahead of the ledger trigger timer, against the last closed
+    // ledger, so that nomination does not have to wait for surge pricing and
+    // validation of the whole transaction queue. Transactions that arrive
+    // after the candidate is built are left for the next ledger. Defaults to
+    // 0 (build synchronously when the trigger timer fires).
+    uint32_t TX_SET_CANDIDATE_LEAD_TIME_MS;
+
+    // Only the highest fee rate transactions that fit into this many ledgers
+    // are validated when building a tx set to nominate, instead of the whole
+    // transaction queue. Being above 1 lets surge pricing observe the
+    // transactions that don't fit, and replace the ones that turn out to be
+    // invalid without pulling more from the queue. Defaults to 1.5.
+    double NOMINATION_TX_LEDGER_MULTIPLIER;
+
     // A string specifying a stream to write fine-grained metadata to for each
     // ledger close while running. This will be opened at startup and
     // synchronously streamed-to during both catchup and live ledger-closing.
@@ -443,6 +479,11 @@ class Config : public std::enable_shared_from_this<Config>
     // in consensus, only a passive "watcher" node.
     std::string METADATA_OUTPUT_STREAM;
 
+    // File to record the SCP envelopes, tx sets and quorum sets received from
+    // peers to, for replaying them with `replay-scp`. Only set from the
+    // command line (`run --record-scp`).
+    std::string RECORD_SCP_MESSAGES_PATH;
+
     // Number of ledgers worth of transaction metadata to preserve on disk for
     // debugging purposes. These records are automatically maintained and
     // rotated during processing, and are helpful for recovery in case of a
@@ -490,6 +531,18 @@ class Config : public std::enable_shared_from_this<Config>
     bool LOG_COLOR;
     std::string BUCKET_DIR_PATH;
 
+    // Directory of the cache of downloaded history files (buckets), shared
+    // across catchups. Empty to disable the cache.
+    std::string HISTORY_CACHE_DIR;
+    // Size above which the least recently used files of the history cache
+    // are deleted, in megabytes.
+    uint64_t HISTORY_CACHE_MAX_SIZE_MB;
+
+    // Write the history files of checkpoints as ledgers close, instead of
+    // storing transactions and SCP messages in the database and reading them
+    // back when publishing. Only used when a history archive is writable.
+    bool STREAM_HISTORY_CHECKPOINTS;
+
     // Ledger protocol version for testing purposes. Defaulted to
     // LEDGER_PROTOCOL_VERSION. Used in the following scenarios: 1. to specify
     // the genesis ledger version (only when USE_CONFIG_FOR_GENESIS is true) 2.
@@ -558,6 +611,9 @@ class Config : public std::enable_shared_from_this<Config>
 
     // Whether to run online quorum intersection checks.
     bool QUORUM_INTERSECTION_CHECKER;
+    // Number of threads (including the one it runs on) a quorum intersection
+    // check splits its search across.
+    int QUORUM_INTERSECTION_CHECKER_THREADS;
 
     // Invariants
     std::vector<std::string> INVARIANT_CHECKS;
@@ -607,6 +663,11 @@ class Config : public std::enable_shared_from_this<Config>
     // on validators that accept transactions.
     bool ENABLE_DIAGNOSTICS_FOR_TX_SUBMISSION;
 
+    // If set to true, signatures of the transactions received from peers are
+    // verified on background threads before the transactions are added to
+    // the transaction queue on the main thread.
+    bool BACKGROUND_TX_SIG_VERIFICATION;
+
     // Override the initial hardcoded MINIMUM_PERSISTENT_ENTRY_LIFETIME
     // for testing.
     uint32_t TESTING_MINIMUM_PERSISTENT_ENTRY_LIFETIME;
@@ -85,12 +85,6 @@ PersistentState::getStoreStateNameForTxSet(Hash const& txSetHash)
     return res;
 }
 
-bool
-PersistentState::hasTxSet(Hash const& txSetHash)
-{
-    return entryExists(getStoreStateNameForTxSet(txSetHash));
-}
-
 std::string
 PersistentState::getState(PersistentState::Entry entry)
 {
@@ -125,25 +119,15 @@ PersistentState::getSCPStateAllSlots()
 }
 
 void
-PersistentState::setSCPStateForSlot(uint64 slot, std::string const& value)
+PersistentState::clearSCPStateAllSlots()
 {
     ZoneScoped;
-    auto slotIdx = static_cast<uint32>(
-        slot % (mApp.getConfig().MAX_SLOTS_TO_REMEMBER + 1));
-    updateDb(getStoreStateName(kLastSCPDataXDR, slotIdx), value);
-}
+    deleteTxSets(getTxSetHashesForAllSlots());
 
-void
-PersistentState::setSCPStateV1ForSlot(
-    uint64 slot, std::string const& value,
-    std::unordered_map<Hash, std::string> const& txSets)
-{
     soci::transaction tx(mApp.getDatabase().getSession());
-    setSCPStateForSlot(slot, value);
-
-    for (auto const& txSet : txSets)
+    for (uint32 i = 0; i <= mApp.getConfig().MAX_SLOTS_TO_REMEMBER; i++)
     {
-        updateDb(getStoreStateNameForTxSet(txSet.first), txSet.second);
+        updateDb(getStoreStateName(kLastSCPDataXDR, i), "");
     }
     tx.commit();
 }
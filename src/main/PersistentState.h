@@ -41,16 +41,14 @@ class PersistentState
     std::vector<std::string> getSCPStateAllSlots();
     std::vector<std::string> getTxSetsForAllSlots();
     std::unordered_set<Hash> getTxSetHashesForAllSlots();
-
-    void
-    setSCPStateV1ForSlot(uint64 slot, std::string const& value,
-                         std::unordered_map<Hash, std::string> const& txSets);
+    // SCP state is kept in the herder's SCPStateJournal, these only remain to
+    // move the state saved by older versions out of the database
+    void clearSCPStateAllSlots();
 
     bool shouldRebuildForType(LedgerEntryType let);
     void clearRebuildForType(LedgerEntryType let);
     void setRebuildForType(LedgerEntryType let);
 
-    bool hasTxSet(Hash const& txSetHash);
     void deleteTxSets(std::unordered_set<Hash> hashesToDelete);
 
   private:
@@ -62,7 +60,6 @@ class PersistentState
     std::string getStoreStateName(Entry n, uint32 subscript = 0);
     std::string getStoreStateNameForTxSet(Hash const& txSetHash);
 
-    void setSCPStateForSlot(uint64 slot, std::string const& value);
     void updateDb(std::string const& entry, std::string const& value);
     std::string getFromDb(std::string const& entry);
     bool entryExists(std::string const& entry);
@@ -2,6 +2,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "catchup/CatchupConfiguration.h"
 #include "crypto/Random.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/test/HistoryTestsUtils.h"
@@ -687,4 +688,63 @@ TEST_CASE("standalone quorum intersection check", "[applicationutils]")
             checkQuorumIntersectionFromJson(JSON_ROOT + "no-file.json", cfg),
             std::runtime_error);
     }
-}
\ No newline at end of file
+}
+
+#ifndef _WIN32
+TEST_CASE("segmented catchup", "[applicationutils][catchup]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    // Paths are passed whole to the segments, even with spaces
+    auto tmpDir = app->getTmpDirManager().tmpDir("segmented catchup");
+    auto workDir = tmpDir.getName() + "/work dir";
+
+    // Stands in for `stellar-core catchup`: writes the catchup info of a
+    // segment ending at ledger N with hash "hN", bootstrapped from the ledger
+    // its range starts at (or from the next one in "mismatch" mode)
+    auto script = tmpDir.getName() + "/catchup.sh";
+    {
+        std::ofstream out(script);
+        out << R"(mode=$1
+end=${2%/*}
+start=$((end - ${2#*/}))
+[ "$mode" = fail ] && exit 1
+[ "$mode" = mismatch ] && start=$((start + 1))
+printf '{"info": {"ledger": {"num": %d, "hash": "h%d"}}, ' $end $end > "$6"
+printf '"catchup_start": {"num": %d, "hash": "h%d"}}' $start $start >> "$6"
+)";
+    }
+
+    auto runSegments = [&](std::string const& mode, Json::Value& info) {
+        CatchupConfiguration cc{640, std::numeric_limits<uint32_t>::max(),
+                                CatchupConfiguration::Mode::OFFLINE_BASIC};
+        return segmentedCatchup(getTestConfig(1), cc, 4, workDir,
+                                fmt::format("sh \"{}\" {}", script, mode), "",
+                                false, info);
+    };
+
+    Json::Value info;
+    SECTION("segments are chained")
+    {
+        REQUIRE(runSegments("ok", info) == 0);
+        std::vector<uint32_t> const ends{191, 383, 511, 640};
+        REQUIRE(info["segments"].size() == ends.size());
+        for (Json::ArrayIndex i = 0; i < ends.size(); ++i)
+        {
+            auto const& segment = info["segments"][i];
+            REQUIRE(segment["to"].asUInt() == ends[i]);
+            REQUIRE(segment["hash"].asString() ==
+                    fmt::format("h{}", ends[i]));
+        }
+        REQUIRE(info["info"]["ledger"]["num"].asUInt() == 640);
+    }
+    SECTION("segment not starting where the previous one ended")
+    {
+        REQUIRE(runSegments("mismatch", info) == 3);
+    }
+    SECTION("segment failing")
+    {
+        REQUIRE(runSegments("fail", info) == 3);
+    }
+}
+#endif
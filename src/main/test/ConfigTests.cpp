@@ -507,3 +507,51 @@ TEST_CASE("operation filter configuration", "[config]")
         loadConfig(vals);
     }
 }
+
+TEST_CASE("local history archive configuration", "[config]")
+{
+    auto loadConfig = [](std::string const& archive) {
+        auto secretKey = SecretKey::fromSeed(sha256("NODE_SEED_0"));
+        std::stringstream ss;
+        ss << "UNSAFE_QUORUM=true\n";
+        ss << "[QUORUM_SET]\n";
+        ss << "THRESHOLD_PERCENT=100\n";
+        ss << "VALIDATORS=[\"" << secretKey.getStrKeyPublic() << " A\"]\n";
+        ss << "[HISTORY.local]\n";
+        ss << archive;
+
+        Config c;
+        c.load(ss);
+        return c;
+    };
+
+    SECTION("path")
+    {
+        auto c = loadConfig("path=\"/tmp/archive\"\n");
+        auto const& archive = c.HISTORY.at("local");
+        REQUIRE(archive.mPath == "/tmp/archive");
+        REQUIRE(!archive.mWritable);
+    }
+    SECTION("writable path")
+    {
+        auto c = loadConfig("path=\"/tmp/archive\"\nwritable=true\n");
+        REQUIRE(c.HISTORY.at("local").mWritable);
+    }
+    SECTION("path with commands")
+    {
+        for (auto const& cmd : {"get=\"cp /tmp/archive/{0} {1}\"\n",
+                                "put=\"cp {0} /tmp/archive/{1}\"\n",
+                                "mkdir=\"mkdir -p /tmp/archive/{0}\"\n"})
+        {
+            REQUIRE_THROWS_WITH(
+                loadConfig(std::string("path=\"/tmp/archive\"\n") + cmd),
+                "Archive 'local' can't have both a path and commands");
+        }
+    }
+    SECTION("writable without path")
+    {
+        REQUIRE_THROWS_WITH(
+            loadConfig("get=\"cp /tmp/archive/{0} {1}\"\nwritable=true\n"),
+            "Archive 'local' can't be writable without a path");
+    }
+}
@@ -8,6 +8,7 @@
 #include "herder/Herder.h"
 #include "main/Application.h"
 #include "medida/counter.h"
+#include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "overlay/OverlayManager.h"
 #include "util/GlobalChecks.h"
@@ -15,46 +16,224 @@
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
+#include <bitset>
 #include <fmt/format.h>
 
 namespace stellar
 {
-Floodgate::FloodRecord::FloodRecord(uint32_t ledger, Peer::pointer peer)
-    : mLedgerSeq(ledger)
+namespace
 {
-    if (peer)
-        mPeersTold.insert(peer->toString());
+constexpr size_t SLOT_WORD_BITS = 64;
+}
+
+bool
+Floodgate::PeerSlotSet::insert(size_t slot)
+{
+    uint64_t* word;
+    if (slot < SLOT_WORD_BITS)
+    {
+        word = &mInline;
+    }
+    else
+    {
+        size_t idx = slot / SLOT_WORD_BITS - 1;
+        if (idx >= mOverflow.size())
+        {
+            mOverflow.resize(idx + 1, 0);
+        }
+        word = &mOverflow[idx];
+    }
+    uint64_t bit = uint64_t(1) << (slot % SLOT_WORD_BITS);
+    if ((*word & bit) != 0)
+    {
+        return false;
+    }
+    *word |= bit;
+    return true;
+}
+
+bool
+Floodgate::PeerSlotSet::contains(size_t slot) const
+{
+    uint64_t bit = uint64_t(1) << (slot % SLOT_WORD_BITS);
+    if (slot < SLOT_WORD_BITS)
+    {
+        return (mInline & bit) != 0;
+    }
+    size_t idx = slot / SLOT_WORD_BITS - 1;
+    return idx < mOverflow.size() && (mOverflow[idx] & bit) != 0;
+}
+
+size_t
+Floodgate::PeerSlotSet::size() const
+{
+    size_t res = std::bitset<SLOT_WORD_BITS>(mInline).count();
+    for (auto w : mOverflow)
+    {
+        res += std::bitset<SLOT_WORD_BITS>(w).count();
+    }
+    return res;
+}
+
+size_t
+Floodgate::PeerSlotSet::heapBytes() const
+{
+    return mOverflow.capacity() * sizeof(uint64_t);
 }
 
 Floodgate::Floodgate(Application& app)
     : mApp(app)
     , mFloodMapSize(
           app.getMetrics().NewCounter({"overlay", "memory", "flood-known"}))
+    , mFloodMapBytes(
+          app.getMetrics().NewCounter({"overlay", "memory", "flood-bytes"}))
+    , mPeerSlotsSize(
+          app.getMetrics().NewCounter({"overlay", "memory", "flood-peer-slots"}))
     , mSendFromBroadcast(app.getMetrics().NewMeter(
           {"overlay", "flood", "broadcast"}, "message"))
     , mMessagesAdvertised(app.getMetrics().NewMeter(
           {"overlay", "flood", "advertised"}, "message"))
+    , mDedupHits(app.getMetrics().NewMeter({"overlay", "flood", "dedup-hit"},
+                                           "message"))
     , mShuttingDown(false)
 {
 }
 
+size_t
+Floodgate::getOrCreatePeerSlot(Peer::pointer const& peer, uint32_t ledger)
+{
+    auto const& name = peer->toString();
+    size_t slot;
+    auto it = mPeerSlotByName.find(name);
+    if (it != mPeerSlotByName.end())
+    {
+        slot = it->second;
+    }
+    else
+    {
+        if (!mFreePeerSlots.empty())
+        {
+            slot = mFreePeerSlots.back();
+            mFreePeerSlots.pop_back();
+        }
+        else
+        {
+            slot = mPeerSlots.size();
+            mPeerSlots.emplace_back();
+        }
+        auto& ps = mPeerSlots[slot];
+        ps.mName = name;
+        ps.mInUse = true;
+        ps.mLastUsedLedger = ledger;
+        mPeerSlotByName.emplace(name, slot);
+    }
+    auto& ps = mPeerSlots[slot];
+    ps.mLastUsedLedger = std::max(ps.mLastUsedLedger, ledger);
+    return slot;
+}
+
+std::optional<size_t>
+Floodgate::findPeerSlot(Peer::pointer const& peer) const
+{
+    auto it = mPeerSlotByName.find(peer->toString());
+    if (it == mPeerSlotByName.end())
+    {
+        return std::nullopt;
+    }
+    return std::make_optional<size_t>(it->second);
+}
+
+Floodgate::FloodRecord&
+Floodgate::createRecord(Hash const& index, uint32_t ledger)
+{
+    auto res = mFloodMap.emplace(index, FloodRecord(ledger));
+    releaseAssert(res.second);
+    mRecordsByLedger[ledger].emplace_back(index);
+    ++mIndexedHashes;
+    return res.first->second;
+}
+
+bool
+Floodgate::recordPeer(FloodRecord& record, Peer::pointer const& peer)
+{
+    // A slot must outlive every record that references it, so it is tagged
+    // with the highest ledger of any such record (the tracking ledger may
+    // move backwards when we lose sync).
+    auto ledger = std::max(record.mLedgerSeq,
+                           mApp.getHerder().trackingConsensusLedgerIndex());
+    auto slot = getOrCreatePeerSlot(peer, ledger);
+    auto before = record.mPeersTold.heapBytes();
+    bool inserted = record.mPeersTold.insert(slot);
+    mOverflowBytes += record.mPeersTold.heapBytes() - before;
+    return inserted;
+}
+
+void
+Floodgate::eraseRecord(UnorderedMap<Hash, FloodRecord>::iterator it)
+{
+    mOverflowBytes -= it->second.mPeersTold.heapBytes();
+    mFloodMap.erase(it);
+}
+
+size_t
+Floodgate::getApproximateMemoryUsage() const
+{
+    // node payload plus the per-node "next" pointer and cached hash
+    constexpr size_t nodeSize =
+        sizeof(UnorderedMap<Hash, FloodRecord>::value_type) +
+        2 * sizeof(void*);
+    return mFloodMap.size() * nodeSize +
+           mFloodMap.bucket_count() * sizeof(void*) + mOverflowBytes +
+           mIndexedHashes * sizeof(Hash) +
+           mPeerSlots.capacity() * sizeof(PeerSlot);
+}
+
+void
+Floodgate::updateSizeMetrics()
+{
+    mFloodMapSize.set_count(mFloodMap.size());
+    mFloodMapBytes.set_count(getApproximateMemoryUsage());
+    mPeerSlotsSize.set_count(mPeerSlotByName.size());
+    TracyPlot("overlay.memory.flood-known",
+              static_cast<int64_t>(mFloodMap.size()));
+}
+
 // remove old flood records
 void
 Floodgate::clearBelow(uint32_t maxLedger)
 {
     ZoneScoped;
-    for (auto it = mFloodMap.cbegin(); it != mFloodMap.cend();)
+    for (auto it = mRecordsByLedger.begin();
+         it != mRecordsByLedger.end() && it->first < maxLedger;)
     {
-        if (it->second->mLedgerSeq < maxLedger)
+        for (auto const& h : it->second)
         {
-            it = mFloodMap.erase(it);
+            auto rec = mFloodMap.find(h);
+            // skip records that were forgotten, or forgotten and re-created
+            // at a later ledger
+            if (rec != mFloodMap.end() && rec->second.mLedgerSeq == it->first)
+            {
+                eraseRecord(rec);
+            }
         }
-        else
+        mIndexedHashes -= it->second.size();
+        it = mRecordsByLedger.erase(it);
+    }
+
+    // Every record that references a slot last used below `maxLedger` is
+    // now gone, so the slot can be handed out again.
+    for (size_t slot = 0; slot < mPeerSlots.size(); ++slot)
+    {
+        auto& ps = mPeerSlots[slot];
+        if (ps.mInUse && ps.mLastUsedLedger < maxLedger)
         {
-            ++it;
+            mPeerSlotByName.erase(ps.mName);
+            ps.mName.clear();
+            ps.mInUse = false;
+            mFreePeerSlots.emplace_back(slot);
         }
     }
-    mFloodMapSize.set_count(mFloodMap.size());
+    updateSizeMetrics();
 }
 
 bool
@@ -69,16 +248,19 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer, Hash& index)
     auto result = mFloodMap.find(index);
     if (result == mFloodMap.end())
     { // we have never seen this message
-        mFloodMap[index] = std::make_shared<FloodRecord>(
-            mApp.getHerder().trackingConsensusLedgerIndex(), peer);
-        mFloodMapSize.set_count(mFloodMap.size());
-        TracyPlot("overlay.memory.flood-known",
-                  static_cast<int64_t>(mFloodMap.size()));
+        auto& rec = createRecord(
+            index, mApp.getHerder().trackingConsensusLedgerIndex());
+        if (peer)
+        {
+            recordPeer(rec, peer);
+        }
+        updateSizeMetrics();
         return true;
     }
     else
     {
-        result->second->mPeersTold.insert(peer->toString());
+        mDedupHits.Mark();
+        recordPeer(result->second, peer);
         return false;
     }
 }
@@ -99,21 +281,14 @@ Floodgate::broadcast(StellarMessage const& msg, std::optional<Hash> const& hash)
     }
     Hash index = xdrBlake2(msg);
 
-    FloodRecord::pointer fr;
     auto result = mFloodMap.find(index);
     if (result == mFloodMap.end())
     { // no one has sent us this message / start from scratch
-        fr = std::make_shared<FloodRecord>(
-            mApp.getHerder().trackingConsensusLedgerIndex(), Peer::pointer());
-        mFloodMap[index] = fr;
-        mFloodMapSize.set_count(mFloodMap.size());
-    }
-    else
-    {
-        fr = result->second;
+        createRecord(index, mApp.getHerder().trackingConsensusLedgerIndex());
+        result = mFloodMap.find(index);
     }
     // send it to people that haven't sent it to us
-    auto& peersTold = fr->mPeersTold;
+    auto& fr = result->second;
 
     // make a copy, in case peers gets modified
     auto peers = mApp.getOverlayManager().getAuthenticatedPeers();
@@ -125,7 +300,7 @@ Floodgate::broadcast(StellarMessage const& msg, std::optional<Hash> const& hash)
         releaseAssert(peer.second->isAuthenticated());
         bool pullMode = msg.type() == TRANSACTION;
 
-        if (peersTold.insert(peer.second->toString()).second)
+        if (recordPeer(fr, peer.second))
         {
             if (pullMode)
             {
@@ -153,8 +328,9 @@ Floodgate::broadcast(StellarMessage const& msg, std::optional<Hash> const& hash)
             broadcasted = true;
         }
     }
+    updateSizeMetrics();
     CLOG_TRACE(Overlay, "broadcast {} told {}", hexAbbrev(index),
-               peersTold.size());
+               fr.mPeersTold.size());
     return broadcasted;
 }
 
@@ -165,11 +341,12 @@ Floodgate::getPeersKnows(Hash const& h)
     auto record = mFloodMap.find(h);
     if (record != mFloodMap.end())
     {
-        auto& ids = record->second->mPeersTold;
+        auto const& told = record->second.mPeersTold;
         auto const& peers = mApp.getOverlayManager().getAuthenticatedPeers();
         for (auto& p : peers)
         {
-            if (ids.find(p.second->toString()) != ids.end())
+            auto slot = findPeerSlot(p.second);
+            if (slot && told.contains(*slot))
             {
                 res.insert(p.second);
             }
@@ -183,11 +360,21 @@ Floodgate::shutdown()
 {
     mShuttingDown = true;
     mFloodMap.clear();
+    mRecordsByLedger.clear();
+    mPeerSlots.clear();
+    mPeerSlotByName.clear();
+    mFreePeerSlots.clear();
+    mOverflowBytes = 0;
+    mIndexedHashes = 0;
 }
 
 void
 Floodgate::forgetRecord(Hash const& h)
 {
-    mFloodMap.erase(h);
+    auto it = mFloodMap.find(h);
+    if (it != mFloodMap.end())
+    {
+        eraseRecord(it);
+    }
 }
 }
@@ -6,7 +6,10 @@
 
 #include "overlay/Peer.h"
 #include "overlay/StellarXDR.h"
+#include "util/HashOfHash.h"
+#include "util/UnorderedMap.h"
 #include <map>
+#include <vector>
 
 /**
  * FloodGate keeps track of which peers have sent us which broadcast messages,
@@ -19,11 +22,20 @@
  * All messages are marked with the ledger sequence number to which they
  * relate, and all flood-management information for a given ledger number
  * is purged from the FloodGate when the ledger closes.
+ *
+ * To keep the memory footprint bounded under heavy transaction flooding,
+ * records are stored in a flat hash table keyed by message hash, and the set
+ * of peers that know about a message is a bitset indexed by a small integer
+ * "peer slot" rather than a set of peer names. Records are additionally
+ * indexed by ledger so that `clearBelow` only touches the ledgers being
+ * dropped. A peer slot is recycled once every record that could reference it
+ * has been purged.
  */
 
 namespace medida
 {
 class Counter;
+class Meter;
 }
 
 namespace stellar
@@ -31,24 +43,70 @@ namespace stellar
 
 class Floodgate
 {
-    class FloodRecord
+    // Set of peer slots, with the first 64 slots stored inline so that the
+    // common case does not allocate.
+    class PeerSlotSet
     {
+        uint64_t mInline{0};
+        std::vector<uint64_t> mOverflow;
+
       public:
-        typedef std::shared_ptr<FloodRecord> pointer;
+        // returns true if `slot` was not already in the set
+        bool insert(size_t slot);
+        bool contains(size_t slot) const;
+        size_t size() const;
+        size_t heapBytes() const;
+    };
 
+    struct FloodRecord
+    {
         uint32_t mLedgerSeq;
-        std::set<std::string> mPeersTold;
+        PeerSlotSet mPeersTold;
 
-        FloodRecord(uint32_t ledger, Peer::pointer peer);
+        explicit FloodRecord(uint32_t ledger) : mLedgerSeq(ledger)
+        {
+        }
+    };
+
+    struct PeerSlot
+    {
+        std::string mName;
+        // last ledger at which this slot was recorded in any FloodRecord
+        uint32_t mLastUsedLedger{0};
+        bool mInUse{false};
     };
 
-    std::map<Hash, FloodRecord::pointer> mFloodMap;
+    UnorderedMap<Hash, FloodRecord> mFloodMap;
+    // ledger -> hashes of records created at that ledger. Entries may be
+    // stale (record forgotten or re-created), `clearBelow` checks that.
+    std::map<uint32_t, std::vector<Hash>> mRecordsByLedger;
+
+    std::vector<PeerSlot> mPeerSlots;
+    UnorderedMap<std::string, size_t> mPeerSlotByName;
+    std::vector<size_t> mFreePeerSlots;
+
     Application& mApp;
     medida::Counter& mFloodMapSize;
+    medida::Counter& mFloodMapBytes;
+    medida::Counter& mPeerSlotsSize;
     medida::Meter& mSendFromBroadcast;
     medida::Meter& mMessagesAdvertised;
+    medida::Meter& mDedupHits;
     bool mShuttingDown;
 
+    // bytes allocated by PeerSlotSets beyond their inline storage
+    size_t mOverflowBytes{0};
+    // number of hashes held in mRecordsByLedger, including stale ones
+    size_t mIndexedHashes{0};
+
+    size_t getOrCreatePeerSlot(Peer::pointer const& peer, uint32_t ledger);
+    std::optional<size_t> findPeerSlot(Peer::pointer const& peer) const;
+    FloodRecord& createRecord(Hash const& index, uint32_t ledger);
+    // returns true if `peer` was not already recorded for `record`
+    bool recordPeer(FloodRecord& record, Peer::pointer const& peer);
+    void eraseRecord(UnorderedMap<Hash, FloodRecord>::iterator it);
+    void updateSizeMetrics();
+
   public:
     Floodgate(Application& app);
     // forget data strictly older than `maxLedger`
@@ -71,6 +129,15 @@ class Floodgate
     // `msgID` corresponds to a `StellarMessage`
     void forgetRecord(Hash const& msgID);
 
+    // approximate number of bytes used by flood records and their indexes
+    size_t getApproximateMemoryUsage() const;
+
+    size_t
+    getRecordCount() const
+    {
+        return mFloodMap.size();
+    }
+
     void shutdown();
 };
 }
@@ -4,6 +4,7 @@
 
 #include "overlay/FlowControl.h"
 #include "herder/Herder.h"
+#include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
@@ -12,6 +13,9 @@
 #include "overlay/OverlayMetrics.h"
 #include "util/Logging.h"
 #include <Tracy.hpp>
+#include <algorithm>
+#include <array>
+#include <limits>
 
 namespace stellar
 {
@@ -19,6 +23,60 @@ namespace stellar
 constexpr std::chrono::seconds const OUTBOUND_QUEUE_TIMEOUT =
     std::chrono::seconds(30);
 
+bool dropMessageAfterTimeout(FlowControl::QueuedOutboundMessage const& queuedMsg,
+                             VirtualClock::time_point now);
+
+// Number of messages each outbound queue may send per round-robin turn. SCP
+// (queue 0) is not part of the rotation, it is always drained first.
+constexpr std::array<size_t, 4> const OUTBOUND_QUEUE_WEIGHTS = {0, 4, 2, 1};
+
+// Adaptive flow control: number of drain rate samples to keep
+constexpr size_t const ADAPTIVE_RATE_SAMPLES = 10;
+// Adaptive flow control: reading windows cover this many times the data
+// drained during one control loop (similar to BBR's cwnd gain)
+constexpr double const ADAPTIVE_WINDOW_GAIN = 2.0;
+// Adaptive flow control: the outbound transaction queue of a peer that can't
+// keep up holds at most this much time worth of data
+constexpr std::chrono::milliseconds const ADAPTIVE_OUTBOUND_QUEUE_TARGET_DELAY =
+    std::chrono::milliseconds(2000);
+
+std::optional<std::chrono::nanoseconds>
+FlowControl::DrainRateEstimator::addSample(uint64_t units,
+                                           VirtualClock::time_point now)
+{
+    std::optional<std::chrono::nanoseconds> elapsed;
+    if (mLastSampleTime && now > *mLastSampleTime)
+    {
+        elapsed = std::make_optional<std::chrono::nanoseconds>(
+            now - *mLastSampleTime);
+        mSamples.emplace_back(static_cast<double>(units) /
+                              std::chrono::duration<double>(*elapsed).count());
+        if (mSamples.size() > ADAPTIVE_RATE_SAMPLES)
+        {
+            mSamples.pop_front();
+        }
+    }
+    mLastSampleTime = now;
+    return elapsed;
+}
+
+void
+FlowControl::DrainRateEstimator::restart(VirtualClock::time_point now)
+{
+    mSamples.clear();
+    mLastSampleTime = now;
+}
+
+double
+FlowControl::DrainRateEstimator::getRate() const
+{
+    if (mSamples.empty())
+    {
+        return 0;
+    }
+    return *std::max_element(mSamples.begin(), mSamples.end());
+}
+
 size_t
 FlowControl::getOutboundQueueByteLimit() const
 {
@@ -28,7 +86,23 @@ FlowControl::getOutboundQueueByteLimit() const
         return *mOutboundQueueLimit;
     }
 #endif
-    return mAppConnector.getConfig().OUTBOUND_TX_QUEUE_BYTE_LIMIT;
+    auto limit = static_cast<double>(
+        mAppConnector.getConfig().OUTBOUND_TX_QUEUE_BYTE_LIMIT);
+    auto rate = mOutboundRateBytes.getRate();
+    if (mAdaptive && rate > 0)
+    {
+        // Peer can't keep up: only queue what it can drain in a short while,
+        // but always leave room for a couple of the largest transactions
+        auto target =
+            rate *
+            std::chrono::duration<double>(ADAPTIVE_OUTBOUND_QUEUE_TARGET_DELAY)
+                .count();
+        auto floor = std::min(
+            2.0 * static_cast<double>(mAppConnector.getHerder().getMaxTxSize()),
+            limit);
+        return static_cast<size_t>(std::clamp(target, floor, limit));
+    }
+    return static_cast<size_t>(limit);
 }
 
 FlowControl::FlowControl(OverlayAppConnector& connector)
@@ -36,8 +110,10 @@ FlowControl::FlowControl(OverlayAppConnector& connector)
           connector.getConfig(), mNodeID))
     , mOverlayMetrics(connector.getOverlayManager().getOverlayMetrics())
     , mAppConnector(connector)
+    , mOutboundQueueWeights(OUTBOUND_QUEUE_WEIGHTS)
     , mNoOutboundCapacity(
           std::make_optional<VirtualClock::time_point>(connector.now()))
+    , mAdaptive(connector.getConfig().ENABLE_ADAPTIVE_FLOW_CONTROL)
 {
     releaseAssert(threadIsMain());
 }
@@ -80,6 +156,23 @@ FlowControl::maybeReleaseCapacityAndTriggerSend(StellarMessage const& msg)
             mOverlayMetrics.mConnectionFloodThrottle.Update(
                 mAppConnector.now() - *mNoOutboundCapacity);
         }
+
+        if (mAdaptive && mFlowControlBytesCapacity)
+        {
+            // Only samples taken while we were waiting on the peer measure
+            // its drain rate; otherwise the peer keeps up with us and the
+            // outbound queue does not need to be restricted.
+            if (mNoOutboundCapacity)
+            {
+                mOutboundRateBytes.addSample(
+                    msg.sendMoreExtendedMessage().numBytes,
+                    mAppConnector.now());
+            }
+            else
+            {
+                mOutboundRateBytes.restart(mAppConnector.now());
+            }
+        }
         mNoOutboundCapacity.reset();
 
         mFlowControlCapacity->releaseOutboundCapacity(msg);
@@ -104,6 +197,70 @@ FlowControl::maybeReleaseCapacityAndTriggerSend(StellarMessage const& msg)
     }
 }
 
+void
+FlowControl::popOutboundQueueFront(size_t queueIndex)
+{
+    auto& queue = mOutboundQueues[queueIndex];
+    releaseAssert(!queue.empty());
+    auto const& msg = *(queue.front().mMessage);
+    switch (msg.type())
+    {
+    case TRANSACTION:
+    {
+        if (mFlowControlBytesCapacity)
+        {
+            size_t s = mFlowControlBytesCapacity->getMsgResourceCount(msg);
+            releaseAssert(mTxQueueByteCount >= s);
+            mTxQueueByteCount -= s;
+        }
+    }
+    break;
+    case SCP_MESSAGE:
+        break;
+    case FLOOD_DEMAND:
+    {
+        size_t s = msg.floodDemand().txHashes.size();
+        releaseAssert(mDemandQueueTxHashCount >= s);
+        mDemandQueueTxHashCount -= s;
+    }
+    break;
+    case FLOOD_ADVERT:
+    {
+        size_t s = msg.floodAdvert().txHashes.size();
+        releaseAssert(mAdvertQueueTxHashCount >= s);
+        mAdvertQueueTxHashCount -= s;
+    }
+    break;
+    default:
+        abort();
+    }
+    queue.pop_front();
+}
+
+bool
+FlowControl::isStaleAtSend(QueuedOutboundMessage const& queuedMsg,
+                           VirtualClock::time_point now) const
+{
+    auto const& msg = *(queuedMsg.mMessage);
+    if (msg.type() != SCP_MESSAGE)
+    {
+        return dropMessageAfterTimeout(queuedMsg, now);
+    }
+
+    auto const& st = msg.envelope().statement;
+    auto& herder = mAppConnector.getHerder();
+    if (st.slotIndex < herder.getMinLedgerSeqToRemember() &&
+        st.slotIndex != herder.getMostRecentCheckpointSeq())
+    {
+        return true;
+    }
+    // Once we closed a slot, only EXTERNALIZE statements still help peers
+    // that are behind; nomination and ballot statements are obsolete.
+    return st.pledges.type() != SCP_ST_EXTERNALIZE &&
+           st.slotIndex <=
+               mAppConnector.getLedgerManager().getLastClosedLedgerNum();
+}
+
 void
 FlowControl::maybeSendNextBatch()
 {
@@ -116,13 +273,43 @@ FlowControl::maybeSendNextBatch()
     }
 
     int sent = 0;
-    for (int i = 0; i < mOutboundQueues.size(); i++)
-    {
-        auto& queue = mOutboundQueues[i];
-        while (!queue.empty())
+    auto now = mAppConnector.now();
+    auto& om = mOverlayMetrics;
+    std::array<bool, 4> blocked{};
+
+    // Send up to `maxToSend` messages from a queue, dropping messages that
+    // went stale while waiting. Returns the number of messages sent.
+    auto sendFromQueue = [&](size_t queueIndex, size_t maxToSend) {
+        auto& queue = mOutboundQueues[queueIndex];
+        size_t sentFromQueue = 0;
+        while (!queue.empty() && sentFromQueue < maxToSend)
         {
             auto& front = queue.front();
             auto const& msg = *(front.mMessage);
+
+            if (isStaleAtSend(front, now))
+            {
+                switch (msg.type())
+                {
+                case TRANSACTION:
+                    om.mOutboundQueueDropTxs.Mark();
+                    break;
+                case SCP_MESSAGE:
+                    om.mOutboundQueueDropSCP.Mark();
+                    break;
+                case FLOOD_DEMAND:
+                    om.mOutboundQueueDropDemand.Mark();
+                    break;
+                case FLOOD_ADVERT:
+                    om.mOutboundQueueDropAdvert.Mark();
+                    break;
+                default:
+                    abort();
+                }
+                popOutboundQueueFront(queueIndex);
+                continue;
+            }
+
             // Can't send _current_ message
             if (!hasOutboundCapacity(msg))
             {
@@ -133,65 +320,66 @@ FlowControl::maybeSendNextBatch()
                     mAppConnector.getConfig().toShortString(mNodeID));
                 // Start a timeout for SEND_MORE
                 mNoOutboundCapacity =
-                    std::make_optional<VirtualClock::time_point>(
-                        mAppConnector.now());
+                    std::make_optional<VirtualClock::time_point>(now);
+                blocked[queueIndex] = true;
                 break;
             }
 
             mSendCallback(std::make_shared<StellarMessage>(msg));
             ++sent;
-            auto& om = mOverlayMetrics;
+            ++sentFromQueue;
 
-            auto const& diff = mAppConnector.now() - front.mTimeEmplaced;
+            auto const& diff = now - front.mTimeEmplaced;
             mFlowControlCapacity->lockOutboundCapacity(msg);
             if (mFlowControlBytesCapacity)
             {
                 mFlowControlBytesCapacity->lockOutboundCapacity(msg);
             }
 
-            switch (front.mMessage->type())
+            switch (msg.type())
             {
             case TRANSACTION:
-            {
                 om.mOutboundQueueDelayTxs.Update(diff);
                 mMetrics.mOutboundQueueDelayTxs.Update(diff);
-                if (mFlowControlBytesCapacity)
-                {
-                    size_t s =
-                        mFlowControlBytesCapacity->getMsgResourceCount(msg);
-                    releaseAssert(mTxQueueByteCount >= s);
-                    mTxQueueByteCount -= s;
-                }
-            }
-            break;
+                break;
             case SCP_MESSAGE:
-            {
                 om.mOutboundQueueDelaySCP.Update(diff);
                 mMetrics.mOutboundQueueDelaySCP.Update(diff);
-            }
-            break;
+                break;
             case FLOOD_DEMAND:
-            {
                 om.mOutboundQueueDelayDemand.Update(diff);
                 mMetrics.mOutboundQueueDelayDemand.Update(diff);
-                size_t s = front.mMessage->floodDemand().txHashes.size();
-                releaseAssert(mDemandQueueTxHashCount >= s);
-                mDemandQueueTxHashCount -= s;
-            }
-            break;
+                break;
             case FLOOD_ADVERT:
-            {
                 om.mOutboundQueueDelayAdvert.Update(diff);
                 mMetrics.mOutboundQueueDelayAdvert.Update(diff);
-                size_t s = front.mMessage->floodAdvert().txHashes.size();
-                releaseAssert(mAdvertQueueTxHashCount >= s);
-                mAdvertQueueTxHashCount -= s;
-            }
-            break;
+                break;
             default:
                 abort();
             }
-            queue.pop_front();
+            popOutboundQueueFront(queueIndex);
+        }
+        return sentFromQueue;
+    };
+
+    // SCP traffic always goes first
+    sendFromQueue(0, std::numeric_limits<size_t>::max());
+
+    // The remaining classes share outbound capacity in weighted round-robin
+    // order, so a transaction flood can't starve demands and adverts. Every
+    // queue sends at least one message per turn, whatever its weight.
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        for (size_t i = 1; i < mOutboundQueues.size(); i++)
+        {
+            if (!blocked[i] && !mOutboundQueues[i].empty() &&
+                sendFromQueue(i, std::max<size_t>(mOutboundQueueWeights[i],
+                                                  1)) > 0)
+            {
+                progress = true;
+            }
         }
     }
 
@@ -276,11 +464,83 @@ FlowControl::endMessageProcessing(StellarMessage const& msg)
         // Reset counters
         mFloodDataProcessed = 0;
         mFloodDataProcessedBytes = 0;
+
+        if (mAdaptive)
+        {
+            // SEND_MORE_EXTENDED must always grant some bytes, but may grant
+            // 0 messages
+            res.first = resizeReadingWindow(mInboundRate, *mFlowControlCapacity,
+                                            res.first, false);
+            if (mFlowControlBytesCapacity)
+            {
+                res.second = resizeReadingWindow(mInboundRateBytes,
+                                                 *mFlowControlBytesCapacity,
+                                                 *res.second, true);
+            }
+        }
     }
 
     return res;
 }
 
+uint64_t
+FlowControl::resizeReadingWindow(DrainRateEstimator& estimator,
+                                 FlowControlCapacity& capacity,
+                                 uint64_t granted, bool keepNonZero)
+{
+    ZoneScoped;
+    auto elapsed = estimator.addSample(granted, mAppConnector.now());
+    if (!elapsed || !mRTT)
+    {
+        return granted;
+    }
+
+    auto limit = capacity.getCapacityLimits().mFloodCapacity;
+    auto baseLimit = limit - capacity.getFloodCapacityAdjustment();
+    auto maxLimit =
+        baseLimit *
+        mAppConnector.getConfig().ADAPTIVE_FLOW_CONTROL_MAX_WINDOW_MULTIPLIER;
+
+    // The window has to cover everything the peer can send during one control
+    // loop: a round trip plus the time it took us to process the batch.
+    auto loop = std::chrono::duration<double>(*mRTT + *elapsed).count();
+    auto target = std::min(ADAPTIVE_WINDOW_GAIN * estimator.getRate() * loop,
+                           static_cast<double>(maxLimit));
+    auto targetLimit =
+        std::clamp(static_cast<uint64_t>(target), baseLimit, maxLimit);
+
+    if (targetLimit > limit)
+    {
+        // Grow by at most what we grant anyway, i.e. at most double the
+        // amount acknowledged in one SEND_MORE
+        uint64_t inc = std::min<uint64_t>(targetLimit - limit,
+                                          std::max<uint64_t>(granted, 1));
+        inc = std::min<uint64_t>(inc, UINT32_MAX - granted);
+        capacity.adjustFloodCapacity(static_cast<int64_t>(inc));
+        return granted + inc;
+    }
+    else if (targetLimit < limit)
+    {
+        uint64_t maxWithheld =
+            keepNonZero ? (granted > 0 ? granted - 1 : 0) : granted;
+        uint64_t dec = std::min({limit - targetLimit,
+                                 capacity.getMaxFloodCapacityDecrease(),
+                                 maxWithheld});
+        if (dec > 0)
+        {
+            capacity.adjustFloodCapacity(-static_cast<int64_t>(dec));
+        }
+        return granted - dec;
+    }
+    return granted;
+}
+
+void
+FlowControl::updateRTT(std::chrono::milliseconds rtt)
+{
+    mRTT = std::make_optional<std::chrono::milliseconds>(rtt);
+}
+
 bool
 FlowControl::canRead() const
 {
@@ -432,15 +692,8 @@ FlowControl::addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg)
         while (isOverLimit(queue))
         {
             dropped++;
-            if (mFlowControlBytesCapacity)
-            {
-                size_t s = mFlowControlBytesCapacity->getMsgResourceCount(
-                    *(queue.front().mMessage));
-                releaseAssert(mTxQueueByteCount >= s);
-                mTxQueueByteCount -= s;
-            }
             om.mOutboundQueueDropTxs.Mark(dropped);
-            queue.pop_front();
+            popOutboundQueueFront(msgQInd);
         }
     }
     else if (type == SCP_MESSAGE)
@@ -487,10 +740,7 @@ FlowControl::addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg)
                (!queue.empty() && dropMessageAfterTimeout(queue.front(), now)))
         {
             dropped++;
-            size_t s = queue.front().mMessage->floodAdvert().txHashes.size();
-            releaseAssert(mAdvertQueueTxHashCount >= s);
-            mAdvertQueueTxHashCount -= s;
-            queue.pop_front();
+            popOutboundQueueFront(msgQInd);
         }
         om.mOutboundQueueDropAdvert.Mark(dropped);
     }
@@ -500,10 +750,7 @@ FlowControl::addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg)
                (!queue.empty() && dropMessageAfterTimeout(queue.front(), now)))
         {
             dropped++;
-            size_t s = queue.front().mMessage->floodDemand().txHashes.size();
-            releaseAssert(mDemandQueueTxHashCount >= s);
-            mDemandQueueTxHashCount -= s;
-            queue.pop_front();
+            popOutboundQueueFront(msgQInd);
         }
         om.mOutboundQueueDropDemand.Mark(dropped);
     }
@@ -544,6 +791,30 @@ FlowControl::getFlowControlJsonInfo(bool compact) const
             mFlowControlBytesCapacity->getOutboundCapacity());
     }
 
+    if (mAdaptive)
+    {
+        auto& adaptive = res["adaptive"];
+        adaptive["window"] = static_cast<Json::UInt64>(
+            mFlowControlCapacity->getCapacityLimits().mFloodCapacity);
+        adaptive["drain_rate"] =
+            static_cast<Json::UInt64>(mInboundRate.getRate());
+        if (mFlowControlBytesCapacity)
+        {
+            adaptive["window_bytes"] = static_cast<Json::UInt64>(
+                mFlowControlBytesCapacity->getCapacityLimits().mFloodCapacity);
+            adaptive["drain_rate_bytes"] =
+                static_cast<Json::UInt64>(mInboundRateBytes.getRate());
+            adaptive["outbound_drain_rate_bytes"] =
+                static_cast<Json::UInt64>(mOutboundRateBytes.getRate());
+            adaptive["outbound_queue_byte_limit"] =
+                static_cast<Json::UInt64>(getOutboundQueueByteLimit());
+        }
+        if (mRTT)
+        {
+            adaptive["rtt_ms"] = static_cast<Json::UInt64>(mRTT->count());
+        }
+    }
+
     if (!compact)
     {
         res["outbound_queue_delay_scp_p75"] = static_cast<Json::UInt64>(
@@ -556,6 +827,20 @@ FlowControl::getFlowControlJsonInfo(bool compact) const
         res["outbound_queue_delay_demand_p75"] = static_cast<Json::UInt64>(
             mMetrics.mOutboundQueueDelayDemand.GetSnapshot()
                 .get75thPercentile());
+
+        auto addDelayHistogram = [&](std::string const& name,
+                                     medida::Timer const& timer) {
+            auto snap = timer.GetSnapshot();
+            auto& h = res["outbound_queue_delay"][name];
+            h["p50"] = static_cast<Json::UInt64>(snap.getMedian());
+            h["p75"] = static_cast<Json::UInt64>(snap.get75thPercentile());
+            h["p99"] = static_cast<Json::UInt64>(snap.get99thPercentile());
+            h["max"] = static_cast<Json::UInt64>(timer.max());
+        };
+        addDelayHistogram("scp", mMetrics.mOutboundQueueDelaySCP);
+        addDelayHistogram("txs", mMetrics.mOutboundQueueDelayTxs);
+        addDelayHistogram("demand", mMetrics.mOutboundQueueDelayDemand);
+        addDelayHistogram("advert", mMetrics.mOutboundQueueDelayAdvert);
     }
 
     return res;
@@ -8,6 +8,7 @@
 #include "medida/timer.h"
 #include "overlay/FlowControlCapacity.h"
 #include "util/Timer.h"
+#include <deque>
 #include <optional>
 
 namespace stellar
@@ -48,6 +49,26 @@ class FlowControl
         medida::Timer mOutboundQueueDelayDemand;
     };
 
+    // Estimates how fast a stream of flood data drains, from the amount of
+    // data acknowledged between consecutive SEND_MORE messages. Like BBR's
+    // bottleneck bandwidth filter, the estimate is the maximum over the
+    // last few samples.
+    class DrainRateEstimator
+    {
+        std::deque<double> mSamples;
+        std::optional<VirtualClock::time_point> mLastSampleTime;
+
+      public:
+        // Records that `units` drained since the previous sample. Returns
+        // the time elapsed since then, if there was a previous sample.
+        std::optional<std::chrono::nanoseconds>
+        addSample(uint64_t units, VirtualClock::time_point now);
+        // Forget all samples and start measuring from `now`
+        void restart(VirtualClock::time_point now);
+        // In resource units per second, 0 if unknown
+        double getRate() const;
+    };
+
     // How many _hashes_ in total are queued?
     // NB: Each advert & demand contains a _vector_ of tx hashes.
     size_t mAdvertQueueTxHashCount{0};
@@ -69,7 +90,11 @@ class FlowControl
     // Priority 1 - transactions
     // Priority 2 - flood demands
     // Priority 3 - flood adverts
+    // SCP messages are always sent first, the other queues are served in
+    // weighted round-robin order (see maybeSendNextBatch).
     std::array<std::deque<QueuedOutboundMessage>, 4> mOutboundQueues;
+    // Number of messages each queue may send per round-robin turn
+    std::array<size_t, 4> mOutboundQueueWeights;
 
     // How many flood messages we received and processed since sending
     // SEND_MORE to this peer
@@ -81,11 +106,31 @@ class FlowControl
     FlowControlMetrics mMetrics;
     std::function<void(std::shared_ptr<StellarMessage>)> mSendCallback;
 
+    // Adaptive flow control state (see ENABLE_ADAPTIVE_FLOW_CONTROL)
+    bool const mAdaptive;
+    std::optional<std::chrono::milliseconds> mRTT;
+    DrainRateEstimator mInboundRate;
+    DrainRateEstimator mInboundRateBytes;
+    DrainRateEstimator mOutboundRateBytes;
+
+    // Resize the reading window of `capacity` based on its drain rate, and
+    // return the adjusted amount of capacity to grant in SEND_MORE.
+    uint64_t resizeReadingWindow(DrainRateEstimator& estimator,
+                                 FlowControlCapacity& capacity,
+                                 uint64_t granted, bool keepNonZero);
+
     // Release capacity used by this message. Return a struct that indicates how
     // much reading and flood capacity was freed
     void maybeSendNextBatch();
     // This methods drops obsolete load from the outbound queue
     void addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg);
+    // Pop the first message of an outbound queue, updating queue accounting
+    void popOutboundQueueFront(size_t queueIndex);
+    // Whether a queued message became useless while waiting to be sent:
+    // flood traffic past its deadline, or SCP statements for slots that
+    // are already closed or forgotten
+    bool isStaleAtSend(QueuedOutboundMessage const& queuedMsg,
+                       VirtualClock::time_point now) const;
     bool hasOutboundCapacity(StellarMessage const& msg) const;
 
   public:
@@ -96,6 +141,8 @@ class FlowControl
     void maybeReleaseCapacityAndTriggerSend(StellarMessage const& msg);
     virtual size_t getOutboundQueueByteLimit() const;
     void handleTxSizeIncrease(uint32_t increase);
+    // Latest round trip time measured for this peer
+    void updateRTT(std::chrono::milliseconds rtt);
 
 #ifdef BUILD_TESTS
     std::shared_ptr<FlowControlCapacity>
@@ -122,6 +169,12 @@ class FlowControl
         return mOutboundQueues;
     }
 
+    void
+    setOutboundQueueWeightsForTesting(std::array<size_t, 4> const& weights)
+    {
+        mOutboundQueueWeights = weights;
+    }
+
     size_t
     getTxQueueByteCountForTesting() const
     {
@@ -28,8 +28,9 @@ FlowControlMessageCapacity::getMsgResourceCount(StellarMessage const& msg) const
 FlowControlCapacity::ReadingCapacity
 FlowControlMessageCapacity::getCapacityLimits() const
 {
-    return {mConfig.PEER_FLOOD_READING_CAPACITY,
-            std::make_optional<uint64_t>(mConfig.PEER_READING_CAPACITY)};
+    return {mConfig.PEER_FLOOD_READING_CAPACITY + mFloodCapacityAdjustment,
+            std::make_optional<uint64_t>(mConfig.PEER_READING_CAPACITY +
+                                         mFloodCapacityAdjustment)};
 }
 
 void
@@ -65,7 +66,9 @@ FlowControlByteCapacity::FlowControlByteCapacity(Config const& cfg,
 FlowControlCapacity::ReadingCapacity
 FlowControlByteCapacity::getCapacityLimits() const
 {
-    return mCapacityLimits;
+    auto res = mCapacityLimits;
+    res.mFloodCapacity += mFloodCapacityAdjustment;
+    return res;
 }
 
 uint64_t
@@ -127,6 +130,45 @@ FlowControlCapacity::checkCapacityInvariants() const
     }
 }
 
+void
+FlowControlCapacity::adjustFloodCapacity(int64_t delta)
+{
+    ZoneScoped;
+    if (delta >= 0)
+    {
+        auto inc = static_cast<uint64_t>(delta);
+        mFloodCapacityAdjustment += inc;
+        mCapacity.mFloodCapacity += inc;
+        if (mCapacity.mTotalCapacity)
+        {
+            *mCapacity.mTotalCapacity += inc;
+        }
+    }
+    else
+    {
+        auto dec = static_cast<uint64_t>(-delta);
+        releaseAssert(dec <= getMaxFloodCapacityDecrease());
+        mFloodCapacityAdjustment -= dec;
+        mCapacity.mFloodCapacity -= dec;
+        if (mCapacity.mTotalCapacity)
+        {
+            *mCapacity.mTotalCapacity -= dec;
+        }
+    }
+    checkCapacityInvariants();
+}
+
+uint64_t
+FlowControlCapacity::getMaxFloodCapacityDecrease() const
+{
+    auto res = std::min(mFloodCapacityAdjustment, mCapacity.mFloodCapacity);
+    if (mCapacity.mTotalCapacity)
+    {
+        res = std::min(res, *mCapacity.mTotalCapacity);
+    }
+    return res;
+}
+
 void
 FlowControlCapacity::lockOutboundCapacity(StellarMessage const& msg)
 {
@@ -29,6 +29,10 @@ class FlowControlCapacity
     uint64_t mOutboundCapacity{0};
     NodeID const& mNodeID;
 
+    // Amount by which adaptive flow control grew the reading window above
+    // its configured size. Applied to both flood and total capacity limits.
+    uint64_t mFloodCapacityAdjustment{0};
+
   public:
     virtual uint64_t getMsgResourceCount(StellarMessage const& msg) const = 0;
     virtual ReadingCapacity getCapacityLimits() const = 0;
@@ -42,6 +46,19 @@ class FlowControlCapacity
 
     bool hasOutboundCapacity(StellarMessage const& msg) const;
     void checkCapacityInvariants() const;
+
+    // Grow (or shrink back towards the configured size) the local reading
+    // window by `delta`. Limits and available capacity move together, so the
+    // caller must advertise the same change to the peer in its next SEND_MORE.
+    void adjustFloodCapacity(int64_t delta);
+    // How much the window can currently shrink by without going below its
+    // configured size or the capacity that is available right now
+    uint64_t getMaxFloodCapacityDecrease() const;
+    uint64_t
+    getFloodCapacityAdjustment() const
+    {
+        return mFloodCapacityAdjustment;
+    }
     ReadingCapacity
     getCapacity() const
     {
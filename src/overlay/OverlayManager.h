@@ -208,6 +208,11 @@ class OverlayManager
     virtual void recordMessageMetric(StellarMessage const& stellarMsg,
                                      Peer::pointer peer) = 0;
 
+    // Appends a consensus message received from a peer to the SCP recording,
+    // if RECORD_SCP_MESSAGES_PATH is set. Called as the message is handed to
+    // the herder, so flooded duplicates are not recorded.
+    virtual void recordSCPMessage(StellarMessage const& stellarMsg) = 0;
+
     virtual AdjustedFlowControlConfig getFlowControlBytesConfig() const = 0;
 
     virtual void
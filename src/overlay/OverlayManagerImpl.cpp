@@ -9,6 +9,7 @@
 #include "crypto/ShortHash.h"
 #include "database/Database.h"
 #include "herder/Herder.h"
+#include "herder/TxFrameInternTable.h"
 #include "ledger/LedgerManager.h"
 #include "lib/util/finally.h"
 #include "lib/util/stdrandom.h"
@@ -312,6 +313,13 @@ OverlayManagerImpl::OverlayManagerImpl(Application& app)
         mPeerManager, RandomPeerSource::nextAttemptCutoff(PeerType::OUTBOUND));
     mPeerSources[PeerType::PREFERRED] = std::make_unique<RandomPeerSource>(
         mPeerManager, RandomPeerSource::nextAttemptCutoff(PeerType::PREFERRED));
+
+    auto const& recordPath = mApp.getConfig().RECORD_SCP_MESSAGES_PATH;
+    if (!recordPath.empty())
+    {
+        mSCPMessageRecorder =
+            std::make_unique<SCPMessageRecorder>(mApp, recordPath);
+    }
 }
 
 OverlayManagerImpl::~OverlayManagerImpl()
@@ -1149,6 +1157,11 @@ OverlayManagerImpl::recvTransaction(StellarMessage const& msg,
         mApp.getNetworkID(), msg.transaction());
     if (transaction)
     {
+        // Share the frame with the queue and the tx sets that already have
+        // this transaction.
+        transaction =
+            mApp.getHerder().getTxFrameInternTable().intern(transaction);
+
         // record that this peer sent us this transaction
         // add it to the floodmap so that this peer gets credit for it
         Hash msgID;
@@ -1158,36 +1171,46 @@ OverlayManagerImpl::recvTransaction(StellarMessage const& msg,
 
         // add it to our current set
         // and make sure it is valid
-        auto recvRes = mApp.getHerder().recvTransaction(transaction, false);
-        bool pulledRelevantTx = false;
-        if (!(recvRes == TransactionQueue::AddResult::ADD_STATUS_PENDING ||
-              recvRes == TransactionQueue::AddResult::ADD_STATUS_DUPLICATE))
-        {
-            forgetFloodedMsg(msgID);
-            CLOG_DEBUG(Overlay,
-                       "Peer::recvTransaction Discarded transaction {} from {}",
-                       hexAbbrev(transaction->getFullHash()), peer->toString());
-        }
-        else
+        mApp.getHerder().recvTransactionAsync(
+            transaction, false,
+            [this, transaction, peer,
+             msgID](TransactionQueue::AddResult recvRes) {
+                recvTransactionResult(transaction, peer, msgID, recvRes);
+            });
+    }
+}
+
+void
+OverlayManagerImpl::recvTransactionResult(
+    TransactionFrameBasePtr const& transaction, Peer::pointer peer,
+    Hash const& msgID, TransactionQueue::AddResult recvRes)
+{
+    bool pulledRelevantTx = false;
+    if (!(recvRes == TransactionQueue::AddResult::ADD_STATUS_PENDING ||
+          recvRes == TransactionQueue::AddResult::ADD_STATUS_DUPLICATE))
+    {
+        forgetFloodedMsg(msgID);
+        CLOG_DEBUG(Overlay,
+                   "Peer::recvTransaction Discarded transaction {} from {}",
+                   hexAbbrev(transaction->getFullHash()), peer->toString());
+    }
+    else
+    {
+        bool dup = recvRes == TransactionQueue::AddResult::ADD_STATUS_DUPLICATE;
+        if (!dup)
         {
-            bool dup =
-                recvRes == TransactionQueue::AddResult::ADD_STATUS_DUPLICATE;
-            if (!dup)
-            {
-                pulledRelevantTx = true;
-            }
-            CLOG_DEBUG(
-                Overlay,
-                "Peer::recvTransaction Received {} transaction {} from {}",
-                (dup ? "duplicate" : "unique"),
-                hexAbbrev(transaction->getFullHash()), peer->toString());
+            pulledRelevantTx = true;
         }
-
-        auto const& om = getOverlayMetrics();
-        auto& meter =
-            pulledRelevantTx ? om.mPulledRelevantTxs : om.mPulledIrrelevantTxs;
-        meter.Mark();
+        CLOG_DEBUG(Overlay,
+                   "Peer::recvTransaction Received {} transaction {} from {}",
+                   (dup ? "duplicate" : "unique"),
+                   hexAbbrev(transaction->getFullHash()), peer->toString());
     }
+
+    auto const& om = getOverlayMetrics();
+    auto& meter =
+        pulledRelevantTx ? om.mPulledRelevantTxs : om.mPulledIrrelevantTxs;
+    meter.Mark();
 }
 
 void
@@ -1273,6 +1296,8 @@ OverlayManagerImpl::shutdown()
     // Stop ticking and resolving peers
     mTimer.cancel();
     mPeerIPTimer.cancel();
+
+    mSCPMessageRecorder.reset();
 }
 
 bool
@@ -1281,6 +1306,15 @@ OverlayManagerImpl::isShuttingDown() const
     return mShuttingDown;
 }
 
+void
+OverlayManagerImpl::recordSCPMessage(StellarMessage const& stellarMsg)
+{
+    if (mSCPMessageRecorder)
+    {
+        mSCPMessageRecorder->record(stellarMsg);
+    }
+}
+
 void
 OverlayManagerImpl::recordMessageMetric(StellarMessage const& stellarMsg,
                                         Peer::pointer peer)
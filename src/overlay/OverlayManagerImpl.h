@@ -8,6 +8,8 @@
 #include "PeerAuth.h"
 #include "PeerDoor.h"
 #include "PeerManager.h"
+#include "herder/SCPMessageRecording.h"
+#include "herder/TransactionQueue.h"
 #include "herder/TxSetFrame.h"
 #include "ledger/LedgerTxn.h"
 #include "overlay/Floodgate.h"
@@ -102,8 +104,16 @@ class OverlayManagerImpl : public OverlayManager
 
     std::shared_ptr<SurveyManager> mSurveyManager;
 
+    std::unique_ptr<SCPMessageRecorder> mSCPMessageRecorder;
+
     int availableOutboundPendingSlots() const;
 
+    // Finishes processing of a transaction received from `peer` once the
+    // herder has decided whether to add it to the queue.
+    void recvTransactionResult(TransactionFrameBasePtr const& transaction,
+                               Peer::pointer peer, Hash const& msgID,
+                               TransactionQueue::AddResult recvRes);
+
   public:
     OverlayManagerImpl(Application& app);
     ~OverlayManagerImpl();
@@ -167,6 +177,7 @@ class OverlayManagerImpl : public OverlayManager
 
     void recordMessageMetric(StellarMessage const& stellarMsg,
                              Peer::pointer peer) override;
+    void recordSCPMessage(StellarMessage const& stellarMsg) override;
 
   private:
     struct ResolvedPeers
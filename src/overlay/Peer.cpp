@@ -1116,6 +1116,7 @@ Peer::recvTxSet(StellarMessage const& msg)
 {
     ZoneScoped;
     auto frame = TxSetXDRFrame::makeFromWire(msg.txSet());
+    mAppConnector.getOverlayManager().recordSCPMessage(msg);
     mAppConnector.getHerder().recvTxSet(frame->getContentsHash(), frame);
 }
 
@@ -1124,6 +1125,7 @@ Peer::recvGeneralizedTxSet(StellarMessage const& msg)
 {
     ZoneScoped;
     auto frame = TxSetXDRFrame::makeFromWire(msg.generalizedTxSet());
+    mAppConnector.getOverlayManager().recordSCPMessage(msg);
     mAppConnector.getHerder().recvTxSet(frame->getContentsHash(), frame);
 }
 
@@ -1170,6 +1172,7 @@ Peer::maybeProcessPingResponse(Hash const& id)
             CLOG_DEBUG(Overlay, "Latency {}: {} ms", toString(),
                        mLastPing.count());
             mOverlayMetrics.mConnectionLatencyTimer.Update(mLastPing);
+            mFlowControl->updateRTT(mLastPing);
         }
     }
 }
@@ -1211,6 +1214,7 @@ Peer::recvSCPQuorumSet(StellarMessage const& msg)
     ZoneScoped;
     Hash hash = xdrSha256(msg.qSet());
     maybeProcessPingResponse(hash);
+    mAppConnector.getOverlayManager().recordSCPMessage(msg);
     mAppConnector.getHerder().recvSCPQuorumSet(hash, msg.qSet());
 }
 
@@ -1251,8 +1255,12 @@ Peer::recvSCPMessage(StellarMessage const& msg)
 
     // add it to the floodmap so that this peer gets credit for it
     Hash msgID;
-    mAppConnector.getOverlayManager().recvFloodedMsgID(msg, shared_from_this(),
-                                                       msgID);
+    if (mAppConnector.getOverlayManager().recvFloodedMsgID(
+            msg, shared_from_this(), msgID))
+    {
+        // Copies of the envelope flooded by other peers are not recorded
+        mAppConnector.getOverlayManager().recordSCPMessage(msg);
+    }
 
     auto res = mAppConnector.getHerder().recvSCPEnvelope(envelope);
     if (res == Herder::ENVELOPE_STATUS_DISCARDED)
@@ -14,16 +14,22 @@
 #include "overlay/OverlayMetrics.h"
 #include "overlay/PeerDoor.h"
 #include "overlay/TCPPeer.h"
+#include "overlay/test/LoopbackPeer.h"
 #include "overlay/test/OverlayTestUtils.h"
 #include "simulation/Simulation.h"
 #include "simulation/Topologies.h"
 #include "test/TestAccount.h"
+#include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 #include "xdrpp/marshal.h"
 
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
 namespace stellar
 {
 using namespace txtest;
@@ -554,4 +560,68 @@ TEST_CASE("Flooding", "[flood][overlay][acceptance]")
         }
     }
 }
+
+TEST_CASE("Floodgate records peers per message", "[flood][overlay]")
+{
+    VirtualClock clock;
+    auto app1 = createTestApplication(clock, getTestConfig(0));
+    auto app2 = createTestApplication(clock, getTestConfig(1));
+    auto app3 = createTestApplication(clock, getTestConfig(2));
+
+    LoopbackPeerConnection conn12(*app1, *app2);
+    LoopbackPeerConnection conn13(*app1, *app3);
+    testutil::crankSome(clock);
+    REQUIRE(conn12.getInitiator()->isAuthenticated());
+    REQUIRE(conn13.getInitiator()->isAuthenticated());
+
+    Peer::pointer peer2 = conn12.getInitiator();
+    Peer::pointer peer3 = conn13.getInitiator();
+
+    auto& om = app1->getOverlayManager();
+    auto& known =
+        app1->getMetrics().NewCounter({"overlay", "memory", "flood-known"});
+    auto& dedupHits = app1->getMetrics().NewMeter(
+        {"overlay", "flood", "dedup-hit"}, "message");
+    auto dedupBefore = dedupHits.count();
+
+    StellarMessage msg;
+    msg.type(GET_SCP_STATE);
+    msg.getSCPLedgerSeq() = 42;
+
+    Hash msgID;
+    REQUIRE(om.recvFloodedMsgID(msg, peer2, msgID));
+    REQUIRE(!om.recvFloodedMsgID(msg, peer2, msgID));
+    REQUIRE(om.getPeersKnows(msgID) == std::set<Peer::pointer>{peer2});
+    REQUIRE(!om.recvFloodedMsgID(msg, peer3, msgID));
+    REQUIRE(om.getPeersKnows(msgID) == std::set<Peer::pointer>{peer2, peer3});
+    REQUIRE(known.count() == 1);
+    REQUIRE(dedupHits.count() == dedupBefore + 2);
+
+    SECTION("forget record")
+    {
+        om.forgetFloodedMsg(msgID);
+        REQUIRE(om.getPeersKnows(msgID).empty());
+        REQUIRE(known.count() == 1);
+        REQUIRE(om.recvFloodedMsgID(msg, peer3, msgID));
+        REQUIRE(om.getPeersKnows(msgID) == std::set<Peer::pointer>{peer3});
+    }
+    SECTION("clear by ledger")
+    {
+        auto lcl = app1->getLedgerManager().getLastClosedLedgerNum();
+        auto tracking = app1->getHerder().trackingConsensusLedgerIndex();
+        om.clearLedgersBelow(tracking, lcl);
+        REQUIRE(om.getPeersKnows(msgID).size() == 2);
+        om.clearLedgersBelow(tracking + 1, lcl);
+        REQUIRE(om.getPeersKnows(msgID).empty());
+        REQUIRE(known.count() == 0);
+
+        // peer slots were recycled, the record starts from scratch
+        REQUIRE(om.recvFloodedMsgID(msg, peer3, msgID));
+        REQUIRE(om.getPeersKnows(msgID) == std::set<Peer::pointer>{peer3});
+    }
+
+    testutil::shutdownWorkScheduler(*app3);
+    testutil::shutdownWorkScheduler(*app2);
+    testutil::shutdownWorkScheduler(*app1);
+}
 }
@@ -0,0 +1,288 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/HerderImpl.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "overlay/FlowControl.h"
+#include "overlay/OverlayManager.h"
+#include "scp/SCP.h"
+#include "simulation/LoadGenerator.h"
+#include "simulation/Simulation.h"
+#include "simulation/Topologies.h"
+#include "test/test.h"
+#include "util/Logging.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/stats/snapshot.h"
+#include "medida/timer.h"
+
+#include <ctime>
+#include <fmt/format.h>
+
+using namespace stellar;
+
+namespace
+{
+
+// Knobs for a single overlay load run. Rates are per second of simulated (for
+// loopback) or wall-clock (for TCP) time. Like the other benchmarks, the runs
+// use fixed values (see "overlay flood load") so that their results can be
+// compared across builds; edit them here to explore other loads.
+//
+// The defaults are a small core network under moderate load: 4 nodes tolerate
+// one failure, 1000 accounts keep per-account sequence number chains short,
+// and 5000 txs at 100 tx/s last 50s, i.e. about 10 ledgers.
+struct OverlayLoadConfig
+{
+    Simulation::Mode mMode{Simulation::OVER_LOOPBACK};
+    int mNumNodes{4};
+    uint32_t mNumAccounts{1000};
+    uint32_t mNumTxs{5000};
+    uint32_t mTxRate{100};
+    // Every node re-sends its latest SCP envelopes directly to each of its
+    // peers at this rate, in addition to the regular consensus traffic. The
+    // envelopes are valid, so receivers run them through the full overlay
+    // receive path before Floodgate rejects them as duplicates.
+    uint32_t mSCPReplayRate{50};
+};
+
+struct OverlayLoadTotals
+{
+    int64_t mMessagesRead{0};
+    int64_t mMessagesWritten{0};
+    int64_t mMessagesDropped{0};
+    int64_t mDropSCP{0};
+    int64_t mDropTxs{0};
+    int64_t mDropAdvert{0};
+    int64_t mDropDemand{0};
+    size_t mMaxQueueDepth[4]{0, 0, 0, 0};
+    size_t mMaxTxQueueBytes{0};
+};
+
+int64_t
+meterCount(Application& app, std::string const& a, std::string const& b,
+           std::string const& c, std::string const& unit)
+{
+    return app.getMetrics().NewMeter({a, b, c}, unit).count();
+}
+
+void
+sampleQueueDepths(Simulation::pointer simulation, OverlayLoadTotals& totals)
+{
+    for (auto const& node : simulation->getNodes())
+    {
+        for (auto const& kv :
+             node->getOverlayManager().getAuthenticatedPeers())
+        {
+            auto fc = kv.second->getFlowControl();
+            if (!fc)
+            {
+                continue;
+            }
+            auto& queues = fc->getQueuesForTesting();
+            for (size_t i = 0; i < queues.size(); ++i)
+            {
+                totals.mMaxQueueDepth[i] =
+                    std::max(totals.mMaxQueueDepth[i], queues[i].size());
+            }
+            totals.mMaxTxQueueBytes = std::max(
+                totals.mMaxTxQueueBytes, fc->getTxQueueByteCountForTesting());
+        }
+    }
+}
+
+void
+replaySCPEnvelopes(Application& app, size_t count)
+{
+    auto& herder = static_cast<HerderImpl&>(app.getHerder());
+    auto envs = herder.getSCP().getLatestMessagesSend(
+        herder.trackingConsensusLedgerIndex() + 1);
+    if (envs.empty())
+    {
+        envs = herder.getSCP().getLatestMessagesSend(
+            herder.trackingConsensusLedgerIndex());
+    }
+    if (envs.empty())
+    {
+        return;
+    }
+
+    auto peers = app.getOverlayManager().getAuthenticatedPeers();
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto msg = std::make_shared<StellarMessage>();
+        msg->type(SCP_MESSAGE);
+        msg->envelope() = envs[i % envs.size()];
+        for (auto const& kv : peers)
+        {
+            kv.second->sendMessage(msg, false);
+        }
+    }
+}
+
+void
+logTimer(Application& app, std::string const& a, std::string const& b,
+         std::string const& c)
+{
+    auto& timer = app.getMetrics().NewTimer({a, b, c});
+    auto snap = timer.GetSnapshot();
+    CLOG_INFO(Overlay,
+              "  {}.{}.{}: count={} p50={:.3f} p75={:.3f} p99={:.3f} "
+              "max={:.3f} (ms)",
+              a, b, c, timer.count(), snap.getMedian(),
+              snap.get75thPercentile(), snap.get99thPercentile(), timer.max());
+}
+
+void
+runOverlayLoad(OverlayLoadConfig const& load)
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto simulation = Topologies::core(
+        load.mNumNodes, 1.0, load.mMode, networkID, [&](int i) {
+            auto cfg = getTestConfig(i);
+            cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = load.mTxRate * 10;
+            return cfg;
+        });
+
+    simulation->startAllNodes();
+    simulation->crankUntil(
+        [&] { return simulation->haveAllExternalized(3, 1); },
+        2 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto nodes = simulation->getNodes();
+    auto& loadGen = nodes[0]->getLoadGenerator();
+    auto& complete =
+        nodes[0]->getMetrics().NewMeter({"loadgen", "run", "complete"}, "run");
+    auto& failed =
+        nodes[0]->getMetrics().NewMeter({"loadgen", "run", "failed"}, "run");
+
+    loadGen.generateLoad(
+        GeneratedLoadConfig::createAccountsLoad(load.mNumAccounts, 1));
+    simulation->crankUntil([&] { return complete.count() == 1; },
+                           100 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    // Only measure the payment phase
+    for (auto const& node : nodes)
+    {
+        node->clearMetrics("overlay");
+    }
+
+    loadGen.generateLoad(GeneratedLoadConfig::txLoad(
+        LoadGenMode::PAY, load.mNumAccounts, load.mNumTxs, load.mTxRate));
+
+    auto const step = std::chrono::milliseconds(100);
+    auto const replayPerStep = std::max<size_t>(load.mSCPReplayRate / 10, 1);
+    OverlayLoadTotals totals;
+    auto cpuStart = std::clock();
+    auto wallStart = std::chrono::steady_clock::now();
+    while (complete.count() < 2 && failed.count() == 0)
+    {
+        if (load.mSCPReplayRate > 0)
+        {
+            for (auto const& node : nodes)
+            {
+                replaySCPEnvelopes(*node, replayPerStep);
+            }
+        }
+        simulation->crankForAtLeast(step, false);
+        sampleQueueDepths(simulation, totals);
+    }
+    auto cpuSeconds =
+        static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    auto wallSeconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - wallStart)
+                           .count();
+    REQUIRE(failed.count() == 0);
+
+    for (auto const& node : nodes)
+    {
+        auto& app = *node;
+        totals.mMessagesRead +=
+            meterCount(app, "overlay", "message", "read", "message");
+        totals.mMessagesWritten +=
+            meterCount(app, "overlay", "message", "write", "message");
+        totals.mMessagesDropped +=
+            meterCount(app, "overlay", "message", "drop", "message");
+        totals.mDropSCP +=
+            meterCount(app, "overlay", "outbound-queue", "drop-scp", "message");
+        totals.mDropTxs +=
+            meterCount(app, "overlay", "outbound-queue", "drop-tx", "message");
+        totals.mDropAdvert += meterCount(app, "overlay", "outbound-queue",
+                                         "drop-advert", "message");
+        totals.mDropDemand += meterCount(app, "overlay", "outbound-queue",
+                                         "drop-demand", "message");
+    }
+
+    CLOG_INFO(Overlay,
+              "Overlay load ({}, {} nodes, {} tx/s, {} scp/s): {} txs in "
+              "{:.2f}s wall",
+              load.mMode == Simulation::OVER_TCP ? "tcp" : "loopback",
+              load.mNumNodes, load.mTxRate, load.mSCPReplayRate, load.mNumTxs,
+              wallSeconds);
+    CLOG_INFO(Overlay,
+              "  messages read={} written={} dropped={}, CPU per message read "
+              "{:.2f}us",
+              totals.mMessagesRead, totals.mMessagesWritten,
+              totals.mMessagesDropped,
+              totals.mMessagesRead == 0
+                  ? 0.0
+                  : cpuSeconds * 1e6 / totals.mMessagesRead);
+    CLOG_INFO(Overlay,
+              "  outbound drops scp={} tx={} advert={} demand={}",
+              totals.mDropSCP, totals.mDropTxs, totals.mDropAdvert,
+              totals.mDropDemand);
+    CLOG_INFO(Overlay,
+              "  max outbound queue depth scp={} tx={} demand={} advert={}, "
+              "max tx queue bytes={}",
+              totals.mMaxQueueDepth[0], totals.mMaxQueueDepth[1],
+              totals.mMaxQueueDepth[2], totals.mMaxQueueDepth[3],
+              totals.mMaxTxQueueBytes);
+
+    for (auto const& node : nodes)
+    {
+        auto& app = *node;
+        CLOG_INFO(Overlay, "Node {} latencies:",
+                  app.getConfig().toShortString(
+                      app.getConfig().NODE_SEED.getPublicKey()));
+        logTimer(app, "overlay", "flood", "tx-pull-latency");
+        logTimer(app, "overlay", "outbound-queue", "scp");
+        logTimer(app, "overlay", "outbound-queue", "tx");
+        logTimer(app, "overlay", "recv", "scp-message");
+        logTimer(app, "overlay", "recv", "transaction");
+    }
+}
+}
+
+TEST_CASE("overlay flood load", "[overlay][bench][!hide]")
+{
+    OverlayLoadConfig load;
+
+    SECTION("loopback")
+    {
+        load.mMode = Simulation::OVER_LOOPBACK;
+        SECTION("low rate")
+        {
+            runOverlayLoad(load);
+        }
+        SECTION("high rate")
+        {
+            // 7 nodes (tolerating two failures) at 5x the default tx rate,
+            // with as many duplicate SCP messages as txs: enough to fill the
+            // outbound queues and make them drop messages
+            load.mNumNodes = 7;
+            load.mNumTxs = 20000;
+            load.mTxRate = 500;
+            load.mSCPReplayRate = 500;
+            runOverlayLoad(load);
+        }
+    }
+    SECTION("tcp")
+    {
+        // The default load over real sockets, to compare with loopback
+        load.mMode = Simulation::OVER_TCP;
+        runOverlayLoad(load);
+    }
+}
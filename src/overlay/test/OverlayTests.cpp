@@ -8,6 +8,7 @@
 #include "main/Application.h"
 #include "main/Config.h"
 #include "overlay/BanManager.h"
+#include "overlay/FlowControlCapacity.h"
 #include "overlay/OverlayManagerImpl.h"
 #include "overlay/PeerManager.h"
 #include "overlay/TCPPeer.h"
@@ -929,6 +930,147 @@ TEST_CASE("drop peers that overflow capacity", "[overlay][flowcontrol]")
     testutil::shutdownWorkScheduler(*app1);
 }
 
+TEST_CASE("adaptive flow control window adjustment", "[overlay][flowcontrol]")
+{
+    auto cfg = getTestConfig();
+    NodeID const nodeID = cfg.NODE_SEED.getPublicKey();
+    FlowControlMessageCapacity capacity(cfg, nodeID);
+    auto const base = capacity.getCapacityLimits();
+    REQUIRE(capacity.getMaxFloodCapacityDecrease() == 0);
+
+    // Growing the window moves limits and available capacity together
+    capacity.adjustFloodCapacity(10);
+    REQUIRE(capacity.getFloodCapacityAdjustment() == 10);
+    REQUIRE(capacity.getCapacityLimits().mFloodCapacity ==
+            base.mFloodCapacity + 10);
+    REQUIRE(*capacity.getCapacityLimits().mTotalCapacity ==
+            *base.mTotalCapacity + 10);
+    REQUIRE(capacity.getCapacity().mFloodCapacity == base.mFloodCapacity + 10);
+
+    StellarMessage tx;
+    tx.type(TRANSACTION);
+    REQUIRE(capacity.lockLocalCapacity(tx));
+    REQUIRE(capacity.getMaxFloodCapacityDecrease() == 10);
+
+    // Shrinking never goes below the configured window
+    capacity.adjustFloodCapacity(-10);
+    REQUIRE(capacity.getFloodCapacityAdjustment() == 0);
+    REQUIRE(capacity.getCapacityLimits().mFloodCapacity == base.mFloodCapacity);
+    REQUIRE(capacity.getCapacity().mFloodCapacity == base.mFloodCapacity - 1);
+    REQUIRE(capacity.getMaxFloodCapacityDecrease() == 0);
+
+    capacity.releaseLocalCapacity(tx);
+    REQUIRE(capacity.getCapacity().mFloodCapacity == base.mFloodCapacity);
+}
+
+TEST_CASE("adaptive flow control follows the peer drain rate",
+          "[overlay][flowcontrol]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.ENABLE_ADAPTIVE_FLOW_CONTROL = true;
+    auto app = createTestApplication(clock, cfg);
+    OverlayAppConnector connector(*app);
+    FlowControl fc(connector);
+    auto const peerID = getTestConfig(1).NODE_SEED.getPublicKey();
+
+    auto advance = [&](std::chrono::milliseconds duration) {
+        clock.setCurrentVirtualTime(clock.now() + duration);
+    };
+
+    StellarMessage tx;
+    tx.type(TRANSACTION);
+
+    SECTION("reading window")
+    {
+        fc.start(peerID, [](std::shared_ptr<StellarMessage>) {}, std::nullopt);
+        fc.updateRTT(std::chrono::milliseconds(100));
+        auto capacity = fc.getCapacity();
+        auto const base = capacity->getCapacityLimits().mFloodCapacity;
+        auto const max = base * cfg.ADAPTIVE_FLOW_CONTROL_MAX_WINDOW_MULTIPLIER;
+
+        // Processes a batch of messages, the time it takes the peer to send
+        // the next one
+        auto processBatch = [&](std::chrono::milliseconds delay) {
+            for (uint32_t i = 0; i < cfg.FLOW_CONTROL_SEND_MORE_BATCH_SIZE;
+                 ++i)
+            {
+                REQUIRE(fc.beginMessageProcessing(tx));
+                fc.endMessageProcessing(tx);
+            }
+            auto limit = capacity->getCapacityLimits().mFloodCapacity;
+            REQUIRE(limit >= base);
+            REQUIRE(limit <= max);
+            advance(delay);
+            return limit;
+        };
+
+        // A fast peer gets a larger window, up to the configured maximum
+        uint64_t limit = base;
+        for (int i = 0; i < 20; ++i)
+        {
+            auto newLimit = processBatch(std::chrono::milliseconds(10));
+            REQUIRE(newLimit >= limit);
+            limit = newLimit;
+        }
+        REQUIRE(limit == max);
+
+        // Once it slows down, the window shrinks back to the configured one
+        for (int i = 0; i < 30; ++i)
+        {
+            auto newLimit = processBatch(std::chrono::seconds(10));
+            REQUIRE(newLimit <= limit);
+            limit = newLimit;
+        }
+        REQUIRE(limit == base);
+        REQUIRE(capacity->getFloodCapacityAdjustment() == 0);
+    }
+
+    SECTION("outbound queue")
+    {
+        fc.start(peerID, [](std::shared_ptr<StellarMessage>) {},
+                 std::make_optional<uint32_t>(
+                     cfg.PEER_FLOOD_READING_CAPACITY_BYTES));
+        auto const configured = cfg.OUTBOUND_TX_QUEUE_BYTE_LIMIT;
+        auto const floor = std::min<size_t>(
+            2 * static_cast<size_t>(app->getHerder().getMaxTxSize()),
+            configured);
+        REQUIRE(fc.getOutboundQueueByteLimit() == configured);
+
+        auto sendMore = [&](uint32_t numMessages, uint32_t numBytes) {
+            StellarMessage msg;
+            msg.type(SEND_MORE_EXTENDED);
+            msg.sendMoreExtendedMessage().numMessages = numMessages;
+            msg.sendMoreExtendedMessage().numBytes = numBytes;
+            fc.maybeReleaseCapacityAndTriggerSend(msg);
+        };
+
+        // Queue more than the peer lets us send
+        for (int i = 0; i < 10; ++i)
+        {
+            fc.addToQueueAndMaybeTrimForTesting(
+                std::make_shared<StellarMessage const>(tx));
+        }
+
+        // A slow peer only gets what it drains in a short while
+        for (int i = 0; i < 5; ++i)
+        {
+            sendMore(100, 1);
+            advance(std::chrono::seconds(1));
+        }
+        auto limit = fc.getOutboundQueueByteLimit();
+        REQUIRE(limit < configured);
+        REQUIRE(limit >= floor);
+
+        // Once it catches up, the limit goes back to the configured one
+        sendMore(100, UINT32_MAX / 2);
+        REQUIRE(fc.getQueuesForTesting()[1].empty());
+        advance(std::chrono::seconds(1));
+        sendMore(100, 1);
+        REQUIRE(fc.getOutboundQueueByteLimit() == configured);
+    }
+}
+
 TEST_CASE("failed auth", "[overlay][connections]")
 {
     VirtualClock clock;
@@ -1179,6 +1321,22 @@ TEST_CASE("outbound queue filtering", "[overlay][connections]")
             }
         }
     }
+    SECTION("SCP messages for closed slots dropped at send time")
+    {
+        auto& dropMeter = node->getOverlayManager()
+                              .getOverlayMetrics()
+                              .mOutboundQueueDropSCP;
+        for (auto const& env : envs)
+        {
+            // All statements are for `lcl`, which this node already closed:
+            // only EXTERNALIZE is still worth sending
+            auto dropped = dropMeter.count();
+            peer->getFlowControl()->maybeSendMessage(constructSCPMsg(env));
+            bool externalize =
+                env.statement.pledges.type() == SCP_ST_EXTERNALIZE;
+            REQUIRE(dropMeter.count() == dropped + (externalize ? 0 : 1));
+        }
+    }
     SECTION("advert demand limit reached")
     {
         SECTION("count-based")
@@ -1239,6 +1397,74 @@ TEST_CASE("outbound queue filtering", "[overlay][connections]")
     }
 }
 
+TEST_CASE("outbound queues weighted round-robin", "[overlay][flowcontrol]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    OverlayAppConnector connector(*app);
+    FlowControl fc(connector);
+
+    std::vector<MessageType> sent;
+    fc.start(getTestConfig(1).NODE_SEED.getPublicKey(),
+             [&](std::shared_ptr<StellarMessage> msg) {
+                 sent.emplace_back(msg->type());
+             },
+             std::nullopt);
+
+    auto fillQueues = [&](size_t count) {
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto hash = sha256(std::to_string(i));
+            StellarMessage tx;
+            tx.type(TRANSACTION);
+            StellarMessage demand;
+            demand.type(FLOOD_DEMAND);
+            demand.floodDemand().txHashes.emplace_back(hash);
+            StellarMessage advert;
+            advert.type(FLOOD_ADVERT);
+            advert.floodAdvert().txHashes.emplace_back(hash);
+            for (auto const& msg : {tx, demand, advert})
+            {
+                fc.addToQueueAndMaybeTrimForTesting(
+                    std::make_shared<StellarMessage const>(msg));
+            }
+        }
+    };
+    // Let the peer accept `count` more messages, which sends them
+    auto grantCapacity = [&](uint32_t count) {
+        StellarMessage sendMore;
+        sendMore.type(SEND_MORE);
+        sendMore.sendMoreMessage().numMessages = count;
+        fc.maybeReleaseCapacityAndTriggerSend(sendMore);
+    };
+
+    auto const T = TRANSACTION;
+    auto const D = FLOOD_DEMAND;
+    auto const A = FLOOD_ADVERT;
+
+    SECTION("default weights")
+    {
+        fillQueues(10);
+        grantCapacity(14);
+        REQUIRE(sent == std::vector<MessageType>{T, T, T, T, D, D, A, T, T, T,
+                                                 T, D, D, A});
+    }
+    SECTION("queue without weight still sends")
+    {
+        fc.setOutboundQueueWeightsForTesting({0, 3, 0, 1});
+        fillQueues(10);
+        grantCapacity(10);
+        REQUIRE(sent ==
+                std::vector<MessageType>{T, T, T, D, A, T, T, T, D, A});
+    }
+    SECTION("other queues keep sending once one is empty")
+    {
+        fillQueues(2);
+        grantCapacity(6);
+        REQUIRE(sent == std::vector<MessageType>{T, T, D, D, A, A});
+    }
+}
+
 TEST_CASE("reject non preferred peer", "[overlay][connections]")
 {
     VirtualClock clock;
@@ -49,6 +49,8 @@ class ProcessManager : public std::enable_shared_from_this<ProcessManager>,
 {
   public:
     static std::shared_ptr<ProcessManager> create(Application& app);
+    // Arguments of `cmdLine` are separated by whitespace, and can be
+    // double-quoted to contain whitespace.
     virtual std::weak_ptr<ProcessExitEvent>
     runProcess(std::string const& cmdLine, std::string outputFile) = 0;
 
@@ -427,6 +427,14 @@ FeeBumpTransactionFrame::getFullHash() const
     return mFullHash;
 }
 
+void
+FeeBumpTransactionFrame::precomputeHashesAndSize() const
+{
+    getFullHash();
+    getContentsHash();
+    mInnerTx->precomputeHashesAndSize();
+}
+
 Hash const&
 FeeBumpTransactionFrame::getInnerFullHash() const
 {
@@ -465,6 +473,26 @@ FeeBumpTransactionFrame::getResultCode() const
     return mResult.result.code();
 }
 
+void
+FeeBumpTransactionFrame::setReplayResult(TransactionResult const& result)
+{
+    // Only the inner transaction checks signatures and applies operations
+    if (result.result.code() != txFEE_BUMP_INNER_SUCCESS &&
+        result.result.code() != txFEE_BUMP_INNER_FAILED)
+    {
+        return;
+    }
+    auto const& inner = result.result.innerResultPair().result;
+    TransactionResult innerResult;
+    innerResult.feeCharged = inner.feeCharged;
+    innerResult.result.code(inner.result.code());
+    if (inner.result.code() == txSUCCESS || inner.result.code() == txFAILED)
+    {
+        innerResult.result.results() = inner.result.results();
+    }
+    mInnerTx->setReplayResult(innerResult);
+}
+
 SequenceNumber
 FeeBumpTransactionFrame::getSeqNum() const
 {
@@ -79,6 +79,7 @@ class FeeBumpTransactionFrame : public TransactionFrameBase
 
     Hash const& getContentsHash() const override;
     Hash const& getFullHash() const override;
+    void precomputeHashesAndSize() const override;
     Hash const& getInnerFullHash() const;
 
     uint32_t getNumOperations() const override;
@@ -88,6 +89,7 @@ class FeeBumpTransactionFrame : public TransactionFrameBase
 
     TransactionResult& getResult() override;
     TransactionResultCode getResultCode() const override;
+    void setReplayResult(TransactionResult const& result) override;
 
     SequenceNumber getSeqNum() const override;
     AccountID getFeeSourceID() const override;
@@ -156,4 +156,24 @@ SignatureChecker::checkAllSignaturesUsed() const
     }
     return true;
 }
+
+AlwaysValidSignatureChecker::AlwaysValidSignatureChecker(
+    uint32_t protocolVersion, Hash const& contentsHash,
+    xdr::xvector<DecoratedSignature, 20> const& signatures)
+    : SignatureChecker(protocolVersion, contentsHash, signatures)
+{
+}
+
+bool
+AlwaysValidSignatureChecker::checkSignature(std::vector<Signer> const&,
+                                            int32_t)
+{
+    return true;
+}
+
+bool
+AlwaysValidSignatureChecker::checkAllSignaturesUsed() const
+{
+    return true;
+}
 };
@@ -23,9 +23,11 @@ class SignatureChecker
         uint32_t protocolVersion, Hash const& contentsHash,
         xdr::xvector<DecoratedSignature, 20> const& signatures);
 
-    bool checkSignature(std::vector<Signer> const& signersV,
-                        int32_t neededWeight);
-    bool checkAllSignaturesUsed() const;
+    virtual ~SignatureChecker() = default;
+
+    virtual bool checkSignature(std::vector<Signer> const& signersV,
+                                int32_t neededWeight);
+    virtual bool checkAllSignaturesUsed() const;
 
   private:
     uint32_t mProtocolVersion;
@@ -34,4 +36,19 @@ class SignatureChecker
 
     std::vector<bool> mUsedSignatures;
 };
+
+// Accepts every signature. Only used to replay transactions whose results are
+// already known and verified, as the signatures were checked when they were
+// originally applied.
+class AlwaysValidSignatureChecker : public SignatureChecker
+{
+  public:
+    AlwaysValidSignatureChecker(
+        uint32_t protocolVersion, Hash const& contentsHash,
+        xdr::xvector<DecoratedSignature, 20> const& signatures);
+
+    bool checkSignature(std::vector<Signer> const& signersV,
+                        int32_t neededWeight) override;
+    bool checkAllSignaturesUsed() const override;
+};
 };
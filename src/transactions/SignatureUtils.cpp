@@ -7,9 +7,13 @@
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "crypto/SignerKey.h"
+#include "transactions/TransactionFrameBase.h"
+#include "transactions/TransactionUtils.h"
 #include "util/GlobalChecks.h"
 #include "xdr/Stellar-transaction.h"
+#include "xdrpp/marshal.h"
 #include <Tracy.hpp>
+#include <algorithm>
 
 namespace stellar
 {
@@ -17,6 +21,61 @@ namespace stellar
 namespace SignatureUtils
 {
 
+namespace
+{
+void
+addSigner(std::vector<PublicKey>& signers, PublicKey const& key)
+{
+    if (std::find(signers.begin(), signers.end(), key) == signers.end())
+    {
+        signers.emplace_back(key);
+    }
+}
+
+std::vector<PublicKey>
+getSigners(AccountID const& source, std::vector<Operation> const& ops,
+           AccountSignersLoader const& loadSigners)
+{
+    std::vector<AccountID> accounts{source};
+    for (auto const& op : ops)
+    {
+        if (op.sourceAccount)
+        {
+            addSigner(accounts, toAccountID(*op.sourceAccount));
+        }
+    }
+
+    std::vector<PublicKey> signers;
+    for (auto const& account : accounts)
+    {
+        addSigner(signers, account);
+        if (loadSigners)
+        {
+            for (auto const& signer : loadSigners(account))
+            {
+                addSigner(signers, signer);
+            }
+        }
+    }
+    return signers;
+}
+
+void
+verifyMatchingSignatures(Hash const& contentsHash,
+                         std::vector<DecoratedSignature> const& signatures,
+                         std::vector<PublicKey> const& signers)
+{
+    for (auto const& sig : signatures)
+    {
+        for (auto const& signer : signers)
+        {
+            // Result lands in the signature verification cache
+            verify(sig, signer, contentsHash);
+        }
+    }
+}
+}
+
 DecoratedSignature
 sign(SecretKey const& secretKey, Hash const& hash)
 {
@@ -134,5 +193,49 @@ doesHintMatch(ByteSlice const& bs, SignatureHint const& hint)
 
     return memcmp(bs.end() - hint.size(), hint.data(), hint.size()) == 0;
 }
+
+void
+populateSignatureCache(TransactionFrameBase const& tx, Hash const& networkID,
+                       AccountSignersLoader const& loadSigners)
+{
+    ZoneScoped;
+    auto const& env = tx.getEnvelope();
+    switch (env.type())
+    {
+    case ENVELOPE_TYPE_TX_V0:
+    {
+        AccountID source;
+        source.ed25519() = env.v0().tx.sourceAccountEd25519;
+        verifyMatchingSignatures(
+            tx.getContentsHash(), env.v0().signatures,
+            getSigners(source, env.v0().tx.operations, loadSigners));
+        break;
+    }
+    case ENVELOPE_TYPE_TX:
+        verifyMatchingSignatures(
+            tx.getContentsHash(), env.v1().signatures,
+            getSigners(toAccountID(env.v1().tx.sourceAccount),
+                       env.v1().tx.operations, loadSigners));
+        break;
+    case ENVELOPE_TYPE_TX_FEE_BUMP:
+    {
+        auto const& feeBump = env.feeBump();
+        verifyMatchingSignatures(
+            tx.getContentsHash(), feeBump.signatures,
+            getSigners(toAccountID(feeBump.tx.feeSource), {}, loadSigners));
+
+        auto const& inner = feeBump.tx.innerTx.v1();
+        auto innerHash =
+            sha256(xdr::xdr_to_opaque(networkID, ENVELOPE_TYPE_TX, inner.tx));
+        verifyMatchingSignatures(
+            innerHash, inner.signatures,
+            getSigners(toAccountID(inner.tx.sourceAccount),
+                       inner.tx.operations, loadSigners));
+        break;
+    }
+    default:
+        break;
+    }
+}
 }
 }
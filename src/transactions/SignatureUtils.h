@@ -6,11 +6,15 @@
 
 #include "xdr/Stellar-ledger-entries.h"
 
+#include <functional>
+#include <vector>
+
 namespace stellar
 {
 
 class ByteSlice;
 class SecretKey;
+class TransactionFrameBase;
 struct DecoratedSignature;
 struct SignerKey;
 
@@ -32,5 +36,21 @@ SignatureHint
 getSignedPayloadHint(SignerKey::_ed25519SignedPayload_t const& signedPayload);
 SignatureHint getHint(ByteSlice const& bs);
 bool doesHintMatch(ByteSlice const& bs, SignatureHint const& hint);
+
+// Returns the additional ed25519 signers of an account.
+using AccountSignersLoader =
+    std::function<std::vector<PublicKey>(AccountID const& accountID)>;
+
+// Verifies the signatures of `tx` (including the inner transaction of a fee
+// bump) that match the master keys of its source accounts, or the signers
+// returned by `loadSigners` when it's set, so that the results land in the
+// signature verification cache and later checks don't have to redo them.
+// This doesn't access the ledger and can run on a background thread, as long
+// as the hashes of `tx` have already been computed. The signature cache is
+// locked and evicts with its own random engine, so it can be filled from
+// several threads while the main thread uses gRandomEngine.
+void populateSignatureCache(TransactionFrameBase const& tx,
+                            Hash const& networkID,
+                            AccountSignersLoader const& loadSigners);
 }
 }
@@ -39,6 +39,7 @@
 #include <Tracy.hpp>
 #include <iterator>
 #include <string>
+#include <utility>
 
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
@@ -126,6 +127,15 @@ TransactionFrame::clearCached()
     Hash zero;
     mContentsHash = zero;
     mFullHash = zero;
+    mSize = 0;
+}
+
+void
+TransactionFrame::precomputeHashesAndSize() const
+{
+    getFullHash();
+    getContentsHash();
+    getSize();
 }
 
 void
@@ -1653,6 +1663,12 @@ TransactionFrame::insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const
     }
 }
 
+void
+TransactionFrame::setReplayResult(TransactionResult const& result)
+{
+    mReplayResult = result;
+}
+
 void
 TransactionFrame::markResultFailed()
 {
@@ -1901,8 +1917,30 @@ TransactionFrame::apply(Application& app, AbstractLedgerTxn& ltx,
     {
         mCachedAccount.reset();
         uint32_t ledgerVersion = ltx.loadHeader().current().ledgerVersion;
-        SignatureChecker signatureChecker{ledgerVersion, getContentsHash(),
-                                          getSignatures(mEnvelope)};
+
+        // A transaction known to have succeeded or failed passed validation
+        // when it was originally applied, so its signatures are not checked
+        // again. Other results are reproduced by running the full checks.
+        auto replayResult = std::exchange(mReplayResult, std::nullopt);
+        bool knownValid =
+            replayResult && (replayResult->result.code() == txSUCCESS ||
+                             replayResult->result.code() == txFAILED);
+        std::unique_ptr<SignatureChecker> checker;
+        if (knownValid)
+        {
+            app.getMetrics()
+                .NewMeter({"ledger", "transaction", "replay-known-valid"},
+                          "transaction")
+                .Mark();
+            checker = std::make_unique<AlwaysValidSignatureChecker>(
+                ledgerVersion, getContentsHash(), getSignatures(mEnvelope));
+        }
+        else
+        {
+            checker = std::make_unique<SignatureChecker>(
+                ledgerVersion, getContentsHash(), getSignatures(mEnvelope));
+        }
+        auto& signatureChecker = *checker;
 
         //  when applying, a failure during tx validation means that
         //  we'll skip trying to apply operations but we'll still
@@ -1948,8 +1986,35 @@ TransactionFrame::apply(Application& app, AbstractLedgerTxn& ltx,
                     updateSorobanMetrics(app);
                 }
 
-                ok = applyOperations(signatureChecker, app, ltx, meta,
-                                     sorobanBasePrngSeed);
+                if (knownValid && !isSoroban() &&
+                    replayResult->result.code() == txFAILED &&
+                    replayResult->result.results().size() == mOperations.size())
+                {
+                    // The operations of a failed classic transaction don't
+                    // change the ledger nor its meta, so only its result needs
+                    // to be reproduced (failed Soroban transactions still emit
+                    // diagnostic events and fee info, so they are applied).
+                    // The operation frames refer to the result elements, which
+                    // are assigned one by one.
+                    app.getMetrics()
+                        .NewMeter({"ledger", "transaction",
+                                   "replay-known-failed"},
+                                  "transaction")
+                        .Mark();
+                    markResultFailed();
+                    auto& results = getResult().result.results();
+                    auto const& known = replayResult->result.results();
+                    for (size_t i = 0; i < results.size(); ++i)
+                    {
+                        results[i] = known[i];
+                    }
+                    ok = false;
+                }
+                else
+                {
+                    ok = applyOperations(signatureChecker, app, ltx, meta,
+                                         sorobanBasePrngSeed);
+                }
             }
             return ok;
         }
@@ -2041,6 +2106,10 @@ uint32_t
 TransactionFrame::getSize() const
 {
     ZoneScoped;
-    return static_cast<uint32_t>(xdr::xdr_size(mEnvelope));
+    if (mSize == 0)
+    {
+        mSize = static_cast<uint32_t>(xdr::xdr_size(mEnvelope));
+    }
+    return mSize;
 }
 } // namespace stellar
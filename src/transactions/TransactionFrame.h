@@ -73,9 +73,12 @@ class TransactionFrame : public TransactionFrameBase
 
     std::shared_ptr<InternalLedgerEntry const> mCachedAccount;
 
+    std::optional<TransactionResult> mReplayResult;
+
     Hash const& mNetworkID;     // used to change the way we compute signatures
     mutable Hash mContentsHash; // the hash of the contents
     mutable Hash mFullHash;     // the hash of the contents and the sig.
+    mutable uint32_t mSize{0};  // the size of the envelope XDR
 
     std::vector<std::shared_ptr<OperationFrame>> mOperations;
 
@@ -177,6 +180,7 @@ class TransactionFrame : public TransactionFrameBase
 
     Hash const& getFullHash() const override;
     Hash const& getContentsHash() const override;
+    void precomputeHashesAndSize() const override;
 
     std::vector<std::shared_ptr<OperationFrame>> const&
     getOperations() const
@@ -204,6 +208,8 @@ class TransactionFrame : public TransactionFrameBase
         return getResult().result.code();
     }
 
+    void setReplayResult(TransactionResult const& result) override;
+
     void resetResults(LedgerHeader const& header,
                       std::optional<int64_t> baseFee, bool applying);
 
@@ -60,6 +60,10 @@ class TransactionFrameBase
 
     virtual Hash const& getContentsHash() const = 0;
     virtual Hash const& getFullHash() const = 0;
+    // Computes the hashes and the XDR size of the transaction, which are
+    // otherwise computed lazily on first use. Afterwards they can be read
+    // concurrently from several threads.
+    virtual void precomputeHashesAndSize() const = 0;
 
     virtual uint32_t getNumOperations() const = 0;
     virtual Resource getResources(bool useByteLimitInClassic) const = 0;
@@ -68,6 +72,12 @@ class TransactionFrameBase
 
     virtual TransactionResult& getResult() = 0;
     virtual TransactionResultCode getResultCode() const = 0;
+    // Sets the result the transaction is known to have produced, from
+    // verified history. It is used by the next `apply` only: a transaction
+    // known to have succeeded or failed after validation doesn't have its
+    // signatures checked again, and the operations of a failed one are not
+    // applied.
+    virtual void setReplayResult(TransactionResult const& result) = 0;
 
     virtual SequenceNumber getSeqNum() const = 0;
     virtual AccountID getFeeSourceID() const = 0;
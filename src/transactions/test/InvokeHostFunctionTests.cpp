@@ -18,6 +18,8 @@
 #include "main/Application.h"
 #include "main/CommandHandler.h"
 #include "main/SettingsUpgradeUtils.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 #include "rust/RustBridge.h"
 #include "test/TestAccount.h"
 #include "test/TestUtils.h"
@@ -1401,6 +1403,55 @@ TEST_CASE("failure diagnostics", "[tx][soroban]")
     REQUIRE(cpuInsnEvBody.data.u64() >= 1000);
 }
 
+TEST_CASE("failed transactions replayed with known results",
+          "[tx][soroban][catchup]")
+{
+    auto cfg = getTestConfig();
+    cfg.ENABLE_SOROBAN_DIAGNOSTIC_EVENTS = true;
+    cfg.EMIT_SOROBAN_TRANSACTION_META_EXT_V1 = true;
+    SorobanTest test(cfg);
+    auto& app = test.getApp();
+    auto& addContract =
+        test.deployWasmContract(rust_bridge::get_test_wasm_add_i32());
+
+    // Overflows, so the transaction fails with diagnostic events
+    auto tx =
+        addContract
+            .prepareInvocation("add", {makeI32(7), makeI32(INT32_MAX)},
+                               SorobanInvocationSpec()
+                                   .setInstructions(2'000'000)
+                                   .setReadBytes(2000))
+            .createTx();
+    auto replayed =
+        TransactionFrameBase::makeTransactionFromWire(app.getNetworkID(),
+                                                      tx->getEnvelope());
+
+    auto apply = [&](TransactionFrameBasePtr const& frame,
+                     TransactionMetaFrame& meta) {
+        // Rolled back, so that both frames apply to the same state
+        LedgerTxn ltx(app.getLedgerTxnRoot());
+        REQUIRE(frame->checkValid(app, ltx, 0, 0, 0));
+        REQUIRE(!frame->apply(app, ltx, meta));
+    };
+
+    TransactionMetaFrame meta(test.getLedgerVersion());
+    apply(tx, meta);
+    REQUIRE(tx->getResult().result.code() == txFAILED);
+
+    auto& knownFailed = app.getMetrics().NewMeter(
+        {"ledger", "transaction", "replay-known-failed"}, "transaction");
+    auto knownFailedBefore = knownFailed.count();
+
+    // Failed Soroban transactions are applied again, as their failure emits
+    // meta
+    replayed->setReplayResult(tx->getResult());
+    TransactionMetaFrame replayedMeta(test.getLedgerVersion());
+    apply(replayed, replayedMeta);
+    REQUIRE(knownFailed.count() == knownFailedBefore);
+    REQUIRE(replayed->getResult() == tx->getResult());
+    REQUIRE(replayedMeta.getXDR() == meta.getXDR());
+}
+
 TEST_CASE("transaction validation diagnostics", "[tx][soroban]")
 {
     auto cfg = getTestConfig();
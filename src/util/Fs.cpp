@@ -37,6 +37,7 @@
 #endif
 
 #include <cstdio>
+#include <cstring>
 
 namespace stellar
 {
@@ -105,6 +106,21 @@ flushFileChanges(native_handle_t fh)
     }
 }
 
+void
+flushFileChanges(std::string const& path)
+{
+    ZoneScoped;
+    HANDLE h = openFileToWrite(path);
+    BOOL flushed = FlushFileBuffers(h);
+    CloseHandle(h);
+    if (flushed == FALSE)
+    {
+        FileSystemException::failWithGetLastError(
+            std::string("fs::flushFileChanges() failed on \"") + path +
+            "\": ");
+    }
+}
+
 native_handle_t
 openFileToWrite(std::string const& path)
 {
@@ -113,7 +129,7 @@ openFileToWrite(std::string const& path)
                             GENERIC_READ | GENERIC_WRITE,       // DesiredAccess
                             FILE_SHARE_READ | FILE_SHARE_WRITE, // ShareMode
                             NULL,                  // SecurityAttributes
-                            CREATE_ALWAYS,         // CreationDisposition
+                            OPEN_ALWAYS,           // CreationDisposition
                             FILE_ATTRIBUTE_NORMAL, // FlagsAndAttributes
                             NULL);                 // TemplateFile
 
@@ -148,12 +164,18 @@ fdOpen(native_handle_t h)
     return res;
 }
 
+void
+flushDirectoryChanges(std::string const& dir)
+{
+}
+
 bool
 durableRename(std::string const& src, std::string const& dst,
               std::string const& dir)
 {
     ZoneScoped;
-    if (MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_WRITE_THROUGH) == 0)
+    if (MoveFileExA(src.c_str(), dst.c_str(),
+                    MOVEFILE_WRITE_THROUGH | MOVEFILE_REPLACE_EXISTING) == 0)
     {
         FileSystemException::failWithGetLastError(
             "fs::durableRename() failed on MoveFileExA(): ");
@@ -234,6 +256,23 @@ flushFileChanges(native_handle_t fd)
     }
 }
 
+void
+flushFileChanges(std::string const& path)
+{
+    ZoneScoped;
+    int fd = openFileToWrite(path);
+    try
+    {
+        flushFileChanges(fd);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
+
 native_handle_t
 openFileToWrite(std::string const& path)
 {
@@ -261,6 +300,14 @@ durableRename(std::string const& src, std::string const& dst,
     {
         return false;
     }
+    flushDirectoryChanges(dir);
+    return true;
+}
+
+void
+flushDirectoryChanges(std::string const& dir)
+{
+    ZoneScoped;
     int dfd;
     while ((dfd = open(dir.c_str(), O_RDONLY)) == -1)
     {
@@ -289,7 +336,6 @@ durableRename(std::string const& src, std::string const& dst,
         FileSystemException::failWithErrno(
             std::string("Failed to close directory ") + dir + " :");
     }
-    return true;
 }
 #endif
 
@@ -426,6 +472,103 @@ size(std::string const& filename)
     return stdfs::file_size(stdfs::path(filename));
 }
 
+#ifdef __linux__
+namespace
+{
+class FdCloser
+{
+    int const mFd;
+
+  public:
+    explicit FdCloser(int fd) : mFd(fd)
+    {
+    }
+    ~FdCloser()
+    {
+        if (mFd >= 0)
+        {
+            ::close(mFd);
+        }
+    }
+};
+
+// Returns false if the kernel can't copy between these files, in which case
+// the caller should copy them itself.
+bool
+copyFileInKernel(std::string const& src, std::string const& dst)
+{
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+    {
+        throw FileSystemException(fmt::format(
+            FMT_STRING("Error opening {}: {}"), src, std::strerror(errno)));
+    }
+    FdCloser closeIn(in);
+    struct stat st;
+    if (::fstat(in, &st) != 0)
+    {
+        throw FileSystemException(fmt::format(
+            FMT_STRING("Error reading {}: {}"), src, std::strerror(errno)));
+    }
+    int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                     st.st_mode & 0777);
+    if (out < 0)
+    {
+        throw FileSystemException(fmt::format(
+            FMT_STRING("Error opening {}: {}"), dst, std::strerror(errno)));
+    }
+    FdCloser closeOut(out);
+
+    // copy_file_range shares the data blocks (reflinks) on filesystems that
+    // support it, and otherwise copies them without going through userspace
+    auto remaining = st.st_size;
+    while (remaining > 0)
+    {
+        auto n = ::copy_file_range(in, nullptr, out, nullptr,
+                                   static_cast<size_t>(remaining), 0);
+        if (n < 0)
+        {
+            if (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                errno == EOPNOTSUPP)
+            {
+                return false;
+            }
+            throw FileSystemException(fmt::format(
+                FMT_STRING("Error copying {} to {}: {}"), src, dst,
+                std::strerror(errno)));
+        }
+        if (n == 0)
+        {
+            // The file was truncated while being copied
+            break;
+        }
+        remaining -= n;
+    }
+    return true;
+}
+}
+#endif
+
+void
+copyFile(std::string const& src, std::string const& dst)
+{
+    ZoneScoped;
+#ifdef __linux__
+    if (copyFileInKernel(src, dst))
+    {
+        return;
+    }
+#endif
+    std::error_code ec;
+    stdfs::copy_file(src, dst, stdfs::copy_options::overwrite_existing, ec);
+    if (ec)
+    {
+        throw FileSystemException(
+            fmt::format(FMT_STRING("Error copying {} to {}: {}"), src, dst,
+                        ec.message()));
+    }
+}
+
 #ifdef _WIN32
 
 int64_t
@@ -47,15 +47,24 @@ void unlockFile(std::string const& path);
 // Call fsync() on POSIX or FlushFileBuffers() on Win32.
 void flushFileChanges(native_handle_t h);
 
-// Open a native handle (fd or HANDLE) for writing.
+// Same as above, for a file that isn't open.
+void flushFileChanges(std::string const& path);
+
+// Open a native handle (fd or HANDLE) for appending, creating the file if it
+// doesn't exist.
 native_handle_t openFileToWrite(std::string const& path);
 
 // creates a FILE* based off h - caller is responsible for closing it
 FILE* fdOpen(native_handle_t h);
 
+// On POSIX, open dir and fsync() it, so that files created in it survive a
+// crash. Does nothing on Win32, where directory entries are journaled.
+void flushDirectoryChanges(std::string const& dir);
+
 // On POSIX, do rename(src, dst) then open dir and fsync() it
 // too: a necessary second step for ensuring durability.
-// On Win32, do MoveFileExA with MOVEFILE_WRITE_THROUGH.
+// On Win32, do MoveFileExA with MOVEFILE_WRITE_THROUGH and
+// MOVEFILE_REPLACE_EXISTING, so that dst is replaced as on POSIX.
 bool durableRename(std::string const& src, std::string const& dst,
                    std::string const& dir);
 
@@ -83,6 +92,11 @@ size_t size(std::ifstream& ifs);
 
 size_t size(std::string const& path);
 
+// Copy `src` to `dst`, replacing it. On Linux, the copy is made by the kernel
+// (sharing the data blocks on filesystems that support it). Throws
+// FileSystemException on failure.
+void copyFile(std::string const& src, std::string const& dst);
+
 ////
 // Utility functions for constructing path names
 ////
@@ -0,0 +1,247 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Gzip.h"
+#include "crypto/ByteSlice.h"
+#include "crypto/SHA.h"
+#include "util/Fs.h"
+
+#include <Tracy.hpp>
+#include <fmt/format.h>
+#include <zlib.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace stellar
+{
+
+namespace
+{
+// Adding 16 to the window bits selects the gzip wrapper instead of the zlib
+// one.
+int const GZIP_WINDOW_BITS = 15 + 16;
+
+class InputFile
+{
+    std::string const& mName;
+    std::ifstream mIn;
+
+  public:
+    explicit InputFile(std::string const& name)
+        : mName(name), mIn(name, std::ifstream::binary)
+    {
+        if (!mIn)
+        {
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Error opening file {}"), name));
+        }
+    }
+
+    // Returns the number of bytes read, 0 at the end of the file.
+    size_t
+    read(std::vector<unsigned char>& buf)
+    {
+        mIn.read(reinterpret_cast<char*>(buf.data()), buf.size());
+        if (mIn.bad())
+        {
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Error reading file {}"), mName));
+        }
+        return static_cast<size_t>(mIn.gcount());
+    }
+};
+
+// Removes the output file unless `commit` is called, so that no partial
+// output is left behind on failure.
+class OutputFile
+{
+    std::string const& mName;
+    std::ofstream mOut;
+    bool mCommitted{false};
+
+  public:
+    explicit OutputFile(std::string const& name)
+        : mName(name), mOut(name, std::ofstream::binary | std::ofstream::trunc)
+    {
+        if (!mOut)
+        {
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Error opening file {}"), name));
+        }
+    }
+
+    ~OutputFile()
+    {
+        if (!mCommitted)
+        {
+            mOut.close();
+            std::remove(mName.c_str());
+        }
+    }
+
+    void
+    write(unsigned char const* data, size_t size)
+    {
+        mOut.write(reinterpret_cast<char const*>(data), size);
+        if (!mOut)
+        {
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Error writing file {}"), mName));
+        }
+    }
+
+    void
+    commit()
+    {
+        mOut.close();
+        if (!mOut)
+        {
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Error closing file {}"), mName));
+        }
+        mCommitted = true;
+    }
+};
+
+class ZStream
+{
+    bool const mDeflate;
+
+  public:
+    z_stream mStream{};
+
+    explicit ZStream(bool deflate) : mDeflate(deflate)
+    {
+        int res = mDeflate ? deflateInit2(&mStream, Z_DEFAULT_COMPRESSION,
+                                          Z_DEFLATED, GZIP_WINDOW_BITS, 8,
+                                          Z_DEFAULT_STRATEGY)
+                           : inflateInit2(&mStream, GZIP_WINDOW_BITS);
+        if (res != Z_OK)
+        {
+            throw std::runtime_error("Could not initialize zlib");
+        }
+    }
+
+    ~ZStream()
+    {
+        if (mDeflate)
+        {
+            deflateEnd(&mStream);
+        }
+        else
+        {
+            inflateEnd(&mStream);
+        }
+    }
+};
+}
+
+void
+gzipFile(std::string const& src, std::string const& dst)
+{
+    ZoneScoped;
+    InputFile in(src);
+    OutputFile out(dst);
+    ZStream zs(/* deflate */ true);
+    std::vector<unsigned char> inBuf(fs::bufsz());
+    std::vector<unsigned char> outBuf(fs::bufsz());
+
+    int res = Z_OK;
+    while (res != Z_STREAM_END)
+    {
+        auto n = in.read(inBuf);
+        int flush = n == 0 ? Z_FINISH : Z_NO_FLUSH;
+        zs.mStream.next_in = inBuf.data();
+        zs.mStream.avail_in = static_cast<uInt>(n);
+        do
+        {
+            zs.mStream.next_out = outBuf.data();
+            zs.mStream.avail_out = static_cast<uInt>(outBuf.size());
+            res = deflate(&zs.mStream, flush);
+            if (res == Z_STREAM_ERROR)
+            {
+                throw std::runtime_error(fmt::format(
+                    FMT_STRING("Error compressing file {}"), src));
+            }
+            out.write(outBuf.data(), outBuf.size() - zs.mStream.avail_out);
+        } while (zs.mStream.avail_out == 0);
+    }
+    out.commit();
+}
+
+void
+gunzipFile(std::string const& src, std::string const& dst, SHA256* hasher,
+           std::chrono::nanoseconds* hashDuration)
+{
+    ZoneScoped;
+    InputFile in(src);
+    OutputFile out(dst);
+    ZStream zs(/* deflate */ false);
+    std::vector<unsigned char> inBuf(fs::bufsz());
+    std::vector<unsigned char> outBuf(fs::bufsz());
+
+    // Like `gzip -d`, accept several concatenated gzip members
+    bool sawMember = false;
+    bool inMember = false;
+    while (true)
+    {
+        if (zs.mStream.avail_in == 0)
+        {
+            auto n = in.read(inBuf);
+            if (n == 0)
+            {
+                break;
+            }
+            zs.mStream.next_in = inBuf.data();
+            zs.mStream.avail_in = static_cast<uInt>(n);
+        }
+
+        zs.mStream.next_out = outBuf.data();
+        zs.mStream.avail_out = static_cast<uInt>(outBuf.size());
+        auto availIn = zs.mStream.avail_in;
+        int res = inflate(&zs.mStream, Z_NO_FLUSH);
+        auto produced = outBuf.size() - zs.mStream.avail_out;
+        if ((res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR) ||
+            (res == Z_BUF_ERROR && produced == 0 &&
+             zs.mStream.avail_in == availIn))
+        {
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Error decompressing file {}: {}"), src,
+                            zs.mStream.msg ? zs.mStream.msg : "corrupt data"));
+        }
+
+        out.write(outBuf.data(), produced);
+        if (hasher)
+        {
+            auto hashStart = std::chrono::steady_clock::now();
+            hasher->add(ByteSlice(outBuf.data(), produced));
+            if (hashDuration)
+            {
+                *hashDuration += std::chrono::steady_clock::now() - hashStart;
+            }
+        }
+
+        if (res == Z_STREAM_END)
+        {
+            sawMember = true;
+            inMember = false;
+            inflateReset(&zs.mStream);
+        }
+        else
+        {
+            inMember = true;
+        }
+    }
+
+    if (!sawMember || inMember)
+    {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("Truncated gzip file {}"), src));
+    }
+    out.commit();
+}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <chrono>
+#include <string>
+
+namespace stellar
+{
+
+class SHA256;
+
+// Streaming gzip compression and decompression of files, producing and
+// accepting the same format as the `gzip` tool. Both functions throw
+// std::runtime_error if a file can't be read or written or if the input is
+// not valid gzip; in that case the (partial) output file is removed.
+
+// Compresses `src` into `dst`.
+void gzipFile(std::string const& src, std::string const& dst);
+
+// Decompresses `src` into `dst`. If `hasher` is not null, the decompressed
+// bytes are also added to it as they are written, so that the output can be
+// verified without reading it again; the time spent hashing is then added to
+// `hashDuration` if it is not null.
+void gunzipFile(std::string const& src, std::string const& dst,
+                SHA256* hasher = nullptr,
+                std::chrono::nanoseconds* hashDuration = nullptr);
+}
@@ -56,6 +56,10 @@ class RandomEvictionCache : public NonMovableOrCopyable
     // Each cache keeps some counters just to monitor its performance.
     Counters mCounters;
 
+    // Engine picking the entries to evict; gRandomEngine unless the cache is
+    // used from several threads.
+    stellar_default_random_engine& mRandomEngine;
+
     // Randomly pick two elements and evict the less-recently-used one.
     void
     evictOne()
@@ -65,8 +69,10 @@ class RandomEvictionCache : public NonMovableOrCopyable
         {
             return;
         }
-        MapValueType*& vp1 = mValuePtrs.at(rand_uniform<size_t>(0, sz - 1));
-        MapValueType*& vp2 = mValuePtrs.at(rand_uniform<size_t>(0, sz - 1));
+        MapValueType*& vp1 =
+            mValuePtrs.at(rand_uniform<size_t>(0, sz - 1, mRandomEngine));
+        MapValueType*& vp2 =
+            mValuePtrs.at(rand_uniform<size_t>(0, sz - 1, mRandomEngine));
         MapValueType*& victim =
             (vp1->second.mLastAccess < vp2->second.mLastAccess ? vp1 : vp2);
         mValueMap.erase(victim->first);
@@ -76,7 +82,15 @@ class RandomEvictionCache : public NonMovableOrCopyable
     }
 
   public:
-    explicit RandomEvictionCache(size_t maxSize) : mMaxSize(maxSize)
+    explicit RandomEvictionCache(size_t maxSize)
+        : RandomEvictionCache(maxSize, gRandomEngine)
+    {
+    }
+
+    // gRandomEngine is not thread-safe: caches accessed from background
+    // threads (under their own lock) must use an engine of their own.
+    RandomEvictionCache(size_t maxSize, stellar_default_random_engine& engine)
+        : mMaxSize(maxSize), mRandomEngine(engine)
     {
         mValueMap.reserve(maxSize + 1);
         mValuePtrs.reserve(maxSize + 1);
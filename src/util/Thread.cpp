@@ -8,6 +8,7 @@
 #ifdef _WIN32
 #include <Windows.h>
 #else
+#include <time.h>
 #include <unistd.h>
 #endif
 #if defined(__APPLE__)
@@ -116,4 +117,33 @@ runCurrentThreadWithMediumPriority()
 }
 
 #endif
+
+std::chrono::nanoseconds
+threadCpuTime()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!::GetThreadTimes(::GetCurrentThread(), &creation, &exit, &kernel,
+                          &user))
+    {
+        return std::chrono::nanoseconds::zero();
+    }
+    // Both times are in units of 100ns
+    auto toNs = [](FILETIME const& t) {
+        ULARGE_INTEGER v;
+        v.LowPart = t.dwLowDateTime;
+        v.HighPart = t.dwHighDateTime;
+        return std::chrono::nanoseconds(v.QuadPart * 100);
+    };
+    return toNs(kernel) + toNs(user);
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    {
+        return std::chrono::nanoseconds::zero();
+    }
+    return std::chrono::seconds(ts.tv_sec) +
+           std::chrono::nanoseconds(ts.tv_nsec);
+#endif
+}
 }
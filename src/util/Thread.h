@@ -14,6 +14,10 @@ namespace stellar
 void runCurrentThreadWithLowPriority();
 void runCurrentThreadWithMediumPriority();
 
+// CPU time used so far by the calling thread, unlike `std::clock` which
+// accounts for all the threads of the process.
+std::chrono::nanoseconds threadCpuTime();
+
 template <typename T>
 bool
 futureIsReady(std::future<T> const& fut)
@@ -151,6 +151,26 @@ TEST_CASE("RandomEvictionCache does not thrash",
     REQUIRE(ctrs.mEvicts < 11);
 }
 
+TEST_CASE("RandomEvictionCache evicts with its own random engine",
+          "[randomevictioncache]")
+{
+    // Caches shared with background threads, like the signature verification
+    // cache, must not draw from gRandomEngine
+    auto globalEngine = gRandomEngine;
+    stellar_default_random_engine engine;
+    auto initialEngine = engine;
+    size_t sz = 100;
+    RandomEvictionCache<size_t, size_t> cache(sz, engine);
+    for (size_t i = 0; i < 2 * sz; ++i)
+    {
+        cache.put(i, i);
+    }
+    REQUIRE(cache.getCounters().mEvicts == sz);
+    REQUIRE(cache.size() == sz);
+    REQUIRE(gRandomEngine == globalEngine);
+    REQUIRE(!(engine == initialEngine));
+}
+
 using RandCache = RandomEvictionCache<int, int>;
 
 TEMPLATE_TEST_CASE("cache empty", "[cache][template]", RandCache)
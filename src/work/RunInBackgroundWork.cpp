@@ -0,0 +1,108 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "work/RunInBackgroundWork.h"
+#include "main/Application.h"
+#include "util/Logging.h"
+#include "util/Thread.h"
+#include <Tracy.hpp>
+
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+namespace stellar
+{
+
+RunInBackgroundWork::RunInBackgroundWork(Application& app,
+                                         std::string const& name,
+                                         std::string const& kind,
+                                         size_t maxRetries)
+    : BasicWork(app, name, maxRetries)
+    , mCpuTime(app.getMetrics().NewTimer({"work", kind, "cpu-time"}))
+{
+}
+
+BasicWork::State
+RunInBackgroundWork::onRun()
+{
+    ZoneScoped;
+    if (mDone)
+    {
+        return mFailed ? State::WORK_FAILURE : State::WORK_SUCCESS;
+    }
+    if (mRunning)
+    {
+        return State::WORK_WAITING;
+    }
+
+    auto job = getJob();
+    auto name = getName();
+    std::weak_ptr<RunInBackgroundWork> weak(
+        std::static_pointer_cast<RunInBackgroundWork>(shared_from_this()));
+    Application& app = mApp;
+    medida::Timer& cpuTime = mCpuTime;
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    mCancelled = cancelled;
+    mRunning = true;
+    app.postOnBackgroundThread(
+        [&app, &cpuTime, job, name, weak, cancelled]() {
+            bool ran = false;
+            bool failed = false;
+            if (!*cancelled)
+            {
+                ran = true;
+                auto start = threadCpuTime();
+                try
+                {
+                    job();
+                }
+                catch (std::exception const& e)
+                {
+                    CLOG_WARNING(Work, "{} failed: {}", name, e.what());
+                    failed = true;
+                }
+                cpuTime.Update(threadCpuTime() - start);
+            }
+
+            // BasicWork's state is not thread-safe, so it is only updated on
+            // the main thread
+            app.postOnMainThread(
+                [weak, ran, failed]() {
+                    auto self = weak.lock();
+                    if (self)
+                    {
+                        self->mRunning = false;
+                        self->mFailed = failed;
+                        self->mDone = ran;
+                        if (!self->isAborting())
+                        {
+                            self->wakeUp();
+                        }
+                    }
+                },
+                "RunInBackgroundWork: finish");
+        },
+        "RunInBackgroundWork: start");
+    return State::WORK_WAITING;
+}
+
+void
+RunInBackgroundWork::onReset()
+{
+    mDone = false;
+    mFailed = false;
+}
+
+bool
+RunInBackgroundWork::onAbort()
+{
+    // The job can't be interrupted once started, wait for it to finish so
+    // that it doesn't race with a reset
+    if (mCancelled)
+    {
+        *mCancelled = true;
+    }
+    return !mRunning;
+}
+}
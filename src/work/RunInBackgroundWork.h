@@ -0,0 +1,55 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "work/Work.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace medida
+{
+class Timer;
+}
+
+namespace stellar
+{
+
+/**
+ * This class helps run a blocking job, such as compressing a file or hashing a
+ * bucket, on the background worker threads instead of the main thread. The job
+ * is built on the main thread by `getJob` and must not refer to the work
+ * itself; it signals failure by throwing. Results can be handed back through
+ * state shared between the job and the work, and used in `onSuccess`, which
+ * runs on the main thread. The work is not scheduled while the job runs, and
+ * wakes up when it's done.
+ *
+ * Failed jobs are retried like any work, after `onReset`. Aborting the work
+ * skips its job if it hasn't started yet, and otherwise waits for it to finish.
+ *
+ * The CPU time of jobs is recorded in the `work.<kind>.cpu-time` timer.
+ */
+class RunInBackgroundWork : public BasicWork
+{
+    bool mRunning{false};
+    bool mDone{false};
+    bool mFailed{false};
+    std::shared_ptr<std::atomic<bool>> mCancelled;
+    medida::Timer& mCpuTime;
+    virtual std::function<void()> getJob() = 0;
+
+  public:
+    RunInBackgroundWork(Application& app, std::string const& name,
+                        std::string const& kind,
+                        size_t maxRetries = BasicWork::RETRY_A_FEW);
+    ~RunInBackgroundWork() = default;
+
+  protected:
+    void onReset() override;
+    BasicWork::State onRun() override;
+    bool onAbort() override;
+};
+}
@@ -13,6 +13,10 @@
 #include "historywork/RunCommandWork.h"
 #include "work/BatchWork.h"
 #include "work/ConditionalWork.h"
+#include "work/RunInBackgroundWork.h"
+
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
 #include <thread>
 
@@ -645,6 +649,95 @@ TEST_CASE("RunCommandWork test", "[work]")
     }
 }
 
+class TestRunInBackgroundWork : public RunInBackgroundWork
+{
+    std::shared_ptr<std::atomic<size_t>> mRuns;
+    size_t const mFailures;
+
+    std::function<void()>
+    getJob() override
+    {
+        return [runs = mRuns, failures = mFailures]() {
+            if (++*runs <= failures)
+            {
+                throw std::runtime_error("test failure");
+            }
+        };
+    }
+
+  public:
+    size_t mSuccessCount{0};
+
+    TestRunInBackgroundWork(Application& app, std::string name,
+                            size_t failures, size_t retries)
+        : RunInBackgroundWork(app, std::move(name), "test", retries)
+        , mRuns(std::make_shared<std::atomic<size_t>>(0))
+        , mFailures(failures)
+    {
+    }
+
+    size_t
+    getRuns() const
+    {
+        return *mRuns;
+    }
+
+  protected:
+    void
+    onSuccess() override
+    {
+        ++mSuccessCount;
+    }
+};
+
+TEST_CASE("RunInBackgroundWork test", "[work]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer appPtr = createTestApplication(clock, cfg);
+    auto& wm = appPtr->getWorkScheduler();
+
+    SECTION("job succeeds")
+    {
+        auto w = wm.scheduleWork<TestRunInBackgroundWork>(
+            "test-background", 0, BasicWork::RETRY_NEVER);
+        while (!wm.allChildrenDone())
+        {
+            clock.crank();
+        }
+        REQUIRE(w->getState() == BasicWork::State::WORK_SUCCESS);
+        REQUIRE(w->getRuns() == 1);
+        REQUIRE(w->mSuccessCount == 1);
+        REQUIRE(appPtr->getMetrics()
+                    .NewTimer({"work", "test", "cpu-time"})
+                    .count() == 1);
+    }
+    SECTION("failed job is retried")
+    {
+        auto w = wm.scheduleWork<TestRunInBackgroundWork>(
+            "test-background", 1, BasicWork::RETRY_ONCE);
+        while (!wm.allChildrenDone())
+        {
+            clock.crank();
+        }
+        REQUIRE(w->getState() == BasicWork::State::WORK_SUCCESS);
+        REQUIRE(w->getRuns() == 2);
+        REQUIRE(w->mSuccessCount == 1);
+    }
+    SECTION("job fails after retries")
+    {
+        auto w = wm.scheduleWork<TestRunInBackgroundWork>(
+            "test-background", 2, BasicWork::RETRY_ONCE);
+        while (!wm.allChildrenDone())
+        {
+            clock.crank();
+        }
+        REQUIRE(w->getState() == BasicWork::State::WORK_FAILURE);
+        REQUIRE(w->getRuns() == 2);
+        REQUIRE(w->mSuccessCount == 0);
+    }
+}
+
 // ======= WorkSequence tests ======== //
 TEST_CASE("WorkSequence test", "[work]")
 {